@@ -0,0 +1,100 @@
+#pragma once
+#include <stdint.h>
+#include <atomic>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <vector>
+#include "WorkerPool.h"
+
+// Handed to an enumeration so it can stop early once a newer request has superseded it.
+class EnumCancel {
+public:
+    EnumCancel() = default;     // never cancelled; for synchronous callers
+    EnumCancel(const std::atomic<uint64_t>* latest, uint64_t request) : m_latest(latest), m_request(request) {}
+    bool Cancelled() const { return m_latest && m_latest->load(std::memory_order_relaxed) != m_request; }
+private:
+    const std::atomic<uint64_t>* m_latest = nullptr;
+    uint64_t m_request = 0;
+};
+
+// A list (devices, sessions) that is enumerated on a WorkerPool and published as an
+// immutable snapshot. Refresh() and Current() never wait for an enumeration: the UI
+// asks for a refresh, keeps showing the snapshot it has, and swaps in the new one
+// when the published callback (called on the worker) tells it to. Each Refresh()
+// supersedes the ones before it; superseded runs are skipped or stopped through
+// EnumCancel and never published. Enumerations of one list run one at a time.
+template<typename T>
+class AsyncList {
+public:
+    typedef std::vector<T> Items;
+    typedef std::shared_ptr<const Items> Snapshot;
+    // Fills out; returns false to discard the result (failure or cancellation).
+    typedef std::function<bool(Items& out, const EnumCancel& cancel)> Enumerate;
+
+    AsyncList(WorkerPool& pool, Enumerate enumerate, std::function<void()> published = nullptr)
+        : m_pool(pool), m_state(std::make_shared<State>()) {
+        m_state->enumerate = std::move(enumerate);
+        m_state->published = std::move(published);
+        m_state->snapshot = std::make_shared<const Items>();
+    }
+    ~AsyncList() { Cancel(); }
+    AsyncList(const AsyncList&) = delete;
+    AsyncList& operator=(const AsyncList&) = delete;
+
+    // Queues an enumeration; returns its request number.
+    uint64_t Refresh() {
+        uint64_t request = ++m_state->latest;
+        std::shared_ptr<State> state = m_state;     // keeps the state alive for a run that outlives the list
+        m_pool.Submit([state, request] { Run(*state, request); });
+        return request;
+    }
+    // Supersedes any outstanding request without starting a new one.
+    void Cancel() { ++m_state->latest; }
+
+    // The latest published snapshot; empty until the first enumeration completes.
+    Snapshot Current() const {
+        std::lock_guard<std::mutex> lock(m_state->snapshotMutex);
+        return m_state->snapshot;
+    }
+    // Request number of Current(), 0 before the first publication.
+    uint64_t PublishedRequest() const {
+        std::lock_guard<std::mutex> lock(m_state->snapshotMutex);
+        return m_state->publishedRequest;
+    }
+    uint64_t DiscardedRuns() const { return m_state->discardedRuns.load(); }
+private:
+    struct State {
+        Enumerate enumerate;
+        std::function<void()> published;
+        std::atomic<uint64_t> latest{0};
+        std::atomic<uint64_t> discardedRuns{0};
+        std::mutex runMutex;
+        mutable std::mutex snapshotMutex;   // held only to copy or swap the pointer
+        Snapshot snapshot;
+        uint64_t publishedRequest = 0;
+    };
+
+    static void Run(State& state, uint64_t request) {
+        std::lock_guard<std::mutex> run(state.runMutex);
+        EnumCancel cancel(&state.latest, request);
+        std::shared_ptr<Items> items;
+        if (!cancel.Cancelled()) {
+            items = std::make_shared<Items>();
+            if (!state.enumerate(*items, cancel)) items.reset();
+        }
+        if (!items || cancel.Cancelled()) {
+            ++state.discardedRuns;
+            return;
+        }
+        {
+            std::lock_guard<std::mutex> lock(state.snapshotMutex);
+            state.snapshot = std::move(items);
+            state.publishedRequest = request;
+        }
+        if (state.published) state.published();
+    }
+
+    WorkerPool& m_pool;
+    std::shared_ptr<State> m_state;
+};
@@ -0,0 +1,155 @@
+#include "AudioExecutor.h"
+#include <future>
+#include "LatencyStats.h"
+#include "log.h"
+
+const int AudioExecutor::kMaxTargets;
+
+AudioExecutor::AudioExecutor(VolumeRamp& ramp, std::function<void()> threadInit, std::function<void()> threadExit)
+    : m_ramp(ramp), m_threadInit(std::move(threadInit)), m_threadExit(std::move(threadExit)) {
+}
+
+AudioExecutor::~AudioExecutor() {
+    Stop();
+}
+
+void AudioExecutor::Start() {
+    if (m_running) return;
+    m_stop = false;
+    m_ramp.SetPaced(true);
+    m_thread = std::thread([this] { Run(); });
+    m_threadId = m_thread.get_id();
+    m_running = true;
+}
+
+void AudioExecutor::Stop() {
+    if (!m_running) return;
+    m_stop = true;
+    m_wake.Set();
+    m_thread.join();
+    m_running = false;
+    m_ramp.SetPaced(false);
+    // Work posted while the thread was winding down runs here.
+    RunTasks();
+}
+
+void AudioExecutor::Invoke(const std::function<void()>& task) {
+    if (!m_running || std::this_thread::get_id() == m_threadId) {
+        task();
+        return;
+    }
+    std::promise<void> done;
+    Post([&] {
+        task();
+        done.set_value();
+    });
+    done.get_future().wait();
+}
+
+void AudioExecutor::Post(std::function<void()> task) {
+    if (!m_running) {
+        task();
+        return;
+    }
+    {
+        std::lock_guard<std::mutex> lock(m_taskMutex);
+        m_tasks.push_back(std::move(task));
+    }
+    m_wake.Set();
+}
+
+void AudioExecutor::SetVolume(int target, float v) {
+    if (target < 0 || target >= kMaxTargets) {
+        STAT_COUNT(StatCounter::WritesDropped);
+        if (!m_rejected.exchange(true, std::memory_order_relaxed))
+            LOG_ERROR("Audio executor: target %d is beyond its %d slots, writes dropped", target, kMaxTargets);
+        return;
+    }
+    if (!m_running) {
+        m_ramp.SetVolume(target, v);
+        return;
+    }
+    m_commands.fetch_add(1, std::memory_order_relaxed);
+    Slot& slot = m_slots[target];
+    slot.value.store(v, std::memory_order_release);
+    // Already queued: the executor will read the value just stored.
+    if (slot.queued.exchange(true, std::memory_order_acq_rel)) {
+        m_collapsed.fetch_add(1, std::memory_order_relaxed);
+        return;
+    }
+    m_queue.Push((uint16_t)target);     // cannot fail: each target is queued at most once
+    // Pairs with the exchange in Run(): either the executor sees the command before it
+    // sleeps, or this thread sees it sleeping and wakes it.
+    if (m_sleeping.exchange(false, std::memory_order_acq_rel)) {
+        m_wakeups.fetch_add(1, std::memory_order_relaxed);
+        m_wake.Set();
+    }
+}
+
+uint32_t AudioExecutor::Flush(bool force) {
+    if (!m_running) return m_ramp.Flush(force);
+    if (force) {
+        m_land = true;
+        m_wake.Set();
+    }
+    // The executor paces itself; nothing is held back on this side.
+    return kNoPendingWrites;
+}
+
+void AudioExecutor::Drain() {
+    uint16_t target;
+    while (m_queue.Pop(target)) {
+        Slot& slot = m_slots[target];
+        // Clear before reading, so a value stored after the read queues the target again.
+        slot.queued.store(false, std::memory_order_seq_cst);
+        m_ramp.SetVolume(target, slot.value.load(std::memory_order_acquire));
+    }
+}
+
+bool AudioExecutor::RunTasks() {
+    bool ran = false;
+    for (;;) {
+        std::function<void()> task;
+        {
+            std::lock_guard<std::mutex> lock(m_taskMutex);
+            if (m_tasks.empty()) return ran;
+            task = std::move(m_tasks.front());
+            m_tasks.pop_front();
+        }
+        // Commands sent before the task was posted are visible now; apply them first.
+        Drain();
+        task();
+        ran = true;
+    }
+}
+
+void AudioExecutor::Run() {
+    if (m_threadInit) m_threadInit();
+    HighResTimer timer;
+    VolumeRamp::Clock::time_point next = VolumeRamp::Clock::now();
+    while (!m_stop) {
+        Drain();
+        RunTasks();
+        if (m_land.exchange(false)) {
+            Drain();
+            m_ramp.Flush(true);
+        }
+        if (m_ramp.Step()) {
+            next += m_ramp.Period();
+            VolumeRamp::Clock::time_point now = VolumeRamp::Clock::now();
+            if (next < now) next = now;     // fell behind (slow write): do not burst to catch up
+            timer.SleepUntil(next);
+            continue;
+        }
+        // At rest: sleep until a command or a task arrives; the next step goes out immediately.
+        m_sleeping.exchange(true, std::memory_order_acq_rel);
+        if (m_queue.Empty() && !m_stop && !m_land)
+            m_wake.Wait(WakeEvent::kInfinite);
+        m_sleeping.store(false, std::memory_order_relaxed);
+        next = VolumeRamp::Clock::now();
+    }
+    Drain();
+    RunTasks();
+    m_ramp.Flush(true);
+    if (m_threadExit) m_threadExit();
+}
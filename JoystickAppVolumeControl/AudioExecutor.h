@@ -0,0 +1,83 @@
+#pragma once
+#include <atomic>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include "AudioSink.h"
+#include "SpscQueue.h"
+#include "VolumeRamp.h"
+#include "WakeEvent.h"
+
+// The one thread that touches audio objects. It runs in its own COM apartment (set up by
+// threadInit), owns the VolumeRamp and everything behind it, and runs posted work such as
+// opening endpoints and handling session and device notifications, so every audio COM
+// object is created, called and released here.
+//
+// Volume writes arrive through SetVolume from a single producer, the input thread, over a
+// bounded lock-free SPSC queue of target ids. The value itself sits in a per-target slot and
+// a target is queued only while it is not queued already, so a burst of writes collapses to
+// the latest value and the queue can never overflow. The producer never takes a lock and
+// only signals the thread when it is asleep.
+//
+// While stopped, SetVolume writes straight through to the ramp on the caller's thread and
+// Invoke runs inline (trace replay, tests).
+class AudioExecutor : public AudioSink {
+public:
+    // One slot per target id; writes to higher ids are dropped with an error, so the sink
+    // handing out the ids is capped to this (SessionTargetSink::SetTargetLimit).
+    static const int kMaxTargets = 256;
+
+    AudioExecutor(VolumeRamp& ramp, std::function<void()> threadInit = nullptr, std::function<void()> threadExit = nullptr);
+    ~AudioExecutor();
+    AudioExecutor(const AudioExecutor&) = delete;
+    AudioExecutor& operator=(const AudioExecutor&) = delete;
+
+    void Start();
+    // Applies the commands still queued, lands the ramp, runs the posted work and joins.
+    void Stop();
+    bool IsRunning() const { return m_running.load(std::memory_order_acquire); }
+
+    // Runs task on the executor and waits for it; inline when stopped or called from the executor.
+    void Invoke(const std::function<void()>& task);
+    // Queues task for the executor; inline when stopped. Commands sent before are applied first.
+    void Post(std::function<void()> task);
+
+    // Producer side; one thread only.
+    void SetVolume(int target, float v) override;
+    // force lands the ramp on the executor, after the commands sent before it.
+    uint32_t Flush(bool force = false) override;
+
+    uint64_t Commands() const { return m_commands.load(std::memory_order_relaxed); }
+    // Commands absorbed by a newer value for the same target before the executor got to them.
+    uint64_t Collapsed() const { return m_collapsed.load(std::memory_order_relaxed); }
+    // Times the producer had to wake the executor.
+    uint64_t Wakeups() const { return m_wakeups.load(std::memory_order_relaxed); }
+private:
+    struct Slot {
+        std::atomic<float> value{0.0f};
+        std::atomic<bool> queued{false};
+    };
+
+    void Run();
+    // Consumer side: hands the latest value of every queued target to the ramp.
+    void Drain();
+    // Runs posted tasks; returns false if there were none.
+    bool RunTasks();
+
+    VolumeRamp& m_ramp;
+    std::function<void()> m_threadInit, m_threadExit;
+    Slot m_slots[kMaxTargets];
+    SpscQueue<uint16_t, kMaxTargets> m_queue;
+    std::mutex m_taskMutex;
+    std::deque<std::function<void()>> m_tasks;
+    std::thread m_thread;
+    std::thread::id m_threadId;
+    WakeEvent m_wake;
+    std::atomic<bool> m_sleeping{false};
+    std::atomic<bool> m_land{false};
+    std::atomic<bool> m_running{false};
+    std::atomic<bool> m_stop{false};
+    std::atomic<bool> m_rejected{false};    // an out-of-range target was reported
+    std::atomic<uint64_t> m_commands{0}, m_collapsed{0}, m_wakeups{0};
+};
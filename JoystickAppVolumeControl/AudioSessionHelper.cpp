@@ -1,99 +1,359 @@
 #include "AudioSessionHelper.h"
 #include <psapi.h>
+#include <functiondiscoverykeys_devpkey.h>
+#include <algorithm>
 #include "log.h"
 
-AudioSessionHelper::AudioSessionHelper() {
-    CoInitialize(NULL);
+static std::wstring QueryProcessName(uint32_t pid) {
+    HANDLE h = OpenProcess(PROCESS_QUERY_INFORMATION | PROCESS_VM_READ, FALSE, pid);
+    wchar_t name[MAX_PATH] = L"";
+    if (h) {
+        GetModuleBaseNameW(h, NULL, name, MAX_PATH);
+        CloseHandle(h);
+    }
+    return name;
+}
+
+// Minimal IUnknown for the callback objects below.
+template<typename Iface>
+class ComCallback : public Iface {
+    LONG m_ref = 1;
+public:
+    virtual ~ComCallback() = default;
+    ULONG STDMETHODCALLTYPE AddRef() override { return InterlockedIncrement(&m_ref); }
+    ULONG STDMETHODCALLTYPE Release() override {
+        ULONG ref = InterlockedDecrement(&m_ref);
+        if (ref == 0) delete this;
+        return ref;
+    }
+    HRESULT STDMETHODCALLTYPE QueryInterface(REFIID riid, void** ppv) override {
+        if (riid == __uuidof(IUnknown) || riid == __uuidof(Iface)) {
+            *ppv = static_cast<Iface*>(this);
+            AddRef();
+            return S_OK;
+        }
+        *ppv = nullptr;
+        return E_NOINTERFACE;
+    }
+};
+
+// Forwards new sessions on the endpoint to the helper.
+class SessionNotifier : public ComCallback<IAudioSessionNotification> {
+    AudioSessionHelper& m_helper;
+    std::wstring m_endpointId;
+    bool m_capture;
+public:
+    SessionNotifier(AudioSessionHelper& helper, const std::wstring& endpointId, bool capture)
+        : m_helper(helper), m_endpointId(endpointId), m_capture(capture) {}
+    HRESULT STDMETHODCALLTYPE OnSessionCreated(IAudioSessionControl* pNewSession) override {
+        if (!pNewSession) return S_OK;
+        CComPtr<IAudioSessionControl> pCtrl(pNewSession);
+        AudioSessionHelper& helper = m_helper;
+        std::wstring endpointId = m_endpointId;
+        bool capture = m_capture;
+        m_helper.Dispatch([&helper, pCtrl, endpointId, capture] { helper.AddSession(pCtrl, endpointId, capture); });
+        return S_OK;
+    }
+};
+
+// Forwards endpoint arrival, removal and default changes to the owning thread.
+class EndpointNotifier : public ComCallback<IMMNotificationClient> {
+    AudioSessionHelper& m_helper;
+public:
+    explicit EndpointNotifier(AudioSessionHelper& helper) : m_helper(helper) {}
+    HRESULT STDMETHODCALLTYPE OnDeviceStateChanged(LPCWSTR pwstrDeviceId, DWORD dwNewState) override {
+        std::wstring id = pwstrDeviceId ? pwstrDeviceId : L"";
+        EndpointManager& m = m_helper.Endpoints();
+        if (dwNewState == DEVICE_STATE_ACTIVE)
+            m_helper.Dispatch([&m, id] { m.OnEndpointAdded(id); });
+        else
+            m_helper.Dispatch([&m, id] { m.OnEndpointRemoved(id); });
+        return S_OK;
+    }
+    HRESULT STDMETHODCALLTYPE OnDeviceAdded(LPCWSTR) override { return S_OK; }     // arrives inactive; see OnDeviceStateChanged
+    HRESULT STDMETHODCALLTYPE OnDeviceRemoved(LPCWSTR pwstrDeviceId) override {
+        std::wstring id = pwstrDeviceId ? pwstrDeviceId : L"";
+        EndpointManager& m = m_helper.Endpoints();
+        m_helper.Dispatch([&m, id] { m.OnEndpointRemoved(id); });
+        return S_OK;
+    }
+    HRESULT STDMETHODCALLTYPE OnDefaultDeviceChanged(EDataFlow flow, ERole role, LPCWSTR pwstrDefaultDeviceId) override {
+        // Bindings follow the multimedia default, the one GetDefaultAudioEndpoint(eMultimedia) reports.
+        if (role != eMultimedia || (flow != eRender && flow != eCapture)) return S_OK;
+        std::wstring id = pwstrDefaultDeviceId ? pwstrDefaultDeviceId : L"";
+        EndpointFlow f = flow == eRender ? EndpointFlow::Render : EndpointFlow::Capture;
+        EndpointManager& m = m_helper.Endpoints();
+        m_helper.Dispatch([&m, f, id] { m.OnDefaultChanged(f, id); });
+        return S_OK;
+    }
+    HRESULT STDMETHODCALLTYPE OnPropertyValueChanged(LPCWSTR, const PROPERTYKEY) override { return S_OK; }
+};
+
+// Watches one session and drops it from the registry when it expires or disconnects.
+class SessionEvents : public ComCallback<IAudioSessionEvents> {
+    AudioSessionHelper& m_helper;
+    std::wstring m_sessionId;
+
+    void Remove() {
+        AudioSessionHelper& helper = m_helper;
+        std::wstring sessionId = m_sessionId;
+        m_helper.Dispatch([&helper, sessionId] { helper.RemoveSession(sessionId); });
+    }
+public:
+    SessionEvents(AudioSessionHelper& helper, const std::wstring& sessionId) : m_helper(helper), m_sessionId(sessionId) {}
+    HRESULT STDMETHODCALLTYPE OnDisplayNameChanged(LPCWSTR, LPCGUID) override { return S_OK; }
+    HRESULT STDMETHODCALLTYPE OnIconPathChanged(LPCWSTR, LPCGUID) override { return S_OK; }
+    HRESULT STDMETHODCALLTYPE OnSimpleVolumeChanged(float, BOOL, LPCGUID) override { return S_OK; }
+    HRESULT STDMETHODCALLTYPE OnChannelVolumeChanged(DWORD, float[], DWORD, LPCGUID) override { return S_OK; }
+    HRESULT STDMETHODCALLTYPE OnGroupingParamChanged(LPCGUID, LPCGUID) override { return S_OK; }
+    HRESULT STDMETHODCALLTYPE OnStateChanged(AudioSessionState state) override {
+        if (state == AudioSessionStateExpired) Remove();
+        return S_OK;
+    }
+    HRESULT STDMETHODCALLTYPE OnSessionDisconnected(AudioSessionDisconnectReason reason) override {
+        LOG_INFO("Audio session disconnected (reason=%d)", (int)reason);
+        Remove();
+        return S_OK;
+    }
+};
+
+// SessionControl over ISimpleAudioVolume. Keeps the session's event sink registered for its lifetime.
+class WasapiSessionControl : public SessionControl {
+    CComPtr<IAudioSessionControl> m_pCtrl;
+    CComPtr<ISimpleAudioVolume> m_pVolume;
+    CComPtr<IAudioSessionEvents> m_pEvents;
+public:
+    WasapiSessionControl(AudioSessionHelper& helper, IAudioSessionControl* pCtrl, ISimpleAudioVolume* pVolume,
+            const std::wstring& sessionId) : m_pCtrl(pCtrl), m_pVolume(pVolume) {
+        m_pEvents.Attach(new SessionEvents(helper, sessionId));
+        if (FAILED(m_pCtrl->RegisterAudioSessionNotification(m_pEvents)))
+            m_pEvents.Release();
+    }
+    ~WasapiSessionControl() override {
+        if (m_pEvents) m_pCtrl->UnregisterAudioSessionNotification(m_pEvents);
+    }
+    bool SetVolume(float v) override {
+        return SUCCEEDED(m_pVolume->SetMasterVolume(v, NULL));
+    }
+};
+
+// SessionControl over the endpoint master volume.
+class EndpointVolumeControl : public SessionControl {
+    CComPtr<IAudioEndpointVolume> m_pEndpointVol;
+public:
+    explicit EndpointVolumeControl(IAudioEndpointVolume* pEndpointVol) : m_pEndpointVol(pEndpointVol) {}
+    bool SetVolume(float v) override {
+        return SUCCEEDED(m_pEndpointVol->SetMasterVolumeLevelScalar(v, NULL));
+    }
+};
+
+// One opened endpoint: the session manager and endpoint volume are activated here once
+// and reused for every write until the endpoint goes away.
+class WasapiEndpoint : public AudioEndpoint {
+    CComPtr<IMMDevice> m_pDevice;
+    CComPtr<IAudioSessionManager2> m_pMgr;
+    CComPtr<IAudioSessionNotification> m_pNotify;
+    std::shared_ptr<SessionControl> m_master;
+public:
+    WasapiEndpoint(AudioSessionHelper& helper, IMMDevice* pDevice, const std::wstring& id, bool capture) : m_pDevice(pDevice) {
+        CComPtr<IAudioEndpointVolume> pEndpointVol;
+        HRESULT hr1 = m_pDevice->Activate(__uuidof(IAudioSessionManager2), CLSCTX_ALL, NULL, (void**)&m_pMgr);
+        HRESULT hr2 = m_pDevice->Activate(__uuidof(IAudioEndpointVolume), CLSCTX_ALL, NULL, (void**)&pEndpointVol);
+        LOG_INFO("Endpoint (%s): activation hr1=0x%08X hr2=0x%08X", capture ? "capture" : "render", hr1, hr2);
+        if (pEndpointVol) m_master = std::make_shared<EndpointVolumeControl>(pEndpointVol);
+        if (!m_pMgr) return;
+
+        // Subscribe first, then walk the existing sessions once; duplicates just replace each other.
+        // (GetSessionEnumerator also has to be called once before notifications are delivered.)
+        m_pNotify.Attach(new SessionNotifier(helper, id, capture));
+        if (FAILED(m_pMgr->RegisterSessionNotification(m_pNotify))) {
+            LOG_ERROR("RegisterSessionNotification failed");
+            m_pNotify.Release();
+        }
+        CComPtr<IAudioSessionEnumerator> pEnumSess;
+        HRESULT hr = m_pMgr->GetSessionEnumerator(&pEnumSess);
+        if (!pEnumSess || FAILED(hr)) {
+            LOG_ERROR("GetSessionEnumerator failed: hr=0x%08X", hr);
+            return;
+        }
+        int count = 0;
+        pEnumSess->GetCount(&count);
+        LOG_INFO("Found %d audio sessions", count);
+        for (int i = 0; i < count; ++i) {
+            CComPtr<IAudioSessionControl> pCtrl;
+            if (SUCCEEDED(pEnumSess->GetSession(i, &pCtrl)))
+                helper.AddSession(pCtrl, id, capture);
+        }
+    }
+    ~WasapiEndpoint() override {
+        if (m_pMgr && m_pNotify) m_pMgr->UnregisterSessionNotification(m_pNotify);
+    }
+    bool Ok() const { return m_pMgr || m_master; }
+    std::shared_ptr<SessionControl> MasterControl() override { return m_master; }
+};
+
+AudioSessionHelper::AudioSessionHelper() : m_registry(QueryProcessName), m_endpoints(*this, m_registry) {
+}
+
+AudioSessionHelper::~AudioSessionHelper() {
+    Close();
+}
+
+bool AudioSessionHelper::Open(Dispatcher post) {
+    m_post = std::move(post);
     pEnum.CoCreateInstance(__uuidof(MMDeviceEnumerator));
-    if (pEnum) pEnum->GetDefaultAudioEndpoint(eRender, eMultimedia, &pDevice);
-    if (pDevice) {
-        HRESULT hr1 = pDevice->Activate(__uuidof(IAudioSessionManager2), CLSCTX_ALL, NULL, (void**)&pMgr);
-        HRESULT hr2 = pDevice->Activate(__uuidof(IAudioEndpointVolume), CLSCTX_ALL, NULL, (void**)&pEndpointVol);
-        DEBUG_LOG("AudioSessionHelper: activation hr1=0x%08X hr2=0x%08X", hr1, hr2);
+    if (!pEnum) {
+        LOG_ERROR("MMDeviceEnumerator could not be created");
+        return false;
+    }
+    // Register before opening, so an endpoint that arrives in between is not missed; the
+    // posted change finds it already open.
+    pDeviceNotify.Attach(new EndpointNotifier(*this));
+    if (FAILED(pEnum->RegisterEndpointNotificationCallback(pDeviceNotify))) {
+        LOG_ERROR("RegisterEndpointNotificationCallback failed");
+        pDeviceNotify.Release();
     }
+    int opened = m_endpoints.Start();
+    LOG_INFO("Opened %d audio endpoint(s)", opened);
+    return true;
+}
+
+void AudioSessionHelper::Close() {
+    if (!pEnum) return;
+    if (pDeviceNotify) pEnum->UnregisterEndpointNotificationCallback(pDeviceNotify);
+    pDeviceNotify.Release();
+    m_endpoints.Stop();
+    m_registry.Clear();
+    pEnum.Release();
+}
+
+void AudioSessionHelper::Dispatch(std::function<void()> work) {
+    auto guarded = [this, work] { if (pEnum) work(); };
+    if (m_post) m_post(guarded);
+    else guarded();
+}
+
+bool AudioSessionHelper::Enumerate(std::vector<std::wstring>& ids) {
+    ids.clear();
+    CComPtr<IMMDeviceCollection> pDevices;
+    if (!pEnum || FAILED(pEnum->EnumAudioEndpoints(eAll, DEVICE_STATE_ACTIVE, &pDevices))) return false;
+    UINT count = 0;
+    pDevices->GetCount(&count);
+    for (UINT i = 0; i < count; ++i) {
+        CComPtr<IMMDevice> pDevice;
+        LPWSTR id = nullptr;
+        if (FAILED(pDevices->Item(i, &pDevice)) || FAILED(pDevice->GetId(&id)) || !id) continue;
+        ids.push_back(id);
+        CoTaskMemFree(id);
+    }
+    return true;
+}
+
+std::wstring AudioSessionHelper::DefaultEndpoint(EndpointFlow flow) {
+    CComPtr<IMMDevice> pDevice;
+    LPWSTR id = nullptr;
+    if (!pEnum || FAILED(pEnum->GetDefaultAudioEndpoint(flow == EndpointFlow::Render ? eRender : eCapture, eMultimedia, &pDevice))
+            || FAILED(pDevice->GetId(&id)) || !id)
+        return std::wstring();
+    std::wstring out = id;
+    CoTaskMemFree(id);
+    return out;
+}
+
+std::unique_ptr<AudioEndpoint> AudioSessionHelper::Open(const std::wstring& id, EndpointInfo& info) {
+    CComPtr<IMMDevice> pDevice;
+    if (!pEnum || FAILED(pEnum->GetDevice(id.c_str(), &pDevice))) return nullptr;
+    DWORD state = 0;
+    if (FAILED(pDevice->GetState(&state)) || state != DEVICE_STATE_ACTIVE) return nullptr;
+    CComPtr<IMMEndpoint> pEndpoint;
+    EDataFlow flow = eRender;
+    if (SUCCEEDED(pDevice->QueryInterface(&pEndpoint))) pEndpoint->GetDataFlow(&flow);
+    info.id = id;
+    info.flow = flow == eCapture ? EndpointFlow::Capture : EndpointFlow::Render;
+    info.name.clear();
+    CComPtr<IPropertyStore> pProps;
+    if (SUCCEEDED(pDevice->OpenPropertyStore(STGM_READ, &pProps))) {
+        PROPVARIANT name;
+        PropVariantInit(&name);
+        if (SUCCEEDED(pProps->GetValue(PKEY_Device_FriendlyName, &name)) && name.vt == VT_LPWSTR)
+            info.name = name.pwszVal;
+        PropVariantClear(&name);
+    }
+    std::unique_ptr<WasapiEndpoint> endpoint(new WasapiEndpoint(*this, pDevice, id, info.flow == EndpointFlow::Capture));
+    if (!endpoint->Ok()) return nullptr;
+    return std::move(endpoint);
+}
+
+void AudioSessionHelper::AddSession(IAudioSessionControl* pCtrl, const std::wstring& endpointId, bool capture) {
+    CComPtr<IAudioSessionControl2> pCtrl2;
+    if (FAILED(pCtrl->QueryInterface(&pCtrl2))) return;
+    DWORD pid = 0;
+    if (FAILED(pCtrl2->GetProcessId(&pid)) || pid == 0) return;
+    AudioSessionState state;
+    if (SUCCEEDED(pCtrl->GetState(&state)) && state == AudioSessionStateExpired) return;
+    CComPtr<ISimpleAudioVolume> pVol;
+    if (FAILED(pCtrl->QueryInterface(&pVol))) return;
+
+    LPWSTR instanceId = nullptr;
+    if (FAILED(pCtrl2->GetSessionInstanceIdentifier(&instanceId)) || !instanceId) return;
+    std::wstring sessionId = instanceId;
+    CoTaskMemFree(instanceId);
+    GUID grouping = GUID_NULL;
+    wchar_t groupingId[40] = L"";
+    if (SUCCEEDED(pCtrl->GetGroupingParam(&grouping)) && grouping != GUID_NULL)
+        StringFromGUID2(grouping, groupingId, ARRAYSIZE(groupingId));
+
+    std::shared_ptr<SessionControl> control = std::make_shared<WasapiSessionControl>(*this, pCtrl, pVol, sessionId);
+    m_registry.OnSessionAdded(sessionId, pid, groupingId, control, endpointId, capture);
+    LOG_DEBUG("Audio session added (pid=%u)", pid);
+}
+
+void AudioSessionHelper::RemoveSession(const std::wstring& sessionId) {
+    m_registry.OnSessionRemoved(sessionId);
 }
 
 bool AudioSessionHelper::EnumerateSessions(std::vector<ProcSessionInfo>& outList, bool includeSystem) {
     outList.clear();
+    std::vector<EndpointInfo> endpoints;
+    m_endpoints.Snapshot(endpoints);
+    std::wstring defaultOut = m_endpoints.DefaultEndpoint(EndpointFlow::Render);
+    auto nameOf = [&](const std::wstring& id) {
+        if (id == defaultOut) return std::wstring();
+        for (const EndpointInfo& e : endpoints)
+            if (e.id == id) return e.name.empty() ? e.id : e.name;
+        return id;
+    };
     if (includeSystem) {
+        // The default output first; its entry follows default-device switches.
         ProcSessionInfo sys;
         sys.processName = L"System Volume";
         sys.pid = 0xFFFFFFFF;
         outList.push_back(sys);
-    }
-    if (!pMgr) return includeSystem;
-    CComPtr<IAudioSessionEnumerator> pEnumSess;
-    HRESULT hr = pMgr->GetSessionEnumerator(&pEnumSess);
-    if (!pEnumSess || FAILED(hr)) {
-        DEBUG_LOG("GetSessionEnumerator failed: hr=0x%08X", hr);
-        return includeSystem;
-    }
-    int count = 0;
-    pEnumSess->GetCount(&count);
-    DEBUG_LOG("Found %d audio sessions", count);
-    for (int i = 0; i < count; ++i) {
-        CComPtr<IAudioSessionControl> pCtrl;
-        if (FAILED(pEnumSess->GetSession(i, &pCtrl))) continue;
-        CComPtr<IAudioSessionControl2> pCtrl2;
-        if (FAILED(pCtrl->QueryInterface(&pCtrl2))) continue;
-        DWORD pid = 0;
-        if (FAILED(pCtrl2->GetProcessId(&pid)) || pid == 0) continue;
-        HANDLE h = OpenProcess(PROCESS_QUERY_INFORMATION | PROCESS_VM_READ, FALSE, pid);
-        wchar_t name[MAX_PATH] = L"";
-        if (h) {
-            GetModuleBaseNameW(h, NULL, name, MAX_PATH);
-            CloseHandle(h);
+        std::sort(endpoints.begin(), endpoints.end(), [](const EndpointInfo& a, const EndpointInfo& b) {
+            return a.flow != b.flow ? a.flow < b.flow : a.name < b.name;
+        });
+        for (const EndpointInfo& e : endpoints) {
+            sys.endpointId = e.id;
+            sys.endpointName = nameOf(e.id);
+            outList.push_back(sys);
         }
-        if (wcslen(name) == 0)
-            wcscpy_s(name, L"Unknown");
+    }
+    if (endpoints.empty()) return includeSystem;
+    std::vector<SessionInfo> sessions;
+    // Runs on the enumeration pool: take names only, so no session control is ever
+    // released off the executor.
+    m_registry.Snapshot(sessions, false);
+    std::sort(sessions.begin(), sessions.end(), [](const SessionInfo& a, const SessionInfo& b) {
+        return a.processName != b.processName ? a.processName < b.processName : a.pid < b.pid;
+    });
+    for (const SessionInfo& s : sessions) {
         ProcSessionInfo psi;
-        psi.processName = name;
-        psi.pid = pid;
+        psi.processName = s.processName;
+        psi.pid = s.pid;
+        psi.endpointId = s.endpointId;
+        psi.endpointName = nameOf(s.endpointId);
         outList.push_back(psi);
-        DEBUG_LOG("Audio session: %ws (pid=%u)", name, pid);
     }
+    LOG_DEBUG("Listed %zu audio sessions (%llu process name lookups so far)", sessions.size(), m_registry.NameLookups());
     return true;
-}
-
-bool AudioSessionHelper::GetSimpleAudioVolume(ProcSessionInfo& session, TargetType tgt) {
-    if (tgt == TargetType::System) {
-        return pEndpointVol != nullptr;
-    }
-    if (!pMgr) return false;
-    CComPtr<IAudioSessionEnumerator> pEnumSess;
-    HRESULT hr = pMgr->GetSessionEnumerator(&pEnumSess);
-    if (!pEnumSess || FAILED(hr)) {
-        DEBUG_LOG("GetSessionEnumerator failed: hr=0x%08X", hr);
-        return false;
-    }
-    int count = 0;
-    pEnumSess->GetCount(&count);
-    for (int i = 0; i < count; ++i) {
-        CComPtr<IAudioSessionControl> pCtrl;
-        if (FAILED(pEnumSess->GetSession(i, &pCtrl))) continue;
-        CComPtr<IAudioSessionControl2> pCtrl2;
-        if (FAILED(pCtrl->QueryInterface(&pCtrl2))) continue;
-        DWORD pid = 0;
-        if (FAILED(pCtrl2->GetProcessId(&pid)) || pid == 0) continue;
-        if (pid == session.pid) {
-            CComPtr<ISimpleAudioVolume> pVol;
-            if (SUCCEEDED(pCtrl->QueryInterface(&pVol))) {
-                session.pVolume = pVol;
-                DEBUG_LOG("Found ISimpleAudioVolume for PID %u", pid);
-                return true;
-            }
-        }
-    }
-    DEBUG_LOG("Did not find ISimpleAudioVolume for PID %u", session.pid);
-    return false;
-}
-void AudioSessionHelper::ReleaseSimpleAudioVolume(ProcSessionInfo& session) {
-    session.pVolume.Release();
-}
-
-void AudioSessionHelper::SetSessionVolume(float v, ProcSessionInfo& session, TargetType tgt) {
-    if (tgt == TargetType::System && pEndpointVol)
-        pEndpointVol->SetMasterVolumeLevelScalar(v, NULL);
-    else if (session.pVolume)
-        session.pVolume->SetMasterVolume(v, NULL);
 }
\ No newline at end of file
@@ -3,27 +3,56 @@
 #include <mmdeviceapi.h>
 #include <audiopolicy.h>
 #include <endpointvolume.h>
+#include <functional>
 #include <vector>
 #include <string>
 #include <atlbase.h>
+#include "EndpointManager.h"
+#include "SessionRegistry.h"
 
 struct ProcSessionInfo {
     std::wstring processName;
     DWORD pid; // system-wide (-1/0xFFFFFFFF)
-    CComPtr<ISimpleAudioVolume> pVolume;
+    std::wstring endpointId;    // "" for the default output's "System Volume"
+    std::wstring endpointName;  // set when the session is not on the default output
 };
 
-class AudioSessionHelper {
+// WASAPI side of the audio targets: the EndpointProvider for every active render and
+// capture endpoint, plus the IMMNotificationClient that keeps the EndpointManager current.
+// Open() and Close() run on the thread that owns the audio objects (the AudioExecutor);
+// session and device notifications are posted back to it, so nothing is activated or
+// released inside a callback and the registry only changes on that thread.
+class AudioSessionHelper : public EndpointProvider {
 public:
-    enum class TargetType { Process, System };
+    // Runs work later on the owning thread; must not run it inline.
+    typedef std::function<void(std::function<void()> work)> Dispatcher;
+
     AudioSessionHelper();
+    ~AudioSessionHelper();
+    // Creates the device enumerator and opens every active endpoint.
+    bool Open(Dispatcher post);
+    // Closes the endpoints and releases every audio object. Safe to call twice.
+    void Close();
+    // Lists the sessions currently in the registry; no enumerator walk or process lookups.
+    // includeSystem adds a "System Volume" entry for the default output and one per other endpoint.
     bool EnumerateSessions(std::vector<ProcSessionInfo>& outList, bool includeSystem = false);
-    bool GetSimpleAudioVolume(ProcSessionInfo& session, TargetType tgt);
-    void ReleaseSimpleAudioVolume(ProcSessionInfo& session);
-    void SetSessionVolume(float v, ProcSessionInfo& session, TargetType tgt);
+    SessionRegistry& Registry() { return m_registry; }
+    EndpointManager& Endpoints() { return m_endpoints; }
+
+    // EndpointProvider
+    bool Enumerate(std::vector<std::wstring>& ids) override;
+    std::wstring DefaultEndpoint(EndpointFlow flow) override;
+    std::unique_ptr<AudioEndpoint> Open(const std::wstring& id, EndpointInfo& info) override;
+
+    // Run on the owning thread; the notification callbacks get there through Dispatch().
+    void AddSession(IAudioSessionControl* pCtrl, const std::wstring& endpointId, bool capture);
+    void RemoveSession(const std::wstring& sessionId);
+    // Called from the notification callbacks. Work posted after Close() is dropped.
+    void Dispatch(std::function<void()> work);
 private:
     CComPtr<IMMDeviceEnumerator> pEnum;
-    CComPtr<IMMDevice> pDevice;
-    CComPtr<IAudioSessionManager2> pMgr;
-    CComPtr<IAudioEndpointVolume> pEndpointVol;
+    CComPtr<IMMNotificationClient> pDeviceNotify;
+    SessionRegistry m_registry;
+    EndpointManager m_endpoints;
+    Dispatcher m_post;
 };
\ No newline at end of file
@@ -0,0 +1,15 @@
+#pragma once
+#include <stdint.h>
+
+// Destination for volume writes. Targets are small integer ids assigned by
+// whoever builds the sink (e.g. an index into a session table).
+class AudioSink {
+public:
+    static const uint32_t kNoPendingWrites = 0xFFFFFFFF;
+
+    virtual ~AudioSink() = default;
+    virtual void SetVolume(int target, float v) = 0;
+    // Writes values the sink has been holding back. Unless force is set, only those
+    // that are due are written. Returns the ms until the next call is needed.
+    virtual uint32_t Flush(bool /*force*/ = false) { return kNoPendingWrites; }
+};
\ No newline at end of file
@@ -0,0 +1,121 @@
+#include "AxisCalibrator.h"
+
+static const LONG kNoValueLow = 0x7FFFFFFF, kNoValueHigh = -0x7FFFFFFF - 1;
+
+static int64_t AlignDown(int64_t v, int64_t width) {
+    int64_t r = v % width;
+    return r < 0 ? v - r - width : v - r;
+}
+
+void AxisCalibrator::Reset() {
+    m_origin = 0;
+    m_shift = 0;
+    m_empty = true;
+    for (int i = 0; i < kBuckets; ++i) {
+        m_hits[i] = 0;
+        m_lo[i] = m_hi[i] = 0;
+    }
+    m_seeded = false;
+    m_seedMin = m_seedMax = 0;
+    m_confLo = kNoValueLow;
+    m_confHi = kNoValueHigh;
+    m_usable = false;
+    m_rangeMin = m_rangeMax = 0;
+    m_stable = 0;
+    m_samples = 0;
+}
+
+void AxisCalibrator::Seed(LONG min, LONG max) {
+    m_seeded = true;
+    m_seedMin = min < max ? min : max;
+    m_seedMax = min < max ? max : min;
+    Recompute();
+}
+
+bool AxisCalibrator::Add(LONG raw) {
+    ++m_samples;
+    if (m_empty) {
+        m_origin = (int64_t)raw - kBuckets / 2;
+        m_empty = false;
+    }
+    int b = BucketOf(raw);
+    if (b < 0 || b >= kBuckets) {
+        Rebin(raw);
+        b = BucketOf(raw);
+    }
+    uint32_t& hits = m_hits[b];
+    if (!hits || raw < m_lo[b]) m_lo[b] = raw;
+    if (!hits || raw > m_hi[b]) m_hi[b] = raw;
+    if (hits < 0xFFFFFFFF) ++hits;
+
+    bool changed = false;
+    if (hits >= kMinHits && (hits == kMinHits || raw < m_confLo || raw > m_confHi))
+        changed = Recompute();
+    if (changed) m_stable = 0;
+    else if (m_stable < kStableSamples) ++m_stable;
+    return changed;
+}
+
+// Doubles the bucket width until raw fits, merging bucket pairs. The new window is
+// aligned to the new width and extended towards raw, and always covers the old one.
+void AxisCalibrator::Rebin(LONG raw) {
+    while (BucketOf(raw) < 0 || BucketOf(raw) >= kBuckets) {
+        int64_t width = (int64_t)1 << m_shift;
+        int64_t newWidth = width * 2;
+        int64_t newOrigin;
+        if ((int64_t)raw < m_origin)
+            newOrigin = -AlignDown(-(m_origin + kBuckets * width), newWidth) - kBuckets * newWidth;
+        else
+            newOrigin = AlignDown(m_origin, newWidth);
+        uint32_t hits[kBuckets] = {};
+        LONG lo[kBuckets] = {}, hi[kBuckets] = {};
+        for (int i = 0; i < kBuckets; ++i) {
+            if (!m_hits[i]) continue;
+            int j = (int)((m_origin + i * width - newOrigin) / newWidth);
+            if (!hits[j] || m_lo[i] < lo[j]) lo[j] = m_lo[i];
+            if (!hits[j] || m_hi[i] > hi[j]) hi[j] = m_hi[i];
+            uint64_t sum = (uint64_t)hits[j] + m_hits[i];
+            hits[j] = sum > 0xFFFFFFFF ? 0xFFFFFFFF : (uint32_t)sum;
+        }
+        for (int i = 0; i < kBuckets; ++i) {
+            m_hits[i] = hits[i];
+            m_lo[i] = lo[i];
+            m_hi[i] = hi[i];
+        }
+        m_origin = newOrigin;
+        ++m_shift;
+    }
+}
+
+bool AxisCalibrator::Recompute() {
+    int first = -1, last = -1;
+    for (int i = 0; i < kBuckets; ++i) {
+        if (m_hits[i] < kMinHits) continue;
+        if (first < 0) first = i;
+        last = i;
+    }
+    bool have = first >= 0;
+    LONG lo = have ? m_lo[first] : 0, hi = have ? m_hi[last] : 0;
+    if (m_seeded) {
+        if (!have || m_seedMin < lo) lo = m_seedMin;
+        if (!have || m_seedMax > hi) hi = m_seedMax;
+        have = true;
+    }
+    if (!have) return false;
+    m_confLo = lo;
+    m_confHi = hi;
+    int64_t span = (int64_t)hi - lo;
+    if (span < m_minSpan) return false;
+
+    int64_t margin = span / 200;
+    LONG newMin = (LONG)(lo + margin), newMax = (LONG)(hi - margin);
+    if (m_usable) {
+        int64_t tolerance = span / 256;
+        int64_t dMin = (int64_t)newMin - m_rangeMin, dMax = (int64_t)newMax - m_rangeMax;
+        if ((dMin < 0 ? -dMin : dMin) <= tolerance && (dMax < 0 ? -dMax : dMax) <= tolerance) return false;
+    }
+    m_usable = true;
+    m_rangeMin = newMin;
+    m_rangeMax = newMax;
+    return true;
+}
\ No newline at end of file
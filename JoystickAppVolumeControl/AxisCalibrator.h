@@ -0,0 +1,52 @@
+#pragma once
+#include "JoyState.h"
+
+// Online range calibration for one device axis. Raw samples go into a fixed
+// 128-bucket histogram that rebins (doubling the bucket width) as the observed span
+// grows, so memory stays constant however long it runs. A bucket only counts
+// towards the range once it has collected kMinHits samples, which rejects single
+// spikes from noisy pots; the range then runs from the lowest to the highest value
+// seen in confirmed buckets, pulled in by a small margin so sticky ends that stop
+// a few counts short still reach the end of the curve. Changes smaller than 1/256
+// of the span are not reported, so noise at the ends does not churn the curve.
+class AxisCalibrator {
+public:
+    static const int kBuckets = 128;
+    static const uint32_t kMinHits = 3;
+    static const uint32_t kStableSamples = 200;     // samples without a range change before Converged()
+
+    // minSpan: confirmed travel required before the range is used; the default is
+    // 1/16 of DirectInput's 0..65535 axis range.
+    explicit AxisCalibrator(LONG minSpan = 4096) : m_minSpan(minSpan) { Reset(); }
+    void Reset();
+    // Starts from a previously persisted range; the confirmed range only ever widens from it.
+    void Seed(LONG min, LONG max);
+    // Feeds one raw sample. Returns true when the usable range changed.
+    bool Add(LONG raw);
+
+    // False until enough of the travel has been confirmed.
+    bool Usable() const { return m_usable; }
+    bool Converged() const { return m_usable && m_stable >= kStableSamples; }
+    // Calibrated range, low <= high. Only meaningful while Usable().
+    LONG Min() const { return m_rangeMin; }
+    LONG Max() const { return m_rangeMax; }
+    uint64_t Samples() const { return m_samples; }
+private:
+    int BucketOf(LONG raw) const { return (int)(((int64_t)raw - m_origin) >> m_shift); }
+    void Rebin(LONG raw);
+    bool Recompute();
+
+    LONG m_minSpan;
+    int64_t m_origin;       // value at the start of bucket 0, a multiple of the bucket width
+    int m_shift;            // bucket width is 1 << m_shift
+    bool m_empty;
+    uint32_t m_hits[kBuckets];
+    LONG m_lo[kBuckets], m_hi[kBuckets];   // extremes seen in each bucket
+    bool m_seeded;
+    LONG m_seedMin, m_seedMax;
+    LONG m_confLo, m_confHi;                // extremes of the confirmed buckets (and seed)
+    bool m_usable;
+    LONG m_rangeMin, m_rangeMax;
+    uint32_t m_stable;
+    uint64_t m_samples;
+};
\ No newline at end of file
@@ -0,0 +1,108 @@
+#include "AxisFilter.h"
+#include <math.h>
+
+static const double kPi = 3.14159265358979323846;
+
+// Smoothing factor of a one-pole low-pass with the given cutoff at sample interval dt.
+static double LowPassAlpha(double cutoffHz, double dt) {
+    double tau = 1.0 / (2.0 * kPi * cutoffHz);
+    return 1.0 / (1.0 + tau / dt);
+}
+
+AxisFilter::AxisFilter(const FilterSpec& spec) : m_spec(spec) {
+    m_window = spec.window < 1 ? 1 : (spec.window > kMaxWindow ? kMaxWindow : spec.window);
+    Reset();
+}
+
+void AxisFilter::Reset() {
+    m_count = m_pos = m_sameRun = 0;
+    m_sum = 0;
+    m_y = m_dx = m_lastT = 0.0;
+    m_lastX = 0;
+    m_primed = false;
+    m_settled = true;
+}
+
+LONG AxisFilter::Median() const {
+    LONG sorted[kMaxWindow];
+    for (int i = 0; i < m_count; ++i) {
+        // Insertion sort; the window is at most 15 samples.
+        LONG v = m_ring[i];
+        int j = i;
+        for (; j > 0 && sorted[j - 1] > v; --j)
+            sorted[j] = sorted[j - 1];
+        sorted[j] = v;
+    }
+    return sorted[m_count / 2];
+}
+
+LONG AxisFilter::Process(LONG x, double tSec) {
+    m_sameRun = (m_primed && x == m_lastX) ? m_sameRun + 1 : 1;
+    double dt = m_primed ? tSec - m_lastT : 0.0;
+    if (dt <= 0.0) dt = 0.001;
+    LONG out = x;
+
+    switch (m_spec.type) {
+    case FilterType::MovingAverage:
+    case FilterType::Median:
+        if (m_count == m_window) m_sum -= m_ring[m_pos];
+        else ++m_count;
+        m_ring[m_pos] = x;
+        m_sum += x;
+        m_pos = (m_pos + 1) % m_window;
+        out = m_spec.type == FilterType::Median ? Median() : (LONG)((m_sum + (m_sum >= 0 ? m_count / 2 : -m_count / 2)) / m_count);
+        m_settled = m_sameRun >= m_window;
+        break;
+    case FilterType::Exponential:
+        m_y = m_primed ? m_y + m_spec.alpha * (x - m_y) : x;
+        break;
+    case FilterType::OneEuro: {
+        double dx = m_primed ? (x - m_lastX) / dt : 0.0;
+        m_dx += LowPassAlpha(1.0, dt) * (dx - m_dx);
+        double cutoff = m_spec.minCutoff + m_spec.beta * fabs(m_dx);
+        m_y = m_primed ? m_y + LowPassAlpha(cutoff, dt) * (x - m_y) : x;
+        break;
+    }
+    default:
+        break;
+    }
+    if (m_spec.type == FilterType::Exponential || m_spec.type == FilterType::OneEuro) {
+        // Snap once within half a count so a held axis lands exactly on its input.
+        if (fabs(x - m_y) < 0.5) {
+            m_y = x;
+            m_dx = 0.0;
+        }
+        out = (LONG)lround(m_y);
+        m_settled = out == x;
+    }
+    m_primed = true;
+    m_lastX = x;
+    m_lastT = tSec;
+    return out;
+}
+
+void FilterChain::Configure(const std::vector<FilterSpec>& specs) {
+    m_count = 0;
+    for (const FilterSpec& spec : specs) {
+        if (spec.type == FilterType::None) continue;
+        if (m_count == kMaxFilters) break;
+        m_filters[m_count++] = AxisFilter(spec);
+    }
+}
+
+void FilterChain::Reset() {
+    for (int i = 0; i < m_count; ++i)
+        m_filters[i].Reset();
+}
+
+LONG FilterChain::Process(LONG x, double tSec) {
+    for (int i = 0; i < m_count; ++i)
+        x = m_filters[i].Process(x, tSec);
+    return x;
+}
+
+bool FilterChain::Settled() const {
+    for (int i = 0; i < m_count; ++i)
+        if (!m_filters[i].Settled()) return false;
+    return true;
+}
\ No newline at end of file
@@ -0,0 +1,55 @@
+#pragma once
+#include <vector>
+#include "JoyState.h"
+
+enum class FilterType { None, MovingAverage, Exponential, OneEuro, Median };
+
+struct FilterSpec {
+    FilterType type;
+    int window;         // MovingAverage, Median: samples, 1..AxisFilter::kMaxWindow
+    float alpha;        // Exponential: weight of the newest sample, 0..1
+    float minCutoff;    // OneEuro: cutoff in Hz while the axis is still
+    float beta;         // OneEuro: cutoff increase per count/s of axis speed
+};
+
+// One smoothing stage for raw axis counts. State lives in fixed-size members,
+// so Process() never allocates.
+class AxisFilter {
+public:
+    static const int kMaxWindow = 15;
+
+    AxisFilter() : AxisFilter(FilterSpec{ FilterType::None }) {}
+    explicit AxisFilter(const FilterSpec& spec);
+    void Reset();
+    // Feeds one sample taken at tSec (any monotonic origin) and returns the filtered value.
+    LONG Process(LONG x, double tSec);
+    // True once the output has caught up with a steady input. An unsettled filter
+    // needs more samples (even repeated ones) to reach its final value.
+    bool Settled() const { return m_settled; }
+private:
+    LONG Median() const;
+
+    FilterSpec m_spec;
+    int m_window;
+    LONG m_ring[kMaxWindow];
+    int m_count, m_pos, m_sameRun;
+    int64_t m_sum;
+    double m_y, m_dx, m_lastT;
+    LONG m_lastX;
+    bool m_primed, m_settled;
+};
+
+// Up to kMaxFilters stages applied in order, configured per binding.
+class FilterChain {
+public:
+    static const int kMaxFilters = 4;
+
+    void Configure(const std::vector<FilterSpec>& specs);
+    void Reset();
+    LONG Process(LONG x, double tSec);
+    bool Settled() const;
+    bool Empty() const { return m_count == 0; }
+private:
+    AxisFilter m_filters[kMaxFilters];
+    int m_count = 0;
+};
\ No newline at end of file
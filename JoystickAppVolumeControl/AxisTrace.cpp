@@ -0,0 +1,173 @@
+#include "AxisTrace.h"
+#include <stddef.h>
+#include <stdio.h>
+#include <string.h>
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <unistd.h>
+#endif
+
+static const char kTraceMagic[4] = { 'J', 'A', 'V', 'T' };
+static const uint32_t kTraceVersion = 1;
+
+TraceRecorder::~TraceRecorder() {
+    Close();
+}
+
+bool TraceRecorder::Open(const std::string& path, size_t initialBytes) {
+    Close();
+#ifdef _WIN32
+    HANDLE h = CreateFileA(path.c_str(), GENERIC_READ | GENERIC_WRITE, FILE_SHARE_READ, nullptr, CREATE_ALWAYS, FILE_ATTRIBUTE_NORMAL, nullptr);
+    if (h == INVALID_HANDLE_VALUE) return false;
+    m_hFile = h;
+#else
+    m_fd = open(path.c_str(), O_RDWR | O_CREAT | O_TRUNC, 0644);
+    if (m_fd < 0) return false;
+#endif
+    if (initialBytes < sizeof(TraceFileHeader) + 4096) initialBytes = sizeof(TraceFileHeader) + 4096;
+    if (!Map(initialBytes)) {
+        Close();
+        return false;
+    }
+    TraceFileHeader hdr = {};
+    memcpy(hdr.magic, kTraceMagic, sizeof(hdr.magic));
+    hdr.version = kTraceVersion;
+    hdr.usedBytes = sizeof(hdr);
+    memcpy(m_base, &hdr, sizeof(hdr));
+    m_used = sizeof(hdr);
+    m_records = 0;
+    m_start = Clock::now();
+    return true;
+}
+
+bool TraceRecorder::Map(size_t bytes) {
+#ifdef _WIN32
+    HANDLE hMap = CreateFileMappingA((HANDLE)m_hFile, nullptr, PAGE_READWRITE, (DWORD)((uint64_t)bytes >> 32), (DWORD)bytes, nullptr);
+    if (!hMap) return false;
+    void* base = MapViewOfFile(hMap, FILE_MAP_WRITE, 0, 0, bytes);
+    if (!base) {
+        CloseHandle(hMap);
+        return false;
+    }
+    m_hMapping = hMap;
+#else
+    if (ftruncate(m_fd, (off_t)bytes) != 0) return false;
+    void* base = mmap(nullptr, bytes, PROT_READ | PROT_WRITE, MAP_SHARED, m_fd, 0);
+    if (base == MAP_FAILED) return false;
+#endif
+    m_base = (uint8_t*)base;
+    m_capacity = bytes;
+    return true;
+}
+
+void TraceRecorder::Unmap() {
+    if (!m_base) return;
+#ifdef _WIN32
+    UnmapViewOfFile(m_base);
+    CloseHandle((HANDLE)m_hMapping);
+    m_hMapping = nullptr;
+#else
+    munmap(m_base, m_capacity);
+#endif
+    m_base = nullptr;
+}
+
+void TraceRecorder::Close() {
+    Unmap();
+    // Trim the file to the data actually written.
+#ifdef _WIN32
+    if (m_hFile) {
+        LARGE_INTEGER size;
+        size.QuadPart = (LONGLONG)m_used;
+        if (m_used && SetFilePointerEx((HANDLE)m_hFile, size, nullptr, FILE_BEGIN))
+            SetEndOfFile((HANDLE)m_hFile);
+        CloseHandle((HANDLE)m_hFile);
+        m_hFile = nullptr;
+    }
+#else
+    if (m_fd >= 0) {
+        if (m_used && ftruncate(m_fd, (off_t)m_used) != 0) perror("TraceRecorder: ftruncate");
+        close(m_fd);
+        m_fd = -1;
+    }
+#endif
+    m_capacity = 0;
+    m_used = 0;
+}
+
+void TraceRecorder::Append(TraceRecordType type, int device, int target, const void* payload, uint32_t bytes) {
+    if (!m_base) return;
+    size_t need = sizeof(TraceRecordHeader) + bytes;
+    if (m_used + need > m_capacity) {
+        size_t grown = m_capacity * 2;
+        Unmap();
+        if (!Map(grown)) {
+            Close();
+            return;
+        }
+    }
+    TraceRecordHeader rec = {};
+    rec.type = (uint8_t)type;
+    rec.device = (uint8_t)device;
+    rec.target = (uint16_t)target;
+    rec.payloadBytes = bytes;
+    rec.timestampNs = std::chrono::duration_cast<std::chrono::nanoseconds>(Clock::now() - m_start).count();
+    memcpy(m_base + m_used, &rec, sizeof(rec));
+    memcpy(m_base + m_used + sizeof(rec), payload, bytes);
+    m_used += need;
+    ++m_records;
+    memcpy(m_base + offsetof(TraceFileHeader, usedBytes), &m_used, sizeof(m_used));
+}
+
+void TraceRecorder::RecordJoyState(int device, const DIJOYSTATE2& js) {
+    Append(TraceRecordType::JoyState, device, 0, &js, sizeof(js));
+}
+
+void TraceRecorder::RecordVolume(int target, float v) {
+    Append(TraceRecordType::VolumeWrite, 0, target, &v, sizeof(v));
+}
+
+bool TraceReader::Load(const std::string& path) {
+    m_records.clear();
+    m_devices = 0;
+    FILE* f = fopen(path.c_str(), "rb");
+    if (!f) return false;
+    std::vector<uint8_t> data;
+    uint8_t buf[65536];
+    size_t n;
+    while ((n = fread(buf, 1, sizeof(buf), f)) > 0)
+        data.insert(data.end(), buf, buf + n);
+    fclose(f);
+
+    TraceFileHeader hdr;
+    if (data.size() < sizeof(hdr)) return false;
+    memcpy(&hdr, data.data(), sizeof(hdr));
+    if (memcmp(hdr.magic, kTraceMagic, sizeof(hdr.magic)) != 0 || hdr.version != kTraceVersion) return false;
+    size_t end = hdr.usedBytes < data.size() ? (size_t)hdr.usedBytes : data.size();
+    size_t pos = sizeof(hdr);
+    while (pos + sizeof(TraceRecordHeader) <= end) {
+        TraceRecordHeader rh;
+        memcpy(&rh, data.data() + pos, sizeof(rh));
+        pos += sizeof(rh);
+        if (pos + rh.payloadBytes > end) break;
+        TraceRecord rec = {};
+        rec.type = (TraceRecordType)rh.type;
+        rec.device = rh.device;
+        rec.target = rh.target;
+        rec.timestampNs = rh.timestampNs;
+        // DIJOYSTATE is a prefix of DIJOYSTATE2, so traces recorded before the switch load zero-extended.
+        if (rec.type == TraceRecordType::JoyState && (rh.payloadBytes == sizeof(DIJOYSTATE2) || rh.payloadBytes == sizeof(DIJOYSTATE))) {
+            memcpy(&rec.state, data.data() + pos, rh.payloadBytes);
+            if (rec.device + 1 > m_devices) m_devices = rec.device + 1;
+            m_records.push_back(rec);
+        } else if (rec.type == TraceRecordType::VolumeWrite && rh.payloadBytes == sizeof(float)) {
+            memcpy(&rec.volume, data.data() + pos, sizeof(float));
+            m_records.push_back(rec);
+        }
+        pos += rh.payloadBytes;
+    }
+    return true;
+}
\ No newline at end of file
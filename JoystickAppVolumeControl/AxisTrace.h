@@ -0,0 +1,120 @@
+#pragma once
+#include <chrono>
+#include <string>
+#include <vector>
+#include "AudioSink.h"
+#include "InputBackend.h"
+
+// Binary axis trace: a header followed by records, each a fixed 16-byte
+// TraceRecordHeader plus a payload sized by its type.
+//   TraceRecordType::JoyState   payload: DIJOYSTATE2 read from `device` (DIJOYSTATE in older traces)
+//   TraceRecordType::VolumeWrite payload: float volume written to `target`
+enum class TraceRecordType : uint8_t { JoyState = 1, VolumeWrite = 2 };
+
+#pragma pack(push, 1)
+struct TraceFileHeader {
+    char magic[4];          // "JAVT"
+    uint32_t version;
+    uint64_t usedBytes;     // bytes of valid data including this header; updated on every append
+};
+
+struct TraceRecordHeader {
+    uint8_t type;           // TraceRecordType
+    uint8_t device;
+    uint16_t target;
+    uint32_t payloadBytes;
+    int64_t timestampNs;    // since the recorder was opened
+};
+#pragma pack(pop)
+
+// Append-only recorder writing into a memory-mapped file. Each append is a memcpy
+// into the mapping plus a header update, so the trace stays readable even if the
+// process dies; the mapping grows by doubling when full. Not thread-safe: record
+// from the input thread only.
+class TraceRecorder {
+public:
+    typedef std::chrono::steady_clock Clock;
+
+    TraceRecorder() = default;
+    ~TraceRecorder();
+    TraceRecorder(const TraceRecorder&) = delete;
+    TraceRecorder& operator=(const TraceRecorder&) = delete;
+
+    bool Open(const std::string& path, size_t initialBytes = 1 << 20);
+    void Close();
+    bool IsOpen() const { return m_base != nullptr; }
+
+    void RecordJoyState(int device, const DIJOYSTATE2& js);
+    void RecordVolume(int target, float v);
+    uint64_t RecordCount() const { return m_records; }
+private:
+    void Append(TraceRecordType type, int device, int target, const void* payload, uint32_t bytes);
+    bool Map(size_t bytes);
+    void Unmap();
+
+    uint8_t* m_base = nullptr;
+    size_t m_capacity = 0;
+    uint64_t m_used = 0;
+    uint64_t m_records = 0;
+    Clock::time_point m_start;
+#ifdef _WIN32
+    void* m_hFile = nullptr;
+    void* m_hMapping = nullptr;
+#else
+    int m_fd = -1;
+#endif
+};
+
+struct TraceRecord {
+    TraceRecordType type;
+    int device;
+    int target;
+    int64_t timestampNs;
+    DIJOYSTATE2 state;      // JoyState
+    float volume;           // VolumeWrite
+};
+
+// Loads a whole trace into memory for replay.
+class TraceReader {
+public:
+    bool Load(const std::string& path);
+    const std::vector<TraceRecord>& Records() const { return m_records; }
+    int DeviceCount() const { return m_devices; }
+private:
+    std::vector<TraceRecord> m_records;
+    int m_devices = 0;
+};
+
+// InputBackend decorator that records every successful read.
+class RecordingInputBackend : public InputBackend {
+public:
+    RecordingInputBackend(InputBackend* inner, TraceRecorder* recorder, int device)
+        : m_inner(inner), m_recorder(recorder), m_device(device) {}
+    bool GetJoyState(DIJOYSTATE2& js) override {
+        if (!m_inner->GetJoyState(js)) return false;
+        m_recorder->RecordJoyState(m_device, js);
+        return true;
+    }
+    void SetNotify(WakeEvent* ev) override { m_inner->SetNotify(ev); }
+    bool IsEventDriven() const override { return m_inner->IsEventDriven(); }
+    uint64_t TakeChanges() override { return m_inner->TakeChanges(); }
+    bool IsPresent() const override { return m_inner->IsPresent(); }
+private:
+    InputBackend* m_inner;
+    TraceRecorder* m_recorder;
+    int m_device;
+};
+
+// AudioSink decorator that records every write it forwards.
+class RecordingSink : public AudioSink {
+public:
+    RecordingSink(AudioSink* next, TraceRecorder* recorder) : m_next(next), m_recorder(recorder) {}
+    void SetVolume(int target, float v) override {
+        m_recorder->RecordVolume(target, v);
+        if (m_next) m_next->SetVolume(target, v);
+    }
+    uint32_t Flush(bool force = false) override { return m_next ? m_next->Flush(force) : kNoPendingWrites; }
+private:
+    AudioSink* m_next;
+    TraceRecorder* m_recorder;
+};
\ No newline at end of file
@@ -0,0 +1,408 @@
+#include "BindingEngine.h"
+#include "LatencyStats.h"
+#include <algorithm>
+#include <utility>
+
+template<typename T> static T Clamp(T val, T min, T max) { return (val < min) ? min : (val > max ? max : val); }
+
+float MapAxisToVolume(LONG axisRaw, const Binding& b) {
+    double a_min = double(b.axisMin), a_max = double(b.axisMax);
+    double v_min = double(b.volMin), v_max = double(b.volMax);
+    if (a_min == a_max) { a_max = a_min + 1.0; } // avoid division by zero
+
+    double t = (double(axisRaw) - a_min) / (a_max - a_min);
+    if (t < 0.0) t = 0.0;
+    if (t > 1.0) t = 1.0;
+
+    double mapped = v_min + t * (v_max - v_min);
+    return Clamp((float)mapped, (float)Clamp(v_min, 0.0, 1.0), (float)Clamp(v_max, 0.0, 1.0));
+}
+
+int BindingSet::AddDevice(InputBackend* dev) {
+    for (size_t i = 0; i < m_devices.size(); ++i)
+        if (m_devices[i].dev == dev) return (int)i;
+    m_devices.push_back({ dev, 0, {}, {}, {}, DIJOYSTATE2(), true, false, false, false });
+    return (int)m_devices.size() - 1;
+}
+
+int BindingSet::AddBinding(const Binding& b) {
+    if (b.device < 0 || b.device >= (int)m_devices.size() || b.target < 0) return -1;
+    int idx = (int)m_bindings.size();
+    InputReader input = InputReader::For(b.axisOfs, b.povAngle);
+    int cal = -1;
+    if (b.autoCalibrate && !input.Digital()) {
+        for (size_t ci = 0; ci < m_calibrators.size(); ++ci)
+            if (m_calibrators[ci].device == b.device && m_calibrators[ci].axisOfs == b.axisOfs) cal = (int)ci;
+        if (cal < 0) {
+            cal = (int)m_calibrators.size();
+            m_calibrators.push_back({ b.device, b.axisOfs, AxisCalibrator(), {} });
+        }
+    }
+    m_bindings.push_back({ input, b.action, b.target, cal, b.volMin, b.volMax, b.step });
+    m_config.push_back(b);
+    m_curves.emplace_back();
+    m_filters.emplace_back();
+    // Buttons and hats are already clean on/off signals.
+    if (!input.Digital()) m_filters.back().Configure(b.filters);
+    m_status.push_back({ false, 0, 0, 0.0f });
+    if (b.target >= (int)m_levels.size()) m_levels.resize(b.target + 1, TargetLevel{ -1.0f, false });
+    m_devices[b.device].watchMask |= JoyStateBit(b.axisOfs);
+    BakeCurve(idx);
+    return idx;
+}
+
+int BindingSet::AddRule(const Rule& rule, std::string* error) {
+    for (int d : rule.devices) {
+        if (d < 0 || d >= (int)m_devices.size()) {
+            if (error) *error = "bad device index";
+            return -1;
+        }
+    }
+    if (rule.target < 0) {
+        if (error) *error = "bad target";
+        return -1;
+    }
+    RuleSlot r;
+    if (!r.program.Compile(rule.expression, (int)rule.devices.size(), error)) return -1;
+    r.target = rule.target;
+    r.devices = rule.devices;
+    r.states.assign(rule.devices.size(), nullptr);
+    r.dirty = r.valid = false;
+    r.volume = 0.0f;
+    for (size_t n = 0; n < rule.devices.size(); ++n)
+        m_devices[rule.devices[n]].watchMask |= r.program.WatchMask((int)n);
+    if (rule.target >= (int)m_levels.size()) m_levels.resize(rule.target + 1, TargetLevel{ -1.0f, false });
+    m_rules.push_back(std::move(r));
+    return (int)m_rules.size() - 1;
+}
+
+// Bakes the binding's table over its calibrated range once one is usable, else over its configured range.
+void BindingSet::BakeCurve(int binding) {
+    const Binding& b = m_config[binding];
+    LONG axisMin = b.axisMin, axisMax = b.axisMax;
+    if (m_bindings[binding].input.Digital()) {
+        // Released maps to volMin, pressed to volMax.
+        axisMin = 0;
+        axisMax = 1;
+    }
+    int cal = m_bindings[binding].calibrator;
+    if (cal >= 0 && m_calibrators[cal].calibrator.Usable()) {
+        const AxisCalibrator& c = m_calibrators[cal].calibrator;
+        // Keep the direction of the configured range; an inverted fader stays inverted.
+        axisMin = b.axisMin <= b.axisMax ? c.Min() : c.Max();
+        axisMax = b.axisMin <= b.axisMax ? c.Max() : c.Min();
+    }
+    m_curves[binding].Bake(axisMin, axisMax, b.volMin, b.volMax, b.curve);
+}
+
+void BindingSet::SeedCalibration(int binding, LONG low, LONG high) {
+    if (binding < 0 || binding >= (int)m_bindings.size()) return;
+    int cal = m_bindings[binding].calibrator;
+    if (cal < 0) return;
+    m_calibrators[cal].calibrator.Seed(low, high);
+    for (size_t bi = 0; bi < m_bindings.size(); ++bi)
+        if (m_bindings[bi].calibrator == cal) BakeCurve((int)bi);
+}
+
+bool BindingSet::CalibratedRange(int binding, LONG& low, LONG& high) const {
+    int cal = m_bindings[binding].calibrator;
+    if (cal < 0 || !m_calibrators[cal].calibrator.Usable()) return false;
+    low = m_calibrators[cal].calibrator.Min();
+    high = m_calibrators[cal].calibrator.Max();
+    return true;
+}
+
+void BindingSet::Seal() {
+    m_order.clear();
+    auto span = [this](Span& out, size_t count, auto member) {
+        out.first = (uint32_t)m_order.size();
+        for (size_t i = 0; i < count; ++i)
+            if (member(i)) m_order.push_back((uint32_t)i);
+        out.count = (uint32_t)m_order.size() - out.first;
+    };
+    for (size_t d = 0; d < m_devices.size(); ++d) {
+        DeviceSlot& slot = m_devices[d];
+        span(slot.bindings, m_bindings.size(), [&](size_t i) { return m_config[i].device == (int)d; });
+        span(slot.calibrators, m_calibrators.size(), [&](size_t i) { return m_calibrators[i].device == (int)d; });
+        span(slot.rules, m_rules.size(), [&](size_t i) {
+            const std::vector<int>& devices = m_rules[i].devices;
+            return std::find(devices.begin(), devices.end(), (int)d) != devices.end();
+        });
+    }
+    for (size_t c = 0; c < m_calibrators.size(); ++c)
+        span(m_calibrators[c].bindings, m_bindings.size(), [&](size_t i) { return m_bindings[i].calibrator == (int)c; });
+}
+
+void BindingSet::Reset(WakeEvent* wake) {
+    for (DeviceSlot& slot : m_devices) {
+        slot.dev->SetNotify(wake);
+        slot.forceRead = true;
+        slot.unsettled = false;
+        slot.parked = false;
+    }
+    for (BindingStatus& st : m_status)
+        st.valid = false;
+    for (FilterChain& f : m_filters)
+        f.Reset();
+    for (TargetLevel& t : m_levels)
+        t = TargetLevel{ -1.0f, false };
+    // m_devices no longer moves once the set is published.
+    for (RuleSlot& r : m_rules) {
+        for (size_t n = 0; n < r.devices.size(); ++n)
+            r.states[n] = &m_devices[r.devices[n]].state;
+        r.dirty = r.valid = false;
+    }
+}
+
+BindingSet& BindingEngine::Draft() {
+    if (!m_draft) m_draft.reset(new BindingSet());
+    return *m_draft;
+}
+
+const BindingSet& BindingEngine::Newest() const {
+    if (m_draft) return *m_draft;
+    return m_sets.empty() ? m_none : *m_sets.back();
+}
+
+void BindingEngine::Publish() {
+    if (!m_draft) return;
+    m_draft->Seal();
+    m_sets.push_back(std::move(m_draft));
+    m_published.store(m_sets.back().get(), std::memory_order_release);
+    Reclaim();
+}
+
+void BindingEngine::Reclaim() {
+    // The input thread only ever moves to newer sets, so everything before the one it
+    // has adopted is out of its reach.
+    const BindingSet* adopted = m_adopted.load(std::memory_order_acquire);
+    for (size_t i = 0; i < m_sets.size(); ++i) {
+        if (m_sets[i].get() != adopted) continue;
+        m_sets.erase(m_sets.begin(), m_sets.begin() + i);
+        break;
+    }
+}
+
+void BindingEngine::Clear() {
+    m_draft.reset();
+    m_active = &m_none;
+    m_published.store(nullptr, std::memory_order_relaxed);
+    m_adopted.store(nullptr, std::memory_order_relaxed);
+    m_sets.clear();
+}
+
+void BindingEngine::Adopt(BindingSet* set, bool keepLevels) {
+    BindingSet* old = m_active;
+    if (old != set) {
+        for (const BindingSet::DeviceSlot& slot : old->m_devices) {
+            bool kept = false;
+            for (const BindingSet::DeviceSlot& next : set->m_devices)
+                kept = kept || next.dev == slot.dev;
+            if (!kept) slot.dev->SetNotify(nullptr);
+        }
+    }
+    set->Reset(&m_wake);
+    if (keepLevels) {
+        size_t n = std::min(old->m_levels.size(), set->m_levels.size());
+        std::copy(old->m_levels.begin(), old->m_levels.begin() + n, set->m_levels.begin());
+    }
+    m_active = set;
+    m_unsettled = false;
+    if (set != &m_none) m_adopted.store(set, std::memory_order_release);
+}
+
+void BindingEngine::Start() {
+    if (m_draft) Publish();
+    BindingSet* set = m_published.load(std::memory_order_acquire);
+    Adopt(set ? set : &m_none, false);
+    m_epoch = std::chrono::steady_clock::now();
+}
+
+void BindingEngine::Stop() {
+    for (BindingSet::DeviceSlot& slot : m_active->m_devices)
+        slot.dev->SetNotify(nullptr);
+    if (m_sink) m_sink->Flush(true);
+}
+
+int BindingEngine::Tick() {
+    return Tick(std::chrono::duration<double>(std::chrono::steady_clock::now() - m_epoch).count());
+}
+
+int BindingEngine::Tick(double now) {
+    STAGE_TIMER(Stage::Tick);
+    STAT_COUNT(StatCounter::Ticks);
+    BindingSet* published = m_published.load(std::memory_order_acquire);
+    if (published && published != m_active) {
+        Adopt(published, true);
+        m_swaps.fetch_add(1, std::memory_order_relaxed);
+    }
+    BindingSet& set = *m_active;
+    const uint32_t* order = set.m_order.data();
+    int changed = 0;
+    m_unsettled = false;
+    for (BindingSet::DeviceSlot& slot : set.m_devices) {
+        if (!slot.dev->IsPresent()) {
+            // Unplugged: the bindings keep their last volume and cost nothing until the device returns.
+            slot.parked = true;
+            slot.ok = false;
+            continue;
+        }
+        if (slot.parked) {
+            slot.parked = false;
+            slot.forceRead = true;
+        }
+        uint64_t changes = slot.dev->TakeChanges();
+        if (slot.forceRead || (changes & slot.watchMask)) {
+            ++m_deviceReads;
+            STAT_COUNT(StatCounter::DeviceReads);
+            {
+                STAGE_TIMER(Stage::DeviceRead);
+                slot.ok = slot.dev->GetJoyState(slot.state);
+            }
+            if (!slot.ok) {
+                slot.forceRead = true;
+                slot.parked = !slot.dev->IsPresent();
+                continue;
+            }
+            slot.forceRead = false;
+            for (uint32_t i = 0; i < slot.rules.count; ++i)
+                set.m_rules[order[slot.rules.first + i]].dirty = true;
+            for (uint32_t i = 0; i < slot.calibrators.count; ++i) {
+                BindingSet::CalibratedAxis& ca = set.m_calibrators[order[slot.calibrators.first + i]];
+                if (!ca.calibrator.Add(*(const LONG*)((const BYTE*)&slot.state + ca.axisOfs))) continue;
+                // New range: rebake and force the bindings to re-map even if their input did not move.
+                for (uint32_t j = 0; j < ca.bindings.count; ++j) {
+                    uint32_t bi = order[ca.bindings.first + j];
+                    set.BakeCurve((int)bi);
+                    set.m_status[bi].valid = false;
+                }
+            }
+        } else if (!slot.unsettled) {
+            continue;
+        }
+        // Reached on a fresh read, or to keep feeding the last state into filters that have not converged yet.
+        slot.unsettled = false;
+        for (uint32_t i = 0; i < slot.bindings.count; ++i) {
+            uint32_t bi = order[slot.bindings.first + i];
+            const BindingSet::BindingSlot& b = set.m_bindings[bi];
+            BindingStatus& st = set.m_status[bi];
+            FilterChain& filter = set.m_filters[bi];
+            LONG raw = b.input.Read(slot.state);
+            if (b.action != BindingAction::Volume) {
+                // Fires on the press edge; the first read after Start only learns the state.
+                bool press = st.valid && raw && !st.axisRaw;
+                st.valid = true;
+                st.axisRaw = st.axisFiltered = raw;
+                if (!press) continue;
+                st.volume = ApplyAction(b);
+                ++changed;
+                continue;
+            }
+            LONG filtered = raw;
+            if (!filter.Empty()) {
+                STAGE_TIMER(Stage::Filter);
+                filtered = filter.Process(raw, now);
+            }
+            if (!filter.Settled()) slot.unsettled = m_unsettled = true;
+            st.axisRaw = raw;
+            if (st.valid && filtered == st.axisFiltered) continue;
+            st.valid = true;
+            st.axisFiltered = filtered;
+            {
+                STAGE_TIMER(Stage::Map);
+                st.volume = set.m_curves[bi].Lookup(filtered);
+            }
+            if (SetTargetLevel(b.target, st.volume)) ++changed;
+        }
+    }
+    if (!set.m_rules.empty()) changed += EvaluateRules();
+    return changed;
+}
+
+// Sets a target's level and writes it unless the target is muted; the level is then
+// restored on unmute. Returns true if a write went out.
+bool BindingEngine::SetTargetLevel(int target, float v) {
+    BindingSet::TargetLevel& level = m_active->m_levels[target];
+    level.level = v;
+    if (level.muted) return false;
+    if (m_sink) {
+        STAGE_TIMER(Stage::SinkWrite);
+        m_sink->SetVolume(target, v);
+    }
+    return true;
+}
+
+// Re-evaluates the rules whose devices were read this tick. A rule with a device that
+// has no good state (not read yet, or parked) keeps its last volume.
+int BindingEngine::EvaluateRules() {
+    int changed = 0;
+    for (BindingSet::RuleSlot& r : m_active->m_rules) {
+        if (!r.dirty) continue;
+        r.dirty = false;
+        bool ready = true;
+        for (int d : r.devices) ready = ready && m_active->m_devices[d].ok;
+        if (!ready) continue;
+        float v;
+        {
+            STAGE_TIMER(Stage::Map);
+            v = r.program.Evaluate(r.states.data());
+        }
+        if (r.valid && v == r.volume) continue;
+        r.valid = true;
+        r.volume = v;
+        if (SetTargetLevel(r.target, v)) ++changed;
+    }
+    return changed;
+}
+
+// Applies a press of a MuteToggle/StepUp/StepDown binding to its target's shared level.
+// Returns the volume written.
+float BindingEngine::ApplyAction(const BindingSet::BindingSlot& b) {
+    BindingSet::TargetLevel& t = m_active->m_levels[b.target];
+    float lo = Clamp(b.volMin, 0.0f, 1.0f), hi = Clamp(b.volMax, 0.0f, 1.0f);
+    if (lo > hi) std::swap(lo, hi);
+    // Nothing has set the target yet: start stepping (or unmute) from the top of the range.
+    float level = t.level < 0.0f ? hi : t.level;
+    switch (b.action) {
+    case BindingAction::MuteToggle:
+        t.muted = !t.muted;
+        break;
+    case BindingAction::StepUp:
+        level = Clamp(level + b.step, lo, hi);
+        t.muted = false;
+        break;
+    case BindingAction::StepDown:
+        level = Clamp(level - b.step, lo, hi);
+        t.muted = false;
+        break;
+    default:
+        break;
+    }
+    t.level = level;
+    float v = t.muted ? 0.0f : level;
+    if (m_sink) {
+        STAGE_TIMER(Stage::SinkWrite);
+        m_sink->SetVolume(b.target, v);
+    }
+    return v;
+}
+
+void BindingEngine::Wait(bool changed) {
+    // Parked devices are not polled; the device manager wakes the engine when one returns.
+    const std::vector<BindingSet::DeviceSlot>& devices = m_active->m_devices;
+    bool eventDriven = !devices.empty();
+    for (const BindingSet::DeviceSlot& slot : devices)
+        if (!slot.parked && (!slot.ok || slot.forceRead || !slot.dev->IsEventDriven())) eventDriven = false;
+    uint32_t timeoutMs = eventDriven ? WakeEvent::kInfinite : m_pollRate.Next(changed);
+    if (m_unsettled && timeoutMs > kFilterSettleMs) timeoutMs = kFilterSettleMs;
+    // Held-back volume writes must land even if the input goes quiet.
+    uint32_t flushMs = m_sink ? m_sink->Flush() : AudioSink::kNoPendingWrites;
+    m_wake.Wait(flushMs < timeoutMs ? flushMs : timeoutMs);
+}
+
+void BindingEngine::Run(const std::atomic<bool>& running) {
+    Start();
+    while (running)
+        Wait(Tick() > 0);
+    Stop();
+}
\ No newline at end of file
@@ -0,0 +1,227 @@
+#pragma once
+#include <atomic>
+#include <chrono>
+#include <memory>
+#include <vector>
+#include "AudioSink.h"
+#include "InputBackend.h"
+#include "AxisCalibrator.h"
+#include "AxisFilter.h"
+#include "JoyInputs.h"
+#include "MappingRule.h"
+#include "ResponseCurve.h"
+
+// What a binding does with its input. Volume follows the input (an axis, or a button or
+// hat direction held for volMax); the others fire once per press of a button or hat direction.
+enum class BindingAction : uint8_t { Volume, MuteToggle, StepUp, StepDown };
+
+// Maps one input of one device to one audio target.
+struct Binding {
+    int device;     // index returned by BindingEngine::AddDevice
+    DWORD axisOfs;  // DIJOYSTATE2 offset of the input: an axis, POV hat or button (see JoyInputs.h)
+    int target;     // AudioSink target id
+    LONG axisMin, axisMax;
+    float volMin, volMax;
+    CurveSpec curve;    // baked into a lookup table by AddBinding; linear if left empty
+    std::vector<FilterSpec> filters;    // smoothing stages applied to the raw axis before the curve
+    bool autoCalibrate = false;         // replace axisMin/axisMax with the range learned from the device axis
+    uint16_t povAngle = 0;              // POV inputs: the hat direction that presses the binding
+    BindingAction action = BindingAction::Volume;
+    float step = 0.05f;                 // StepUp/StepDown: volume change per press, clamped to volMin..volMax
+};
+
+// Drives one audio target from an expression over inputs of any number of devices
+// (see MappingRule.h), e.g. a fader times a master fader on another device.
+struct Rule {
+    std::vector<int> devices;   // indices returned by AddDevice; dN in the expression is devices[N]
+    int target;
+    std::string expression;
+};
+
+struct BindingStatus {
+    bool valid;     // false until the first sample was read
+    LONG axisRaw;       // axis position, or 1/0 for a pressed/released button or hat direction
+    LONG axisFiltered;  // after the binding's filter chain; what the curve was evaluated at
+    float volume;       // volume the binding last set for its target (0 once its mute toggle is on)
+};
+
+// Reference linear mapping (the original per-tick lerp); the engine uses the baked CurveTable.
+float MapAxisToVolume(LONG axisRaw, const Binding& b);
+
+// A compiled configuration: devices, bindings and rules flattened into arrays of plain
+// structs indexed by small ids (device slot, binding index, AudioSink target id), so a
+// tick reads no strings and allocates nothing. Built with the Add* calls, then handed to
+// a BindingEngine, after which the configuration never changes. The run state kept next
+// to it (filter history, learned ranges, last status, target levels) is touched only by
+// the input thread.
+class BindingSet {
+public:
+    BindingSet() = default;
+    BindingSet(const BindingSet&) = delete;
+    BindingSet& operator=(const BindingSet&) = delete;
+
+    int AddDevice(InputBackend* dev);
+    int AddBinding(const Binding& b);
+    // Compiles the rule's expression; returns -1 with the reason in error if it does not compile.
+    int AddRule(const Rule& rule, std::string* error = nullptr);
+    // Starts an auto-calibrating binding's axis from a persisted range (low/high in raw counts).
+    void SeedCalibration(int binding, LONG low, LONG high);
+
+    size_t BindingCount() const { return m_bindings.size(); }
+    size_t RuleCount() const { return m_rules.size(); }
+    size_t DeviceCount() const { return m_devices.size(); }
+    const BindingStatus& Status(int binding) const { return m_status[binding]; }
+    bool DeviceOk(int device) const { return m_devices[device].ok; }
+    // Last volume the rule set; only meaningful once the rule has been evaluated.
+    float RuleVolume(int rule) const { return m_rules[rule].volume; }
+    // Learned range of an auto-calibrating binding's axis; false until it is usable.
+    bool CalibratedRange(int binding, LONG& low, LONG& high) const;
+private:
+    friend class BindingEngine;
+
+    // A run of m_order entries: the bindings, calibrated axes or rules of one device, or
+    // the bindings of one calibrated axis.
+    struct Span {
+        uint32_t first, count;
+    };
+    struct DeviceSlot {
+        InputBackend* dev;
+        uint64_t watchMask;         // JoyStateBit() of every axis bound to this device
+        Span bindings, calibrators, rules;
+        DIJOYSTATE2 state;          // last state read, replayed into unsettled filters
+        bool forceRead;
+        bool ok;
+        bool unsettled;             // a binding's filter still converging on the last input
+        bool parked;                // device gone; skipped by Tick and Wait until it is present again
+    };
+    // What a tick needs of a binding; the full Binding is only read again to rebake the curve.
+    struct BindingSlot {
+        InputReader input;
+        BindingAction action;
+        int target;
+        int calibrator;             // index into m_calibrators, -1 when not auto-calibrating
+        float volMin, volMax, step;
+    };
+    // One per calibrated device axis, shared by every binding on that axis.
+    struct CalibratedAxis {
+        int device;
+        DWORD axisOfs;
+        AxisCalibrator calibrator;
+        Span bindings;
+    };
+    struct RuleSlot {
+        MappingProgram program;
+        int target;
+        std::vector<int> devices;
+        std::vector<const DIJOYSTATE2*> states;     // &m_devices[devices[N]].state, set by Reset
+        bool dirty;     // one of its devices was read this tick
+        bool valid;
+        float volume;
+    };
+    // Per audio target, shared by every binding that writes it.
+    struct TargetLevel {
+        float level;    // volume while unmuted; < 0 until a binding sets one
+        bool muted;
+    };
+
+    // Lays out the index lists in m_order; called once, when the set is published.
+    void Seal();
+    // Puts the run state back to where Start leaves it.
+    void Reset(WakeEvent* wake);
+    void BakeCurve(int binding);
+
+    std::vector<DeviceSlot> m_devices;
+    std::vector<BindingSlot> m_bindings;
+    std::vector<Binding> m_config;      // as added, for rebaking after calibration
+    std::vector<CurveTable> m_curves;
+    std::vector<FilterChain> m_filters;
+    std::vector<BindingStatus> m_status;
+    std::vector<CalibratedAxis> m_calibrators;
+    std::vector<TargetLevel> m_levels;  // indexed by AudioSink target id
+    std::vector<RuleSlot> m_rules;
+    std::vector<uint32_t> m_order;      // binding, calibrator and rule indices grouped by owner, laid out by Seal
+};
+
+// Drives any number of bindings from a single input thread. Each tick reads every
+// device with pending changes exactly once and fans the DIJOYSTATE2 out to all of
+// the bindings that reference it. Bindings sharing a target share its level: a mute
+// toggle silences whatever level the fader or step buttons last set, and restores it.
+//
+// The configuration is a BindingSet. The Add* calls build a draft; Publish() hands it
+// to the input thread, which swaps it in at the start of its next tick, so bindings
+// can change while the engine runs. Target levels carry over to the new set; its
+// devices are read afresh. A published set is freed by the configuring thread once the
+// input thread has moved on to a newer one. Devices must outlive the sets using them.
+class BindingEngine {
+public:
+    BindingEngine() = default;
+    BindingEngine(const BindingEngine&) = delete;
+    BindingEngine& operator=(const BindingEngine&) = delete;
+
+    // Configuration, all on one thread; they edit the draft set.
+    int AddDevice(InputBackend* dev) { return Draft().AddDevice(dev); }
+    int AddBinding(const Binding& b) { return Draft().AddBinding(b); }
+    int AddRule(const Rule& rule, std::string* error = nullptr) { return Draft().AddRule(rule, error); }
+    void SeedCalibration(int binding, LONG low, LONG high) { Draft().SeedCalibration(binding, low, high); }
+    // Makes the draft the engine's configuration; safe while the engine is running.
+    void Publish();
+    void SetSink(AudioSink* sink) { m_sink = sink; }
+    AudioSink* Sink() const { return m_sink; }
+    // Drops every set; only valid while the engine is not running.
+    void Clear();
+
+    // Publishes a pending draft, attaches the wake event to every device and forces a
+    // full read on the next tick.
+    void Start();
+    void Stop();
+    // One scheduler pass. Returns the number of bindings whose volume changed.
+    int Tick();
+    // Same, with filter time supplied by the caller (seconds since Start); used by trace replay.
+    int Tick(double nowSec);
+    // Flushes the sink, then blocks until a device reports data, the poll interval,
+    // a pending sink flush or a filter settle interval expires, or Wake() is called.
+    void Wait(bool changed);
+    void Wake() { m_wake.Set(); }
+    // Runs Tick/Wait until running is cleared (and Wake() called).
+    void Run(const std::atomic<bool>& running);
+
+    // The newest configuration (the draft while there is one); for the configuring thread.
+    size_t BindingCount() const { return Newest().BindingCount(); }
+    size_t RuleCount() const { return Newest().RuleCount(); }
+    size_t DeviceCount() const { return Newest().DeviceCount(); }
+    // The set the input thread is running; read it from that thread, or once it stopped.
+    const BindingSet& Active() const { return *m_active; }
+    const BindingStatus& Status(int binding) const { return m_active->Status(binding); }
+    bool DeviceOk(int device) const { return m_active->DeviceOk(device); }
+    float RuleVolume(int rule) const { return m_active->RuleVolume(rule); }
+    bool CalibratedRange(int binding, LONG& low, LONG& high) const { return m_active->CalibratedRange(binding, low, high); }
+    uint64_t DeviceReads() const { return m_deviceReads; }
+    // Sets the input thread has swapped in since Start.
+    uint64_t Swaps() const { return m_swaps.load(std::memory_order_relaxed); }
+private:
+    static const uint32_t kFilterSettleMs = 10;
+
+    BindingSet& Draft();
+    const BindingSet& Newest() const;
+    // Input thread: switches to set; keepLevels carries the target levels over from the old one.
+    void Adopt(BindingSet* set, bool keepLevels);
+    // Frees the published sets older than the one the input thread runs.
+    void Reclaim();
+    float ApplyAction(const BindingSet::BindingSlot& b);
+    bool SetTargetLevel(int target, float v);
+    int EvaluateRules();
+
+    std::unique_ptr<BindingSet> m_draft;
+    std::vector<std::unique_ptr<BindingSet>> m_sets;    // published, oldest first; configuring thread
+    std::atomic<BindingSet*> m_published{nullptr};      // newest of m_sets
+    std::atomic<const BindingSet*> m_adopted{nullptr};  // what the input thread runs; older sets are free
+    BindingSet m_none;
+    BindingSet* m_active = &m_none;                     // input thread
+    std::atomic<uint64_t> m_swaps{0};
+    AudioSink* m_sink = nullptr;
+    WakeEvent m_wake;
+    AdaptivePollRate m_pollRate;
+    std::chrono::steady_clock::time_point m_epoch;
+    bool m_unsettled = false;
+    uint64_t m_deviceReads = 0;
+};
@@ -0,0 +1,183 @@
+#include "DeviceManager.h"
+#include "LatencyStats.h"
+#include "log.h"
+
+static double MsBetween(std::chrono::steady_clock::time_point from, std::chrono::steady_clock::time_point to) {
+    return std::chrono::duration<double, std::milli>(to - from).count();
+}
+
+bool ManagedDevice::GetJoyState(DIJOYSTATE2& js) {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    if (!m_inner) return false;
+    if (!m_inner->GetJoyState(js)) {
+        if (!m_inner->IsPresent()) MarkLostLocked(true);
+        return false;
+    }
+    if (m_reattachPending) {
+        m_reattachPending = false;
+        Clock::time_point now = Clock::now();
+        double ms = MsBetween(m_attachedAt, now);
+        m_health.lastReattachMs = ms;
+        if (ms > m_health.maxReattachMs) m_health.maxReattachMs = ms;
+        STAGE_RECORD(Stage::Reattach, (uint64_t)std::chrono::duration_cast<std::chrono::nanoseconds>(now - m_attachedAt).count());
+        LOG_INFO("Device %s back after %.0f ms, first read %.2f ms after reopen", m_current.instanceId.c_str(), m_health.lastOutageMs, ms);
+    }
+    return true;
+}
+
+void ManagedDevice::SetNotify(WakeEvent* ev) {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_notify = ev;
+    if (m_inner) m_inner->SetNotify(ev);
+}
+
+bool ManagedDevice::IsEventDriven() const {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_inner && m_inner->IsEventDriven();
+}
+
+uint64_t ManagedDevice::TakeChanges() {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    if (!m_inner) return 0;
+    uint64_t mask = m_inner->TakeChanges();
+    if (m_fresh) {
+        m_fresh = false;
+        return kAllJoyStateBits;
+    }
+    return mask;
+}
+
+DeviceHealth ManagedDevice::Health() const {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    DeviceHealth health = m_health;
+    health.present = IsPresent();
+    return health;
+}
+
+void ManagedDevice::MarkLostLocked(bool requestRescan) {
+    if (!m_present.load(std::memory_order_relaxed)) return;
+    m_present.store(false, std::memory_order_release);
+    m_lostAt = Clock::now();
+    ++m_health.lossCount;
+    STAT_COUNT(StatCounter::DeviceLosses);
+    LOG_WARN("Device %s lost, parking its bindings", m_current.instanceId.c_str());
+    if (requestRescan && m_onLost && *m_onLost) (*m_onLost)();
+}
+
+void ManagedDevice::Attach(std::unique_ptr<InputBackend> inner, const DeviceIdentity& found) {
+    WakeEvent* notify;
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        inner.swap(m_inner);
+        m_current = found;
+        notify = m_notify;
+        if (notify) m_inner->SetNotify(notify);
+        m_fresh = true;
+        m_attachedAt = Clock::now();
+        if (m_health.lossCount) {
+            m_health.lastOutageMs = MsBetween(m_lostAt, m_attachedAt);
+            ++m_health.reattachCount;
+            m_reattachPending = true;
+            STAT_COUNT(StatCounter::DeviceReattaches);
+        }
+        m_present.store(true, std::memory_order_release);
+    }
+    // Whatever was open before is released outside the lock; the engine is woken to unpark.
+    inner.reset();
+    if (notify) notify->Set();
+}
+
+std::unique_ptr<InputBackend> ManagedDevice::Detach() {
+    std::unique_ptr<InputBackend> inner;
+    WakeEvent* notify;
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        MarkLostLocked(false);     // found missing by an enumeration already
+        inner.swap(m_inner);
+        m_reattachPending = false;
+        notify = m_notify;
+    }
+    if (notify) notify->Set();
+    return inner;
+}
+
+ManagedDevice* DeviceManager::Track(const DeviceIdentity& wanted, std::unique_ptr<InputBackend> opened, const DeviceIdentity& found) {
+    m_devices.emplace_back(new ManagedDevice);
+    ManagedDevice* d = m_devices.back().get();
+    d->m_onLost = &m_onLost;
+    d->m_wanted = wanted;
+    d->m_current = wanted;
+    if (opened) d->Attach(std::move(opened), found);
+    else LOG_WARN("Device %s not attached, its bindings wait for it", wanted.instanceId.c_str());
+    return d;
+}
+
+void DeviceManager::Clear() {
+    m_devices.clear();
+}
+
+bool DeviceManager::AnyParked() const {
+    for (const std::unique_ptr<ManagedDevice>& d : m_devices)
+        if (!d->IsPresent()) return true;
+    return false;
+}
+
+int DeviceManager::FindMatch(const DeviceIdentity& known, const std::vector<DeviceIdentity>& attached, const std::vector<bool>& claimed) const {
+    for (size_t i = 0; i < attached.size(); ++i)
+        if (!claimed[i] && attached[i].instanceId == known.instanceId) return (int)i;
+    int byProduct = -1, productCount = 0, byName = -1, nameCount = 0;
+    for (size_t i = 0; i < attached.size(); ++i) {
+        if (claimed[i]) continue;
+        const DeviceIdentity& a = attached[i];
+        if (!known.productId.empty() && a.productId == known.productId) {
+            if (!known.path.empty() && a.path == known.path) return (int)i;
+            byProduct = (int)i;
+            ++productCount;
+        } else if (known.productId.empty() && !known.name.empty() && a.name == known.name) {
+            byName = (int)i;
+            ++nameCount;
+        }
+    }
+    // Several identical controllers on new ports cannot be told apart; leave them parked.
+    if (productCount == 1) return byProduct;
+    if (nameCount == 1) return byName;
+    return -1;
+}
+
+int DeviceManager::Reconcile(const std::vector<DeviceIdentity>& attached) {
+    std::vector<bool> claimed(attached.size(), false);
+    for (const std::unique_ptr<ManagedDevice>& d : m_devices) {
+        if (!d->IsPresent()) continue;
+        std::string current;
+        {
+            std::lock_guard<std::mutex> lock(d->m_mutex);
+            current = d->m_current.instanceId;
+        }
+        bool found = false;
+        for (size_t i = 0; i < attached.size() && !found; ++i) {
+            if (claimed[i] || attached[i].instanceId != current) continue;
+            claimed[i] = found = true;
+        }
+        if (!found) d->Detach();
+    }
+    int reattached = 0;
+    for (const std::unique_ptr<ManagedDevice>& d : m_devices) {
+        if (d->IsPresent() || !m_open) continue;
+        DeviceIdentity known;
+        {
+            std::lock_guard<std::mutex> lock(d->m_mutex);
+            known = d->m_current;
+        }
+        // Fill in whatever the last open did not know from the binding.
+        if (known.productId.empty()) known.productId = d->m_wanted.productId;
+        if (known.name.empty()) known.name = d->m_wanted.name;
+        int i = FindMatch(known, attached, claimed);
+        if (i < 0) continue;
+        std::unique_ptr<InputBackend> inner = m_open(attached[i]);
+        if (!inner) continue;
+        claimed[i] = true;
+        d->Attach(std::move(inner), attached[i]);
+        ++reattached;
+    }
+    return reattached;
+}
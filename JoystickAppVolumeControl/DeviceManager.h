@@ -0,0 +1,98 @@
+#pragma once
+#include <atomic>
+#include <chrono>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+#include "InputBackend.h"
+
+// How a device is recognised again after it was unplugged. The instance GUID is
+// stable for most devices; when it is not, the product GUID (VID/PID) and the
+// device interface path (same USB port) identify it.
+struct DeviceIdentity {
+    std::string instanceId;     // "{...}" instance GUID
+    std::string productId;      // "{...}" product GUID; empty if unknown (old profiles)
+    std::wstring path;          // device interface path; empty if unknown
+    std::wstring name;          // product name, the last resort when the product GUID is unknown
+};
+
+struct DeviceHealth {
+    bool present;
+    uint32_t lossCount;
+    uint32_t reattachCount;
+    double lastOutageMs;        // from loss to the device being opened again
+    double lastReattachMs;      // from reopen to the first good read by the input thread
+    double maxReattachMs;
+};
+
+// The InputBackend the engine holds for a tracked device. It forwards to whichever
+// backend is currently open for the device and stays valid while the device is
+// gone: IsPresent() is then false and the engine parks the device's bindings.
+class ManagedDevice : public InputBackend {
+public:
+    bool GetJoyState(DIJOYSTATE2& js) override;
+    void SetNotify(WakeEvent* ev) override;
+    bool IsEventDriven() const override;
+    uint64_t TakeChanges() override;
+    bool IsPresent() const override { return m_present.load(std::memory_order_acquire); }
+
+    const DeviceIdentity& Wanted() const { return m_wanted; }
+    DeviceHealth Health() const;
+private:
+    friend class DeviceManager;
+    typedef std::chrono::steady_clock Clock;
+
+    void Attach(std::unique_ptr<InputBackend> inner, const DeviceIdentity& found);
+    std::unique_ptr<InputBackend> Detach();
+    // requestRescan: the loss was noticed by a read, so the owner should confirm it with an enumeration.
+    void MarkLostLocked(bool requestRescan);
+
+    DeviceIdentity m_wanted;
+    DeviceIdentity m_current;       // what is (or was last) open; guarded by m_mutex
+    mutable std::mutex m_mutex;     // the inner backend may be swapped while the input thread reads
+    std::unique_ptr<InputBackend> m_inner;
+    WakeEvent* m_notify = nullptr;
+    bool m_fresh = false;           // report every element changed on the first read after attach
+    bool m_reattachPending = false;
+    Clock::time_point m_lostAt, m_attachedAt;
+    DeviceHealth m_health = {};
+    const std::function<void()>* m_onLost = nullptr;
+    std::atomic<bool> m_present{false};
+};
+
+// Keeps bound devices attached across unplug/replug. Devices are tracked once when
+// the engine is built; after every device enumeration (triggered by arrival and
+// removal notifications) Reconcile() parks the ones that vanished and reopens parked
+// ones that came back, matching by instance GUID, then product GUID and path, then a
+// unique product GUID (or name) not already claimed by another tracked device.
+class DeviceManager {
+public:
+    // Opens a backend for a device found by Reconcile; nullptr if it cannot be opened.
+    typedef std::function<std::unique_ptr<InputBackend>(const DeviceIdentity& found)> Opener;
+
+    explicit DeviceManager(Opener open = nullptr) : m_open(std::move(open)) {}
+    void SetOpener(Opener open) { m_open = std::move(open); }
+    // Called on the input thread when a device stops answering, e.g. to request an enumeration
+    // that confirms the removal. Set before tracking devices.
+    void SetLostHandler(std::function<void()> onLost) { m_onLost = std::move(onLost); }
+
+    // Tracks a device. opened is the backend if the device could be opened already, or
+    // nullptr to start parked until Reconcile finds it. The pointer stays valid until Clear().
+    ManagedDevice* Track(const DeviceIdentity& wanted, std::unique_ptr<InputBackend> opened, const DeviceIdentity& found);
+    // Brings tracked devices in line with the attached devices. Returns how many were reattached.
+    int Reconcile(const std::vector<DeviceIdentity>& attached);
+    void Clear();
+
+    size_t Count() const { return m_devices.size(); }
+    ManagedDevice* Device(int index) const { return m_devices[index].get(); }
+    // True when any tracked device is parked.
+    bool AnyParked() const;
+private:
+    int FindMatch(const DeviceIdentity& wanted, const std::vector<DeviceIdentity>& attached, const std::vector<bool>& claimed) const;
+
+    Opener m_open;
+    std::function<void()> m_onLost;
+    std::vector<std::unique_ptr<ManagedDevice>> m_devices;
+};
@@ -0,0 +1,159 @@
+#include "EndpointManager.h"
+
+EndpointManager::EndpointManager(EndpointProvider& provider, SessionRegistry& registry)
+    : m_provider(provider), m_registry(registry) {
+}
+
+EndpointManager::~EndpointManager() {
+    Stop();
+}
+
+int EndpointManager::Start() {
+    std::vector<std::wstring> ids;
+    m_provider.Enumerate(ids);
+    int opened = 0;
+    for (const std::wstring& id : ids) {
+        EndpointEvent added;
+        if (!Open(id, &added)) continue;
+        ++opened;
+        m_listeners.Notify(added);
+    }
+    OnDefaultChanged(EndpointFlow::Render, m_provider.DefaultEndpoint(EndpointFlow::Render));
+    OnDefaultChanged(EndpointFlow::Capture, m_provider.DefaultEndpoint(EndpointFlow::Capture));
+    return opened;
+}
+
+void EndpointManager::Stop() {
+    std::vector<std::wstring> ids;
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        for (const auto& kv : m_endpoints) ids.push_back(kv.first);
+    }
+    for (const std::wstring& id : ids) OnEndpointRemoved(id);
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_default[0].clear();
+    m_default[1].clear();
+}
+
+// Opens the endpoint unless it is open or being opened already; fills *added when it was
+// opened now. The provider is called without the lock: activating an endpoint reports its
+// sessions to the registry, and registry listeners call back into the manager.
+bool EndpointManager::Open(const std::wstring& id, EndpointEvent* added) {
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        if (id.empty() || m_endpoints.count(id) || m_opening.count(id)) return false;
+        m_opening[id] = false;
+    }
+    Entry entry;
+    entry.info = EndpointInfo{ id, L"", EndpointFlow::Render };
+    entry.endpoint = m_provider.Open(id, entry.info);
+    if (entry.endpoint) entry.master = entry.endpoint->MasterControl();
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        bool removed = m_opening[id];
+        m_opening.erase(id);
+        if (!entry.endpoint) return false;
+        ++m_activations;
+        if (!removed) {
+            *added = EndpointEvent{ EndpointChange::Added, entry.info, entry.master };
+            m_endpoints.emplace(id, std::move(entry));
+            return true;
+        }
+    }
+    // Removed while it was being opened: close it again, as OnEndpointRemoved would have.
+    entry.endpoint.reset();
+    DropSessions(id);
+    return false;
+}
+
+void EndpointManager::OnEndpointAdded(const std::wstring& id) {
+    EndpointEvent added;
+    if (Open(id, &added)) m_listeners.Notify(added);
+}
+
+void EndpointManager::OnEndpointRemoved(const std::wstring& id) {
+    Entry entry;
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        auto it = m_endpoints.find(id);
+        if (it == m_endpoints.end()) {
+            auto opening = m_opening.find(id);
+            if (opening != m_opening.end()) opening->second = true;     // Open() closes it
+            return;
+        }
+        entry = std::move(it->second);
+        m_endpoints.erase(it);
+    }
+    // Close outside the lock: this unregisters the session notifications and releases the
+    // cached interfaces. Sessions the endpoint did not report as expired go with it.
+    entry.endpoint.reset();
+    DropSessions(id);
+    m_listeners.Notify(EndpointEvent{ EndpointChange::Removed, entry.info, nullptr });
+}
+
+void EndpointManager::DropSessions(const std::wstring& id) {
+    std::vector<SessionInfo> sessions;
+    m_registry.Snapshot(sessions);
+    for (const SessionInfo& s : sessions)
+        if (s.endpointId == id) m_registry.OnSessionRemoved(s.sessionId);
+}
+
+void EndpointManager::OnDefaultChanged(EndpointFlow flow, const std::wstring& id) {
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_default[(int)flow] = id;
+    }
+    // The default may be announced before the endpoint's own arrival.
+    EndpointEvent added;
+    if (Open(id, &added)) m_listeners.Notify(added);
+    EndpointEvent event = { EndpointChange::Default, EndpointInfo{ id, L"", flow }, nullptr };
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        auto it = m_endpoints.find(id);
+        if (it != m_endpoints.end()) {
+            event.info = it->second.info;
+            event.master = it->second.master;
+        }
+    }
+    m_listeners.Notify(event);
+}
+
+std::shared_ptr<SessionControl> EndpointManager::MasterControl(const std::wstring& id) const {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    auto it = m_endpoints.find(id.empty() ? m_default[(int)EndpointFlow::Render] : id);
+    return it != m_endpoints.end() ? it->second.master : nullptr;
+}
+
+std::wstring EndpointManager::DefaultEndpoint(EndpointFlow flow) const {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_default[(int)flow];
+}
+
+bool EndpointManager::Find(const std::wstring& id, EndpointInfo& out) const {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    auto it = m_endpoints.find(id);
+    if (it == m_endpoints.end()) return false;
+    out = it->second.info;
+    return true;
+}
+
+void EndpointManager::Snapshot(std::vector<EndpointInfo>& out) const {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    out.clear();
+    out.reserve(m_endpoints.size());
+    for (const auto& kv : m_endpoints)
+        out.push_back(kv.second.info);
+}
+
+size_t EndpointManager::Size() const {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_endpoints.size();
+}
+
+int EndpointManager::AddListener(Listener listener) {
+    return m_listeners.Add(std::move(listener));
+}
+
+void EndpointManager::RemoveListener(int id) {
+    m_listeners.Remove(id);
+}
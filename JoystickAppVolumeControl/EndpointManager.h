@@ -0,0 +1,112 @@
+#pragma once
+#include <stdint.h>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+#include "ListenerList.h"
+#include "SessionRegistry.h"
+
+enum class EndpointFlow : uint8_t { Render, Capture };
+
+struct EndpointInfo {
+    std::wstring id;            // IMMDevice id, "{0.0.0.00000000}.{guid}"; stable across reboots
+    std::wstring name;          // friendly name, e.g. "Headphones (USB Audio)"
+    EndpointFlow flow;
+};
+
+// One active endpoint as opened by an EndpointProvider. Its session manager and endpoint
+// volume are activated once when it is opened and stay cached until it is closed; while
+// open, it reports the endpoint's sessions to the SessionRegistry.
+class AudioEndpoint {
+public:
+    virtual ~AudioEndpoint() = default;
+    // The endpoint master volume ("System Volume" on this output).
+    virtual std::shared_ptr<SessionControl> MasterControl() = 0;
+};
+
+// Platform side of the endpoint manager: IMMDeviceEnumerator on Windows, a scripted table
+// in tests. Changes are reported back through the EndpointManager::On* entry points.
+class EndpointProvider {
+public:
+    virtual ~EndpointProvider() = default;
+    // Ids of the active endpoints of both flows.
+    virtual bool Enumerate(std::vector<std::wstring>& ids) = 0;
+    // Id of the default endpoint for the flow, "" if there is none.
+    virtual std::wstring DefaultEndpoint(EndpointFlow flow) = 0;
+    // Activates the endpoint and fills info; nullptr if it cannot be opened.
+    virtual std::unique_ptr<AudioEndpoint> Open(const std::wstring& id, EndpointInfo& info) = 0;
+};
+
+enum class EndpointChange { Added, Removed, Default };
+
+struct EndpointEvent {
+    EndpointChange change;
+    EndpointInfo info;          // Default: the new default of info.flow; id is "" when there is none
+    std::shared_ptr<SessionControl> master;     // nullptr for Removed or a missing default
+};
+
+// Keeps every active endpoint open, so sessions on any output or input can be listed and
+// driven, and writes never activate anything. Endpoints are opened once by Start() and then
+// kept current incrementally from device notifications: an added endpoint is opened, a
+// removed one is closed and its sessions dropped from the registry, and a default-device
+// switch only moves the default pointer and tells the listeners, without touching other
+// endpoints or re-activating anything.
+// Notification entry points must not be called from inside an IMMNotificationClient callback:
+// closing an endpoint releases MMDevice objects.
+class EndpointManager {
+public:
+    // Called after each change, outside the manager and listener locks.
+    typedef std::function<void(const EndpointEvent& event)> Listener;
+
+    EndpointManager(EndpointProvider& provider, SessionRegistry& registry);
+    ~EndpointManager();
+    EndpointManager(const EndpointManager&) = delete;
+    EndpointManager& operator=(const EndpointManager&) = delete;
+
+    // Opens every active endpoint and reads the defaults. Returns how many were opened.
+    int Start();
+    // Closes every endpoint; their sessions are dropped from the registry.
+    void Stop();
+
+    // Notification entry points (IMMNotificationClient, or a test).
+    void OnEndpointAdded(const std::wstring& id);
+    void OnEndpointRemoved(const std::wstring& id);
+    void OnDefaultChanged(EndpointFlow flow, const std::wstring& id);
+
+    // Master volume of an open endpoint; "" is the default render endpoint.
+    std::shared_ptr<SessionControl> MasterControl(const std::wstring& id) const;
+    std::wstring DefaultEndpoint(EndpointFlow flow) const;
+    bool Find(const std::wstring& id, EndpointInfo& out) const;
+    void Snapshot(std::vector<EndpointInfo>& out) const;
+    size_t Size() const;
+
+    // Listeners may add or remove listeners. RemoveListener waits for calls of the listener
+    // under way on other threads, so it must not be called with a lock the listener takes.
+    int AddListener(Listener listener);
+    void RemoveListener(int id);
+
+    // Endpoints opened so far; stays put across default switches.
+    uint64_t Activations() const { return m_activations; }
+private:
+    struct Entry {
+        EndpointInfo info;
+        std::unique_ptr<AudioEndpoint> endpoint;
+        std::shared_ptr<SessionControl> master;
+    };
+
+    bool Open(const std::wstring& id, EndpointEvent* added);
+    void DropSessions(const std::wstring& id);
+
+    EndpointProvider& m_provider;
+    SessionRegistry& m_registry;
+    mutable std::mutex m_mutex;
+    std::unordered_map<std::wstring, Entry> m_endpoints;
+    // Endpoints being opened outside the lock; true once removed in the meantime.
+    std::unordered_map<std::wstring, bool> m_opening;
+    std::wstring m_default[2];      // indexed by EndpointFlow
+    uint64_t m_activations = 0;
+    ListenerList<const EndpointEvent&> m_listeners;
+};
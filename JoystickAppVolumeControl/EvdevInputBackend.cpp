@@ -0,0 +1,338 @@
+#include "EvdevInputBackend.h"
+#include <errno.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <stdio.h>
+#include <string.h>
+#include <sys/eventfd.h>
+#include <sys/ioctl.h>
+#include <unistd.h>
+#include <algorithm>
+#include <chrono>
+#include "log.h"
+
+namespace {
+const int32_t kReplayAxisMin = -32768, kReplayAxisMax = 32767;
+const size_t kLongBits = sizeof(unsigned long) * 8;
+
+// Absolute axes that fill the two sliders, in the order they claim them.
+const int kSliderAxes[] = { ABS_THROTTLE, ABS_RUDDER, ABS_WHEEL, ABS_GAS, ABS_BRAKE };
+
+bool TestBit(const std::vector<unsigned long>& bits, int n) {
+    return (bits[n / kLongBits] >> (n % kLongBits)) & 1;
+}
+
+// Reads an EVIOCGBIT/EVIOCGKEY style bitmap of count bits into one bool per bit.
+bool ReadBits(int fd, unsigned long request, int count, std::vector<bool>& out) {
+    std::vector<unsigned long> bits((count + kLongBits - 1) / kLongBits, 0);
+    if (ioctl(fd, request, bits.data()) < 0) return false;
+    out.assign(count, false);
+    for (int i = 0; i < count; ++i) out[i] = TestBit(bits, i);
+    return true;
+}
+
+LONG ScaleAxis(int32_t v, int32_t min, int32_t max) {
+    if (max <= min) return 0;
+    v = std::min(std::max(v, min), max);
+    return (LONG)((int64_t)(v - min) * 65535 / ((int64_t)max - min));
+}
+
+// Hat position to DirectInput POV: hundredths of a degree clockwise from up, or centered.
+DWORD PovFromHat(int x, int y) {
+    static const DWORD kAngles[3][3] = {
+        { 31500, 0, 4500 },
+        { 27000, 0xFFFFFFFF, 9000 },
+        { 22500, 18000, 13500 },
+    };
+    return kAngles[y + 1][x + 1];
+}
+
+int64_t EventMicros(const input_event& ev) {
+#ifdef input_event_sec
+    return (int64_t)ev.input_event_sec * 1000000 + ev.input_event_usec;
+#else
+    return (int64_t)ev.time.tv_sec * 1000000 + ev.time.tv_usec;
+#endif
+}
+}
+
+EvdevInputBackend::~EvdevInputBackend() {
+    Close();
+}
+
+void EvdevInputBackend::MapAbs(int code, int32_t min, int32_t max) {
+    AbsMap& m = m_abs[code];
+    if (code <= ABS_RZ) {
+        m.slot = code;      // ABS_X..ABS_RZ share DirectInput's order
+    } else if (code >= ABS_HAT0X && code <= ABS_HAT3Y) {
+        m.slot = kHatBase + (code - ABS_HAT0X);
+    } else {
+        int slider = 0;
+        for (const AbsMap& other : m_abs)
+            if (other.slot == 6 || other.slot == 7) ++slider;
+        if (slider >= 2) return;
+        m.slot = 6 + slider;
+    }
+    m.min = min;
+    m.max = max;
+}
+
+void EvdevInputBackend::BuildDeviceMaps(const std::vector<bool>& abs, const std::vector<bool>& keys) {
+    for (int code = ABS_X; code <= ABS_RZ; ++code)
+        if (abs[code]) MapAbs(code, 0, 0);
+    for (int code : kSliderAxes)
+        if (abs[code]) MapAbs(code, 0, 0);
+    for (int code = ABS_HAT0X; code <= ABS_HAT3Y; ++code)
+        if (abs[code]) MapAbs(code, 0, 0);
+    for (int code = 0; code < ABS_CNT; ++code) {
+        if (m_abs[code].slot == kNoSlot) continue;
+        input_absinfo info = {};
+        if (ioctl(m_fd, EVIOCGABS(code), &info) == 0) {
+            m_abs[code].min = info.minimum;
+            m_abs[code].max = info.maximum;
+        }
+    }
+    DWORD next = 0;
+    for (int code = BTN_MISC; code < KEY_CNT && next < kJoyButtonCount; ++code)
+        if (keys[code]) m_button[code] = next++;
+    for (int code = 0; code < BTN_MISC && next < kJoyButtonCount; ++code)
+        if (keys[code]) m_button[code] = next++;
+}
+
+void EvdevInputBackend::BuildReplayMaps() {
+    for (int code = ABS_X; code <= ABS_RZ; ++code) MapAbs(code, kReplayAxisMin, kReplayAxisMax);
+    for (int code : kSliderAxes) MapAbs(code, kReplayAxisMin, kReplayAxisMax);
+    for (int code = ABS_HAT0X; code <= ABS_HAT3Y; ++code) MapAbs(code, -1, 1);
+    for (DWORD i = 0; i < kJoyButtonCount && BTN_JOYSTICK + i < KEY_CNT; ++i)
+        m_button[BTN_JOYSTICK + i] = i;
+    // Axes start centered, like a stick at rest.
+    for (const AbsMap& m : m_abs)
+        if (m.slot != kNoSlot && m.slot < kHatBase) (&m_pending.lX)[m.slot] = ScaleAxis(0, m.min, m.max);
+}
+
+bool EvdevInputBackend::Open(const std::string& path) {
+    Close();
+    m_fd = open(path.c_str(), O_RDONLY | O_NONBLOCK | O_CLOEXEC);
+    if (m_fd < 0) {
+        LOG_WARN("Cannot open %s: errno %d", path.c_str(), errno);
+        return false;
+    }
+    char name[256] = {};
+    if (ioctl(m_fd, EVIOCGNAME(sizeof(name) - 1), name) < 0) name[0] = '\0';
+    std::vector<bool> abs, keys;
+    if (!ReadBits(m_fd, EVIOCGBIT(EV_ABS, (ABS_CNT + 7) / 8), ABS_CNT, abs)) abs.assign(ABS_CNT, false);
+    if (!ReadBits(m_fd, EVIOCGBIT(EV_KEY, (KEY_CNT + 7) / 8), KEY_CNT, keys)) keys.assign(KEY_CNT, false);
+    BuildDeviceMaps(abs, keys);
+    bool any = std::any_of(std::begin(m_button), std::end(m_button), [](int b) { return b != kNoSlot; })
+        || std::any_of(std::begin(m_abs), std::end(m_abs), [](const AbsMap& m) { return m.slot != kNoSlot; });
+    if (!any) {
+        LOG_WARN("%s (%s) has no joystick axes or buttons", path.c_str(), name);
+        Close();
+        return false;
+    }
+    m_stopFd = eventfd(0, EFD_CLOEXEC | EFD_NONBLOCK);
+    if (m_stopFd < 0) {
+        Close();
+        return false;
+    }
+    m_name = name;
+    Resync();
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_changes = kAllJoyStateBits;
+    }
+    m_thread = std::thread([this] { ReadDevice(); });
+    LOG_INFO("Opened evdev device %s (%s)", path.c_str(), name);
+    return true;
+}
+
+bool EvdevInputBackend::OpenReplay(const std::string& path, double speed) {
+    Close();
+    FILE* f = fopen(path.c_str(), "rb");
+    if (!f) {
+        LOG_WARN("Cannot open evdev recording %s", path.c_str());
+        return false;
+    }
+    input_event ev;
+    while (fread(&ev, sizeof(ev), 1, f) == 1)
+        m_recording.push_back(ev);
+    fclose(f);
+    BuildReplayMaps();
+    m_name = path;
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_state = m_pending;
+        m_changes = kAllJoyStateBits;
+    }
+    m_thread = std::thread([this, speed] { PlayRecording(speed); });
+    LOG_INFO("Replaying %zu evdev event(s) from %s at %.2fx", m_recording.size(), path.c_str(), speed);
+    return true;
+}
+
+void EvdevInputBackend::Close() {
+    if (m_thread.joinable()) {
+        {
+            std::lock_guard<std::mutex> lock(m_stopMutex);
+            m_stop = true;
+        }
+        m_stopCv.notify_all();
+        if (m_stopFd >= 0) {
+            uint64_t one = 1;
+            if (write(m_stopFd, &one, sizeof(one)) < 0) {}
+        }
+        m_thread.join();
+    }
+    if (m_fd >= 0) close(m_fd);
+    if (m_stopFd >= 0) close(m_stopFd);
+    m_fd = m_stopFd = -1;
+    m_stop = false;
+    m_recording.clear();
+    for (AbsMap& m : m_abs) m = AbsMap();
+    for (int& button : m_button) button = kNoSlot;
+    memset(m_hat, 0, sizeof(m_hat));
+    m_pending = DIJOYSTATE2();
+    for (DWORD& pov : m_pending.rgdwPOV)
+        pov = 0xFFFFFFFF;
+    m_dropped = false;
+    m_lost = false;
+    m_finished = false;
+}
+
+bool EvdevInputBackend::GetJoyState(DIJOYSTATE2& js) {
+    if (m_lost.load(std::memory_order_acquire)) return false;
+    std::lock_guard<std::mutex> lock(m_mutex);
+    js = m_state;
+    return true;
+}
+
+void EvdevInputBackend::SetNotify(WakeEvent* ev) {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_notify = ev;
+}
+
+uint64_t EvdevInputBackend::TakeChanges() {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    uint64_t mask = m_changes;
+    m_changes = 0;
+    return mask;
+}
+
+void EvdevInputBackend::Apply(const input_event& ev) {
+    m_events.fetch_add(1, std::memory_order_relaxed);
+    if (m_dropped) {
+        // The kernel's buffer overflowed; what follows up to the next report is partial.
+        if (ev.type == EV_SYN && ev.code == SYN_REPORT) {
+            m_dropped = false;
+            Resync();
+        }
+        return;
+    }
+    switch (ev.type) {
+    case EV_SYN:
+        if (ev.code == SYN_REPORT) Commit();
+        else if (ev.code == SYN_DROPPED) m_dropped = true;
+        break;
+    case EV_ABS: {
+        if (ev.code >= ABS_CNT) break;
+        const AbsMap& m = m_abs[ev.code];
+        if (m.slot == kNoSlot) break;
+        if (m.slot >= kHatBase) {
+            int hat = m.slot - kHatBase;
+            m_hat[hat / 2][hat % 2] = ev.value < 0 ? -1 : ev.value > 0 ? 1 : 0;
+            m_pending.rgdwPOV[hat / 2] = PovFromHat(m_hat[hat / 2][0], m_hat[hat / 2][1]);
+        } else {
+            (&m_pending.lX)[m.slot] = ScaleAxis(ev.value, m.min, m.max);
+        }
+        break;
+    }
+    case EV_KEY:
+        if (ev.code < KEY_CNT && m_button[ev.code] != kNoSlot)
+            m_pending.rgbButtons[m_button[ev.code]] = ev.value ? 0x80 : 0;
+        break;
+    }
+}
+
+void EvdevInputBackend::Commit() {
+    WakeEvent* notify;
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        uint64_t mask = DiffJoyState(m_state, m_pending);
+        if (!mask) return;
+        m_state = m_pending;
+        m_changes |= mask;
+        notify = m_notify;
+    }
+    if (notify) notify->Set();
+}
+
+// Reloads every mapped axis and button from the device's current state.
+void EvdevInputBackend::Resync() {
+    if (m_fd < 0) return;
+    for (int code = 0; code < ABS_CNT; ++code) {
+        if (m_abs[code].slot == kNoSlot) continue;
+        input_absinfo info = {};
+        if (ioctl(m_fd, EVIOCGABS(code), &info) < 0) continue;
+        input_event ev = {};
+        ev.type = EV_ABS;
+        ev.code = (uint16_t)code;
+        ev.value = info.value;
+        Apply(ev);
+    }
+    std::vector<bool> keys;
+    if (ReadBits(m_fd, EVIOCGKEY((KEY_CNT + 7) / 8), KEY_CNT, keys)) {
+        for (int code = 0; code < KEY_CNT; ++code)
+            if (m_button[code] != kNoSlot) m_pending.rgbButtons[m_button[code]] = keys[code] ? 0x80 : 0;
+    }
+    Commit();
+}
+
+void EvdevInputBackend::MarkLost() {
+    WakeEvent* notify;
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_lost = true;
+        m_changes = kAllJoyStateBits;   // the next read finds out
+        notify = m_notify;
+    }
+    LOG_WARN("evdev device %s is gone", m_name.c_str());
+    if (notify) notify->Set();
+}
+
+void EvdevInputBackend::ReadDevice() {
+    input_event buf[64];
+    pollfd fds[2] = { { m_fd, POLLIN, 0 }, { m_stopFd, POLLIN, 0 } };
+    for (;;) {
+        if (poll(fds, 2, -1) < 0) {
+            if (errno == EINTR) continue;
+            MarkLost();
+            return;
+        }
+        if (fds[1].revents) return;
+        ssize_t n = read(m_fd, buf, sizeof(buf));
+        if (n < 0 && (errno == EAGAIN || errno == EINTR)) continue;
+        if (n <= 0) {
+            MarkLost();     // ENODEV once the device is unplugged
+            return;
+        }
+        for (size_t i = 0; i < (size_t)n / sizeof(input_event); ++i)
+            Apply(buf[i]);
+    }
+}
+
+void EvdevInputBackend::PlayRecording(double speed) {
+    typedef std::chrono::steady_clock Clock;
+    Clock::time_point start = Clock::now();
+    int64_t first = m_recording.empty() ? 0 : EventMicros(m_recording[0]);
+    for (const input_event& ev : m_recording) {
+        std::unique_lock<std::mutex> lock(m_stopMutex);
+        if (speed > 0) {
+            Clock::time_point due = start + std::chrono::microseconds((int64_t)((EventMicros(ev) - first) / speed));
+            m_stopCv.wait_until(lock, due, [this] { return m_stop; });
+        }
+        if (m_stop) return;
+        lock.unlock();
+        Apply(ev);
+    }
+    Commit();   // a recording cut off before its last SYN_REPORT
+    m_finished.store(true, std::memory_order_release);
+}
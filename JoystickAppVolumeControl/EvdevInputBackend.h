@@ -0,0 +1,93 @@
+#pragma once
+#include <linux/input.h>
+#include <atomic>
+#include <condition_variable>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+#include "InputBackend.h"
+
+// Joystick state from a Linux evdev device (/dev/input/event*), mapped onto DIJOYSTATE2
+// the way DirectInput presents the same controller: X/Y/Z/Rx/Ry/Rz in their slots, other
+// absolute axes (throttle, rudder, wheel, gas, brake) filling the two sliders in code
+// order, hats on the POV slots, and buttons numbered like joydev (BTN_MISC and up first,
+// then the rest, in code order). Axes are scaled to DirectInput's default 0..65535 range.
+//
+// A reader thread blocks on the device and publishes the state on every SYN_REPORT, so
+// the backend is event-driven: it records the change mask and signals the attached
+// WakeEvent like buffered DirectInput. SYN_DROPPED resynchronises from the kernel's
+// current state. When the device goes away (ENODEV) reads fail and IsPresent() turns
+// false; the DeviceManager opens a new backend once the node is back.
+//
+// OpenReplay plays a recording of struct input_event records instead (for example
+// `cat /dev/input/eventN > pad.evdev`) with the recorded timing. A recording carries no
+// capabilities: every axis is taken to span -32768..32767 (hats -1..1) and buttons are
+// numbered from BTN_JOYSTICK.
+class EvdevInputBackend : public InputBackend {
+public:
+    EvdevInputBackend() = default;
+    ~EvdevInputBackend();
+    EvdevInputBackend(const EvdevInputBackend&) = delete;
+    EvdevInputBackend& operator=(const EvdevInputBackend&) = delete;
+
+    // Opens a device node; false if it cannot be opened or reports no axes and no buttons.
+    bool Open(const std::string& path);
+    // speed scales playback (2 = twice as fast); 0 applies the records without waiting.
+    bool OpenReplay(const std::string& path, double speed = 1.0);
+    void Close();
+
+    bool GetJoyState(DIJOYSTATE2& js) override;
+    void SetNotify(WakeEvent* ev) override;
+    bool IsEventDriven() const override { return m_thread.joinable(); }
+    uint64_t TakeChanges() override;
+    bool IsPresent() const override { return !m_lost.load(std::memory_order_acquire); }
+
+    const std::string& Name() const { return m_name; }
+    // Replay: true once the last record was applied. Always false for a device.
+    bool Finished() const { return m_finished.load(std::memory_order_acquire); }
+    // Input events consumed so far.
+    uint64_t EventCount() const { return m_events.load(std::memory_order_relaxed); }
+private:
+    static const int kNoSlot = -1;
+
+    struct AbsMap {
+        int slot = kNoSlot;         // LONG index into DIJOYSTATE2 (0-7), or kHatBase + pov * 2 + axis
+        int32_t min = 0, max = 0;
+    };
+    static const int kHatBase = 100;
+
+    void MapAbs(int code, int32_t min, int32_t max);
+    void BuildDeviceMaps(const std::vector<bool>& abs, const std::vector<bool>& keys);
+    void BuildReplayMaps();
+    // Reader side; the pending state is only touched by the reader thread.
+    void Apply(const input_event& ev);
+    void Commit();
+    void Resync();
+    void MarkLost();
+    void ReadDevice();
+    void PlayRecording(double speed);
+
+    std::string m_name;
+    int m_fd = -1;
+    int m_stopFd = -1;              // eventfd that interrupts the device reader
+    std::vector<input_event> m_recording;
+    AbsMap m_abs[ABS_CNT];
+    int m_button[KEY_CNT];          // button index, or kNoSlot
+    int m_hat[4][2] = {};           // raw hat positions, -1..1
+    DIJOYSTATE2 m_pending = {};
+    bool m_dropped = false;         // after SYN_DROPPED: ignore events up to the next SYN_REPORT
+
+    std::mutex m_mutex;             // m_state, m_changes, m_notify
+    DIJOYSTATE2 m_state = {};
+    uint64_t m_changes = 0;
+    WakeEvent* m_notify = nullptr;
+
+    std::thread m_thread;
+    std::mutex m_stopMutex;         // replay pacing
+    std::condition_variable m_stopCv;
+    bool m_stop = false;
+    std::atomic<bool> m_lost{false};
+    std::atomic<bool> m_finished{false};
+    std::atomic<uint64_t> m_events{0};
+};
@@ -0,0 +1,111 @@
+#include "FakeEndpointProvider.h"
+
+bool FakeVolumeControl::SetVolume(float v) {
+    m_volume = v;
+    ++m_writes;
+    return true;
+}
+
+// Marks the endpoint closed again when the manager lets go of it.
+class FakeEndpointProvider::OpenEndpoint : public AudioEndpoint {
+    FakeEndpointProvider& m_owner;
+    std::wstring m_id;
+    std::shared_ptr<SessionControl> m_master;
+public:
+    OpenEndpoint(FakeEndpointProvider& owner, const std::wstring& id, std::shared_ptr<SessionControl> master)
+        : m_owner(owner), m_id(id), m_master(std::move(master)) {}
+    ~OpenEndpoint() override {
+        std::lock_guard<std::mutex> lock(m_owner.m_mutex);
+        auto it = m_owner.m_endpoints.find(m_id);
+        if (it != m_owner.m_endpoints.end()) it->second.open = false;
+    }
+    std::shared_ptr<SessionControl> MasterControl() override { return m_master; }
+};
+
+void FakeEndpointProvider::Plug(const EndpointInfo& info) {
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        Endpoint& e = m_endpoints[info.id];
+        if (!e.master) e.master = std::make_shared<FakeVolumeControl>();
+        e.info = info;
+        e.active = true;
+    }
+    if (m_notify) m_notify->OnEndpointAdded(info.id);
+}
+
+void FakeEndpointProvider::Unplug(const std::wstring& id) {
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        auto it = m_endpoints.find(id);
+        if (it == m_endpoints.end()) return;
+        it->second.active = false;
+    }
+    if (m_notify) m_notify->OnEndpointRemoved(id);
+}
+
+void FakeEndpointProvider::SetDefault(EndpointFlow flow, const std::wstring& id) {
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_default[(int)flow] = id;
+    }
+    if (m_notify) m_notify->OnDefaultChanged(flow, id);
+}
+
+void FakeEndpointProvider::AddSession(const std::wstring& endpointId, const std::wstring& sessionId, uint32_t pid) {
+    FakeSession s = { sessionId, pid, std::make_shared<FakeVolumeControl>() };
+    bool report;
+    bool capture;
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        Endpoint& e = m_endpoints.at(endpointId);
+        e.sessions.push_back(s);
+        report = e.open;
+        capture = e.info.flow == EndpointFlow::Capture;
+    }
+    if (report) m_registry.OnSessionAdded(sessionId, pid, L"", s.control, endpointId, capture);
+}
+
+std::shared_ptr<FakeVolumeControl> FakeEndpointProvider::Master(const std::wstring& id) {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    auto it = m_endpoints.find(id);
+    return it != m_endpoints.end() ? it->second.master : nullptr;
+}
+
+std::shared_ptr<FakeVolumeControl> FakeEndpointProvider::Session(const std::wstring& sessionId) {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    for (const auto& kv : m_endpoints)
+        for (const FakeSession& s : kv.second.sessions)
+            if (s.sessionId == sessionId) return s.control;
+    return nullptr;
+}
+
+bool FakeEndpointProvider::Enumerate(std::vector<std::wstring>& ids) {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    ids.clear();
+    for (const auto& kv : m_endpoints)
+        if (kv.second.active) ids.push_back(kv.first);
+    return true;
+}
+
+std::wstring FakeEndpointProvider::DefaultEndpoint(EndpointFlow flow) {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_default[(int)flow];
+}
+
+std::unique_ptr<AudioEndpoint> FakeEndpointProvider::Open(const std::wstring& id, EndpointInfo& info) {
+    std::vector<FakeSession> sessions;
+    std::shared_ptr<FakeVolumeControl> master;
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        auto it = m_endpoints.find(id);
+        if (it == m_endpoints.end() || !it->second.active) return nullptr;
+        it->second.open = true;
+        info = it->second.info;
+        sessions = it->second.sessions;
+        master = it->second.master;
+    }
+    ++m_opens;
+    for (const FakeSession& s : sessions)
+        m_registry.OnSessionAdded(s.sessionId, s.pid, L"", s.control, id, info.flow == EndpointFlow::Capture);
+    return std::unique_ptr<AudioEndpoint>(new OpenEndpoint(*this, id, master));
+}
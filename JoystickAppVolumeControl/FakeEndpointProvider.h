@@ -0,0 +1,64 @@
+#pragma once
+#include <atomic>
+#include <map>
+#include <memory>
+#include <mutex>
+#include "EndpointManager.h"
+
+// Volume control that only records what was written.
+class FakeVolumeControl : public SessionControl {
+public:
+    bool SetVolume(float v) override;
+    float Volume() const { return m_volume.load(); }
+    uint64_t Writes() const { return m_writes.load(); }
+private:
+    std::atomic<float> m_volume{-1.0f};
+    std::atomic<uint64_t> m_writes{0};
+};
+
+// Scripted audio endpoints used to drive the EndpointManager without WASAPI. Opening an
+// endpoint reports its sessions to the registry; plugging, unplugging and default
+// switches are announced to the attached manager like IMMNotificationClient would.
+class FakeEndpointProvider : public EndpointProvider {
+public:
+    explicit FakeEndpointProvider(SessionRegistry& registry) : m_registry(registry) {}
+
+    void SetNotify(EndpointManager* manager) { m_notify = manager; }
+    // Adds an active endpoint; announced as an arrival.
+    void Plug(const EndpointInfo& info);
+    void Unplug(const std::wstring& id);
+    void SetDefault(EndpointFlow flow, const std::wstring& id);
+    // A session that is reported whenever the endpoint is opened; if it is open already,
+    // reported now like a session-created notification.
+    void AddSession(const std::wstring& endpointId, const std::wstring& sessionId, uint32_t pid);
+
+    // Master volume of the endpoint, nullptr if unknown.
+    std::shared_ptr<FakeVolumeControl> Master(const std::wstring& id);
+    std::shared_ptr<FakeVolumeControl> Session(const std::wstring& sessionId);
+    uint64_t Opens() const { return m_opens.load(); }
+
+    bool Enumerate(std::vector<std::wstring>& ids) override;
+    std::wstring DefaultEndpoint(EndpointFlow flow) override;
+    std::unique_ptr<AudioEndpoint> Open(const std::wstring& id, EndpointInfo& info) override;
+private:
+    struct FakeSession {
+        std::wstring sessionId;
+        uint32_t pid;
+        std::shared_ptr<FakeVolumeControl> control;
+    };
+    struct Endpoint {
+        EndpointInfo info;
+        bool active;
+        bool open;
+        std::shared_ptr<FakeVolumeControl> master;
+        std::vector<FakeSession> sessions;
+    };
+    class OpenEndpoint;
+
+    SessionRegistry& m_registry;
+    EndpointManager* m_notify = nullptr;
+    std::mutex m_mutex;
+    std::map<std::wstring, Endpoint> m_endpoints;
+    std::wstring m_default[2];
+    std::atomic<uint64_t> m_opens{0};
+};
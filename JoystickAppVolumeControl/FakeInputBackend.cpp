@@ -0,0 +1,106 @@
+#include "FakeInputBackend.h"
+#include <thread>
+
+FakeInputBackend::FakeInputBackend(bool eventDriven) : m_eventDriven(eventDriven) {
+    for (DWORD& pov : m_state.rgdwPOV)
+        pov = 0xFFFFFFFF;   // centered, like a real device at rest
+}
+
+bool FakeInputBackend::GetJoyState(DIJOYSTATE2& js) {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    ++m_reads;
+    if (!m_present) return false;
+    js = m_state;
+    return true;
+}
+
+void FakeInputBackend::Unplug() {
+    WakeEvent* notify;
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_present = false;
+        m_pending = kAllJoyStateBits;   // the next read finds out
+        notify = m_eventDriven ? m_notify : nullptr;
+    }
+    if (notify) notify->Set();
+}
+
+void FakeInputBackend::Replug() {
+    WakeEvent* notify;
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_present = true;
+        m_pending = kAllJoyStateBits;
+        notify = m_eventDriven ? m_notify : nullptr;
+    }
+    if (notify) notify->Set();
+}
+
+void FakeInputBackend::SetNotify(WakeEvent* ev) {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_notify = ev;
+}
+
+uint64_t FakeInputBackend::TakeChanges() {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    if (!m_eventDriven) return kAllJoyStateBits;
+    uint64_t mask = m_pending;
+    m_pending = 0;
+    return mask;
+}
+
+void FakeInputBackend::SetState(const DIJOYSTATE2& js) {
+    WakeEvent* notify = nullptr;
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        uint64_t mask = DiffJoyState(m_state, js);
+        if (!mask) return;
+        m_state = js;
+        m_pending |= mask;
+        m_lastChange = Clock::now();
+        notify = m_eventDriven ? m_notify : nullptr;
+    }
+    if (notify) notify->Set();
+}
+
+void FakeInputBackend::SetAxis(DWORD axisOfs, LONG value) {
+    DIJOYSTATE2 js;
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        js = m_state;
+    }
+    *(LONG*)((BYTE*)&js + axisOfs) = value;
+    SetState(js);
+}
+
+void FakeInputBackend::SetButton(DWORD button, bool pressed) {
+    DIJOYSTATE2 js;
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        js = m_state;
+    }
+    js.rgbButtons[button] = pressed ? 0x80 : 0;
+    SetState(js);
+}
+
+void FakeInputBackend::SetPov(DWORD pov, DWORD value) {
+    DIJOYSTATE2 js;
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        js = m_state;
+    }
+    js.rgdwPOV[pov] = value;
+    SetState(js);
+}
+
+void FakeInputBackend::RunScript(const std::vector<FakeInputStep>& steps) {
+    for (const FakeInputStep& step : steps) {
+        if (step.delayMs) std::this_thread::sleep_for(std::chrono::milliseconds(step.delayMs));
+        SetAxis(step.axisOfs, step.value);
+    }
+}
+
+FakeInputBackend::Clock::time_point FakeInputBackend::LastChangeTime() {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_lastChange;
+}
\ No newline at end of file
@@ -0,0 +1,54 @@
+#pragma once
+#include "InputBackend.h"
+#include <atomic>
+#include <chrono>
+#include <mutex>
+#include <vector>
+
+// One scripted input change: wait delayMs, then set the LONG at axisOfs to value.
+struct FakeInputStep {
+    uint32_t delayMs;
+    DWORD axisOfs;
+    LONG value;
+};
+
+// Scripted joystick used to drive the input thread without hardware.
+// Changes pushed from any thread update the state, record the change mask and,
+// in event-driven mode, signal the attached WakeEvent like DirectInput would.
+class FakeInputBackend : public InputBackend {
+public:
+    typedef std::chrono::steady_clock Clock;
+
+    explicit FakeInputBackend(bool eventDriven = true);
+    bool GetJoyState(DIJOYSTATE2& js) override;
+    void SetNotify(WakeEvent* ev) override;
+    bool IsEventDriven() const override { return m_eventDriven; }
+    uint64_t TakeChanges() override;
+    bool IsPresent() const override { return m_present.load(); }
+
+    void SetState(const DIJOYSTATE2& js);
+    void SetAxis(DWORD axisOfs, LONG value);
+    void SetButton(DWORD button, bool pressed);
+    // value in hundredths of a degree clockwise from up, 0xFFFFFFFF for centered.
+    void SetPov(DWORD pov, DWORD value);
+    // Plays the steps on the calling thread, sleeping between them.
+    void RunScript(const std::vector<FakeInputStep>& steps);
+    // Simulates unplugging: reads fail and IsPresent() turns false, and the attached event
+    // is signalled like DirectInput reporting lost input.
+    void Unplug();
+    // Plugs it back in: reads succeed again with the current state, every element counts
+    // as changed, and the attached event is signalled.
+    void Replug();
+
+    uint64_t ReadCount() const { return m_reads.load(); }
+    Clock::time_point LastChangeTime();
+private:
+    std::mutex m_mutex;
+    DIJOYSTATE2 m_state = {};
+    uint64_t m_pending = 0;
+    Clock::time_point m_lastChange;
+    WakeEvent* m_notify = nullptr;
+    bool m_eventDriven;
+    std::atomic<uint64_t> m_reads{0};
+    std::atomic<bool> m_present{true};
+};
\ No newline at end of file
@@ -0,0 +1,43 @@
+#pragma once
+#include "JoyState.h"
+#include "WakeEvent.h"
+
+// A source of joystick state the input thread can read from.
+// Event-driven backends signal the attached WakeEvent whenever the device reports
+// new data, so the thread can block instead of polling on a fixed interval.
+class InputBackend {
+public:
+    virtual ~InputBackend() = default;
+    virtual bool GetJoyState(DIJOYSTATE2& js) = 0;
+    // Attaches the event signalled on new input, or detaches it with nullptr.
+    virtual void SetNotify(WakeEvent* ev) = 0;
+    // True while the backend will signal its WakeEvent on every change.
+    virtual bool IsEventDriven() const = 0;
+    // Returns the elements changed since the previous call as a JoyStateBit() mask.
+    // Backends that cannot tell report kAllJoyStateBits.
+    virtual uint64_t TakeChanges() = 0;
+    // False once the device is gone (unplugged). The engine then parks the device's
+    // bindings: no reads and no polling until it is present again.
+    virtual bool IsPresent() const { return true; }
+};
+
+// Poll interval for backends that are not event-driven: stays at the minimum
+// while the input is moving and backs off towards the maximum once it is idle.
+class AdaptivePollRate {
+public:
+    AdaptivePollRate(uint32_t minMs = 5, uint32_t maxMs = 100) : m_minMs(minMs), m_maxMs(maxMs), m_curMs(minMs) {}
+    uint32_t Next(bool changed) {
+        if (changed) {
+            m_idleTicks = 0;
+            m_curMs = m_minMs;
+        } else if (++m_idleTicks > kIdleTicksBeforeBackoff) {
+            m_curMs = m_curMs * 2 > m_maxMs ? m_maxMs : m_curMs * 2;
+        }
+        return m_curMs;
+    }
+    uint32_t Current() const { return m_curMs; }
+private:
+    static const uint32_t kIdleTicksBeforeBackoff = 8;
+    uint32_t m_minMs, m_maxMs, m_curMs;
+    uint32_t m_idleTicks = 0;
+};
\ No newline at end of file
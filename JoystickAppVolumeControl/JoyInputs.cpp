@@ -0,0 +1,47 @@
+#include "JoyInputs.h"
+
+static void AddAxes(std::vector<InputDesc>& table, const char* prefix, DWORD base) {
+    static const char* const kAxes[] = { "X", "Y", "Z", "Rx", "Ry", "Rz", "Slider0", "Slider1" };
+    for (DWORD i = 0; i < 8; ++i)
+        table.push_back({ std::string(prefix) + kAxes[i], base + i * (DWORD)sizeof(LONG), InputKind::Axis, 0 });
+}
+
+static std::vector<InputDesc> BuildTable() {
+    static const char* const kPovDirs[] = { "Up", "Right", "Down", "Left" };
+    std::vector<InputDesc> table;
+    AddAxes(table, "", DIJOFS_X);
+    AddAxes(table, "V", kJoyVelocityOfs);
+    AddAxes(table, "A", kJoyAccelOfs);
+    AddAxes(table, "F", kJoyForceOfs);
+    for (DWORD n = 0; n < 4; ++n)
+        for (DWORD d = 0; d < 4; ++d)
+            table.push_back({ "POV" + std::to_string(n) + kPovDirs[d], (DWORD)DIJOFS_POV(n), InputKind::Pov, (uint16_t)(d * 9000) });
+    for (DWORD n = 0; n < kJoyButtonCount; ++n)
+        table.push_back({ "Button" + std::to_string(n), (DWORD)DIJOFS_BUTTON(n), InputKind::Button, 0 });
+    return table;
+}
+
+const std::vector<InputDesc>& JoyInputs() {
+    static const std::vector<InputDesc> s_table = BuildTable();
+    return s_table;
+}
+
+int FindInput(DWORD ofs, uint16_t povAngle) {
+    const std::vector<InputDesc>& table = JoyInputs();
+    for (size_t i = 0; i < table.size(); ++i)
+        if (table[i].ofs == ofs && (table[i].kind != InputKind::Pov || table[i].povAngle == povAngle)) return (int)i;
+    return -1;
+}
+
+int FindInput(const std::string& name) {
+    const std::vector<InputDesc>& table = JoyInputs();
+    for (size_t i = 0; i < table.size(); ++i)
+        if (table[i].name == name) return (int)i;
+    return -1;
+}
+
+InputKind InputKindAt(DWORD ofs) {
+    if (ofs >= DIJOFS_POV(0) && ofs < DIJOFS_BUTTON(0)) return InputKind::Pov;
+    if (ofs >= DIJOFS_BUTTON(0) && ofs < kJoyVelocityOfs) return InputKind::Button;
+    return InputKind::Axis;
+}
@@ -0,0 +1,52 @@
+#pragma once
+#include <string>
+#include <vector>
+#include "JoyState.h"
+
+// Every element of DIJOYSTATE2 a binding can read, described by data: where it lives
+// in the state and how to read it. Adding an input is a table entry, not a code path.
+enum class InputKind : uint8_t { Axis, Pov, Button };
+
+struct InputDesc {
+    std::string name;   // shown in the UI and written to profiles
+    DWORD ofs;          // DIJOYSTATE2 offset
+    InputKind kind;
+    uint16_t povAngle;  // Pov: the direction this entry stands for, hundredths of a degree clockwise from up
+};
+
+// The table in UI order: position, velocity, acceleration and force axes, then the four
+// directions of each POV hat, then the buttons.
+const std::vector<InputDesc>& JoyInputs();
+// Index of the entry for an offset (and POV direction), or -1 for offsets without a name.
+int FindInput(DWORD ofs, uint16_t povAngle = 0);
+int FindInput(const std::string& name);
+// What an offset holds; offsets between table entries read as axes.
+InputKind InputKindAt(DWORD ofs);
+
+// One binding's input with its offset resolved up front: each read is a single load
+// (plus a compare for buttons and hats) instead of a lookup by axis.
+struct InputReader {
+    DWORD ofs;
+    InputKind kind;
+    uint16_t povAngle;
+
+    static InputReader For(DWORD ofs, uint16_t povAngle = 0) { return { ofs, InputKindAt(ofs), povAngle }; }
+    bool Digital() const { return kind != InputKind::Axis; }
+    // Axis position, or 1/0 for a pressed/released button or hat direction.
+    LONG Read(const DIJOYSTATE2& js) const {
+        const BYTE* p = (const BYTE*)&js + ofs;
+        switch (kind) {
+        case InputKind::Button:
+            return (*p & 0x80) ? 1 : 0;
+        case InputKind::Pov: {
+            DWORD pov = *(const DWORD*)p;
+            if ((pov & 0xFFFF) == 0xFFFF) return 0;    // centered
+            // Diagonals press both neighbouring directions.
+            DWORD diff = (pov + 36000 - povAngle) % 36000;
+            return diff <= 4500 || diff >= 31500 ? 1 : 0;
+        }
+        default:
+            return *(const LONG*)p;
+        }
+    }
+};
@@ -0,0 +1,108 @@
+#pragma once
+// DIJOYSTATE2 for code that must also build without the DirectX SDK.
+// On Windows this is the real dinput.h definition; elsewhere a layout-compatible
+// copy is declared so the engine, fakes and tools build on any platform.
+#ifdef _WIN32
+#include <windows.h>
+#include <dinput.h>
+#else
+#include <stddef.h>
+#include <stdint.h>
+
+typedef int32_t  LONG;
+typedef uint32_t DWORD;
+typedef uint8_t  BYTE;
+
+typedef struct DIJOYSTATE {
+    LONG  lX;
+    LONG  lY;
+    LONG  lZ;
+    LONG  lRx;
+    LONG  lRy;
+    LONG  lRz;
+    LONG  rglSlider[2];
+    DWORD rgdwPOV[4];
+    BYTE  rgbButtons[32];
+} DIJOYSTATE;
+
+typedef struct DIJOYSTATE2 {
+    LONG  lX;
+    LONG  lY;
+    LONG  lZ;
+    LONG  lRx;
+    LONG  lRy;
+    LONG  lRz;
+    LONG  rglSlider[2];
+    DWORD rgdwPOV[4];
+    BYTE  rgbButtons[128];
+    LONG  lVX;
+    LONG  lVY;
+    LONG  lVZ;
+    LONG  lVRx;
+    LONG  lVRy;
+    LONG  lVRz;
+    LONG  rglVSlider[2];
+    LONG  lAX;
+    LONG  lAY;
+    LONG  lAZ;
+    LONG  lARx;
+    LONG  lARy;
+    LONG  lARz;
+    LONG  rglASlider[2];
+    LONG  lFX;
+    LONG  lFY;
+    LONG  lFZ;
+    LONG  lFRx;
+    LONG  lFRy;
+    LONG  lFRz;
+    LONG  rglFSlider[2];
+} DIJOYSTATE2;
+
+#define DIJOFS_X            offsetof(DIJOYSTATE, lX)
+#define DIJOFS_Y            offsetof(DIJOYSTATE, lY)
+#define DIJOFS_Z            offsetof(DIJOYSTATE, lZ)
+#define DIJOFS_RX           offsetof(DIJOYSTATE, lRx)
+#define DIJOFS_RY           offsetof(DIJOYSTATE, lRy)
+#define DIJOFS_RZ           offsetof(DIJOYSTATE, lRz)
+#define DIJOFS_SLIDER(n)    (offsetof(DIJOYSTATE, rglSlider) + (n) * sizeof(LONG))
+#define DIJOFS_POV(n)       (offsetof(DIJOYSTATE, rgdwPOV) + (n) * sizeof(DWORD))
+#define DIJOFS_BUTTON(n)    (offsetof(DIJOYSTATE, rgbButtons) + (n))
+#endif
+#include <stdint.h>
+
+// DIJOYSTATE2 groups its extra axes in three blocks of eight LONGs after the buttons.
+const DWORD kJoyVelocityOfs = offsetof(DIJOYSTATE2, lVX);
+const DWORD kJoyAccelOfs = offsetof(DIJOYSTATE2, lAX);
+const DWORD kJoyForceOfs = offsetof(DIJOYSTATE2, lFX);
+const DWORD kJoyButtonCount = 128;
+
+// Change masks: one bit per position axis/slider (0-7), POV hat (8-11) and velocity,
+// acceleration and force axis (12-35); the 128 buttons share bits 36-63, so a button
+// press may also wake a binding on another button (an extra read, nothing more).
+// Indexed by DIJOYSTATE2 offset so buffered DirectInput data maps straight onto it.
+const uint64_t kAllJoyStateBits = ~0ull;
+
+inline uint64_t JoyStateBit(DWORD ofs) {
+    DWORD idx;
+    if (ofs < DIJOFS_BUTTON(0)) idx = ofs / sizeof(LONG);
+    else if (ofs < kJoyVelocityOfs) idx = 36 + (ofs - DIJOFS_BUTTON(0)) % 28;
+    else if (ofs < sizeof(DIJOYSTATE2)) idx = 12 + (ofs - kJoyVelocityOfs) / sizeof(LONG);
+    else return 0;
+    return 1ull << idx;
+}
+
+// Returns the elements that differ between two states as a change mask.
+inline uint64_t DiffJoyState(const DIJOYSTATE2& a, const DIJOYSTATE2& b) {
+    uint64_t mask = 0;
+    const LONG* la = &a.lX;
+    const LONG* lb = &b.lX;
+    for (DWORD i = 0; i < 12; ++i)     // axes, sliders and POV hats are contiguous
+        if (la[i] != lb[i]) mask |= 1ull << i;
+    for (DWORD i = 0; i < kJoyButtonCount; ++i)
+        if (a.rgbButtons[i] != b.rgbButtons[i]) mask |= JoyStateBit(DIJOFS_BUTTON(i));
+    la = &a.lVX;
+    lb = &b.lVX;
+    for (DWORD i = 0; i < 24; ++i)
+        if (la[i] != lb[i]) mask |= 1ull << (12 + i);
+    return mask;
+}
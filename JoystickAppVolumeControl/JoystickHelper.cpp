@@ -1,69 +1,146 @@
 #include "JoystickHelper.h"
 #include "log.h"
 
+LPDIRECTINPUT8 SharedDirectInput() {
+    static LPDIRECTINPUT8 s_pDI = [] {
+        LPDIRECTINPUT8 pDI = nullptr;
+        HRESULT hr = DirectInput8Create(GetModuleHandle(nullptr), DIRECTINPUT_VERSION, IID_IDirectInput8, (VOID**)&pDI, nullptr);
+        if (FAILED(hr)) LOG_ERROR("DirectInput8Create failed: hr=0x%08X", hr);
+        return FAILED(hr) ? nullptr : pDI;
+    }();
+    return s_pDI;
+}
+
+namespace {
+struct EnumContext {
+    std::vector<DInputDeviceInfo>* outList;
+    const EnumCancel* cancel;
+};
+}
+
 BOOL CALLBACK EnumJoyDevCB(const DIDEVICEINSTANCE* pdidInstance, VOID* pContext) {
-    std::vector<DInputDeviceInfo>* outList = (std::vector<DInputDeviceInfo>*)pContext;
-    DInputDeviceInfo info = { pdidInstance->guidInstance, pdidInstance->tszProductName };
-    outList->push_back(info);
+    EnumContext* ctx = (EnumContext*)pContext;
+    if (ctx->cancel->Cancelled()) return DIENUM_STOP;
+    DInputDeviceInfo info = { pdidInstance->guidInstance, pdidInstance->tszProductName, pdidInstance->guidProduct };
+    // The interface path needs a device object; creating one does not acquire the device.
+    LPDIRECTINPUTDEVICE8 pDev = nullptr;
+    if (SUCCEEDED(SharedDirectInput()->CreateDevice(pdidInstance->guidInstance, &pDev, nullptr))) {
+        DIPROPGUIDANDPATH gp = { { sizeof(DIPROPGUIDANDPATH), sizeof(DIPROPHEADER), 0, DIPH_DEVICE } };
+        if (SUCCEEDED(pDev->GetProperty(DIPROP_GUIDANDPATH, &gp.diph))) info.path = gp.wszPath;
+        pDev->Release();
+    }
+    ctx->outList->push_back(info);
     return DIENUM_CONTINUE;
 }
 
-void JoystickHelper::EnumerateDevices(std::vector<DInputDeviceInfo>& outList) {
-    LPDIRECTINPUT8 pDI = nullptr;
-    HRESULT hr = DirectInput8Create(GetModuleHandle(nullptr), DIRECTINPUT_VERSION, IID_IDirectInput8, (VOID**)&pDI, nullptr);
-    if (FAILED(hr)) {
-        DEBUG_LOG("DirectInput8Create failed: hr=0x%08X", hr);
-        return;
-    }
+bool JoystickHelper::EnumerateDevices(std::vector<DInputDeviceInfo>& outList, const EnumCancel& cancel) {
     outList.clear();
-    pDI->EnumDevices(DI8DEVCLASS_GAMECTRL, EnumJoyDevCB, &outList, DIEDFL_ATTACHEDONLY);
-    pDI->Release();
-    DEBUG_LOG("EnumerateDevices found %zu devices.", outList.size());
+    LPDIRECTINPUT8 pDI = SharedDirectInput();
+    if (!pDI) return false;
+    EnumContext ctx = { &outList, &cancel };
+    pDI->EnumDevices(DI8DEVCLASS_GAMECTRL, EnumJoyDevCB, &ctx, DIEDFL_ATTACHEDONLY);
+    if (cancel.Cancelled()) return false;
+    LOG_INFO("EnumerateDevices found %zu devices.", outList.size());
+    return true;
 }
 
+static const DWORD kInputBufferSize = 64;
+
 bool JoystickHelper::Init(const GUID& guid, HWND hwnd) {
     if (m_pJoy) m_pJoy->Unacquire(), m_pJoy->Release(), m_pJoy = nullptr;
-    if (!m_pDI)
-        if (FAILED(DirectInput8Create(GetModuleHandle(nullptr), DIRECTINPUT_VERSION,
-                IID_IDirectInput8, (VOID**)&m_pDI, nullptr))) {
-            DEBUG_LOG("DirectInput8Create failed for device init.");
-            return false;
-        }
+    m_buffered = m_acquired = m_lost = false;
+    LPDIRECTINPUT8 pDI = SharedDirectInput();
+    if (!pDI) {
+        LOG_ERROR("DirectInput unavailable for device init.");
+        return false;
+    }
 
-    if (FAILED(m_pDI->CreateDevice(guid, &m_pJoy, nullptr))) {
-        DEBUG_LOG("CreateDevice failed.");
+    if (FAILED(pDI->CreateDevice(guid, &m_pJoy, nullptr))) {
+        LOG_ERROR("CreateDevice failed.");
         return false;
     }
-    if (FAILED(m_pJoy->SetDataFormat(&c_dfDIJoystick))) {
-        DEBUG_LOG("SetDataFormat failed.");
+    if (FAILED(m_pJoy->SetDataFormat(&c_dfDIJoystick2))) {
+        LOG_ERROR("SetDataFormat failed.");
         return false;
     }
     if (FAILED(m_pJoy->SetCooperativeLevel(hwnd, DISCL_NONEXCLUSIVE | DISCL_BACKGROUND))) {
-        DEBUG_LOG("SetCooperativeLevel failed.");
+        LOG_ERROR("SetCooperativeLevel failed.");
         return false;
     }
+
+    // Polled devices never signal the notification event; those stay on the adaptive poll path.
+    DIDEVCAPS caps = { sizeof(caps) };
+    DIPROPDWORD bufSize = { { sizeof(DIPROPDWORD), sizeof(DIPROPHEADER), 0, DIPH_DEVICE }, kInputBufferSize };
+    if (SUCCEEDED(m_pJoy->GetCapabilities(&caps)) && !(caps.dwFlags & (DIDC_POLLEDDEVICE | DIDC_POLLEDDATAFORMAT)) &&
+        SUCCEEDED(m_pJoy->SetProperty(DIPROP_BUFFERSIZE, &bufSize.diph)))
+        m_buffered = true;
+    if (m_notify) m_pJoy->SetEventNotification(m_notify->NativeHandle());
+    m_acquired = SUCCEEDED(m_pJoy->Acquire());
     m_guid = guid;
-    DEBUG_LOG("JoystickHelper::Init succeeded (GUID set).");
+    LOG_INFO("JoystickHelper::Init succeeded (GUID set).");
     return true;
 }
 
-bool JoystickHelper::GetJoyState(DIJOYSTATE& js) {
-    if (!m_pJoy) return false;
+// An unplugged device fails to reacquire with DIERR_UNPLUGGED (or DIERR_INPUTLOST on older
+// drivers); it never comes back on this object, the device manager opens a new one.
+bool JoystickHelper::Reacquire() {
+    HRESULT hr = m_pJoy->Acquire();
+    m_acquired = SUCCEEDED(hr);
+    if (hr == DIERR_UNPLUGGED || hr == DIERR_INPUTLOST) {
+        if (!m_lost) LOG_WARN("Joystick unplugged: hr=0x%08X", hr);
+        m_lost = true;
+    }
+    return m_acquired;
+}
+
+bool JoystickHelper::GetJoyState(DIJOYSTATE2& js) {
+    if (!m_pJoy || m_lost) return false;
     if (FAILED(m_pJoy->Poll())) {
-        m_pJoy->Acquire();
+        Reacquire();
+        if (m_lost) return false;
         if (FAILED(m_pJoy->Poll())) {
-            DEBUG_LOG("Joystick Poll failed even after Acquire.");
+            LOG_WARN("Joystick Poll failed even after Acquire.");
             return false;
         }
     }
     if (FAILED(m_pJoy->GetDeviceState(sizeof(js), &js))) {
-        DEBUG_LOG("GetDeviceState failed.");
+        LOG_WARN("GetDeviceState failed.");
         return false;
     }
     return true;
 }
 
+void JoystickHelper::SetNotify(WakeEvent* ev) {
+    m_notify = ev;
+    if (!m_pJoy) return;
+    // The notification event can only be changed while the device is unacquired.
+    m_pJoy->Unacquire();
+    if (FAILED(m_pJoy->SetEventNotification(ev ? ev->NativeHandle() : nullptr)))
+        LOG_WARN("SetEventNotification failed.");
+    m_acquired = SUCCEEDED(m_pJoy->Acquire());
+}
+
+uint64_t JoystickHelper::TakeChanges() {
+    if (!m_pJoy || m_lost) return 0;
+    if (!m_buffered) return kAllJoyStateBits;
+    uint64_t mask = 0;
+    for (;;) {
+        DIDEVICEOBJECTDATA data[16];
+        DWORD count = ARRAYSIZE(data);
+        HRESULT hr = m_pJoy->GetDeviceData(sizeof(DIDEVICEOBJECTDATA), data, &count, 0);
+        if (hr == DIERR_INPUTLOST || hr == DIERR_NOTACQUIRED) {
+            Reacquire();
+            LOG_WARN("Joystick input lost, reacquire %s.", m_acquired ? "succeeded" : "failed");
+            return kAllJoyStateBits;
+        }
+        if (FAILED(hr) || hr == DI_BUFFEROVERFLOW) return kAllJoyStateBits;
+        for (DWORD i = 0; i < count; ++i)
+            mask |= JoyStateBit(data[i].dwOfs);
+        if (count < ARRAYSIZE(data)) break;
+    }
+    return mask;
+}
+
 JoystickHelper::~JoystickHelper() {
     if (m_pJoy) m_pJoy->Unacquire(), m_pJoy->Release();
-    if (m_pDI) m_pDI->Release();
 }
\ No newline at end of file
@@ -2,21 +2,39 @@
 #include <dinput.h>
 #include <string>
 #include <vector>
+#include "InputBackend.h"
+#include "AsyncList.h"
 
 struct DInputDeviceInfo {
     GUID guid;
     std::wstring name;
+    GUID product;           // VID/PID, the same for every unit of a model
+    std::wstring path;      // device interface path (DIPROP_GUIDANDPATH); tied to the port
 };
 
-class JoystickHelper {
-    LPDIRECTINPUT8         m_pDI = nullptr;
+// Process-wide DirectInput instance, created on first use and kept for the process
+// lifetime; device opens and enumerations share it instead of creating their own.
+LPDIRECTINPUT8 SharedDirectInput();
+
+class JoystickHelper : public InputBackend {
     LPDIRECTINPUTDEVICE8   m_pJoy = nullptr;
     GUID                   m_guid;
+    WakeEvent*             m_notify = nullptr;
+    bool                   m_buffered = false; // device delivers buffered data and events without Poll()
+    bool                   m_acquired = false;
+    bool                   m_lost = false;     // unplugged; reads fail until the device manager reopens it
 public:
     JoystickHelper() = default;
-    static void EnumerateDevices(std::vector<DInputDeviceInfo>& outList);
+    // Lists attached game controllers. Stops early, returning false, once cancel fires.
+    static bool EnumerateDevices(std::vector<DInputDeviceInfo>& outList, const EnumCancel& cancel = EnumCancel());
 
     bool Init(const GUID& guid, HWND hwnd);
-    bool GetJoyState(DIJOYSTATE& js);
+    bool GetJoyState(DIJOYSTATE2& js) override;
+    void SetNotify(WakeEvent* ev) override;
+    bool IsEventDriven() const override { return m_buffered && m_notify && m_acquired; }
+    uint64_t TakeChanges() override;
+    bool IsPresent() const override { return !m_lost; }
     ~JoystickHelper();
+private:
+    bool Reacquire();
 };
\ No newline at end of file
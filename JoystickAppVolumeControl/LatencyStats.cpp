@@ -0,0 +1,127 @@
+#include "LatencyStats.h"
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
+
+#if JAVC_LATENCY_STATS
+LatencyHistogram g_stageHistograms[(int)Stage::Count];
+std::atomic<uint64_t> g_statCounters[(int)StatCounter::Count] = {};
+#endif
+
+static int64_t NowNs() {
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+static std::atomic<int64_t> s_resetNs{ NowNs() };
+
+static const char* const kStageNames[] = { "device read", "filter", "map", "sink write", "ui publish", "tick", "reattach", "ramp write" };
+static const char* const kCounterNames[] = { "ticks", "device reads", "writes requested", "writes suppressed", "writes dropped", "session writes",
+    "device losses", "device reattaches", "ramp steps" };
+
+const char* StageName(Stage stage) {
+    return kStageNames[(int)stage];
+}
+
+const char* StatCounterName(StatCounter counter) {
+    return kCounterNames[(int)counter];
+}
+
+static int HighBit(uint64_t v) {
+#ifdef _MSC_VER
+    unsigned long idx;
+    _BitScanReverse64(&idx, v);
+    return (int)idx;
+#else
+    return 63 - __builtin_clzll(v);
+#endif
+}
+
+int LatencyHistogram::BucketOf(uint64_t ns) {
+    const uint64_t kSub = 1ull << kSubBits;
+    if (ns < kSub) return (int)ns;
+    int e = HighBit(ns);
+    if (e >= kMaxExponent) return kBuckets - 1;  // 2^40 ns and up share the last bucket
+    int sub = (int)((ns >> (e - kSubBits)) & (kSub - 1));
+    return ((e - kSubBits + 1) << kSubBits) + sub;
+}
+
+uint64_t LatencyHistogram::BucketUpperBound(int bucket) {
+    const int kSub = 1 << kSubBits;
+    if (bucket < kSub) return (uint64_t)bucket;
+    int e = (bucket >> kSubBits) + kSubBits - 1;
+    int sub = bucket & (kSub - 1);
+    return ((uint64_t)(kSub + sub + 1) << (e - kSubBits)) - 1;
+}
+
+double LatencyHistogram::Mean() const {
+    uint64_t n = Count();
+    return n ? (double)m_sum.load(std::memory_order_relaxed) / n : 0.0;
+}
+
+uint64_t LatencyHistogram::Percentile(double q) const {
+    uint64_t total = 0;
+    for (const std::atomic<uint32_t>& b : m_buckets) total += b.load(std::memory_order_relaxed);
+    if (!total) return 0;
+    uint64_t rank = (uint64_t)(q * (total - 1)) + 1;
+    uint64_t seen = 0;
+    for (int i = 0; i < kBuckets; ++i) {
+        seen += m_buckets[i].load(std::memory_order_relaxed);
+        if (seen >= rank) {
+            // The last bucket is open-ended, so only Max() bounds it.
+            uint64_t upper = i == kBuckets - 1 ? Max() : BucketUpperBound(i);
+            return upper < Max() ? upper : Max();
+        }
+    }
+    return Max();
+}
+
+void LatencyHistogram::Reset() {
+    for (std::atomic<uint32_t>& b : m_buckets) b.store(0, std::memory_order_relaxed);
+    m_count = 0;
+    m_sum = 0;
+    m_max = 0;
+}
+
+LatencySnapshot GetLatencyStats() {
+    LatencySnapshot snap = {};
+    snap.elapsedSec = (NowNs() - s_resetNs.load()) * 1e-9;
+#if JAVC_LATENCY_STATS
+    for (int i = 0; i < (int)Stage::Count; ++i) {
+        const LatencyHistogram& h = g_stageHistograms[i];
+        snap.stages[i] = { h.Count(), h.Mean(), h.Percentile(0.50), h.Percentile(0.99), h.Max() };
+    }
+    for (int i = 0; i < (int)StatCounter::Count; ++i)
+        snap.counters[i] = g_statCounters[i].load(std::memory_order_relaxed);
+#endif
+    snap.tickRate = snap.elapsedSec > 0 ? snap.counters[(int)StatCounter::Ticks] / snap.elapsedSec : 0.0;
+    return snap;
+}
+
+void ResetLatencyStats() {
+#if JAVC_LATENCY_STATS
+    for (LatencyHistogram& h : g_stageHistograms) h.Reset();
+    for (std::atomic<uint64_t>& c : g_statCounters) c.store(0, std::memory_order_relaxed);
+#endif
+    s_resetNs = NowNs();
+}
+
+void DumpLatencyStats(FILE* out) {
+    LatencySnapshot snap = GetLatencyStats();
+    fprintf(out, "Pipeline latency over %.1fs (%.1f ticks/s)\n", snap.elapsedSec, snap.tickRate);
+    fprintf(out, "  %-12s %10s %10s %10s %10s %10s\n", "stage", "count", "mean ns", "p50 ns", "p99 ns", "max ns");
+    for (int i = 0; i < (int)Stage::Count; ++i) {
+        const StageSummary& s = snap.stages[i];
+        fprintf(out, "  %-12s %10llu %10.0f %10llu %10llu %10llu\n", kStageNames[i], (unsigned long long)s.count, s.meanNs,
+            (unsigned long long)s.p50Ns, (unsigned long long)s.p99Ns, (unsigned long long)s.maxNs);
+    }
+    for (int i = 0; i < (int)StatCounter::Count; ++i)
+        fprintf(out, "  %-18s %llu\n", kCounterNames[i], (unsigned long long)snap.counters[i]);
+}
+
+bool DumpLatencyStats(const char* path) {
+    FILE* f = fopen(path, "a");
+    if (!f) return false;
+    DumpLatencyStats(f);
+    fclose(f);
+    return true;
+}
\ No newline at end of file
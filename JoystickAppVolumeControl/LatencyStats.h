@@ -0,0 +1,109 @@
+#pragma once
+#include <stdint.h>
+#include <stdio.h>
+#include <atomic>
+#include <chrono>
+
+// Per-stage latency histograms and pipeline counters for the input-to-volume path.
+// Build with JAVC_LATENCY_STATS=0 to compile the STAGE_TIMER/STAT_* hooks out entirely;
+// the query functions then report zeros.
+#ifndef JAVC_LATENCY_STATS
+#define JAVC_LATENCY_STATS 1
+#endif
+
+enum class Stage : int { DeviceRead, Filter, Map, SinkWrite, UiPublish, Tick, Reattach, RampWrite, Count };
+enum class StatCounter : int {
+    Ticks,              // scheduler passes
+    DeviceReads,        // GetJoyState calls
+    WritesRequested,    // volumes handed to the coalescer
+    WritesSuppressed,   // dropped by the coalescer's deadband or superseded while rate limited
+    WritesDropped,      // reached the session sink but no session was attached to the target
+    SessionWrites,      // individual session volume calls issued
+    DeviceLosses,       // bound devices that stopped answering or were unplugged
+    DeviceReattaches,   // lost devices reopened by the device manager
+    RampSteps,          // volume steps written by the ramp
+    Count
+};
+
+const char* StageName(Stage stage);
+const char* StatCounterName(StatCounter counter);
+
+// Lock-free log-linear histogram of nanosecond values: 16 linear sub-buckets per
+// power of two (at most 6.25% relative error), covering up to 2^40 ns. Any number
+// of threads may record concurrently.
+class LatencyHistogram {
+public:
+    static const int kSubBits = 4;
+    static const int kMaxExponent = 40;
+    static const int kBuckets = (kMaxExponent - kSubBits + 1) << kSubBits;
+
+    void Record(uint64_t ns) {
+        m_buckets[BucketOf(ns)].fetch_add(1, std::memory_order_relaxed);
+        m_count.fetch_add(1, std::memory_order_relaxed);
+        m_sum.fetch_add(ns, std::memory_order_relaxed);
+        uint64_t max = m_max.load(std::memory_order_relaxed);
+        while (ns > max && !m_max.compare_exchange_weak(max, ns, std::memory_order_relaxed)) {}
+    }
+    uint64_t Count() const { return m_count.load(std::memory_order_relaxed); }
+    uint64_t Max() const { return m_max.load(std::memory_order_relaxed); }
+    double Mean() const;
+    // Upper bound of the bucket holding the q-th quantile (0..1), capped at Max().
+    uint64_t Percentile(double q) const;
+    void Reset();
+
+    static int BucketOf(uint64_t ns);
+    static uint64_t BucketUpperBound(int bucket);
+private:
+    std::atomic<uint32_t> m_buckets[kBuckets] = {};
+    std::atomic<uint64_t> m_count{0};
+    std::atomic<uint64_t> m_sum{0};
+    std::atomic<uint64_t> m_max{0};
+};
+
+struct StageSummary {
+    uint64_t count;
+    double meanNs;
+    uint64_t p50Ns, p99Ns, maxNs;
+};
+
+struct LatencySnapshot {
+    StageSummary stages[(int)Stage::Count];
+    uint64_t counters[(int)StatCounter::Count];
+    double elapsedSec;  // since the last reset
+    double tickRate;    // ticks per second over elapsedSec
+};
+
+LatencySnapshot GetLatencyStats();
+void ResetLatencyStats();
+// Writes a table of the current snapshot; the path overload appends to a file.
+void DumpLatencyStats(FILE* out);
+bool DumpLatencyStats(const char* path);
+
+#if JAVC_LATENCY_STATS
+extern LatencyHistogram g_stageHistograms[(int)Stage::Count];
+extern std::atomic<uint64_t> g_statCounters[(int)StatCounter::Count];
+
+// Records the lifetime of the enclosing scope into a stage histogram.
+class ScopedStageTimer {
+public:
+    explicit ScopedStageTimer(Stage stage) : m_stage(stage), m_start(std::chrono::steady_clock::now()) {}
+    ~ScopedStageTimer() {
+        g_stageHistograms[(int)m_stage].Record(
+            (uint64_t)std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - m_start).count());
+    }
+private:
+    Stage m_stage;
+    std::chrono::steady_clock::time_point m_start;
+};
+
+#define STAT_CONCAT2(a, b) a##b
+#define STAT_CONCAT(a, b) STAT_CONCAT2(a, b)
+#define STAGE_TIMER(stage) ScopedStageTimer STAT_CONCAT(stageTimer_, __LINE__)(stage)
+#define STAGE_RECORD(stage, ns) g_stageHistograms[(int)(stage)].Record(ns)
+#define STAT_ADD(counter, n) g_statCounters[(int)(counter)].fetch_add((n), std::memory_order_relaxed)
+#else
+#define STAGE_TIMER(stage) ((void)0)
+#define STAGE_RECORD(stage, ns) ((void)0)
+#define STAT_ADD(counter, n) ((void)0)
+#endif
+#define STAT_COUNT(counter) STAT_ADD(counter, 1)
\ No newline at end of file
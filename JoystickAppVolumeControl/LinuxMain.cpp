@@ -0,0 +1,300 @@
+#include <signal.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <atomic>
+#include <chrono>
+#include <map>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+#include "AudioExecutor.h"
+#include "BindingEngine.h"
+#include "DeviceManager.h"
+#include "EndpointManager.h"
+#include "EvdevInputBackend.h"
+#include "FakeEndpointProvider.h"
+#include "LatencyStats.h"
+#include "Profile.h"
+#include "SessionTargetSink.h"
+#include "VolumeCoalescer.h"
+#include "VolumeRamp.h"
+#include "log.h"
+
+// Headless front end for Linux: builds the engine from a profile and runs the same
+// input thread, coalescer, audio executor and ramp as the Windows build. Devices are
+// evdev nodes, named by path in the profile's device field (a /dev/input/by-id link
+// survives replugging); --replay stands a recording in for a device. Volumes go to an
+// in-process fake output with one session per --app, reported at exit. SIGHUP reloads
+// the profile into the running engine. The profile is not written back.
+
+static const wchar_t kFakeOutput[] = L"fake-output";
+static const int kReplaySettleMs = 250;
+
+std::atomic<bool> g_running{false};
+std::atomic<bool> g_rescan{false};
+volatile sig_atomic_t g_signalled = 0;
+volatile sig_atomic_t g_reload = 0;
+
+std::map<uint32_t, std::wstring> g_appNames;    // fake session pid -> process name
+SessionRegistry g_registry([](uint32_t pid) {
+    auto it = g_appNames.find(pid);
+    if (it != g_appNames.end()) return it->second;
+    char path[64], name[64] = {};
+    snprintf(path, sizeof(path), "/proc/%u/comm", pid);
+    FILE* f = fopen(path, "r");
+    if (!f) return std::wstring();
+    if (!fgets(name, sizeof(name), f)) name[0] = '\0';
+    fclose(f);
+    name[strcspn(name, "\n")] = '\0';
+    return std::wstring(name, name + strlen(name));
+});
+FakeEndpointProvider g_provider(g_registry);
+EndpointManager g_endpoints(g_provider, g_registry);
+
+Profile g_profile;
+BindingEngine g_engine;
+SessionTargetSink g_sink(g_registry, &g_endpoints);
+VolumeRamp g_ramp(&g_sink);
+AudioExecutor g_audio(g_ramp);
+VolumeCoalescer g_coalescer(&g_audio);
+DeviceManager g_deviceManager;
+
+std::map<std::string, InputBackend*> g_tracked;    // profile device id -> tracked device, kept across reloads
+std::map<std::string, std::string> g_replays;   // profile device id -> recording
+double g_replaySpeed = 1.0;
+std::vector<EvdevInputBackend*> g_replayInputs;  // owned by g_deviceManager
+
+static void OnSignal(int) {
+    g_signalled = 1;
+}
+
+static void OnHangup(int) {
+    g_reload = 1;
+}
+
+static std::wstring Widen(const std::string& s) {
+    return std::wstring(s.begin(), s.end());
+}
+
+// Opens the recording standing in for a device, or the device node itself.
+static std::unique_ptr<InputBackend> OpenDevice(const std::string& id) {
+    std::unique_ptr<EvdevInputBackend> dev(new EvdevInputBackend());
+    auto replay = g_replays.find(id);
+    if (replay != g_replays.end()) {
+        if (!dev->OpenReplay(replay->second, g_replaySpeed)) return nullptr;
+        g_replayInputs.push_back(dev.get());
+    } else if (!dev->Open(id)) {
+        return nullptr;
+    }
+    return std::unique_ptr<InputBackend>(dev.release());
+}
+
+// Tracked device nodes that exist right now.
+static std::vector<DeviceIdentity> AttachedDevices() {
+    std::vector<DeviceIdentity> ids;
+    for (size_t i = 0; i < g_deviceManager.Count(); ++i) {
+        const DeviceIdentity& wanted = g_deviceManager.Device((int)i)->Wanted();
+        if (g_replays.count(wanted.instanceId) || access(wanted.instanceId.c_str(), R_OK) == 0)
+            ids.push_back(wanted);
+    }
+    return ids;
+}
+
+// Loads the profile into a new binding set and publishes it; the input thread may be
+// running. Devices are opened once and stay tracked for later reloads; targets named
+// again keep their sink ids.
+static void BuildEngine() {
+    g_audio.Invoke([] { g_ramp.SetSettings(g_profile.ramp); });
+    std::map<std::string, int> deviceSlot;
+    auto slotFor = [&](const std::string& id) {
+        auto found = deviceSlot.find(id);
+        if (found != deviceSlot.end()) return found->second;
+        InputBackend*& input = g_tracked[id];
+        if (!input) {
+            DeviceIdentity wanted = { id, "", L"", L"" };
+            input = g_deviceManager.Track(wanted, OpenDevice(id), wanted);
+        }
+        return deviceSlot.emplace(id, g_engine.AddDevice(input)).first->second;
+    };
+    for (const ProfileBinding& cfg : g_profile.bindings) {
+        int device = slotFor(cfg.deviceId);
+        const AxisCalibration* cal = g_profile.FindCalibration(cfg.deviceId, cfg.axisOfs);
+        LONG axisMin = cfg.axisMin, axisMax = cfg.axisMax;
+        if (cal && !cfg.autoCalibrate) {
+            axisMin = cfg.axisMin <= cfg.axisMax ? cal->min : cal->max;
+            axisMax = cfg.axisMin <= cfg.axisMax ? cal->max : cal->min;
+        }
+        Binding b = { device, cfg.axisOfs, g_sink.AddTarget(cfg.target),
+            axisMin, axisMax, cfg.volMin, cfg.volMax, cfg.curve, cfg.filters };
+        b.autoCalibrate = cfg.autoCalibrate;
+        b.povAngle = cfg.povAngle;
+        b.action = cfg.action;
+        b.step = cfg.step;
+        int index = g_engine.AddBinding(b);
+        if (cal && cfg.autoCalibrate) g_engine.SeedCalibration(index, cal->min, cal->max);
+    }
+    for (const ProfileRule& cfg : g_profile.rules) {
+        Rule rule = { {}, g_sink.AddTarget(cfg.target), cfg.expression };
+        for (const std::string& id : cfg.deviceIds)
+            rule.devices.push_back(slotFor(id));
+        std::string error;
+        if (g_engine.AddRule(rule, &error) < 0) LOG_ERROR("Rule '%s' skipped: %s", cfg.expression.c_str(), error.c_str());
+    }
+    g_engine.Publish();
+}
+
+static void Reload(const std::string& path) {
+    Profile profile;
+    std::string error;
+    if (!LoadProfile(path, profile, &error)) {
+        LOG_ERROR("Reload of %s failed, keeping the running profile: %s", path.c_str(), error.c_str());
+        return;
+    }
+    g_profile = profile;
+    BuildEngine();
+    LOG_INFO("Reloaded %s: %zu binding(s) and %zu rule(s)", path.c_str(), g_engine.BindingCount(), g_engine.RuleCount());
+}
+
+static bool ReplaysFinished() {
+    if (g_replayInputs.empty()) return false;
+    for (EvdevInputBackend* dev : g_replayInputs)
+        if (!dev->Finished()) return false;
+    return true;
+}
+
+static void Report(FILE* out) {
+    std::shared_ptr<FakeVolumeControl> master = g_provider.Master(kFakeOutput);
+    fprintf(out, "system: volume=%.3f writes=%llu\n", master->Volume(), (unsigned long long)master->Writes());
+    for (const auto& app : g_appNames) {
+        std::shared_ptr<FakeVolumeControl> s = g_provider.Session(L"app-" + std::to_wstring(app.first));
+        fprintf(out, "%ls: volume=%.3f writes=%llu\n", app.second.c_str(), s->Volume(), (unsigned long long)s->Writes());
+    }
+    fprintf(out, "device reads=%llu, executor commands=%llu (%llu collapsed), wakeups=%llu\n",
+        (unsigned long long)g_engine.DeviceReads(), (unsigned long long)g_audio.Commands(),
+        (unsigned long long)g_audio.Collapsed(), (unsigned long long)g_audio.Wakeups());
+}
+
+static void Usage() {
+    fprintf(stderr,
+        "usage: javc-headless --profile FILE [options]\n"
+        "  --replay DEVICE=FILE  play an evdev recording instead of opening DEVICE\n"
+        "  --speed X             replay speed factor, 0 for no pacing (default 1)\n"
+        "  --app NAME            add a session of process NAME to the fake output\n"
+        "  --seconds N           stop after N seconds (default: on SIGINT/SIGTERM,\n"
+        "                        or once every replay has finished)\n"
+        "  --stats               print latency stats at exit\n"
+        "  --verbose             debug logging\n"
+        "SIGHUP reloads the profile while running.\n");
+}
+
+int main(int argc, char** argv) {
+    std::string profilePath;
+    double seconds = 0;
+    bool stats = false;
+    std::vector<std::string> apps;
+    for (int i = 1; i < argc; ++i) {
+        const char* arg = argv[i];
+        bool hasValue = i + 1 < argc;
+        if (strcmp(arg, "--profile") == 0 && hasValue) {
+            profilePath = argv[++i];
+        } else if (strcmp(arg, "--replay") == 0 && hasValue) {
+            std::string spec = argv[++i];
+            size_t eq = spec.find('=');
+            if (eq == std::string::npos) {
+                Usage();
+                return 1;
+            }
+            g_replays[spec.substr(0, eq)] = spec.substr(eq + 1);
+        } else if (strcmp(arg, "--speed") == 0 && hasValue) {
+            g_replaySpeed = atof(argv[++i]);
+        } else if (strcmp(arg, "--app") == 0 && hasValue) {
+            apps.push_back(argv[++i]);
+        } else if (strcmp(arg, "--seconds") == 0 && hasValue) {
+            seconds = atof(argv[++i]);
+        } else if (strcmp(arg, "--stats") == 0) {
+            stats = true;
+        } else if (strcmp(arg, "--verbose") == 0) {
+            SetLogLevel(LogLevel::Debug);
+        } else {
+            Usage();
+            return 1;
+        }
+    }
+    std::string error;
+    if (profilePath.empty() || !LoadProfile(profilePath, g_profile, &error)) {
+        if (!profilePath.empty()) fprintf(stderr, "Cannot load profile %s: %s\n", profilePath.c_str(), error.c_str());
+        else Usage();
+        return 1;
+    }
+    if (g_profile.bindings.empty() && g_profile.rules.empty()) {
+        fprintf(stderr, "Profile %s has no bindings or rules\n", profilePath.c_str());
+        return 1;
+    }
+
+    g_provider.Plug(EndpointInfo{ kFakeOutput, L"Fake output", EndpointFlow::Render });
+    g_provider.SetDefault(EndpointFlow::Render, kFakeOutput);
+    for (size_t i = 0; i < apps.size(); ++i) {
+        uint32_t pid = 1000 + (uint32_t)i;
+        g_appNames[pid] = Widen(apps[i]);
+        g_provider.AddSession(kFakeOutput, L"app-" + std::to_wstring(pid), pid);
+    }
+    g_provider.SetNotify(&g_endpoints);
+    g_audio.Start();
+    g_audio.Invoke([] { g_endpoints.Start(); });
+
+    g_engine.SetSink(&g_coalescer);
+    g_sink.SetTargetLimit(AudioExecutor::kMaxTargets);
+    g_deviceManager.SetOpener([](const DeviceIdentity& found) { return OpenDevice(found.instanceId); });
+    g_deviceManager.SetLostHandler([] { g_rescan = true; });
+    BuildEngine();
+    signal(SIGINT, OnSignal);
+    signal(SIGTERM, OnSignal);
+    signal(SIGHUP, OnHangup);
+    ResetLatencyStats();
+    g_running = true;
+    std::thread input([] { g_engine.Run(g_running); });
+    LOG_INFO("Headless: %zu binding(s) and %zu rule(s) on %zu device(s)",
+        g_engine.BindingCount(), g_engine.RuleCount(), g_engine.DeviceCount());
+
+    typedef std::chrono::steady_clock Clock;
+    Clock::time_point start = Clock::now(), lastScan = start, finished;
+    bool replaysDone = false;
+    while (!g_signalled) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(50));
+        Clock::time_point now = Clock::now();
+        if (seconds > 0 && now - start >= std::chrono::duration<double>(seconds)) break;
+        // Give filters and the coalescer time to settle on the last recorded state.
+        if (!replaysDone && ReplaysFinished()) {
+            replaysDone = true;
+            finished = now;
+        }
+        if (replaysDone && now - finished >= std::chrono::milliseconds(kReplaySettleMs)) break;
+        if (g_reload) {
+            g_reload = 0;
+            Reload(profilePath);
+        }
+        // No hotplug notifications here: parked devices are looked for once a second.
+        if (g_rescan.exchange(false) || (g_deviceManager.AnyParked() && now - lastScan >= std::chrono::seconds(1))) {
+            g_deviceManager.Reconcile(AttachedDevices());
+            lastScan = now;
+        }
+    }
+    g_running = false;
+    g_engine.Wake();
+    input.join();
+    g_audio.Invoke([] { g_ramp.Flush(true); });
+
+    Report(stdout);
+    if (stats) DumpLatencyStats(stdout);
+    g_audio.Invoke([] {
+        g_sink.Clear();
+        g_endpoints.Stop();
+    });
+    g_audio.Stop();
+    g_deviceManager.Clear();
+    StopLogging();
+    return 0;
+}
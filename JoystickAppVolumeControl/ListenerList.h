@@ -0,0 +1,76 @@
+#pragma once
+#include <algorithm>
+#include <condition_variable>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// Listeners for change notifications, called outside the list's lock, so a listener may add
+// or remove listeners, itself included. Remove() waits for calls of that listener running on
+// other threads: once it returns the listener is never called again, and whatever it
+// captured may be destroyed. Remove() must therefore not be called while holding a lock the
+// listener takes.
+template<typename... Args>
+class ListenerList {
+public:
+    typedef std::function<void(Args...)> Listener;
+
+    int Add(Listener listener) {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        std::shared_ptr<Slot> slot = std::make_shared<Slot>();
+        slot->id = m_nextId;
+        slot->listener = std::move(listener);
+        m_slots.push_back(std::move(slot));
+        return m_nextId++;
+    }
+
+    void Remove(int id) {
+        std::unique_lock<std::mutex> lock(m_mutex);
+        auto it = std::find_if(m_slots.begin(), m_slots.end(), [id](const std::shared_ptr<Slot>& s) { return s->id == id; });
+        if (it == m_slots.end()) return;
+        std::shared_ptr<Slot> slot = *it;
+        m_slots.erase(it);
+        slot->removed = true;
+        // A call further up this thread's own stack can only finish after we return.
+        std::thread::id self = std::this_thread::get_id();
+        m_idle.wait(lock, [&] {
+            return std::all_of(slot->callers.begin(), slot->callers.end(), [self](std::thread::id t) { return t == self; });
+        });
+    }
+
+    void Notify(Args... args) {
+        std::vector<std::shared_ptr<Slot>> slots;
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            slots = m_slots;
+        }
+        std::thread::id self = std::this_thread::get_id();
+        for (const std::shared_ptr<Slot>& slot : slots) {
+            {
+                std::lock_guard<std::mutex> lock(m_mutex);
+                if (slot->removed) continue;    // removed since the copy was taken
+                slot->callers.push_back(self);
+            }
+            slot->listener(args...);
+            {
+                std::lock_guard<std::mutex> lock(m_mutex);
+                slot->callers.erase(std::find(slot->callers.begin(), slot->callers.end(), self));
+            }
+            m_idle.notify_all();
+        }
+    }
+private:
+    struct Slot {
+        int id = 0;
+        Listener listener;
+        bool removed = false;
+        std::vector<std::thread::id> callers;   // threads inside listener right now
+    };
+
+    std::mutex m_mutex;
+    std::condition_variable m_idle;     // a call finished
+    std::vector<std::shared_ptr<Slot>> m_slots;
+    int m_nextId = 1;
+};
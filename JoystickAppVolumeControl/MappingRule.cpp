@@ -0,0 +1,331 @@
+#include "MappingRule.h"
+#include <ctype.h>
+#include <stdlib.h>
+#include <string.h>
+
+static const float kAxisScale = 1.0f / 65535.0f;
+
+float MappingProgram::Apply(Op op, float a, float b, float c) {
+    switch (op) {
+    case Op::Add: return a + b;
+    case Op::Sub: return a - b;
+    case Op::Mul: return a * b;
+    case Op::Div: return b != 0.0f ? a / b : 0.0f;
+    case Op::Neg: return -a;
+    case Op::Not: return a == 0.0f ? 1.0f : 0.0f;
+    case Op::Lt: return a < b ? 1.0f : 0.0f;
+    case Op::Le: return a <= b ? 1.0f : 0.0f;
+    case Op::Gt: return a > b ? 1.0f : 0.0f;
+    case Op::Ge: return a >= b ? 1.0f : 0.0f;
+    case Op::Eq: return a == b ? 1.0f : 0.0f;
+    case Op::Ne: return a != b ? 1.0f : 0.0f;
+    case Op::And: return a != 0.0f && b != 0.0f ? 1.0f : 0.0f;
+    case Op::Or: return a != 0.0f || b != 0.0f ? 1.0f : 0.0f;
+    case Op::Select: return a != 0.0f ? b : c;
+    case Op::Min: return a < b ? a : b;
+    case Op::Max: return a > b ? a : b;
+    case Op::Abs: return a < 0.0f ? -a : a;
+    case Op::Clamp: return a < b ? b : (a > c ? c : a);
+    case Op::Lerp: return a + (b - a) * c;
+    case Op::Range: {
+        if (c == b) return a >= c ? 1.0f : 0.0f;
+        float t = (a - b) / (c - b);
+        return t < 0.0f ? 0.0f : (t > 1.0f ? 1.0f : t);
+    }
+    default: return 0.0f;
+    }
+}
+
+float MappingProgram::Evaluate(const DIJOYSTATE2* const* states) {
+    float* r = m_regs.data();
+    for (const Instr& in : m_code) {
+        if (in.op == Op::Load) {
+            const Input& input = m_inputs[in.a];
+            LONG v = input.reader.Read(*states[input.device]);
+            r[in.dst] = input.reader.Digital() ? (float)v : (float)v * kAxisScale;
+        } else {
+            r[in.dst] = Apply(in.op, r[in.a], r[in.b], r[in.c]);
+        }
+    }
+    float v = r[m_result];
+    // NaN fails both compares and lands on 0.
+    return v > 0.0f ? (v < 1.0f ? v : 1.0f) : 0.0f;
+}
+
+uint64_t MappingProgram::WatchMask(int device) const {
+    uint64_t mask = 0;
+    for (const Input& in : m_inputs)
+        if (in.device == device) mask |= JoyStateBit(in.reader.ofs);
+    return mask;
+}
+
+// Recursive-descent parser emitting straight into the program. Operands are tracked as
+// constants or temporaries while compiling; temporaries are released as soon as their
+// parent instruction is emitted, so the register file is as deep as the expression, not as long.
+class RuleCompiler {
+public:
+    typedef MappingProgram::Op Op;
+
+    RuleCompiler(MappingProgram& prog, const std::string& text, int deviceCount)
+        : m_prog(prog), m_p(text.c_str()), m_deviceCount(deviceCount) {}
+
+    bool Run(std::string& error) {
+        Operand result = Expr();
+        Skip();
+        if (m_error.empty() && *m_p) Fail("unexpected '" + std::string(1, *m_p) + "'");
+        if (m_error.empty() && (m_consts.size() + m_maxTemps > 256)) Fail("expression too large");
+        if (!m_error.empty()) {
+            error = m_error;
+            return false;
+        }
+        // Constants take the low registers, temporaries follow.
+        size_t base = m_consts.size();
+        for (size_t i = 0; i < m_code.size(); ++i) {
+            MappingProgram::Instr& in = m_code[i];
+            in.dst = (uint8_t)(in.dst + base);
+            if (in.op == Op::Load) continue;
+            in.a = Reg(m_args[i].ops[0], base);
+            in.b = Reg(m_args[i].ops[1], base);
+            in.c = Reg(m_args[i].ops[2], base);
+        }
+        m_prog.m_regs = m_consts;
+        m_prog.m_regs.resize(base + m_maxTemps, 0.0f);
+        m_prog.m_code = m_code;
+        m_prog.m_result = Reg(result, base);
+        return true;
+    }
+private:
+    struct Operand {
+        bool isConst;
+        int index;      // into m_consts, or the temporary register
+    };
+    struct Args {
+        Operand ops[3];
+    };
+
+    static uint8_t Reg(const Operand& o, size_t base) { return (uint8_t)(o.isConst ? o.index : o.index + base); }
+
+    void Fail(const std::string& message) {
+        if (m_error.empty()) m_error = message;
+    }
+    void Skip() {
+        while (isspace((unsigned char)*m_p)) ++m_p;
+    }
+    bool Accept(const char* token) {
+        Skip();
+        size_t n = strlen(token);
+        if (strncmp(m_p, token, n) != 0) return false;
+        // '<' must not swallow the first half of '<='.
+        if (n == 1 && (token[0] == '<' || token[0] == '>' || token[0] == '!') && m_p[1] == '=') return false;
+        m_p += n;
+        return true;
+    }
+    void Expect(const char* token) {
+        if (!Accept(token)) Fail(std::string("expected '") + token + "'");
+    }
+
+    Operand Const(float v) {
+        m_consts.push_back(v);
+        return { true, (int)m_consts.size() - 1 };
+    }
+    float ConstValue(const Operand& o) const { return m_consts[o.index]; }
+
+    // Releases the temporary of an operand consumed by an instruction; temporaries are
+    // allocated like a stack, so the operands of one instruction are always the newest.
+    void Release(const Operand& o) {
+        if (!o.isConst && o.index + 1 == m_temps) --m_temps;
+    }
+    Operand Emit(Op op, Operand a) { return Emit(op, 1, a, a, a); }
+    Operand Emit(Op op, Operand a, Operand b) { return Emit(op, 2, a, b, a); }
+    Operand Emit(Op op, Operand a, Operand b, Operand c) { return Emit(op, 3, a, b, c); }
+    // Unused operand slots repeat a, keeping every register index valid.
+    Operand Emit(Op op, int argc, Operand a, Operand b, Operand c) {
+        if (!m_error.empty()) return Const(0.0f);
+        Args args = { { a, b, c } };
+        bool allConst = true;
+        for (int i = 0; i < argc; ++i) allConst = allConst && args.ops[i].isConst;
+        if (allConst)
+            return Const(MappingProgram::Apply(op, ConstValue(a), ConstValue(b), ConstValue(c)));
+        for (int i = argc - 1; i >= 0; --i) Release(args.ops[i]);
+        Operand dst = NewTemp();
+        MappingProgram::Instr in = { op, (uint8_t)dst.index, 0, 0, 0 };
+        m_code.push_back(in);
+        m_args.push_back(args);
+        return dst;
+    }
+    Operand NewTemp() {
+        Operand t = { false, m_temps++ };
+        if (m_temps > m_maxTemps) m_maxTemps = m_temps;
+        return t;
+    }
+
+    Operand Expr() {
+        Operand cond = Or();
+        if (!Accept("?")) return cond;
+        Operand yes = Expr();
+        Expect(":");
+        Operand no = Expr();
+        return Emit(Op::Select, cond, yes, no);
+    }
+    Operand Or() {
+        Operand a = And();
+        while (Accept("||")) a = Emit(Op::Or, a, And());
+        return a;
+    }
+    Operand And() {
+        Operand a = Cmp();
+        while (Accept("&&")) a = Emit(Op::And, a, Cmp());
+        return a;
+    }
+    Operand Cmp() {
+        Operand a = Sum();
+        if (Accept("<=")) return Emit(Op::Le, a, Sum());
+        if (Accept(">=")) return Emit(Op::Ge, a, Sum());
+        if (Accept("==")) return Emit(Op::Eq, a, Sum());
+        if (Accept("!=")) return Emit(Op::Ne, a, Sum());
+        if (Accept("<")) return Emit(Op::Lt, a, Sum());
+        if (Accept(">")) return Emit(Op::Gt, a, Sum());
+        return a;
+    }
+    Operand Sum() {
+        Operand a = Prod();
+        for (;;) {
+            if (Accept("+")) a = Emit(Op::Add, a, Prod());
+            else if (Accept("-")) a = Emit(Op::Sub, a, Prod());
+            else return a;
+        }
+    }
+    Operand Prod() {
+        Operand a = Unary();
+        for (;;) {
+            if (Accept("*")) a = Emit(Op::Mul, a, Unary());
+            else if (Accept("/")) a = Emit(Op::Div, a, Unary());
+            else return a;
+        }
+    }
+    Operand Unary() {
+        if (Accept("-")) return Emit(Op::Neg, Unary());
+        if (Accept("!")) return Emit(Op::Not, Unary());
+        return Primary();
+    }
+    Operand Primary() {
+        Skip();
+        if (Accept("(")) {
+            Operand e = Expr();
+            Expect(")");
+            return e;
+        }
+        if (isdigit((unsigned char)*m_p) || *m_p == '.') {
+            char* end;
+            float v = strtof(m_p, &end);
+            if (end == m_p) {
+                Fail("bad number");
+                return Const(0.0f);
+            }
+            m_p = end;
+            return Const(v);
+        }
+        std::string name = Identifier();
+        if (name.empty()) {
+            Fail(*m_p ? "unexpected '" + std::string(1, *m_p) + "'" : "unexpected end of expression");
+            return Const(0.0f);
+        }
+        Skip();
+        if (*m_p == '(') return Call(name);
+        return LoadInput(name);
+    }
+    std::string Identifier() {
+        Skip();
+        const char* start = m_p;
+        while (isalnum((unsigned char)*m_p) || *m_p == '_') ++m_p;
+        return std::string(start, m_p);
+    }
+
+    Operand Call(const std::string& name) {
+        struct Func { const char* name; Op op; int argc; };
+        static const Func kFuncs[] = {
+            { "min", Op::Min, 2 }, { "max", Op::Max, 2 }, { "abs", Op::Abs, 1 },
+            { "clamp", Op::Clamp, 3 }, { "lerp", Op::Lerp, 3 }, { "range", Op::Range, 3 },
+        };
+        const Func* f = nullptr;
+        for (const Func& k : kFuncs)
+            if (name == k.name) f = &k;
+        if (!f) {
+            Fail("unknown function '" + name + "'");
+            return Const(0.0f);
+        }
+        Expect("(");
+        Operand args[3];
+        for (int i = 0; i < f->argc; ++i) {
+            if (i) Expect(",");
+            args[i] = Expr();
+        }
+        Expect(")");
+        if (f->argc == 1) return Emit(f->op, args[0]);
+        if (f->argc == 2) return Emit(f->op, args[0], args[1]);
+        return Emit(f->op, args[0], args[1], args[2]);
+    }
+
+    Operand LoadInput(const std::string& first) {
+        int device = 0;
+        std::string name = first;
+        if (first.size() > 1 && first[0] == 'd' && isdigit((unsigned char)first[1]) && *m_p == '.') {
+            device = atoi(first.c_str() + 1);
+            ++m_p;
+            name = Identifier();
+        }
+        if (device >= m_deviceCount) {
+            Fail("no device d" + std::to_string(device));
+            return Const(0.0f);
+        }
+        int i = FindInput(name);
+        if (i < 0) {
+            Fail("unknown input '" + name + "'");
+            return Const(0.0f);
+        }
+        const InputDesc& desc = JoyInputs()[i];
+        InputReader reader = InputReader::For(desc.ofs, desc.povAngle);
+        // An input read twice loads once per use; sharing the slot keeps WatchMask() exact either way.
+        int slot = -1;
+        for (size_t k = 0; k < m_prog.m_inputs.size() && slot < 0; ++k) {
+            const MappingProgram::Input& in = m_prog.m_inputs[k];
+            if (in.device == device && in.reader.ofs == reader.ofs && in.reader.povAngle == reader.povAngle) slot = (int)k;
+        }
+        if (slot < 0) {
+            slot = (int)m_prog.m_inputs.size();
+            m_prog.m_inputs.push_back({ device, reader });
+        }
+        Operand dst = NewTemp();
+        MappingProgram::Instr in = { Op::Load, (uint8_t)dst.index, (uint8_t)slot, 0, 0 };
+        m_code.push_back(in);
+        m_args.push_back(Args());
+        return dst;
+    }
+
+    MappingProgram& m_prog;
+    const char* m_p;
+    int m_deviceCount;
+    std::string m_error;
+    std::vector<MappingProgram::Instr> m_code;
+    std::vector<Args> m_args;       // operands of m_code, resolved to registers once the constants are counted
+    std::vector<float> m_consts;
+    int m_temps = 0;
+    int m_maxTemps = 0;
+};
+
+bool MappingProgram::Compile(const std::string& text, int deviceCount, std::string* error) {
+    m_code.clear();
+    m_regs.clear();
+    m_inputs.clear();
+    m_result = 0;
+    std::string message;
+    RuleCompiler compiler(*this, text, deviceCount);
+    if (!compiler.Run(message)) {
+        m_code.clear();
+        m_regs.clear();
+        m_inputs.clear();
+        if (error) *error = message;
+        return false;
+    }
+    return true;
+}
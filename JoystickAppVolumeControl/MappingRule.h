@@ -0,0 +1,64 @@
+#pragma once
+#include <stdint.h>
+#include <string>
+#include <vector>
+#include "JoyInputs.h"
+
+// Mapping rules: an expression over inputs of one or more devices that yields a volume.
+//
+//   expr    := or ['?' expr ':' expr]
+//   or      := and {'||' and}
+//   and     := cmp {'&&' cmp}
+//   cmp     := sum [('<' | '<=' | '>' | '>=' | '==' | '!=') sum]
+//   sum     := prod {('+' | '-') prod}
+//   prod    := unary {('*' | '/') unary}
+//   unary   := ('-' | '!') unary | primary
+//   primary := number | input | func '(' expr {',' expr} ')' | '(' expr ')'
+//   input   := ['d' N '.'] name        name from JoyInputs(); no prefix means d0
+//
+// Axes read 0..1 over DirectInput's default 0..65535 range; buttons and hat directions
+// read 1 while pressed, else 0. Comparisons and logic yield 1 or 0; x / 0 is 0.
+// Functions: min(a, b), max(a, b), abs(x), clamp(x, lo, hi), lerp(a, b, t) and
+// range(x, lo, hi), which maps lo..hi onto 0..1 and clamps. The result is clamped to 0..1.
+//
+//   d0.Z * d1.Slider0                  fader scaled by a master fader on another device
+//   Z * (Button3 ? 0.2 : 1)            duck to 20% while button 3 is held
+//   1 - X   and   X                    two rules crossfading between two sessions
+//
+// Compile() parses once and emits register bytecode, folding constant subexpressions;
+// Evaluate() runs it over a preallocated register file and never allocates.
+class MappingProgram {
+public:
+    struct Input {
+        int device;             // rule-local device index: the N of dN
+        InputReader reader;
+    };
+
+    // deviceCount bounds the dN prefixes the expression may use.
+    bool Compile(const std::string& text, int deviceCount, std::string* error = nullptr);
+    // states[N] is the latest state of device dN.
+    float Evaluate(const DIJOYSTATE2* const* states);
+
+    const std::vector<Input>& Inputs() const { return m_inputs; }
+    // JoyStateBit() mask of the inputs the rule reads on a device.
+    uint64_t WatchMask(int device) const;
+    size_t InstructionCount() const { return m_code.size(); }
+    size_t RegisterCount() const { return m_regs.size(); }
+private:
+    enum class Op : uint8_t {
+        Load, Add, Sub, Mul, Div, Neg, Not, Lt, Le, Gt, Ge, Eq, Ne, And, Or,
+        Select, Min, Max, Abs, Clamp, Lerp, Range
+    };
+    struct Instr {
+        Op op;
+        uint8_t dst, a, b, c;   // registers; a is the input index for Load
+    };
+    friend class RuleCompiler;
+
+    static float Apply(Op op, float a, float b, float c);
+
+    std::vector<Instr> m_code;
+    std::vector<float> m_regs;      // constants first, then temporaries
+    std::vector<Input> m_inputs;
+    uint8_t m_result = 0;
+};
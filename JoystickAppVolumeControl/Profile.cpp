@@ -0,0 +1,406 @@
+#include "Profile.h"
+#include "MappingRule.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+static const char* const kCurveNames[] = { "linear", "audio_taper", "s_curve", "piecewise" };
+static const char* const kFilterNames[] = { "none", "moving_average", "exponential", "one_euro", "median" };
+static const char* const kActionNames[] = { "volume", "mute_toggle", "step_up", "step_down" };
+
+const char* AxisName(DWORD axisOfs, uint16_t povAngle) {
+    int i = FindInput(axisOfs, povAngle);
+    return i >= 0 ? JoyInputs()[i].name.c_str() : nullptr;
+}
+
+bool ParseAxis(const std::string& text, DWORD& axisOfs, uint16_t* povAngle) {
+    int i = FindInput(text);
+    if (i >= 0) {
+        axisOfs = JoyInputs()[i].ofs;
+        if (povAngle) *povAngle = JoyInputs()[i].povAngle;
+        return true;
+    }
+    char* end = nullptr;
+    unsigned long ofs = strtoul(text.c_str(), &end, 10);
+    if (end == text.c_str() || *end || ofs + sizeof(LONG) > sizeof(DIJOYSTATE2)) return false;
+    axisOfs = (DWORD)ofs;
+    if (povAngle) *povAngle = 0;
+    return true;
+}
+
+const AxisCalibration* Profile::FindCalibration(const std::string& deviceId, DWORD axisOfs) const {
+    for (const AxisCalibration& c : calibrations)
+        if (c.axisOfs == axisOfs && c.deviceId == deviceId) return &c;
+    return nullptr;
+}
+
+void Profile::SetCalibration(const AxisCalibration& cal) {
+    for (AxisCalibration& c : calibrations) {
+        if (c.axisOfs == cal.axisOfs && c.deviceId == cal.deviceId) {
+            c = cal;
+            return;
+        }
+    }
+    calibrations.push_back(cal);
+}
+
+// UTF-8 <-> wchar_t (UTF-16 on Windows, UTF-32 elsewhere).
+static std::string ToUtf8(const std::wstring& s) {
+    std::string out;
+    for (size_t i = 0; i < s.size(); ++i) {
+        uint32_t c = (uint32_t)s[i];
+        if (sizeof(wchar_t) == 2 && c >= 0xD800 && c < 0xDC00 && i + 1 < s.size()) {
+            uint32_t lo = (uint32_t)s[i + 1];
+            if (lo >= 0xDC00 && lo < 0xE000) {
+                c = 0x10000 + ((c - 0xD800) << 10) + (lo - 0xDC00);
+                ++i;
+            }
+        }
+        if (c < 0x80) {
+            out += (char)c;
+        } else if (c < 0x800) {
+            out += (char)(0xC0 | (c >> 6));
+            out += (char)(0x80 | (c & 0x3F));
+        } else if (c < 0x10000) {
+            out += (char)(0xE0 | (c >> 12));
+            out += (char)(0x80 | ((c >> 6) & 0x3F));
+            out += (char)(0x80 | (c & 0x3F));
+        } else {
+            out += (char)(0xF0 | (c >> 18));
+            out += (char)(0x80 | ((c >> 12) & 0x3F));
+            out += (char)(0x80 | ((c >> 6) & 0x3F));
+            out += (char)(0x80 | (c & 0x3F));
+        }
+    }
+    return out;
+}
+
+static std::wstring FromUtf8(const std::string& s) {
+    std::wstring out;
+    for (size_t i = 0; i < s.size();) {
+        unsigned char b = (unsigned char)s[i];
+        uint32_t c;
+        int extra;
+        if (b < 0x80) { c = b; extra = 0; }
+        else if ((b & 0xE0) == 0xC0) { c = b & 0x1F; extra = 1; }
+        else if ((b & 0xF0) == 0xE0) { c = b & 0x0F; extra = 2; }
+        else { c = b & 0x07; extra = 3; }
+        ++i;
+        for (int k = 0; k < extra && i < s.size(); ++k, ++i)
+            c = (c << 6) | ((unsigned char)s[i] & 0x3F);
+        if (sizeof(wchar_t) == 2 && c >= 0x10000) {
+            c -= 0x10000;
+            out += (wchar_t)(0xD800 + (c >> 10));
+            out += (wchar_t)(0xDC00 + (c & 0x3FF));
+        } else {
+            out += (wchar_t)c;
+        }
+    }
+    return out;
+}
+
+static std::string Trim(const std::string& s) {
+    size_t b = s.find_first_not_of(" \t\r\n");
+    if (b == std::string::npos) return std::string();
+    size_t e = s.find_last_not_of(" \t\r\n");
+    return s.substr(b, e - b + 1);
+}
+
+static bool ParseLong(const std::string& s, LONG& out) {
+    char* end = nullptr;
+    long v = strtol(s.c_str(), &end, 10);
+    if (end == s.c_str() || *end) return false;
+    out = (LONG)v;
+    return true;
+}
+
+static bool ParseFloat(const std::string& s, float& out) {
+    char* end = nullptr;
+    double v = strtod(s.c_str(), &end);
+    if (end == s.c_str() || *end) return false;
+    out = (float)v;
+    return true;
+}
+
+static bool ParseBool(const std::string& s, bool& out) {
+    if (s == "1" || s == "true") out = true;
+    else if (s == "0" || s == "false") out = false;
+    else return false;
+    return true;
+}
+
+template<size_t N> static int FindName(const char* const (&names)[N], const std::string& s) {
+    for (size_t i = 0; i < N; ++i)
+        if (s == names[i]) return (int)i;
+    return -1;
+}
+
+// "one_euro min_cutoff=1 beta=0.0005"
+static bool ParseFilter(const std::string& text, FilterSpec& f) {
+    f = FilterSpec{ FilterType::None, 0, 0.0f, 0.0f, 0.0f };
+    size_t sp = text.find(' ');
+    int type = FindName(kFilterNames, text.substr(0, sp));
+    if (type < 0) return false;
+    f.type = (FilterType)type;
+    while (sp != std::string::npos) {
+        size_t next = text.find(' ', sp + 1);
+        std::string param = text.substr(sp + 1, next == std::string::npos ? std::string::npos : next - sp - 1);
+        sp = next;
+        size_t eq = param.find('=');
+        if (eq == std::string::npos) continue;
+        std::string key = param.substr(0, eq), value = param.substr(eq + 1);
+        LONG n;
+        if (key == "window" && ParseLong(value, n)) f.window = (int)n;
+        else if (key == "alpha") ParseFloat(value, f.alpha);
+        else if (key == "min_cutoff") ParseFloat(value, f.minCutoff);
+        else if (key == "beta") ParseFloat(value, f.beta);
+    }
+    return true;
+}
+
+// "0:0 0.5:0.2 1:1"
+static bool ParsePoints(const std::string& text, std::vector<CurvePoint>& points) {
+    points.clear();
+    const char* p = text.c_str();
+    while (*p) {
+        char* end;
+        float x = strtof(p, &end);
+        if (end == p || *end != ':') return false;
+        p = end + 1;
+        float y = strtof(p, &end);
+        if (end == p) return false;
+        points.push_back({ x, y });
+        p = end;
+        while (*p == ' ') ++p;
+    }
+    return true;
+}
+
+static ProfileBinding DefaultBinding() {
+    ProfileBinding b;
+    b.axisOfs = DIJOFS_Z;
+    b.povAngle = 0;
+    b.action = BindingAction::Volume;
+    b.step = 0.05f;
+    b.target = TargetSpec{ L"", L"", false, true };
+    b.axisMin = 0;
+    b.axisMax = 65535;
+    b.volMin = 0.0f;
+    b.volMax = 1.0f;
+    b.curve = CurveSpec{ CurveType::Linear };
+    b.autoCalibrate = true;
+    return b;
+}
+
+bool LoadProfile(const std::string& path, Profile& out, std::string* error) {
+    FILE* f = fopen(path.c_str(), "rb");
+    if (!f) {
+        if (error) *error = "cannot open " + path;
+        return false;
+    }
+    Profile profile;
+    enum { None, InBinding, InRule, InCalibration, InRamp } section = None;
+    char buf[1024];
+    int lineNo = 0;
+    bool ok = true;
+    std::string message;
+    while (ok && fgets(buf, sizeof(buf), f)) {
+        ++lineNo;
+        std::string line = buf;
+        size_t hash = line.find('#');
+        if (hash != std::string::npos) line.erase(hash);
+        line = Trim(line);
+        if (line.empty()) continue;
+        if (line == "[binding]") {
+            profile.bindings.push_back(DefaultBinding());
+            section = InBinding;
+            continue;
+        }
+        if (line == "[rule]") {
+            profile.rules.push_back(ProfileRule{ {}, TargetSpec{ L"", L"", false, true }, std::string() });
+            section = InRule;
+            continue;
+        }
+        if (line == "[ramp]") {
+            section = InRamp;
+            continue;
+        }
+        if (line == "[calibration]") {
+            profile.calibrations.push_back(AxisCalibration{ std::string(), 0, 0, 65535 });
+            section = InCalibration;
+            continue;
+        }
+        size_t eq = line.find('=');
+        if (eq == std::string::npos || section == None) {
+            ok = false;
+            message = "expected a section or key = value";
+            break;
+        }
+        std::string key = Trim(line.substr(0, eq)), value = Trim(line.substr(eq + 1));
+        if (section == InRule) {
+            ProfileRule& r = profile.rules.back();
+            if (key == "devices") {
+                r.deviceIds.clear();
+                size_t pos = 0;
+                while ((pos = value.find_first_not_of(' ', pos)) != std::string::npos) {
+                    size_t end = value.find(' ', pos);
+                    r.deviceIds.push_back(value.substr(pos, end - pos));
+                    pos = end;
+                }
+            } else if (key == "process") r.target.processName = FromUtf8(value);
+            else if (key == "grouping") r.target.groupingId = FromUtf8(value);
+            else if (key == "system") ok = ParseBool(value, r.target.system);
+            else if (key == "all_sessions") ok = ParseBool(value, r.target.allSessions);
+            else if (key == "endpoint") r.target.endpointId = FromUtf8(value);
+            else if (key == "expr") r.expression = value;
+        } else if (section == InRamp) {
+            LONG n;
+            if (key == "write_rate") {
+                ok = ParseLong(value, n) && n > 0;
+                if (ok) profile.ramp.writeRateHz = (uint32_t)n;
+            } else if (key == "slew") {
+                ok = ParseFloat(value, profile.ramp.slewPerSec);
+            } else if (key == "budget") {
+                ok = ParseLong(value, n) && n > 0;
+                if (ok) profile.ramp.budgetPerSec = (uint32_t)n;
+            }
+        } else if (section == InCalibration) {
+            AxisCalibration& c = profile.calibrations.back();
+            if (key == "device") c.deviceId = value;
+            else if (key == "axis") ok = ParseAxis(value, c.axisOfs);
+            else if (key == "min") ok = ParseLong(value, c.min);
+            else if (key == "max") ok = ParseLong(value, c.max);
+        } else {
+            ProfileBinding& b = profile.bindings.back();
+            if (key == "device") b.deviceId = value;
+            else if (key == "device_name") b.deviceName = FromUtf8(value);
+            else if (key == "device_product") b.deviceProduct = value;
+            else if (key == "axis") ok = ParseAxis(value, b.axisOfs, &b.povAngle);
+            else if (key == "process") b.target.processName = FromUtf8(value);
+            else if (key == "grouping") b.target.groupingId = FromUtf8(value);
+            else if (key == "system") ok = ParseBool(value, b.target.system);
+            else if (key == "all_sessions") ok = ParseBool(value, b.target.allSessions);
+            else if (key == "endpoint") b.target.endpointId = FromUtf8(value);
+            else if (key == "axis_min") ok = ParseLong(value, b.axisMin);
+            else if (key == "axis_max") ok = ParseLong(value, b.axisMax);
+            else if (key == "vol_min") ok = ParseFloat(value, b.volMin);
+            else if (key == "vol_max") ok = ParseFloat(value, b.volMax);
+            else if (key == "action") {
+                int action = FindName(kActionNames, value);
+                ok = action >= 0;
+                if (ok) b.action = (BindingAction)action;
+            } else if (key == "step") ok = ParseFloat(value, b.step);
+            else if (key == "curve") {
+                int type = FindName(kCurveNames, value);
+                ok = type >= 0;
+                if (ok) b.curve.type = (CurveType)type;
+            } else if (key == "curve_dead") {
+                ok = sscanf(value.c_str(), "%f %f", &b.curve.deadLow, &b.curve.deadHigh) == 2;
+            } else if (key == "curve_points") {
+                ok = ParsePoints(value, b.curve.points);
+            } else if (key == "auto_calibrate") {
+                ok = ParseBool(value, b.autoCalibrate);
+            } else if (key == "filter") {
+                FilterSpec spec;
+                ok = ParseFilter(value, spec) && b.filters.size() < (size_t)FilterChain::kMaxFilters;
+                if (ok) b.filters.push_back(spec);
+            }
+        }
+        if (!ok) message = "bad value for " + key;
+    }
+    fclose(f);
+    if (!ok) {
+        if (error) *error = path + ":" + std::to_string(lineNo) + ": " + message;
+        return false;
+    }
+    for (const ProfileBinding& b : profile.bindings) {
+        if (b.deviceId.empty()) {
+            if (error) *error = path + ": binding without a device";
+            return false;
+        }
+    }
+    for (size_t i = 0; i < profile.rules.size(); ++i) {
+        const ProfileRule& r = profile.rules[i];
+        MappingProgram program;
+        std::string reason;
+        if (r.deviceIds.empty() || !program.Compile(r.expression, (int)r.deviceIds.size(), &reason)) {
+            if (error) *error = path + ": rule " + std::to_string(i + 1) + ": " + (r.deviceIds.empty() ? "no devices" : reason);
+            return false;
+        }
+    }
+    out = std::move(profile);
+    return true;
+}
+
+static void WriteAxis(FILE* f, DWORD axisOfs, uint16_t povAngle = 0) {
+    const char* name = AxisName(axisOfs, povAngle);
+    if (name) fprintf(f, "axis = %s\n", name);
+    else fprintf(f, "axis = %lu\n", (unsigned long)axisOfs);
+}
+
+bool SaveProfile(const std::string& path, const Profile& profile) {
+    // Write a sibling file and swap it in, so a crash mid-save never leaves half a profile.
+    std::string tmp = path + ".tmp";
+    FILE* f = fopen(tmp.c_str(), "wb");
+    if (!f) return false;
+    fprintf(f, "# JoystickAppVolumeControl profile\n");
+    for (const ProfileBinding& b : profile.bindings) {
+        fprintf(f, "\n[binding]\n");
+        fprintf(f, "device = %s\n", b.deviceId.c_str());
+        if (!b.deviceName.empty()) fprintf(f, "device_name = %s\n", ToUtf8(b.deviceName).c_str());
+        if (!b.deviceProduct.empty()) fprintf(f, "device_product = %s\n", b.deviceProduct.c_str());
+        WriteAxis(f, b.axisOfs, b.povAngle);
+        if (!b.target.processName.empty()) fprintf(f, "process = %s\n", ToUtf8(b.target.processName).c_str());
+        if (!b.target.groupingId.empty()) fprintf(f, "grouping = %s\n", ToUtf8(b.target.groupingId).c_str());
+        fprintf(f, "system = %d\nall_sessions = %d\n", b.target.system ? 1 : 0, b.target.allSessions ? 1 : 0);
+        if (!b.target.endpointId.empty()) fprintf(f, "endpoint = %s\n", ToUtf8(b.target.endpointId).c_str());
+        fprintf(f, "axis_min = %ld\naxis_max = %ld\n", (long)b.axisMin, (long)b.axisMax);
+        fprintf(f, "vol_min = %g\nvol_max = %g\n", b.volMin, b.volMax);
+        fprintf(f, "action = %s\n", kActionNames[(int)b.action]);
+        if (b.action == BindingAction::StepUp || b.action == BindingAction::StepDown) fprintf(f, "step = %g\n", b.step);
+        fprintf(f, "curve = %s\n", kCurveNames[(int)b.curve.type]);
+        if (b.curve.deadLow != 0.0f || b.curve.deadHigh != 0.0f) fprintf(f, "curve_dead = %g %g\n", b.curve.deadLow, b.curve.deadHigh);
+        if (!b.curve.points.empty()) {
+            fprintf(f, "curve_points =");
+            for (const CurvePoint& p : b.curve.points) fprintf(f, " %g:%g", p.x, p.y);
+            fprintf(f, "\n");
+        }
+        for (const FilterSpec& s : b.filters) {
+            fprintf(f, "filter = %s", kFilterNames[(int)s.type]);
+            if (s.window) fprintf(f, " window=%d", s.window);
+            if (s.alpha != 0.0f) fprintf(f, " alpha=%g", s.alpha);
+            if (s.minCutoff != 0.0f) fprintf(f, " min_cutoff=%g", s.minCutoff);
+            if (s.beta != 0.0f) fprintf(f, " beta=%g", s.beta);
+            fprintf(f, "\n");
+        }
+        fprintf(f, "auto_calibrate = %d\n", b.autoCalibrate ? 1 : 0);
+    }
+    for (const ProfileRule& r : profile.rules) {
+        fprintf(f, "\n[rule]\ndevices =");
+        for (const std::string& id : r.deviceIds) fprintf(f, " %s", id.c_str());
+        fprintf(f, "\n");
+        if (!r.target.processName.empty()) fprintf(f, "process = %s\n", ToUtf8(r.target.processName).c_str());
+        if (!r.target.groupingId.empty()) fprintf(f, "grouping = %s\n", ToUtf8(r.target.groupingId).c_str());
+        fprintf(f, "system = %d\nall_sessions = %d\n", r.target.system ? 1 : 0, r.target.allSessions ? 1 : 0);
+        if (!r.target.endpointId.empty()) fprintf(f, "endpoint = %s\n", ToUtf8(r.target.endpointId).c_str());
+        fprintf(f, "expr = %s\n", r.expression.c_str());
+    }
+    fprintf(f, "\n[ramp]\nwrite_rate = %u\nslew = %g\nbudget = %u\n",
+        profile.ramp.writeRateHz, profile.ramp.slewPerSec, profile.ramp.budgetPerSec);
+    for (const AxisCalibration& c : profile.calibrations) {
+        fprintf(f, "\n[calibration]\ndevice = %s\n", c.deviceId.c_str());
+        WriteAxis(f, c.axisOfs);
+        fprintf(f, "min = %ld\nmax = %ld\n", (long)c.min, (long)c.max);
+    }
+    bool ok = fflush(f) == 0;
+    ok = fclose(f) == 0 && ok;
+    if (!ok) {
+        remove(tmp.c_str());
+        return false;
+    }
+#ifdef _WIN32
+    return MoveFileExA(tmp.c_str(), path.c_str(), MOVEFILE_REPLACE_EXISTING) != 0;
+#else
+    return rename(tmp.c_str(), path.c_str()) == 0;
+#endif
+}
\ No newline at end of file
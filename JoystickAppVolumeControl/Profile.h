@@ -0,0 +1,62 @@
+#pragma once
+#include <string>
+#include <vector>
+#include "AxisFilter.h"
+#include "BindingEngine.h"
+#include "ResponseCurve.h"
+#include "SessionTargetSink.h"
+#include "VolumeRamp.h"
+
+// One binding as persisted: keyed by device instance GUID and target process, not by
+// list indices, so it still applies after a reboot or when devices enumerate in another order.
+struct ProfileBinding {
+    std::string deviceId;       // instance GUID, "{xxxxxxxx-xxxx-xxxx-xxxx-xxxxxxxxxxxx}"; the evdev node path on Linux
+    std::wstring deviceName;    // product name; used to find the device if the GUID no longer resolves
+    std::string deviceProduct;  // product GUID (VID/PID); finds the device when it comes back with a new instance GUID
+    DWORD axisOfs;              // DIJOYSTATE2 offset of the input (axis, POV hat or button)
+    uint16_t povAngle;          // POV inputs: the hat direction
+    BindingAction action;
+    float step;                 // StepUp/StepDown volume change per press
+    TargetSpec target;
+    LONG axisMin, axisMax;
+    float volMin, volMax;
+    CurveSpec curve;
+    std::vector<FilterSpec> filters;
+    bool autoCalibrate;         // learn the axis range from use (see AxisCalibrator)
+};
+
+// Measured travel of one axis of one device; overrides the range of bindings on that axis.
+struct AxisCalibration {
+    std::string deviceId;
+    DWORD axisOfs;
+    LONG min, max;
+};
+
+// A mapping rule as persisted; devices by instance GUID, in dN order.
+struct ProfileRule {
+    std::vector<std::string> deviceIds;
+    TargetSpec target;
+    std::string expression;     // see MappingRule.h
+};
+
+struct Profile {
+    std::vector<ProfileBinding> bindings;
+    std::vector<ProfileRule> rules;
+    std::vector<AxisCalibration> calibrations;
+    RampSettings ramp = VolumeRamp::kDefaultSettings;
+
+    const AxisCalibration* FindCalibration(const std::string& deviceId, DWORD axisOfs) const;
+    // Adds or replaces the entry for the calibration's device and axis.
+    void SetCalibration(const AxisCalibration& cal);
+};
+
+// Line-based UTF-8 text: "[binding]", "[rule]", "[calibration]" and "[ramp]" sections of
+// "key = value" lines; '#' starts a comment. Unknown keys are ignored so newer profiles
+// still load. Rule expressions are compiled on load so syntax errors are reported there.
+bool LoadProfile(const std::string& path, Profile& out, std::string* error = nullptr);
+bool SaveProfile(const std::string& path, const Profile& profile);
+
+// Input names used in profiles ("X", "VSlider1", "POV0Left", "Button12", see JoyInputs.h);
+// offsets without a name are written as numbers.
+const char* AxisName(DWORD axisOfs, uint16_t povAngle = 0);
+bool ParseAxis(const std::string& text, DWORD& axisOfs, uint16_t* povAngle = nullptr);
\ No newline at end of file
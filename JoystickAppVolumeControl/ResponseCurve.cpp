@@ -0,0 +1,94 @@
+#include "ResponseCurve.h"
+#include <algorithm>
+
+namespace {
+
+const int kTaperSize = CurveTable::kSegments;
+
+struct TaperTable {
+    float v[kTaperSize + 1];
+};
+
+// exp() for the constexpr tables: halve into the series' fast-converging range, then square back up.
+constexpr double ConstExp(double x) {
+    int halvings = 0;
+    while (x > 0.5 || x < -0.5) {
+        x /= 2;
+        ++halvings;
+    }
+    double term = 1.0, sum = 1.0;
+    for (int i = 1; i < 16; ++i) {
+        term *= x / i;
+        sum += term;
+    }
+    while (halvings-- > 0)
+        sum *= sum;
+    return sum;
+}
+
+// Audio (log) taper spanning 60 dB: y = (e^(k t) - 1) / (e^k - 1) with k = ln(1000).
+constexpr TaperTable MakeAudioTaper() {
+    TaperTable t = {};
+    const double k = 6.907755278982137;
+    const double denom = ConstExp(k) - 1.0;
+    for (int i = 0; i <= kTaperSize; ++i)
+        t.v[i] = (float)((ConstExp(k * i / kTaperSize) - 1.0) / denom);
+    return t;
+}
+
+// Smootherstep: flat at both ends, steepest in the middle.
+constexpr TaperTable MakeSCurve() {
+    TaperTable t = {};
+    for (int i = 0; i <= kTaperSize; ++i) {
+        double x = (double)i / kTaperSize;
+        t.v[i] = (float)(x * x * x * (x * (x * 6 - 15) + 10));
+    }
+    return t;
+}
+
+constexpr TaperTable kAudioTaper = MakeAudioTaper();
+constexpr TaperTable kSCurve = MakeSCurve();
+
+float SampleTaper(const TaperTable& table, float t) {
+    float pos = t * kTaperSize;
+    int i = (int)pos;
+    if (i >= kTaperSize) return table.v[kTaperSize];
+    return table.v[i] + (table.v[i + 1] - table.v[i]) * (pos - i);
+}
+
+float SamplePiecewise(const std::vector<CurvePoint>& points, float t) {
+    if (points.empty()) return t;
+    if (t <= points.front().x) return points.front().y;
+    for (size_t i = 1; i < points.size(); ++i) {
+        const CurvePoint& a = points[i - 1];
+        const CurvePoint& b = points[i];
+        if (t <= b.x) return b.x > a.x ? a.y + (b.y - a.y) * (t - a.x) / (b.x - a.x) : b.y;
+    }
+    return points.back().y;
+}
+
+template<typename T> T Clamp(T val, T min, T max) { return (val < min) ? min : (val > max ? max : val); }
+
+}
+
+float EvaluateCurve(const CurveSpec& curve, float t) {
+    float live = 1.0f - curve.deadLow - curve.deadHigh;
+    t = live > 0.0f ? Clamp((t - curve.deadLow) / live, 0.0f, 1.0f) : (t < 0.5f ? 0.0f : 1.0f);
+    switch (curve.type) {
+    case CurveType::AudioTaper: return SampleTaper(kAudioTaper, t);
+    case CurveType::SCurve: return SampleTaper(kSCurve, t);
+    case CurveType::Piecewise: return Clamp(SamplePiecewise(curve.points, t), 0.0f, 1.0f);
+    default: return t;
+    }
+}
+
+void CurveTable::Bake(LONG axisMin, LONG axisMax, float volMin, float volMax, const CurveSpec& curve) {
+    m_axisMin = axisMin;
+    m_range = axisMax != axisMin ? (int64_t)axisMax - axisMin : 1; // avoid division by zero
+    m_scale = (int64_t)(((int64_t)kSegments << 32) / m_range);
+    float lo = Clamp(volMin, 0.0f, 1.0f), hi = Clamp(volMax, 0.0f, 1.0f);
+    for (int i = 0; i <= kSegments; ++i) {
+        float shaped = EvaluateCurve(curve, (float)i / kSegments);
+        m_table[i] = Clamp(volMin + shaped * (volMax - volMin), lo, hi);
+    }
+}
\ No newline at end of file
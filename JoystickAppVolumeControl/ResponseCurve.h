@@ -0,0 +1,46 @@
+#pragma once
+#include <vector>
+#include "JoyState.h"
+
+enum class CurveType { Linear, AudioTaper, SCurve, Piecewise };
+
+struct CurvePoint {
+    float x, y;     // normalized travel -> normalized volume, both 0..1
+};
+
+// Shape of a binding's response between its axis range and volume range.
+struct CurveSpec {
+    CurveType type;
+    float deadLow, deadHigh;        // fraction of travel ignored at each end
+    std::vector<CurvePoint> points; // Piecewise only; sorted by x
+};
+
+// Normalized shape of a curve, evaluated with real math. Used when baking and as
+// the reference the tables are checked against.
+float EvaluateCurve(const CurveSpec& curve, float t);
+
+// A binding's complete axis -> volume mapping baked into a 1024-segment table.
+// Lookup is a fixed-point index plus one linear interpolation: no divisions,
+// doubles or transcendental functions per sample. The audio and S-curve tapers
+// come from constexpr tables, so baking them costs no pow/exp either.
+class CurveTable {
+public:
+    static const int kSegments = 1024;
+
+    void Bake(LONG axisMin, LONG axisMax, float volMin, float volMax, const CurveSpec& curve);
+
+    float Lookup(LONG raw) const {
+        int64_t d = (int64_t)raw - m_axisMin;
+        if (m_range > 0 ? d <= 0 : d >= 0) return m_table[0];
+        if (m_range > 0 ? d >= m_range : d <= m_range) return m_table[kSegments];
+        uint64_t pos = (uint64_t)(d * m_scale);   // segment index in 32.32 fixed point
+        uint32_t i = (uint32_t)(pos >> 32);
+        float f = (float)((pos >> 16) & 0xFFFF) * (1.0f / 65536.0f);
+        return m_table[i] + (m_table[i + 1] - m_table[i]) * f;
+    }
+private:
+    LONG m_axisMin = 0;
+    int64_t m_range = 1;
+    int64_t m_scale = 0;
+    float m_table[kSegments + 1] = {};
+};
\ No newline at end of file
@@ -0,0 +1,180 @@
+#include "SessionRegistry.h"
+#include <unordered_set>
+#include <wctype.h>
+
+SessionRegistry::SessionRegistry(NameResolver resolver) : m_resolver(std::move(resolver)) {
+}
+
+std::wstring SessionRegistry::ResolveName(uint32_t pid) {
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        auto it = m_nameCache.find(pid);
+        if (it != m_nameCache.end()) return it->second;
+    }
+    // Resolve outside the lock; this is the expensive part.
+    std::wstring name = m_resolver ? m_resolver(pid) : std::wstring();
+    if (name.empty()) name = L"Unknown";
+    std::lock_guard<std::mutex> lock(m_mutex);
+    ++m_nameLookups;
+    m_nameCache[pid] = name;
+    return name;
+}
+
+std::shared_ptr<SessionControl> SessionRegistry::OnSessionAdded(const std::wstring& sessionId, uint32_t pid,
+        const std::wstring& groupingId, std::shared_ptr<SessionControl> control, const std::wstring& endpointId, bool capture) {
+    SessionInfo info = { sessionId, groupingId, pid, ResolveName(pid), std::move(control), endpointId, capture };
+    std::shared_ptr<SessionControl> replaced;
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        replaced = EraseLocked(sessionId);
+        m_byPid.emplace(pid, sessionId);
+        m_byName.emplace(FoldName(info.processName), sessionId);
+        m_sessions.emplace(sessionId, info);
+        LogChange(true, sessionId);
+    }
+    m_listeners.Notify(info, true);
+    return replaced;
+}
+
+std::shared_ptr<SessionControl> SessionRegistry::OnSessionRemoved(const std::wstring& sessionId) {
+    SessionInfo info;
+    std::shared_ptr<SessionControl> removed;
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        if (!m_sessions.count(sessionId)) return nullptr;
+        removed = EraseLocked(sessionId, &info);
+        LogChange(false, sessionId);
+    }
+    m_listeners.Notify(info, false);
+    return removed;
+}
+
+void SessionRegistry::Clear() {
+    std::vector<SessionInfo> removed;
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        removed.reserve(m_sessions.size());
+        while (!m_sessions.empty()) {
+            std::wstring id = m_sessions.begin()->first;
+            removed.emplace_back();
+            EraseLocked(id, &removed.back());
+            LogChange(false, id);
+        }
+    }
+    for (const SessionInfo& info : removed)
+        m_listeners.Notify(info, false);
+}
+
+template<typename Map, typename Key>
+static void EraseIndexEntry(Map& index, const Key& key, const std::wstring& sessionId) {
+    auto range = index.equal_range(key);
+    for (auto p = range.first; p != range.second; ++p) {
+        if (p->second == sessionId) {
+            index.erase(p);
+            return;
+        }
+    }
+}
+
+std::shared_ptr<SessionControl> SessionRegistry::EraseLocked(const std::wstring& sessionId, SessionInfo* removed) {
+    auto it = m_sessions.find(sessionId);
+    if (it == m_sessions.end()) return nullptr;
+    uint32_t pid = it->second.pid;
+    EraseIndexEntry(m_byName, FoldName(it->second.processName), sessionId);
+    if (removed) *removed = it->second;
+    std::shared_ptr<SessionControl> control = std::move(it->second.control);
+    m_sessions.erase(it);
+    EraseIndexEntry(m_byPid, pid, sessionId);
+    // Once a process has no sessions left its PID may be reused, so forget its name.
+    if (!m_byPid.count(pid)) m_nameCache.erase(pid);
+    return control;
+}
+
+void SessionRegistry::LogChange(bool added, const std::wstring& sessionId) {
+    ++m_rev;
+    m_log.push_back({ m_rev, added, sessionId });
+    if (m_log.size() > kMaxChangeLog) m_log.pop_front();
+}
+
+bool SessionRegistry::FindBySessionId(const std::wstring& sessionId, SessionInfo& out) const {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    auto it = m_sessions.find(sessionId);
+    if (it == m_sessions.end()) return false;
+    out = it->second;
+    return true;
+}
+
+bool SessionRegistry::FindByPid(uint32_t pid, SessionInfo& out) const {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    auto it = m_byPid.find(pid);
+    if (it == m_byPid.end()) return false;
+    out = m_sessions.at(it->second);
+    return true;
+}
+
+void SessionRegistry::FindByName(const std::wstring& processName, const std::wstring& groupingId,
+        std::vector<SessionInfo>& out) const {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    out.clear();
+    auto range = m_byName.equal_range(FoldName(processName));
+    for (auto it = range.first; it != range.second; ++it) {
+        const SessionInfo& info = m_sessions.at(it->second);
+        if (groupingId.empty() || info.groupingId == groupingId)
+            out.push_back(info);
+    }
+}
+
+void SessionRegistry::Snapshot(std::vector<SessionInfo>& out, bool withControls) const {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    out.clear();
+    out.reserve(m_sessions.size());
+    for (const auto& kv : m_sessions) {
+        out.push_back(kv.second);
+        if (!withControls) out.back().control.reset();
+    }
+}
+
+size_t SessionRegistry::Size() const {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_sessions.size();
+}
+
+uint64_t SessionRegistry::Revision() const {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_rev;
+}
+
+bool SessionRegistry::ChangesSince(uint64_t since, std::vector<SessionInfo>& added, std::vector<std::wstring>& removed,
+        uint64_t& current) const {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    added.clear();
+    removed.clear();
+    current = m_rev;
+    if (since >= m_rev) return true;
+    if (m_log.empty() || m_log.front().rev > since + 1) return false;
+    // Only the final state of each touched session matters.
+    std::unordered_set<std::wstring> touched;
+    for (auto it = m_log.rbegin(); it != m_log.rend() && it->rev > since; ++it)
+        touched.insert(it->sessionId);
+    for (const std::wstring& id : touched) {
+        auto s = m_sessions.find(id);
+        if (s != m_sessions.end()) added.push_back(s->second);
+        else removed.push_back(id);
+    }
+    return true;
+}
+
+int SessionRegistry::AddListener(Listener listener) {
+    return m_listeners.Add(std::move(listener));
+}
+
+void SessionRegistry::RemoveListener(int id) {
+    m_listeners.Remove(id);
+}
+
+std::wstring SessionRegistry::FoldName(const std::wstring& name) {
+    std::wstring folded(name);
+    for (wchar_t& c : folded)
+        c = (wchar_t)towlower(c);
+    return folded;
+}
\ No newline at end of file
@@ -0,0 +1,99 @@
+#pragma once
+#include <stdint.h>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+#include "ListenerList.h"
+
+// Volume control for one audio session. Wraps ISimpleAudioVolume on Windows.
+class SessionControl {
+public:
+    virtual ~SessionControl() = default;
+    virtual bool SetVolume(float v) = 0;
+};
+
+struct SessionInfo {
+    std::wstring sessionId;     // session instance identifier; unique per session
+    std::wstring groupingId;    // grouping GUID shared by sessions of one app ("" if none)
+    uint32_t pid;
+    std::wstring processName;
+    std::shared_ptr<SessionControl> control;
+    std::wstring endpointId;    // audio endpoint the session plays on or records from (see EndpointManager)
+    bool capture;               // the endpoint is an input
+};
+
+// Persistent table of live audio sessions, kept current by session created/expired
+// notifications instead of re-walking the session enumerator. Process names are
+// cached per PID so each process costs one name lookup for as long as it has sessions.
+// All methods are thread-safe; notifications may arrive on any thread.
+class SessionRegistry {
+public:
+    // Looks up a process name on a cache miss (OpenProcess + GetModuleBaseNameW on Windows).
+    typedef std::function<std::wstring(uint32_t pid)> NameResolver;
+    // Called after a session was added (added=true) or removed, outside the registry lock.
+    typedef std::function<void(const SessionInfo& info, bool added)> Listener;
+
+    explicit SessionRegistry(NameResolver resolver);
+
+    // Notification entry points. Adding an existing sessionId replaces it. Both return the
+    // control that was dropped (if any) so a caller inside a notification callback can defer
+    // its release; WASAPI objects must not be finally released during a callback.
+    std::shared_ptr<SessionControl> OnSessionAdded(const std::wstring& sessionId, uint32_t pid,
+        const std::wstring& groupingId, std::shared_ptr<SessionControl> control,
+        const std::wstring& endpointId = std::wstring(), bool capture = false);
+    std::shared_ptr<SessionControl> OnSessionRemoved(const std::wstring& sessionId);
+    // Removes every session, notifying each removal.
+    void Clear();
+
+    bool FindBySessionId(const std::wstring& sessionId, SessionInfo& out) const;
+    // First live session of the process.
+    bool FindByPid(uint32_t pid, SessionInfo& out) const;
+    // All live sessions of a process name (case-insensitive), optionally restricted to one grouping id.
+    void FindByName(const std::wstring& processName, const std::wstring& groupingId, std::vector<SessionInfo>& out) const;
+    // withControls = false leaves control empty, for threads that must not hold (and so
+    // possibly be the last to release) a session's audio object, e.g. list enumeration.
+    void Snapshot(std::vector<SessionInfo>& out, bool withControls = true) const;
+    size_t Size() const;
+
+    // Incremented on every add/remove.
+    uint64_t Revision() const;
+    // Fills what changed after revision `since` (sessions added and ids removed) and returns
+    // the current revision. Returns false if `since` is too old for the change log, in which
+    // case the caller should resync from Snapshot().
+    bool ChangesSince(uint64_t since, std::vector<SessionInfo>& added, std::vector<std::wstring>& removed,
+        uint64_t& current) const;
+
+    // Listeners may add or remove listeners. RemoveListener waits for calls of the listener
+    // under way on other threads, so it must not be called with a lock the listener takes.
+    int AddListener(Listener listener);
+    void RemoveListener(int id);
+
+    uint64_t NameLookups() const { return m_nameLookups; }
+    static std::wstring FoldName(const std::wstring& name);
+private:
+    struct Change {
+        uint64_t rev;
+        bool added;
+        std::wstring sessionId;
+    };
+    static const size_t kMaxChangeLog = 4096;
+
+    std::wstring ResolveName(uint32_t pid);
+    void LogChange(bool added, const std::wstring& sessionId);
+    std::shared_ptr<SessionControl> EraseLocked(const std::wstring& sessionId, SessionInfo* removed = nullptr);
+
+    NameResolver m_resolver;
+    mutable std::mutex m_mutex;
+    std::unordered_map<std::wstring, SessionInfo> m_sessions;
+    std::unordered_multimap<uint32_t, std::wstring> m_byPid;
+    std::unordered_multimap<std::wstring, std::wstring> m_byName;  // folded process name -> session id
+    std::unordered_map<uint32_t, std::wstring> m_nameCache;
+    std::deque<Change> m_log;
+    uint64_t m_rev = 0;
+    uint64_t m_nameLookups = 0;
+    ListenerList<const SessionInfo&, bool> m_listeners;
+};
\ No newline at end of file
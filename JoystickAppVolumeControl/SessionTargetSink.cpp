@@ -0,0 +1,197 @@
+#include "SessionTargetSink.h"
+#include <algorithm>
+#include "LatencyStats.h"
+#include "log.h"
+
+// Case-folded glob match supporting * and ?.
+static bool WildcardMatch(const wchar_t* pat, const wchar_t* str) {
+    const wchar_t* star = nullptr;
+    const wchar_t* resume = nullptr;
+    while (*str) {
+        if (*pat == L'?' || *pat == *str) {
+            ++pat;
+            ++str;
+        } else if (*pat == L'*') {
+            star = pat++;
+            resume = str;
+        } else if (star) {
+            pat = star + 1;
+            str = ++resume;
+        } else {
+            return false;
+        }
+    }
+    while (*pat == L'*') ++pat;
+    return *pat == 0;
+}
+
+bool SessionTargetSink::MatchesSpec(const TargetSpec& spec, const SessionInfo& info) {
+    if (spec.system) return false;
+    if (spec.endpointId.empty() ? info.capture : spec.endpointId != info.endpointId) return false;
+    if (!spec.groupingId.empty() && spec.groupingId != info.groupingId) return false;
+    if (spec.processName.empty()) return !spec.groupingId.empty();
+    return WildcardMatch(SessionRegistry::FoldName(spec.processName).c_str(), SessionRegistry::FoldName(info.processName).c_str());
+}
+
+void SessionTargetSink::CollectMatches(const TargetSpec& spec, std::vector<SessionInfo>& out) const {
+    // Plain names go through the registry's name index; patterns and group-only specs need a scan.
+    bool scan = spec.processName.empty() || spec.processName.find_first_of(L"*?") != std::wstring::npos;
+    if (scan) m_registry.Snapshot(out);
+    else m_registry.FindByName(spec.processName, spec.groupingId, out);
+    out.erase(std::remove_if(out.begin(), out.end(), [&](const SessionInfo& s) { return !MatchesSpec(spec, s); }), out.end());
+}
+
+SessionTargetSink::SessionTargetSink(SessionRegistry& registry, EndpointManager* endpoints)
+    : m_registry(registry), m_endpoints(endpoints) {
+    m_listenerId = m_registry.AddListener([this](const SessionInfo& info, bool added) { OnSessionEvent(info, added); });
+    if (m_endpoints)
+        m_endpointListenerId = m_endpoints->AddListener([this](const EndpointEvent& event) { OnEndpointEvent(event); });
+}
+
+SessionTargetSink::~SessionTargetSink() {
+    m_registry.RemoveListener(m_listenerId);
+    if (m_endpoints) m_endpoints->RemoveListener(m_endpointListenerId);
+}
+
+static bool SameSpec(const TargetSpec& a, const TargetSpec& b) {
+    return a.processName == b.processName && a.groupingId == b.groupingId && a.system == b.system &&
+        a.allSessions == b.allSessions && a.endpointId == b.endpointId;
+}
+
+int SessionTargetSink::AddTarget(const TargetSpec& spec) {
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        for (size_t i = 0; i < m_targets.size(); ++i)
+            if (SameSpec(m_targets[i].spec, spec)) return (int)i;
+        if ((int)m_targets.size() >= m_targetLimit) {
+            LOG_ERROR("Audio target limit of %d reached, target ignored", m_targetLimit);
+            return -1;
+        }
+    }
+    Target t;
+    t.spec = spec;
+    t.haveVolume = false;
+    t.lastVolume = 0.0f;
+    t.deadSince = Clock::now();
+    t.health = { false, 0, 0.0, 0.0, 0 };
+    auto group = std::make_shared<Group>();
+    if (spec.system) {
+        // Members of a system group are keyed by endpoint id, so its removal can be recognised.
+        std::wstring id = spec.endpointId;
+        if (m_endpoints && id.empty()) id = m_endpoints->DefaultEndpoint(EndpointFlow::Render);
+        std::shared_ptr<SessionControl> master = m_endpoints ? m_endpoints->MasterControl(id) : nullptr;
+        if (master) group->push_back({ id, master });
+    } else {
+        std::vector<SessionInfo> sessions;
+        CollectMatches(spec, sessions);
+        for (const SessionInfo& s : sessions)
+            group->push_back({ s.sessionId, s.control });
+        if (!spec.allSessions && group->size() > 1) group->erase(group->begin(), group->end() - 1);
+    }
+    t.health.attached = !group->empty();
+    t.health.sessionCount = (uint32_t)group->size();
+    t.group = group;
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_targets.push_back(t);
+    return (int)m_targets.size() - 1;
+}
+
+void SessionTargetSink::Clear() {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_targets.clear();
+}
+
+void SessionTargetSink::SetVolume(int target, float v) {
+    std::shared_ptr<const Group> group;
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        if (target < 0 || target >= (int)m_targets.size()) return;
+        Target& t = m_targets[target];
+        t.haveVolume = true;
+        t.lastVolume = v;
+        group = t.group;
+        m_sessionWrites += group->size();
+    }
+    if (group->empty()) STAT_COUNT(StatCounter::WritesDropped);
+    STAT_ADD(StatCounter::SessionWrites, group->size());
+    // The writes are cross-process calls; issue them back to back outside the lock.
+    for (const Member& m : *group)
+        m.control->SetVolume(v);
+}
+
+TargetHealth SessionTargetSink::Health(int target) const {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    if (target < 0 || target >= (int)m_targets.size()) return TargetHealth{ false, 0, 0.0, 0.0, 0 };
+    return m_targets[target].health;
+}
+
+void SessionTargetSink::SetGroup(Target& t, std::shared_ptr<const Group> group) {
+    bool attached = !group->empty();
+    if (attached && !t.health.attached) {
+        double deadMs = std::chrono::duration<double, std::milli>(Clock::now() - t.deadSince).count();
+        ++t.health.reattachCount;
+        t.health.lastDeadMs = deadMs;
+        if (deadMs > t.health.maxDeadMs) t.health.maxDeadMs = deadMs;
+    } else if (!attached && t.health.attached) {
+        t.deadSince = Clock::now();
+    }
+    t.health.attached = attached;
+    t.health.sessionCount = (uint32_t)group->size();
+    t.group = std::move(group);
+}
+
+void SessionTargetSink::OnSessionEvent(const SessionInfo& info, bool added) {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    for (Target& t : m_targets) {
+        if (!MatchesSpec(t.spec, info)) continue;
+        const Group& cur = *t.group;
+        auto group = std::make_shared<Group>();
+        if (added) {
+            // In single-session mode the newest session wins: a restarted app replaces the one that went away.
+            if (t.spec.allSessions)
+                for (const Member& m : cur)
+                    if (m.sessionId != info.sessionId) group->push_back(m);
+            group->push_back({ info.sessionId, info.control });
+            if (t.haveVolume && info.control) info.control->SetVolume(t.lastVolume);
+        } else {
+            bool member = std::any_of(cur.begin(), cur.end(), [&](const Member& m) { return m.sessionId == info.sessionId; });
+            if (!member) continue;
+            for (const Member& m : cur)
+                if (m.sessionId != info.sessionId) group->push_back(m);
+            if (group->empty() && !t.spec.allSessions) {
+                // Fall back to another live session of the same app, if any.
+                std::vector<SessionInfo> others;
+                CollectMatches(t.spec, others);
+                for (const SessionInfo& s : others)
+                    if (s.sessionId != info.sessionId) {
+                        group->push_back({ s.sessionId, s.control });
+                        if (t.haveVolume && s.control) s.control->SetVolume(t.lastVolume);
+                        break;
+                    }
+            }
+        }
+        SetGroup(t, group);
+    }
+}
+void SessionTargetSink::OnEndpointEvent(const EndpointEvent& event) {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    for (Target& t : m_targets) {
+        if (!t.spec.system) continue;
+        bool follows;
+        if (event.change == EndpointChange::Removed) {
+            // Also detaches a default follower whose endpoint went away before the new default arrives.
+            follows = !t.group->empty() && t.group->front().sessionId == event.info.id;
+        } else if (t.spec.endpointId.empty()) {
+            follows = event.change == EndpointChange::Default && event.info.flow == EndpointFlow::Render;
+        } else {
+            follows = event.change == EndpointChange::Added && t.spec.endpointId == event.info.id;
+        }
+        if (!follows) continue;
+        auto group = std::make_shared<Group>();
+        if (event.master) {
+            group->push_back({ event.info.id, event.master });
+            if (t.haveVolume) event.master->SetVolume(t.lastVolume);
+        }
+        SetGroup(t, group);
+    }
+}
@@ -0,0 +1,85 @@
+#pragma once
+#include <limits.h>
+#include <chrono>
+#include "AudioSink.h"
+#include "EndpointManager.h"
+#include "SessionRegistry.h"
+
+// What a binding controls: an application by executable name or session group, not a PID.
+struct TargetSpec {
+    std::wstring processName;   // e.g. L"firefox.exe", case-insensitive; may use * and ? wildcards; "" matches any
+    std::wstring groupingId;    // optional session grouping GUID; "" matches any session
+    bool system;                // the endpoint master volume instead of an application
+    bool allSessions;           // drive every matching session (multi-process apps) instead of the newest one
+    std::wstring endpointId;    // system: that endpoint's volume, "" follows the default output;
+                                // applications: only sessions on that endpoint, "" any output
+};
+
+struct TargetHealth {
+    bool attached;
+    uint32_t reattachCount;
+    double lastDeadMs;          // how long the target was detached before its last reattach
+    double maxDeadMs;
+    uint32_t sessionCount;      // sessions currently driven by the target
+};
+
+// AudioSink whose targets follow their application. Each target listens to session
+// created/expired notifications from the registry and re-resolves itself when the
+// process restarts or opens new sessions, re-applying the last volume on attach.
+// A target may cover a whole group of sessions; one SetVolume fans out to all of them
+// from an immutable list, without re-enumerating or allocating per write.
+// System targets hold the cached endpoint volume from the EndpointManager. A default-device
+// switch costs each target that follows the default one pointer swap and one write of
+// its last volume; the others are not touched.
+class SessionTargetSink : public AudioSink {
+public:
+    typedef std::chrono::steady_clock Clock;
+
+    // endpoints may be nullptr, leaving system targets detached.
+    SessionTargetSink(SessionRegistry& registry, EndpointManager* endpoints);
+    ~SessionTargetSink();
+    SessionTargetSink(const SessionTargetSink&) = delete;
+    SessionTargetSink& operator=(const SessionTargetSink&) = delete;
+
+    // Configuration; only valid while nothing is writing to the sink. A spec that was
+    // added before returns the same id, so every binding of one app shares its target.
+    // Returns -1, and logs an error, once the target limit is reached.
+    int AddTarget(const TargetSpec& spec);
+    void Clear();
+    // Most targets the sink will hand out; the next stage may have a fixed slot per target
+    // (see AudioExecutor::kMaxTargets).
+    void SetTargetLimit(int limit) { m_targetLimit = limit; }
+
+    void SetVolume(int target, float v) override;
+    TargetHealth Health(int target) const;
+    uint64_t SessionWrites() const { return m_sessionWrites; }
+
+    static bool MatchesSpec(const TargetSpec& spec, const SessionInfo& info);
+private:
+    struct Member {
+        std::wstring sessionId;
+        std::shared_ptr<SessionControl> control;
+    };
+    typedef std::vector<Member> Group;
+    struct Target {
+        TargetSpec spec;
+        std::shared_ptr<const Group> group;       // replaced, never modified, when membership changes
+        bool haveVolume;
+        float lastVolume;
+        Clock::time_point deadSince;
+        TargetHealth health;
+    };
+    void CollectMatches(const TargetSpec& spec, std::vector<SessionInfo>& out) const;
+    void SetGroup(Target& t, std::shared_ptr<const Group> group);
+    void OnSessionEvent(const SessionInfo& info, bool added);
+    void OnEndpointEvent(const EndpointEvent& event);
+
+    SessionRegistry& m_registry;
+    EndpointManager* m_endpoints;
+    int m_listenerId;
+    int m_endpointListenerId = 0;
+    mutable std::mutex m_mutex;
+    std::vector<Target> m_targets;
+    int m_targetLimit = INT_MAX;
+    uint64_t m_sessionWrites = 0;
+};
\ No newline at end of file
@@ -0,0 +1,34 @@
+#pragma once
+#include <atomic>
+#include <stdint.h>
+
+// Single-producer/single-consumer "latest value" slot (a triple buffer).
+// Publish() never waits for the reader and Read() never waits for the writer;
+// the reader always sees the most recently completed publication, and
+// intermediate values it was too slow to pick up are simply overwritten.
+template<typename T>
+class SnapshotSlot {
+public:
+    SnapshotSlot() : m_buffers(), m_middle(1) {}
+
+    // Producer side.
+    void Publish(const T& value) {
+        m_buffers[m_back] = value;
+        m_back = m_middle.exchange(m_back | kFresh, std::memory_order_acq_rel) & kIndexMask;
+    }
+
+    // Consumer side. Returns false (and leaves out untouched) if nothing new was published.
+    bool Read(T& out) {
+        if (!(m_middle.load(std::memory_order_relaxed) & kFresh)) return false;
+        m_front = m_middle.exchange(m_front, std::memory_order_acq_rel) & kIndexMask;
+        out = m_buffers[m_front];
+        return true;
+    }
+private:
+    static const uint32_t kFresh = 4;
+    static const uint32_t kIndexMask = 3;
+    T m_buffers[3];
+    std::atomic<uint32_t> m_middle;
+    uint32_t m_back = 0;   // owned by the producer
+    uint32_t m_front = 2;  // owned by the consumer
+};
\ No newline at end of file
@@ -0,0 +1,47 @@
+#pragma once
+#include <stdint.h>
+#include <atomic>
+
+// Bounded lock-free ring for exactly one producer thread and one consumer thread.
+// Push and Pop never block or allocate. Each side owns its index and keeps a cached
+// copy of the other one, re-reading the shared index only when the ring looks full
+// (producer) or empty (consumer), so in steady state the two threads do not touch
+// each other's cache lines.
+template<typename T, uint32_t Capacity>
+class SpscQueue {
+    static_assert(Capacity && (Capacity & (Capacity - 1)) == 0, "capacity must be a power of two");
+public:
+    // Producer side. Returns false if the ring is full.
+    bool Push(const T& value) {
+        uint32_t head = m_head.load(std::memory_order_relaxed);
+        if (head - m_cachedTail == Capacity) {
+            m_cachedTail = m_tail.load(std::memory_order_acquire);
+            if (head - m_cachedTail == Capacity) return false;
+        }
+        m_slots[head & (Capacity - 1)] = value;
+        m_head.store(head + 1, std::memory_order_release);
+        return true;
+    }
+
+    // Consumer side. Returns false if the ring is empty.
+    bool Pop(T& out) {
+        uint32_t tail = m_tail.load(std::memory_order_relaxed);
+        if (tail == m_cachedHead) {
+            m_cachedHead = m_head.load(std::memory_order_acquire);
+            if (tail == m_cachedHead) return false;
+        }
+        out = m_slots[tail & (Capacity - 1)];
+        m_tail.store(tail + 1, std::memory_order_release);
+        return true;
+    }
+
+    // Exact on the consumer thread; a snapshot anywhere else.
+    bool Empty() const { return m_head.load(std::memory_order_acquire) == m_tail.load(std::memory_order_acquire); }
+    static uint32_t MaxSize() { return Capacity; }
+private:
+    alignas(64) std::atomic<uint32_t> m_head{0};    // written by the producer
+    uint32_t m_cachedTail = 0;                      // producer's view of m_tail
+    alignas(64) std::atomic<uint32_t> m_tail{0};    // written by the consumer
+    uint32_t m_cachedHead = 0;                      // consumer's view of m_head
+    alignas(64) T m_slots[Capacity];
+};
@@ -0,0 +1,94 @@
+#include "TraceReplay.h"
+#include <atomic>
+
+static std::atomic<int64_t> s_traceNs{0};
+
+std::chrono::steady_clock::time_point TraceClockNow() {
+    return std::chrono::steady_clock::time_point(std::chrono::nanoseconds(s_traceNs.load(std::memory_order_relaxed)));
+}
+
+namespace {
+// Counts the writes the engine emits while forwarding them to its real sink.
+class CountingSink : public AudioSink {
+public:
+    explicit CountingSink(AudioSink* next) : m_next(next) {}
+    void SetVolume(int target, float v) override {
+        ++writes;
+        if (m_next) m_next->SetVolume(target, v);
+    }
+    uint32_t Flush(bool force = false) override { return m_next ? m_next->Flush(force) : kNoPendingWrites; }
+    uint64_t writes = 0;
+private:
+    AudioSink* m_next;
+};
+}
+
+void TraceVerifySink::Reset(const TraceReader& trace) {
+    m_expected.clear();
+    for (const TraceRecord& rec : trace.Records())
+        if (rec.type == TraceRecordType::VolumeWrite) m_expected.push_back(&rec);
+    m_pos = 0;
+    m_matched = m_mismatched = 0;
+}
+
+void TraceVerifySink::SetVolume(int target, float v) {
+    if (m_pos < m_expected.size() && m_expected[m_pos]->target == target && m_expected[m_pos]->volume == v)
+        ++m_matched;
+    else
+        ++m_mismatched;
+    ++m_pos;
+    if (m_next) m_next->SetVolume(target, v);
+}
+
+void TraceVerifySink::Finish() {
+    if (m_pos < m_expected.size()) m_mismatched += m_expected.size() - m_pos;
+    m_pos = m_expected.size();
+}
+
+ReplayStats ReplayTrace(const TraceReader& trace, BindingEngine& engine, const std::vector<FakeInputBackend*>& devices,
+    TraceVerifySink* verify) {
+    ReplayStats stats = {};
+    const std::vector<TraceRecord>& records = trace.Records();
+    int64_t firstNs = -1, lastNs = 0;
+
+    AudioSink* realSink = engine.Sink();
+    CountingSink counter(realSink);
+    engine.SetSink(&counter);
+    if (verify) verify->Reset(trace);
+    s_traceNs = 0;
+    engine.Start();
+
+    auto wallStart = std::chrono::steady_clock::now();
+    for (const TraceRecord& rec : records) {
+        if (firstNs < 0) firstNs = rec.timestampNs;
+        lastNs = rec.timestampNs;
+        if (rec.type == TraceRecordType::VolumeWrite) {
+            ++stats.recordedWrites;
+            continue;
+        }
+        if (rec.device >= (int)devices.size()) continue;
+        // Land writes the sink held back up to this point at the time the live thread's Wait() would have.
+        int64_t nowNs = s_traceNs.load(std::memory_order_relaxed);
+        for (uint32_t ms = counter.Flush(); ms != AudioSink::kNoPendingWrites; ms = counter.Flush()) {
+            nowNs += (int64_t)(ms ? ms : 1) * 1000000;
+            if (nowNs > rec.timestampNs) break;
+            s_traceNs.store(nowNs, std::memory_order_relaxed);
+        }
+        s_traceNs.store(rec.timestampNs, std::memory_order_relaxed);
+        devices[rec.device]->SetState(rec.state);
+        engine.Tick(rec.timestampNs * 1e-9);
+        ++stats.samples;
+    }
+    stats.wallSeconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - wallStart).count();
+
+    engine.Stop();
+    stats.engineWrites = counter.writes;
+    if (verify) {
+        verify->Finish();
+        stats.matchedWrites = verify->Matched();
+        stats.mismatchedWrites = verify->Mismatched();
+    }
+    engine.SetSink(realSink);
+    stats.traceSeconds = firstNs < 0 ? 0 : (lastNs - firstNs) * 1e-9;
+    return stats;
+}
\ No newline at end of file
@@ -0,0 +1,51 @@
+#pragma once
+#include <chrono>
+#include <vector>
+#include "AxisTrace.h"
+#include "BindingEngine.h"
+#include "FakeInputBackend.h"
+
+struct ReplayStats {
+    uint64_t samples;           // JoyState records pushed through the engine
+    uint64_t recordedWrites;    // VolumeWrite records in the trace
+    uint64_t engineWrites;      // writes the engine emitted during replay (before any coalescing)
+    uint64_t matchedWrites;     // replayed writes equal to the recorded one at the same position
+    uint64_t mismatchedWrites;  // replayed writes that differ from or run past the recording, plus recorded
+                                // writes the replay never produced
+    double traceSeconds;        // span of the recorded timestamps
+    double wallSeconds;         // time the replay took
+    double SamplesPerSecond() const { return wallSeconds > 0 ? samples / wallSeconds : 0; }
+    // With a TraceVerifySink: the replay reproduced the recorded writes exactly.
+    bool Verified() const { return mismatchedWrites == 0 && matchedWrites == recordedWrites; }
+};
+
+// Stands where the RecordingSink sat during capture and checks each write against
+// the recorded sequence, then forwards it.
+class TraceVerifySink : public AudioSink {
+public:
+    explicit TraceVerifySink(AudioSink* next = nullptr) : m_next(next) {}
+    void Reset(const TraceReader& trace);
+    void SetVolume(int target, float v) override;
+    // Counts the recorded writes the replay did not reach as mismatches; call once it is over.
+    void Finish();
+    uint32_t Flush(bool force = false) override { return m_next ? m_next->Flush(force) : kNoPendingWrites; }
+    uint64_t Matched() const { return m_matched; }
+    uint64_t Mismatched() const { return m_mismatched; }
+private:
+    AudioSink* m_next;
+    std::vector<const TraceRecord*> m_expected;
+    size_t m_pos = 0;
+    uint64_t m_matched = 0, m_mismatched = 0;
+};
+
+// Pushes a recorded trace through a configured BindingEngine as fast as possible.
+// The engine's devices must be FakeInputBackends, one per trace device id in the
+// order they were added. Each sample is applied and ticked at its recorded time,
+// so filters and a VolumeCoalescer clocked by TraceClockNow() behave exactly as
+// they did live regardless of replay speed. Pass the TraceVerifySink placed in the
+// engine's sink chain, if any, to have the emitted writes checked (see ReplayStats::Verified).
+ReplayStats ReplayTrace(const TraceReader& trace, BindingEngine& engine, const std::vector<FakeInputBackend*>& devices,
+    TraceVerifySink* verify = nullptr);
+
+// Trace time of the sample being replayed; pass to VolumeCoalescer::SetClock.
+std::chrono::steady_clock::time_point TraceClockNow();
\ No newline at end of file
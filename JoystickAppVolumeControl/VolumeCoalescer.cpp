@@ -0,0 +1,81 @@
+#include "VolumeCoalescer.h"
+#include "LatencyStats.h"
+#include <math.h>
+
+const CoalescerSettings VolumeCoalescer::kDefaultSettings = { 0.001f, 1, 10 };
+
+VolumeCoalescer::VolumeCoalescer(AudioSink* next, const CoalescerSettings& settings) : m_next(next), m_settings(settings) {
+}
+
+void VolumeCoalescer::Reset() {
+    m_targets.clear();
+}
+
+void VolumeCoalescer::SetVolume(int target, float v) {
+    if (target < 0) return;
+    ++m_requested;
+    STAT_COUNT(StatCounter::WritesRequested);
+    if (target >= (int)m_targets.size())
+        m_targets.resize(target + 1, TargetState{ false, false, 0, 0, Clock::time_point() });
+    TargetState& st = m_targets[target];
+
+    float step = Step();
+    long q = lroundf(v / step);
+    long maxQ = lroundf(1.0f / step);
+    long ref = st.pending ? st.pendingQ : st.lastQ;
+    if (st.written || st.pending) {
+        long delta = labs(q - ref);
+        // Hysteresis: small wobbles around the current value are ignored, but the ends of the range always land.
+        bool atEnd = (q <= 0 || q >= maxQ) && q != ref;
+        if (delta == 0 || (delta <= m_settings.deadbandSteps && !atEnd)) {
+            ++m_suppressed;
+            STAT_COUNT(StatCounter::WritesSuppressed);
+            return;
+        }
+    }
+    Clock::time_point now = m_now();
+    if (st.written && now - st.lastWrite < std::chrono::milliseconds(m_settings.minIntervalMs)) {
+        if (st.pending) { // the previously held value is superseded
+            ++m_suppressed;
+            STAT_COUNT(StatCounter::WritesSuppressed);
+        }
+        st.pending = true;
+        st.pendingQ = q;
+        return;
+    }
+    if (st.pending) { // due, but q replaces the held value
+        ++m_suppressed;
+        STAT_COUNT(StatCounter::WritesSuppressed);
+    }
+    Write(target, st, q, now);
+}
+
+uint32_t VolumeCoalescer::Flush(bool force) {
+    uint32_t nextMs = kNoPendingWrites;
+    Clock::time_point now = m_now();
+    for (size_t i = 0; i < m_targets.size(); ++i) {
+        TargetState& st = m_targets[i];
+        if (!st.pending) continue;
+        Clock::time_point due = st.lastWrite + std::chrono::milliseconds(m_settings.minIntervalMs);
+        if (force || now >= due) {
+            Write((int)i, st, st.pendingQ, now);
+        } else {
+            uint32_t ms = (uint32_t)std::chrono::duration_cast<std::chrono::milliseconds>(due - now).count() + 1;
+            if (ms < nextMs) nextMs = ms;
+        }
+    }
+    if (m_next) {
+        uint32_t downstream = m_next->Flush(force);
+        if (downstream < nextMs) nextMs = downstream;
+    }
+    return nextMs;
+}
+
+void VolumeCoalescer::Write(int target, TargetState& st, long q, Clock::time_point now) {
+    st.pending = false;
+    st.written = true;
+    st.lastQ = q;
+    st.lastWrite = now;
+    ++m_written;
+    if (m_next) m_next->SetVolume(target, (float)(q * (double)Step()));
+}
\ No newline at end of file
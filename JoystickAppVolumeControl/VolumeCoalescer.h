@@ -0,0 +1,50 @@
+#pragma once
+#include <chrono>
+#include <vector>
+#include "AudioSink.h"
+
+struct CoalescerSettings {
+    float quantStep;        // volume resolution; values are rounded to multiples of this
+    int deadbandSteps;      // a new value must move more than this many steps from the last write
+    uint32_t minIntervalMs; // minimum time between two writes to the same target
+};
+
+// AudioSink decorator that drops redundant writes before they reach the (cross-process)
+// audio sink. Values are quantized and passed through a hysteresis deadband; what is
+// left is rate-limited per target, with the latest value held back and written by
+// Flush() once the interval has passed, so the final position always lands.
+class VolumeCoalescer : public AudioSink {
+public:
+    typedef std::chrono::steady_clock Clock;
+    static const CoalescerSettings kDefaultSettings;
+
+    explicit VolumeCoalescer(AudioSink* next = nullptr, const CoalescerSettings& settings = kDefaultSettings);
+    void SetNext(AudioSink* next) { m_next = next; }
+    void SetSettings(const CoalescerSettings& settings) { m_settings = settings; }
+    // Forgets all per-target state, e.g. when the engine is rebuilt.
+    void Reset();
+
+    void SetVolume(int target, float v) override;
+    uint32_t Flush(bool force = false) override;
+
+    uint64_t Requested() const { return m_requested; }
+    uint64_t Written() const { return m_written; }
+    uint64_t Suppressed() const { return m_suppressed; }
+    // Overrides the clock for deterministic tests and replays.
+    void SetClock(Clock::time_point (*now)()) { m_now = now; }
+private:
+    struct TargetState {
+        bool written;       // a value has been sent for this target
+        bool pending;       // pendingQ is waiting for the rate limit
+        long lastQ, pendingQ;
+        Clock::time_point lastWrite;
+    };
+    float Step() const { return m_settings.quantStep > 0.0f ? m_settings.quantStep : kDefaultSettings.quantStep; }
+    void Write(int target, TargetState& st, long q, Clock::time_point now);
+
+    AudioSink* m_next;
+    CoalescerSettings m_settings;
+    std::vector<TargetState> m_targets;
+    Clock::time_point (*m_now)() = &Clock::now;
+    uint64_t m_requested = 0, m_written = 0, m_suppressed = 0;
+};
\ No newline at end of file
@@ -0,0 +1,93 @@
+#include "VolumeRamp.h"
+#include "LatencyStats.h"
+#include <math.h>
+
+const RampSettings VolumeRamp::kDefaultSettings = { 250, 4.0f, 2000 };
+
+VolumeRamp::VolumeRamp(AudioSink* next, const RampSettings& settings) : m_next(next), m_settings(settings) {
+}
+
+void VolumeRamp::Reset() {
+    m_targets.clear();
+    m_rr = 0;
+}
+
+void VolumeRamp::ResetStepStats() {
+    m_steps = 0;
+    m_maxStep = 0.0f;
+}
+
+void VolumeRamp::SetVolume(int target, float v) {
+    if (target < 0) return;
+    if (target >= (int)m_targets.size()) m_targets.resize(target + 1, TargetState{ false, false, 0.0f, 0.0f });
+    if (!m_paced) {
+        m_targets[target] = TargetState{ true, true, v, v };
+        if (m_next) m_next->SetVolume(target, v);
+        return;
+    }
+    m_targets[target].hasGoal = true;
+    m_targets[target].goal = v;
+}
+
+bool VolumeRamp::Step() {
+    bool moving = Advance(false);
+    WriteBatch();
+    return moving;
+}
+
+VolumeRamp::Clock::duration VolumeRamp::Period() const {
+    return std::chrono::nanoseconds(1000000000ll / Rate());
+}
+
+uint32_t VolumeRamp::Flush(bool force) {
+    if (force) {
+        Advance(true);
+        WriteBatch();
+    }
+    return m_next ? m_next->Flush(force) : kNoPendingWrites;
+}
+
+bool VolumeRamp::Advance(bool force) {
+    m_batch.clear();
+    if (m_batch.capacity() < m_targets.size()) m_batch.reserve(m_targets.size());
+    uint32_t rate = Rate();
+    float maxStep = m_settings.slewPerSec > 0.0f ? m_settings.slewPerSec / rate : 1.0f;
+    size_t budget = force ? m_targets.size() : (size_t)(m_settings.budgetPerSec / rate);
+    if (budget == 0) budget = 1;
+    size_t n = m_targets.size();
+    bool moving = false;
+    for (size_t k = 0; k < n; ++k) {
+        size_t i = (m_rr + k) % n;
+        TargetState& t = m_targets[i];
+        if (!t.hasGoal || (t.known && t.current == t.goal)) continue;
+        if (m_batch.size() >= budget) {
+            moving = true;
+            continue;
+        }
+        float v = t.goal;
+        // Nothing is known about the session's volume before the first write, so there is nothing to ramp from.
+        if (t.known && !force) {
+            float d = t.goal - t.current;
+            if (d > maxStep) v = t.current + maxStep;
+            else if (d < -maxStep) v = t.current - maxStep;
+            float step = fabsf(v - t.current);
+            if (step > m_maxStep.load(std::memory_order_relaxed)) m_maxStep.store(step, std::memory_order_relaxed);
+        }
+        t.known = true;
+        t.current = v;
+        if (t.current != t.goal) moving = true;
+        m_batch.push_back({ (int)i, v });
+    }
+    // Targets left out this step go first next step.
+    if (n) m_rr = (m_rr + m_batch.size()) % n;
+    return moving;
+}
+
+void VolumeRamp::WriteBatch() {
+    if (m_batch.empty() || !m_next) return;
+    STAGE_TIMER(Stage::RampWrite);
+    for (const Write& w : m_batch)
+        m_next->SetVolume(w.target, w.v);
+    STAT_ADD(StatCounter::RampSteps, m_batch.size());
+    m_steps.fetch_add(m_batch.size(), std::memory_order_relaxed);
+}
@@ -0,0 +1,71 @@
+#pragma once
+#include <atomic>
+#include <chrono>
+#include <vector>
+#include "AudioSink.h"
+
+struct RampSettings {
+    uint32_t writeRateHz;   // ramp steps per second for each moving target
+    float slewPerSec;       // largest volume change per second; 1.0 crosses the full range in a second
+    uint32_t budgetPerSec;  // ramp steps per second shared by all targets
+};
+
+// AudioSink decorator that glides each target from its current volume to the latest
+// requested one, so a fast fader sweep reaches the audio session as many small steps
+// instead of a few audible jumps. Once paced, SetVolume only moves the goal and Step(),
+// called every Period() by the AudioExecutor on a high-resolution timer, writes the steps;
+// they never exceed slewPerSec / writeRateHz. When more targets move than the shared
+// budget allows per step, they take turns and ramp a little slower instead of stepping harder.
+//
+// Not thread-safe: it belongs to the executor thread. While not paced (trace replay,
+// tests, executor stopped) writes pass straight through.
+class VolumeRamp : public AudioSink {
+public:
+    typedef std::chrono::steady_clock Clock;
+    static const RampSettings kDefaultSettings;
+
+    explicit VolumeRamp(AudioSink* next = nullptr, const RampSettings& settings = kDefaultSettings);
+
+    void SetNext(AudioSink* next) { m_next = next; }
+    void SetSettings(const RampSettings& settings) { m_settings = settings; }
+    const RampSettings& Settings() const { return m_settings; }
+    void Reset();
+    void SetPaced(bool paced) { m_paced = paced; }
+
+    void SetVolume(int target, float v) override;
+    // Advances moving targets by one step within the budget and writes them. Returns
+    // false once every target is at rest.
+    bool Step();
+    Clock::duration Period() const;
+    // force: land every target on its requested volume now (the engine is stopping).
+    uint32_t Flush(bool force = false) override;
+
+    // Steps written and the largest one, since the last ResetStepStats(); readable from any thread.
+    uint64_t Steps() const { return m_steps.load(std::memory_order_relaxed); }
+    float MaxStep() const { return m_maxStep.load(std::memory_order_relaxed); }
+    void ResetStepStats();
+private:
+    struct TargetState {
+        bool hasGoal;       // SetVolume was called for it; untouched ids below the highest are never written
+        bool known;         // current was written at least once; the first write jumps straight to the goal
+        float current, goal;
+    };
+    struct Write {
+        int target;
+        float v;
+    };
+
+    // Fills m_batch with the next step of each moving target (force: straight to their goals).
+    bool Advance(bool force);
+    void WriteBatch();
+    uint32_t Rate() const { return m_settings.writeRateHz ? m_settings.writeRateHz : kDefaultSettings.writeRateHz; }
+
+    AudioSink* m_next;
+    RampSettings m_settings;
+    bool m_paced = false;
+    std::vector<TargetState> m_targets;
+    std::vector<Write> m_batch;     // reused every step
+    size_t m_rr = 0;                // round-robin start when the budget is short
+    std::atomic<uint64_t> m_steps{0};
+    std::atomic<float> m_maxStep{0.0f};
+};
@@ -0,0 +1,75 @@
+#include "WakeEvent.h"
+#ifndef _WIN32
+#include <thread>
+#endif
+
+#ifdef _WIN32
+WakeEvent::WakeEvent() {
+    m_hEvent = CreateEvent(nullptr, FALSE, FALSE, nullptr);
+}
+
+WakeEvent::~WakeEvent() {
+    if (m_hEvent) CloseHandle(m_hEvent);
+}
+
+void WakeEvent::Set() {
+    SetEvent(m_hEvent);
+}
+
+bool WakeEvent::Wait(uint32_t timeoutMs) {
+    return WaitForSingleObject(m_hEvent, timeoutMs == kInfinite ? INFINITE : timeoutMs) == WAIT_OBJECT_0;
+}
+
+#ifndef CREATE_WAITABLE_TIMER_HIGH_RESOLUTION
+#define CREATE_WAITABLE_TIMER_HIGH_RESOLUTION 0x00000002
+#endif
+
+HighResTimer::HighResTimer() {
+    m_hTimer = CreateWaitableTimerExW(nullptr, nullptr, CREATE_WAITABLE_TIMER_HIGH_RESOLUTION, TIMER_ALL_ACCESS);
+    if (!m_hTimer) m_hTimer = CreateWaitableTimerExW(nullptr, nullptr, 0, TIMER_ALL_ACCESS);
+}
+
+HighResTimer::~HighResTimer() {
+    if (m_hTimer) CloseHandle(m_hTimer);
+}
+
+void HighResTimer::SleepUntil(Clock::time_point deadline) {
+    Clock::duration left = deadline - Clock::now();
+    if (left <= Clock::duration::zero()) return;
+    // Relative due time in 100 ns units.
+    LARGE_INTEGER due;
+    due.QuadPart = -(LONGLONG)(std::chrono::duration_cast<std::chrono::nanoseconds>(left).count() / 100);
+    if (m_hTimer && SetWaitableTimer(m_hTimer, &due, 0, nullptr, nullptr, FALSE))
+        WaitForSingleObject(m_hTimer, INFINITE);
+    else
+        Sleep((DWORD)std::chrono::duration_cast<std::chrono::milliseconds>(left).count());
+}
+#else
+WakeEvent::WakeEvent() = default;
+WakeEvent::~WakeEvent() = default;
+
+void WakeEvent::Set() {
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_signalled = true;
+    }
+    m_cv.notify_one();
+}
+
+bool WakeEvent::Wait(uint32_t timeoutMs) {
+    std::unique_lock<std::mutex> lock(m_mutex);
+    if (timeoutMs == kInfinite)
+        m_cv.wait(lock, [this] { return m_signalled; });
+    else if (!m_cv.wait_for(lock, std::chrono::milliseconds(timeoutMs), [this] { return m_signalled; }))
+        return false;
+    m_signalled = false;
+    return true;
+}
+
+HighResTimer::HighResTimer() = default;
+HighResTimer::~HighResTimer() = default;
+
+void HighResTimer::SleepUntil(Clock::time_point deadline) {
+    std::this_thread::sleep_until(deadline);
+}
+#endif
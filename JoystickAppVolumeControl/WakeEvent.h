@@ -0,0 +1,55 @@
+#pragma once
+#include <stdint.h>
+#include <chrono>
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <condition_variable>
+#include <mutex>
+#endif
+
+// Auto-reset event the input thread sleeps on. Backends signal it when new input
+// arrives and the UI signals it to stop the thread. On Windows it wraps a kernel
+// event so it can be handed directly to IDirectInputDevice8::SetEventNotification.
+class WakeEvent {
+public:
+    static const uint32_t kInfinite = 0xFFFFFFFF;
+
+    WakeEvent();
+    ~WakeEvent();
+    WakeEvent(const WakeEvent&) = delete;
+    WakeEvent& operator=(const WakeEvent&) = delete;
+
+    void Set();
+    // Returns true if the event was signalled, false on timeout.
+    bool Wait(uint32_t timeoutMs);
+#ifdef _WIN32
+    HANDLE NativeHandle() const { return m_hEvent; }
+private:
+    HANDLE m_hEvent;
+#else
+private:
+    std::mutex m_mutex;
+    std::condition_variable m_cv;
+    bool m_signalled = false;
+#endif
+};
+
+// Sleeps until a deadline with sub-millisecond precision, for threads that must run
+// on a fixed cadence. On Windows this is a high-resolution waitable timer (Windows 10
+// 1803 and later), falling back to a plain waitable timer on older systems.
+class HighResTimer {
+public:
+    typedef std::chrono::steady_clock Clock;
+
+    HighResTimer();
+    ~HighResTimer();
+    HighResTimer(const HighResTimer&) = delete;
+    HighResTimer& operator=(const HighResTimer&) = delete;
+
+    void SleepUntil(Clock::time_point deadline);
+#ifdef _WIN32
+private:
+    HANDLE m_hTimer;
+#endif
+};
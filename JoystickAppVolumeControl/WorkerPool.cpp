@@ -0,0 +1,47 @@
+#include "WorkerPool.h"
+
+WorkerPool::WorkerPool(int threads, std::function<void()> threadInit, std::function<void()> threadExit)
+    : m_threadCount(threads > 0 ? threads : 1), m_threadInit(std::move(threadInit)), m_threadExit(std::move(threadExit)) {
+}
+
+WorkerPool::~WorkerPool() {
+    Stop();
+}
+
+void WorkerPool::Submit(std::function<void()> task) {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    if (m_stopping) return;
+    if (m_threads.empty())
+        for (int i = 0; i < m_threadCount; ++i) m_threads.emplace_back(&WorkerPool::Run, this);
+    m_tasks.push_back(std::move(task));
+    m_wake.notify_one();
+}
+
+void WorkerPool::Stop() {
+    std::vector<std::thread> threads;
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_stopping = true;
+        m_tasks.clear();
+        threads.swap(m_threads);
+        m_wake.notify_all();
+    }
+    for (std::thread& t : threads) t.join();
+}
+
+void WorkerPool::Run() {
+    if (m_threadInit) m_threadInit();
+    std::unique_lock<std::mutex> lock(m_mutex);
+    for (;;) {
+        m_wake.wait(lock, [this] { return m_stopping || !m_tasks.empty(); });
+        if (m_stopping) break;
+        std::function<void()> task = std::move(m_tasks.front());
+        m_tasks.pop_front();
+        lock.unlock();
+        task();
+        task = nullptr;     // release captures outside the lock
+        lock.lock();
+    }
+    lock.unlock();
+    if (m_threadExit) m_threadExit();
+}
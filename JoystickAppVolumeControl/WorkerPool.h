@@ -0,0 +1,34 @@
+#pragma once
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// Small fixed-size pool for background work the UI must not wait on (device and
+// session enumeration). Threads start on the first Submit, so a process that never
+// uses the pool never pays for it. threadInit/threadExit run on each worker, e.g. to
+// enter and leave a COM apartment.
+class WorkerPool {
+public:
+    explicit WorkerPool(int threads, std::function<void()> threadInit = nullptr, std::function<void()> threadExit = nullptr);
+    ~WorkerPool();
+    WorkerPool(const WorkerPool&) = delete;
+    WorkerPool& operator=(const WorkerPool&) = delete;
+
+    // Queues task and returns immediately. Ignored once Stop() has been called.
+    void Submit(std::function<void()> task);
+    // Drops queued tasks, waits for running ones and joins the threads.
+    void Stop();
+private:
+    void Run();
+
+    int m_threadCount;
+    std::function<void()> m_threadInit, m_threadExit;
+    std::mutex m_mutex;
+    std::condition_variable m_wake;
+    std::deque<std::function<void()>> m_tasks;
+    std::vector<std::thread> m_threads;
+    bool m_stopping = false;
+};
@@ -1,13 +1,277 @@
 #include "log.h"
-#include <stdarg.h>
-
-void DebugLog(const char* fmt, ...) {
-    char buffer[512];
-    va_list args;
-    va_start(args, fmt);
-    vsnprintf(buffer, sizeof(buffer), fmt, args);
-    va_end(args);
-    OutputDebugStringA(buffer);
-    OutputDebugStringA("\n");
-    // FILE* f = fopen("debuglog.txt", "a"); if (f) { fprintf(f, "%s\n", buffer); fclose(f); }
+#include <stdio.h>
+#include <string.h>
+#include <algorithm>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+#include <vector>
+#ifdef _WIN32
+#include <windows.h>
+#endif
+
+#ifdef _DEBUG
+std::atomic<uint8_t> g_logLevel{ (uint8_t)LogLevel::Debug };
+#else
+std::atomic<uint8_t> g_logLevel{ (uint8_t)LogLevel::Info };
+#endif
+
+thread_local LogRing* t_logRing = nullptr;
+
+namespace {
+const uint32_t kDrainIntervalMs = 20;
+
+struct LogState {
+    std::mutex mutex;               // rings, drain thread and flush bookkeeping
+    std::condition_variable wake;
+    std::condition_variable flushed;
+    std::vector<LogRing*> rings;
+    std::thread drain;
+    bool stop = false;
+    bool stopped = false;
+    int nextThread = 0;
+    uint64_t flushRequested = 0, flushDone = 0;
+
+    std::mutex outMutex;            // output and file
+    void (*output)(const char*, size_t) = nullptr;
+    FILE* file = nullptr;
+
+    std::atomic<uint64_t> written{0};
+    std::atomic<uint64_t> dropped{0};
+    int64_t startNs = std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+};
+
+// Never destroyed, so logging from other static destructors stays safe.
+LogState& State() {
+    static LogState* state = new LogState;
+    return *state;
+}
+
+// Marks the thread's ring for collection when the thread exits.
+struct RingOwner {
+    LogRing* ring = nullptr;
+    ~RingOwner() {
+        if (ring) ring->orphaned = true;
+        t_logRing = nullptr;
+    }
+};
+thread_local RingOwner t_ringOwner;
+
+struct PendingRecord {
+    LogRecord rec;
+    int thread;
+};
+
+void DefaultOutput(const char* text, size_t len) {
+#ifdef _WIN32
+    (void)len;
+    OutputDebugStringA(text);
+#else
+    fwrite(text, 1, len, stderr);
+#endif
+}
+
+const char kLevelChars[] = { 'D', 'I', 'W', 'E', '-' };
+
+void DrainLoop() {
+    LogState& st = State();
+    std::vector<PendingRecord> batch;
+    char line[640];
+    std::unique_lock<std::mutex> lock(st.mutex);
+    for (;;) {
+        st.wake.wait_for(lock, std::chrono::milliseconds(kDrainIntervalMs),
+            [&] { return st.stop || st.flushRequested > st.flushDone; });
+        uint64_t flushTarget = st.flushRequested;
+        bool stopping = st.stop;
+
+        batch.clear();
+        uint64_t dropped = 0;
+        for (size_t i = 0; i < st.rings.size();) {
+            LogRing* ring = st.rings[i];
+            bool orphaned = ring->orphaned.load();
+            uint32_t tail;
+            uint32_t n = ring->Readable(tail);
+            for (uint32_t k = 0; k < n; ++k)
+                batch.push_back({ ring->At(tail + k), ring->threadNum });
+            ring->Release(tail + n);
+            dropped += ring->TakeDropped();
+            if (orphaned) {
+                delete ring;
+                st.rings.erase(st.rings.begin() + i);
+            } else {
+                ++i;
+            }
+        }
+        lock.unlock();
+
+        // Rings are drained one after another; restore the global order (stable keeps each thread's own order).
+        std::stable_sort(batch.begin(), batch.end(),
+            [](const PendingRecord& a, const PendingRecord& b) { return a.rec.timeNs < b.rec.timeNs; });
+        {
+            std::lock_guard<std::mutex> out(st.outMutex);
+            void (*write)(const char*, size_t) = st.output ? st.output : DefaultOutput;
+            for (const PendingRecord& p : batch) {
+                int n = snprintf(line, sizeof(line), "%10.6f %c T%d: ", (p.rec.timeNs - st.startNs) * 1e-9,
+                    kLevelChars[p.rec.level < 4 ? p.rec.level : 4], p.thread);
+                size_t len = (size_t)n + FormatLogRecord(p.rec, line + n, sizeof(line) - n - 1);
+                line[len++] = '\n';
+                line[len] = '\0';
+                write(line, len);
+                if (st.file) fwrite(line, 1, len, st.file);
+            }
+            if (dropped) {
+                int len = snprintf(line, sizeof(line), "%llu log record(s) dropped, ring full\n", (unsigned long long)dropped);
+                write(line, (size_t)len);
+                if (st.file) fwrite(line, 1, (size_t)len, st.file);
+            }
+            if (st.file && !batch.empty()) fflush(st.file);
+        }
+        st.written += batch.size();
+        st.dropped += dropped;
+
+        lock.lock();
+        st.flushDone = flushTarget;
+        st.flushed.notify_all();
+        if (stopping) break;
+    }
+}
+}
+
+LogRing* LogRegisterThread() {
+    LogState& st = State();
+    std::lock_guard<std::mutex> lock(st.mutex);
+    if (st.stopped) return nullptr;
+    LogRing* ring = new LogRing;
+    ring->threadNum = ++st.nextThread;
+    st.rings.push_back(ring);
+    if (!st.drain.joinable()) st.drain = std::thread(DrainLoop);
+    t_ringOwner.ring = ring;
+    t_logRing = ring;
+    return ring;
+}
+
+void SetLogLevel(LogLevel level) {
+    g_logLevel.store((uint8_t)level, std::memory_order_relaxed);
+}
+
+LogLevel GetLogLevel() {
+    return (LogLevel)g_logLevel.load(std::memory_order_relaxed);
+}
+
+void FlushLog() {
+    LogState& st = State();
+    std::unique_lock<std::mutex> lock(st.mutex);
+    if (!st.drain.joinable() || st.stopped) return;
+    uint64_t request = ++st.flushRequested;
+    st.wake.notify_one();
+    st.flushed.wait(lock, [&] { return st.flushDone >= request || st.stopped; });
+}
+
+bool SetLogFile(const char* path) {
+    LogState& st = State();
+    std::lock_guard<std::mutex> out(st.outMutex);
+    if (st.file) fclose(st.file);
+    st.file = path ? fopen(path, "a") : nullptr;
+    return !path || st.file;
+}
+
+void SetLogOutput(void (*write)(const char* text, size_t len)) {
+    LogState& st = State();
+    std::lock_guard<std::mutex> out(st.outMutex);
+    st.output = write;
+}
+
+void StopLogging() {
+    LogState& st = State();
+    std::thread drain;
+    {
+        std::lock_guard<std::mutex> lock(st.mutex);
+        if (st.stopped) return;
+        st.stop = st.stopped = true;
+        st.wake.notify_one();
+        drain = std::move(st.drain);
+    }
+    if (drain.joinable()) drain.join();
+    std::lock_guard<std::mutex> out(st.outMutex);
+    if (st.file) fclose(st.file);
+    st.file = nullptr;
+}
+
+LogStats GetLogStats() {
+    LogState& st = State();
+    return LogStats{ st.written.load(), st.dropped.load() };
+}
+
+namespace {
+// Writes whatever is still queued when the process exits normally.
+struct LogShutdown {
+    ~LogShutdown() { StopLogging(); }
+} s_logShutdown;
+}
+
+size_t FormatLogRecord(const LogRecord& r, char* buf, size_t size) {
+    size_t len = 0;
+    int arg = 0;
+    char spec[32];
+    auto put = [&](int n) {
+        if (n > 0) len += (size_t)n < size - len ? (size_t)n : size - len - 1;
+    };
+    for (const char* p = r.fmt; *p && len + 1 < size; ++p) {
+        if (*p != '%') {
+            buf[len++] = *p;
+            continue;
+        }
+        if (p[1] == '%') {
+            buf[len++] = '%';
+            ++p;
+            continue;
+        }
+        // %[flags][width][.precision][length]conversion; the length is replaced to match the stored type.
+        const char* start = p++;
+        size_t specLen = 0;
+        spec[specLen++] = '%';
+        while (*p && strchr("-+ #0", *p) && specLen < 12) spec[specLen++] = *p++;
+        while (*p && ((*p >= '0' && *p <= '9') || *p == '.') && specLen < 24) spec[specLen++] = *p++;
+        while (*p && strchr("hlzjtLqI64", *p)) ++p;
+        char conv = *p;
+        if (!conv) break;
+        if (arg >= r.argc) {
+            // Missing argument: copy the specifier through.
+            for (const char* q = start; q <= p && len + 1 < size; ++q) buf[len++] = *q;
+            continue;
+        }
+        char type = r.types[arg];
+        uint64_t v = r.args[arg++];
+        if (type == 'f' || strchr("fFeEgGaA", conv)) {
+            double d;
+            if (type == 'f') memcpy(&d, &v, sizeof(d));
+            else d = type == 'u' ? (double)v : (double)(int64_t)v;
+            spec[specLen++] = strchr("fFeEgGaA", conv) ? conv : 'g';
+            spec[specLen] = '\0';
+            put(snprintf(buf + len, size - len, spec, d));
+        } else if (type == 's') {
+            spec[specLen++] = 's';
+            spec[specLen] = '\0';
+            put(snprintf(buf + len, size - len, spec, v < (uint64_t)kLogStringBytes ? r.strings + v : ""));
+        } else if (type == 'p' || conv == 'p') {
+            spec[specLen++] = 'p';
+            spec[specLen] = '\0';
+            put(snprintf(buf + len, size - len, spec, (void*)(uintptr_t)v));
+        } else if (conv == 'c') {
+            spec[specLen++] = 'c';
+            spec[specLen] = '\0';
+            put(snprintf(buf + len, size - len, spec, (int)v));
+        } else {
+            bool isSigned = !strchr("uxXo", conv);
+            spec[specLen++] = 'l';
+            spec[specLen++] = 'l';
+            spec[specLen++] = strchr("diuxXo", conv) ? conv : 'd';
+            spec[specLen] = '\0';
+            if (type == 'd' && !isSigned) v &= 0xFFFFFFFFull;
+            if (isSigned) put(snprintf(buf + len, size - len, spec, (long long)(int64_t)v));
+            else put(snprintf(buf + len, size - len, spec, (unsigned long long)v));
+        }
+    }
+    buf[len] = '\0';
+    return len;
 }
\ No newline at end of file
@@ -1,11 +1,151 @@
 #pragma once
-#include <windows.h>
-#include <stdio.h>
+#include <stdint.h>
+#include <string.h>
+#include <atomic>
+#include <chrono>
+#include <type_traits>
 
-void DebugLog(const char* fmt, ...);
+// Always-on binary logger. A log call copies the format pointer, a timestamp and its
+// raw arguments into a per-thread lock-free ring; a background thread formats and
+// writes the records (OutputDebugString on Windows, stderr elsewhere, plus an optional
+// file). Formats must be string literals. Strings are copied, truncated to what fits
+// in the record. Records are dropped, and counted, when a thread's ring is full.
+enum class LogLevel : uint8_t { Debug, Info, Warn, Error, Off };
 
-#ifdef _DEBUG
-#define DEBUG_LOG(fmt, ...) DebugLog(fmt, __VA_ARGS__)
-#else
-#define DEBUG_LOG(fmt, ...) /* nothing */
-#endif
\ No newline at end of file
+extern std::atomic<uint8_t> g_logLevel;
+inline bool LogEnabled(LogLevel level) { return (uint8_t)level >= g_logLevel.load(std::memory_order_relaxed); }
+void SetLogLevel(LogLevel level);
+LogLevel GetLogLevel();
+
+// Writes every record a thread had logged before the call, then returns.
+void FlushLog();
+// Appends formatted lines to path as well (nullptr stops).
+bool SetLogFile(const char* path);
+// Replaces the default output (OutputDebugString/stderr); nullptr restores it.
+void SetLogOutput(void (*write)(const char* text, size_t len));
+// Flushes and joins the drain thread. Logging afterwards is dropped.
+void StopLogging();
+
+struct LogStats {
+    uint64_t written;
+    uint64_t dropped;
+};
+LogStats GetLogStats();
+
+const int kLogMaxArgs = 8;
+const int kLogStringBytes = 256;   // room for a few paths, GUIDs or device instance ids
+
+struct LogRecord {
+    const char* fmt;
+    int64_t timeNs;
+    uint8_t level;
+    uint8_t argc;
+    uint16_t stringBytes;
+    char types[kLogMaxArgs];    // 'i' int64, 'd' narrower signed, 'u' unsigned, 'f' double, 's' offset into strings, 'p' pointer
+    uint64_t args[kLogMaxArgs];
+    char strings[kLogStringBytes];
+};
+
+// Single-producer (the owning thread) / single-consumer (the drain thread) ring.
+class LogRing {
+public:
+    static const uint32_t kSlots = 1024;
+
+    LogRecord* Acquire() {
+        uint32_t head = m_head.load(std::memory_order_relaxed);
+        if (head - m_cachedTail == kSlots) {
+            m_cachedTail = m_tail.load(std::memory_order_acquire);
+            if (head - m_cachedTail == kSlots) {
+                m_dropped.fetch_add(1, std::memory_order_relaxed);
+                return nullptr;
+            }
+        }
+        return &m_slots[head & (kSlots - 1)];
+    }
+    void Commit() { m_head.store(m_head.load(std::memory_order_relaxed) + 1, std::memory_order_release); }
+
+    // Drain side.
+    uint32_t Readable(uint32_t& tail) const {
+        tail = m_tail.load(std::memory_order_relaxed);
+        return m_head.load(std::memory_order_acquire) - tail;
+    }
+    const LogRecord& At(uint32_t pos) const { return m_slots[pos & (kSlots - 1)]; }
+    void Release(uint32_t tail) { m_tail.store(tail, std::memory_order_release); }
+    uint64_t TakeDropped() { return m_dropped.exchange(0, std::memory_order_relaxed); }
+
+    int threadNum = 0;
+    std::atomic<bool> orphaned{false};  // owning thread exited; freed once drained
+private:
+    LogRecord m_slots[kSlots];
+    alignas(64) std::atomic<uint32_t> m_head{0};
+    uint32_t m_cachedTail = 0;
+    alignas(64) std::atomic<uint32_t> m_tail{0};
+    std::atomic<uint64_t> m_dropped{0};
+};
+
+extern thread_local LogRing* t_logRing;
+LogRing* LogRegisterThread();
+
+namespace logdetail {
+inline void Put(LogRecord& r, int i, const char* s) {
+    if (!s) s = "(null)";
+    size_t room = kLogStringBytes - r.stringBytes;
+    size_t n = strnlen(s, room ? room - 1 : 0);
+    r.types[i] = 's';
+    r.args[i] = r.stringBytes;
+    if (room) {
+        memcpy(r.strings + r.stringBytes, s, n);
+        r.strings[r.stringBytes + n] = '\0';
+        r.stringBytes += (uint16_t)(n + 1);
+    } else {
+        r.args[i] = kLogStringBytes;    // formats as ""
+    }
+}
+inline void Put(LogRecord& r, int i, char* s) { Put(r, i, (const char*)s); }
+template<typename T> inline void Put(LogRecord& r, int i, T v) {
+    static_assert(std::is_arithmetic<T>::value || std::is_enum<T>::value || std::is_pointer<T>::value, "unsupported log argument type");
+    if constexpr (std::is_pointer<T>::value) {
+        r.types[i] = 'p';
+        r.args[i] = (uint64_t)(uintptr_t)v;
+    } else if constexpr (std::is_floating_point<T>::value) {
+        double d = v;
+        r.types[i] = 'f';
+        memcpy(&r.args[i], &d, sizeof(d));
+    } else if constexpr (std::is_enum<T>::value) {
+        r.types[i] = 'i';
+        r.args[i] = (uint64_t)(int64_t)v;
+    } else if constexpr (std::is_signed<T>::value) {
+        r.types[i] = sizeof(T) < sizeof(int64_t) ? 'd' : 'i';   // so %X of a negative HRESULT stays 8 digits
+        r.args[i] = (uint64_t)(int64_t)v;
+    } else {
+        r.types[i] = 'u';
+        r.args[i] = (uint64_t)v;
+    }
+}
+}
+
+template<typename... Args> void LogWrite(LogLevel level, const char* fmt, const Args&... args) {
+    static_assert(sizeof...(Args) <= kLogMaxArgs, "too many log arguments");
+    LogRing* ring = t_logRing ? t_logRing : LogRegisterThread();
+    if (!ring) return;
+    LogRecord* r = ring->Acquire();
+    if (!r) return;
+    r->fmt = fmt;
+    r->timeNs = std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+    r->level = (uint8_t)level;
+    r->argc = (uint8_t)sizeof...(Args);
+    r->stringBytes = 0;
+    int i = 0;
+    (void)i;
+    (logdetail::Put(*r, i++, args), ...);
+    ring->Commit();
+}
+
+// Formats one record into buf (always NUL-terminated); returns the length written.
+size_t FormatLogRecord(const LogRecord& r, char* buf, size_t size);
+
+#define LOG_AT(level, fmt, ...) do { if (LogEnabled(level)) LogWrite(level, fmt, ##__VA_ARGS__); } while (0)
+#define LOG_DEBUG(fmt, ...) LOG_AT(LogLevel::Debug, fmt, ##__VA_ARGS__)
+#define LOG_INFO(fmt, ...)  LOG_AT(LogLevel::Info, fmt, ##__VA_ARGS__)
+#define LOG_WARN(fmt, ...)  LOG_AT(LogLevel::Warn, fmt, ##__VA_ARGS__)
+#define LOG_ERROR(fmt, ...) LOG_AT(LogLevel::Error, fmt, ##__VA_ARGS__)
\ No newline at end of file
@@ -1,118 +1,462 @@
 #include <windows.h>
 #include <commctrl.h>
+#include <shellapi.h>
+#include <dbt.h>
 #include <stdio.h>
+#include <map>
+#include <memory>
 #include <string>
 #include <vector>
 #include "JoystickHelper.h"
 #include "AudioSessionHelper.h"
 #include "resource.h"
 #include "log.h"
+#include "BindingEngine.h"
+#include "VolumeCoalescer.h"
+#include "SnapshotSlot.h"
+#include "SessionTargetSink.h"
+#include "AxisTrace.h"
+#include "LatencyStats.h"
+#include "Profile.h"
+#include "WorkerPool.h"
+#include "AsyncList.h"
+#include "DeviceManager.h"
+#include "AudioExecutor.h"
+#include "VolumeRamp.h"
+#include "JoyInputs.h"
 
 #pragma comment(lib, "comctl32.lib")
+#pragma comment(lib, "shell32.lib")
 
 #define APP_MENU_BIND   2001
+#define IDT_STATUS      1
+#define STATUS_REFRESH_MS 33
+#define WM_APP_LIST_READY (WM_APP + 1)  // wParam: kDeviceList or kSessionList
 
 HINSTANCE g_hInst;
 HWND g_hListBox, g_hStartBtn, g_hJoystickLabel;
 
 int g_selectedSession = -1;
 int g_selectedDeviceIdx = -1;
-int g_selectedAxisIdx = 2; // Default: Z axis
+std::string g_selectedDeviceId;   // GUID of the selected device; g_selectedDeviceIdx follows it across list refreshes
+int g_selectedAxisIdx = 2; // index into JoyInputs(); default: Z axis
 bool g_running = false;
 
-int g_axisMin = 65535, g_axisMax = 0;
+int g_axisMin = 0, g_axisMax = 65535;
+bool g_autoCalibrate = true;
 float g_volMin = 0.0f, g_volMax = 0.1f;
+CurveType g_curve = CurveType::Linear;
+int g_filterPreset = 0;
+BindingAction g_action = BindingAction::Volume;
 
-JoystickHelper joystick;
 AudioSessionHelper audioHelper;
-std::vector<DInputDeviceInfo> g_devices;
-std::vector<std::wstring> g_axes = {
-    L"X", L"Y", L"Z", L"Rx", L"Ry", L"Rz", L"Slider0", L"Slider1"
+
+// Devices and sessions are enumerated on worker threads and published as immutable snapshots.
+// The UI thread only asks for refreshes and swaps the new snapshot in when WM_APP_LIST_READY
+// arrives, so it never waits for DirectInput or the session registry.
+enum { kDeviceList, kSessionList };
+HWND g_hMainWnd = nullptr, g_hBindDlg = nullptr;
+WorkerPool g_enumPool(2, [] { CoInitializeEx(nullptr, COINIT_MULTITHREADED); }, [] { CoUninitialize(); });
+void PostListReady(WPARAM list) {
+    if (g_hMainWnd) PostMessage(g_hMainWnd, WM_APP_LIST_READY, list, 0);
+}
+AsyncList<DInputDeviceInfo> g_deviceList(g_enumPool,
+    [](std::vector<DInputDeviceInfo>& out, const EnumCancel& cancel) { return JoystickHelper::EnumerateDevices(out, cancel); },
+    [] { PostListReady(kDeviceList); });
+AsyncList<ProcSessionInfo> g_sessionList(g_enumPool,
+    [](std::vector<ProcSessionInfo>& out, const EnumCancel& cancel) { return audioHelper.EnumerateSessions(out, true) && !cancel.Cancelled(); },
+    [] { PostListReady(kSessionList); });
+AsyncList<DInputDeviceInfo>::Snapshot g_devices = g_deviceList.Current();   // as shown in the UI
+AsyncList<ProcSessionInfo>::Snapshot g_sessions = g_sessionList.Current();
+// Every input of DIJOYSTATE2, named from the descriptor table.
+std::vector<std::wstring> g_axes = [] {
+    std::vector<std::wstring> names;
+    for (const InputDesc& in : JoyInputs())
+        names.push_back(std::wstring(in.name.begin(), in.name.end()));
+    return names;
+}();
+std::vector<std::wstring> g_actions = {  // indexed by BindingAction
+    L"Set volume", L"Mute toggle", L"Volume up 5%", L"Volume down 5%"
+};
+std::vector<std::wstring> g_curves = {  // indexed by CurveType; Piecewise curves come from profiles
+    L"Linear", L"Audio taper", L"S-curve"
+};
+std::vector<std::wstring> g_filterPresets = {
+    L"None", L"Moving average (4)", L"Exponential", L"One-Euro", L"Median (5)"
 };
-std::vector<ProcSessionInfo> g_sessions;
 
-void RefreshSessionList(HWND hwnd = nullptr);
+// Smoothing stages for the preset listed at idx in g_filterPresets.
+std::vector<FilterSpec> FilterPresetSpecs(int idx) {
+    switch (idx) {
+    case 1: return { { FilterType::MovingAverage, 4 } };
+    case 2: return { { FilterType::Exponential, 0, 0.3f } };
+    case 3: return { { FilterType::OneEuro, 0, 0.0f, 1.0f, 0.0005f } };
+    case 4: return { { FilterType::Median, 5 } };
+    default: return {};
+    }
+}
+
+// Bindings are kept in their persisted form: device by instance GUID, target by application,
+// so the binding survives restarts, new PIDs and a different device enumeration order.
+std::vector<ProfileBinding> g_bindings; // Configure > Add to Binding Table; when empty, Start binds the current selection
+std::vector<ProfileBinding> g_active;   // what the running engine was built from
+
+// Loaded at startup and rewritten whenever the engine starts from the UI.
+Profile g_profile;
+std::string g_profilePath;
+bool g_headless = false;    // --headless: no window, engine built straight from the profile
+
+// One input thread serves every binding; each device is opened once however many bindings use it.
+BindingEngine g_engine;
+SessionTargetSink g_sink(audioHelper.Registry(), &audioHelper.Endpoints());
+// Glides each session towards the coalesced volume in small steps.
+VolumeRamp g_ramp(&g_sink);
+// Owns every audio COM object: the ramp and the sink run on its MTA thread, which also opens
+// endpoints and handles session and device notifications. The input thread hands it volume
+// commands through a lock-free queue.
+AudioExecutor g_audio(g_ramp, [] { CoInitializeEx(nullptr, COINIT_MULTITHREADED); }, [] { CoUninitialize(); });
+VolumeCoalescer g_coalescer(&g_audio); // drops redundant writes before they reach audiosrv
+// Owns the opened devices; the engine holds their ManagedDevice wrappers, which stay valid
+// across unplug/replug.
+DeviceManager g_deviceManager;
+
+// Configure > Record Input Trace: device reads and the writes leaving the coalescer go to a
+// trace file for offline replay (see TraceReplay.h).
+bool g_recordTrace = false;
+TraceRecorder g_trace;
+RecordingSink g_traceSink(&g_audio, &g_trace);    // records what the engine asked for, before ramping
+std::vector<std::unique_ptr<RecordingInputBackend>> g_traceInputs;
+
+// The audio executor runs for the life of the process: the endpoints and sessions are
+// opened on it at startup and released on it at exit.
+static void StartAudio() {
+    g_sink.SetTargetLimit(AudioExecutor::kMaxTargets);
+    g_audio.Start();
+    g_audio.Invoke([] { audioHelper.Open([](std::function<void()> work) { g_audio.Post(std::move(work)); }); });
+}
+
+static void StopAudio() {
+    g_audio.Invoke([] {
+        g_sink.Clear();
+        audioHelper.Close();
+    });
+    g_audio.Stop();
+}
+
+// Milliseconds since the process was created, for cold-start measurements.
+static double MsSinceProcessStart() {
+    FILETIME created, exited, kernel, user, now;
+    if (!GetProcessTimes(GetCurrentProcess(), &created, &exited, &kernel, &user)) return 0.0;
+    GetSystemTimePreciseAsFileTime(&now);
+    ULARGE_INTEGER c, n;
+    c.LowPart = created.dwLowDateTime;
+    c.HighPart = created.dwHighDateTime;
+    n.LowPart = now.dwLowDateTime;
+    n.HighPart = now.dwHighDateTime;
+    return (n.QuadPart - c.QuadPart) / 10000.0;
+}
+
+void RefreshSessionList();
 void RefreshDeviceList();
 INT_PTR CALLBACK BindDlgProc(HWND hDlg, UINT uMsg, WPARAM wParam, LPARAM lParam);
 
-bool GetSelectedAxisValue(const DIJOYSTATE& js, int axisIdx, LONG& val) {
-    switch(axisIdx) {
-    case 0: val = js.lX; break;
-    case 1: val = js.lY; break;
-    case 2: val = js.lZ; break;
-    case 3: val = js.lRx; break;
-    case 4: val = js.lRy; break;
-    case 5: val = js.lRz; break;
-    case 6: val = js.rglSlider[0]; break;
-    case 7: val = js.rglSlider[1]; break;
-    default: return false;
-    }
-    return true;
+// DIJOYSTATE2 offset of the input listed at axisIdx in g_axes.
+DWORD GetSelectedAxisOffset(int axisIdx) {
+    return JoyInputs()[axisIdx].ofs;
 }
 
-// Clamp
-template<typename T> T Clamp(T val, T min, T max) { return (val < min) ? min : (val > max ? max : val); }
+// Latest state of the primary binding. Published by the input thread after each tick and
+// rendered by the UI thread on a timer, so the input path never waits on the message queue.
+struct StatusSnapshot {
+    bool deviceOk;
+    bool valid;
+    LONG axisRaw;
+    float volume;
+};
+SnapshotSlot<StatusSnapshot> g_status;
+// What the status line shows: the first binding, its device and its target, as set up by BuildEngine.
+struct StatusSource {
+    int deviceSlot;             // engine device index
+    ManagedDevice* device;
+    int target;                 // sink target id, -1 for a profile of only rules
+};
+StatusSource g_statusSource = { 0, nullptr, -1 };
 
 DWORD WINAPI PollingThreadProc(LPVOID param) {
-    HWND hwnd = (HWND)param;
-    ProcSessionInfo& sess = g_sessions[g_selectedSession];
-    AudioSessionHelper::TargetType tgtType = sess.pid == 0xFFFFFFFF ? AudioSessionHelper::TargetType::System : AudioSessionHelper::TargetType::Process;
-    audioHelper.GetSimpleAudioVolume(sess, tgtType);
-
+    g_engine.Start();
+    bool lastOk = true;
+    bool firstWrite = true;
     while (g_running) {
-        DIJOYSTATE js = {};
-        if (joystick.GetJoyState(js)) {
-            LONG axisRaw = 0;
-            if (GetSelectedAxisValue(js, g_selectedAxisIdx, axisRaw)) {
-                // Robust user-mapping:
-                double a_min = double(g_axisMin), a_max = double(g_axisMax);
-                double v_min = double(g_volMin), v_max = double(g_volMax);
-                double input = double(axisRaw);
-                if (a_min == a_max) { a_max = a_min + 1.0; } // avoid division by zero
-
-                double t = (input - a_min) / (a_max - a_min);
-                if (t < 0.0) t = 0.0;
-                if (t > 1.0) t = 1.0;
-
-                double mapped = v_min + t * (v_max - v_min);
-                float v = Clamp((float)mapped, (float)Clamp(v_min, 0.0, 1.0), (float)Clamp(v_max, 0.0, 1.0));
-                audioHelper.SetSessionVolume(v, sess, tgtType);
-
-                wchar_t buf[256];
-                swprintf_s(buf, 256, L"Dev: %s Axis: %s|%ld\nV=%.2f [%.2f-%.2f], Axis in [%d-%d]",
-                    g_devices[g_selectedDeviceIdx].name.c_str(), g_axes[g_selectedAxisIdx].c_str(), axisRaw,
-                    v, g_volMin, g_volMax, g_axisMin, g_axisMax);
-                SetWindowText(g_hJoystickLabel, buf);
-                DEBUG_LOG("AxisValue=%ld mapped=%.3f", axisRaw, v);
-            } else {
-                SetWindowText(g_hJoystickLabel, L"Selected axis not available!");
-                DEBUG_LOG("Axis not available. DeviceIdx=%d AxisIdx=%d", g_selectedDeviceIdx, g_selectedAxisIdx);
+        int changed = g_engine.Tick();
+        if (changed && firstWrite) {
+            LOG_INFO("First volume write %.1f ms after process start (%s)", MsSinceProcessStart(), g_headless ? "headless" : "gui");
+            firstWrite = false;
+        }
+        // A profile of only rules has no primary binding to show.
+        static const BindingStatus kNoBinding = { false, 0, 0, 0.0f };
+        const BindingStatus& st = g_engine.Active().BindingCount() ? g_engine.Status(0) : kNoBinding;
+        bool ok = g_engine.DeviceOk(g_statusSource.deviceSlot);
+        if (changed || ok != lastOk) {
+            {
+                STAGE_TIMER(Stage::UiPublish);
+                g_status.Publish({ ok, st.valid, st.axisRaw, st.volume });
             }
-        } else {
-            SetWindowText(g_hJoystickLabel, L"Joystick No Data");
-            DEBUG_LOG("Joystick poll failed");
+            lastOk = ok;
+            if (ok) LOG_DEBUG("AxisValue=%ld mapped=%.3f", st.axisRaw, st.volume);
+            else LOG_WARN("Joystick poll failed");
         }
-        Sleep(40);
+        g_engine.Wait(changed > 0);
+    }
+    g_engine.Stop();
+    g_audio.Invoke([] {
+        g_ramp.Flush(true);
+        g_sink.Clear();
+    });
+    if (g_trace.IsOpen()) {
+        LOG_INFO("Trace closed after %llu record(s)", (unsigned long long)g_trace.RecordCount());
+        g_trace.Close();
     }
-    audioHelper.ReleaseSimpleAudioVolume(sess);
     return 0;
 }
 
-void RefreshSessionList(HWND hwnd) {
-    SendMessage(g_hListBox, LB_RESETCONTENT, 0, 0);
-    g_sessions.clear();
-    audioHelper.EnumerateSessions(g_sessions, true);
-    for (size_t i = 0; i < g_sessions.size(); ++i) {
-        std::wstring item = g_sessions[i].processName + L" (PID: " +
-            (g_sessions[i].pid == 0xFFFFFFFF ? L"System" : std::to_wstring(g_sessions[i].pid)) + L")";
-        SendMessage(g_hListBox, LB_ADDSTRING, 0, (LPARAM)item.c_str());
+static std::string GuidToString(const GUID& guid) {
+    wchar_t wide[64];
+    StringFromGUID2(guid, wide, 64);
+    std::string out;
+    for (const wchar_t* p = wide; *p; ++p) out += (char)*p;
+    return out;
+}
+
+static bool GuidFromString(const std::string& text, GUID& guid) {
+    std::wstring wide(text.begin(), text.end());
+    return SUCCEEDED(CLSIDFromString(wide.c_str(), &guid));
+}
+
+TargetSpec SpecForSession(const ProcSessionInfo& session) {
+    // Name bindings drive every session of the app, so multi-process browsers and launchers follow one fader.
+    // A session picked on another endpoint than the default output stays on that endpoint.
+    std::wstring endpoint = session.endpointName.empty() ? L"" : session.endpointId;
+    return TargetSpec{ session.processName, L"", session.pid == 0xFFFFFFFF, true, endpoint };
+}
+
+// The binding described by the current UI selection and Bind dialog settings.
+ProfileBinding SelectedBinding() {
+    ProfileBinding b;
+    b.deviceId = GuidToString((*g_devices)[g_selectedDeviceIdx].guid);
+    b.deviceName = (*g_devices)[g_selectedDeviceIdx].name;
+    b.deviceProduct = GuidToString((*g_devices)[g_selectedDeviceIdx].product);
+    b.axisOfs = GetSelectedAxisOffset(g_selectedAxisIdx);
+    b.povAngle = JoyInputs()[g_selectedAxisIdx].povAngle;
+    b.action = g_action;
+    b.step = 0.05f;
+    b.target = SpecForSession((*g_sessions)[g_selectedSession]);
+    b.axisMin = g_axisMin;
+    b.axisMax = g_axisMax;
+    b.volMin = g_volMin;
+    b.volMax = g_volMax;
+    b.curve = CurveSpec{ g_curve };
+    b.filters = FilterPresetSpecs(g_filterPreset);
+    b.autoCalibrate = g_autoCalibrate;
+    return b;
+}
+
+void RenderStatus(const StatusSnapshot& snap, const TargetHealth& health, const DeviceHealth& device) {
+    if (!device.present) {
+        SetWindowText(g_hJoystickLabel, L"Joystick disconnected, waiting for it to return");
+        return;
     }
+    if (!snap.deviceOk) {
+        SetWindowText(g_hJoystickLabel, L"Joystick No Data");
+        return;
+    }
+    if (!snap.valid) return;
+    const ProfileBinding& cfg = g_active[0];
+    const char* axis = AxisName(cfg.axisOfs, cfg.povAngle);
+    wchar_t buf[256];
+    wchar_t target[96];
+    if (health.attached && health.reattachCount)
+        swprintf_s(target, 96, L"%s x%u (reattached after %.0f ms)", cfg.target.processName.c_str(), health.sessionCount, health.lastDeadMs);
+    else if (health.sessionCount > 1)
+        swprintf_s(target, 96, L"%s x%u", cfg.target.processName.c_str(), health.sessionCount);
+    else
+        swprintf_s(target, 96, L"%s%s", cfg.target.processName.c_str(), health.attached ? L"" : L" (waiting for app)");
+    swprintf_s(buf, 256, L"Dev: %s Axis: %hs|%ld -> %s\nV=%.2f [%.2f-%.2f], Axis in [%ld-%ld]%s",
+        cfg.deviceName.c_str(), axis ? axis : "?", snap.axisRaw, target,
+        snap.volume, cfg.volMin, cfg.volMax, cfg.axisMin, cfg.axisMax,
+        g_active.size() > 1 ? L" (+more)" : L"");
+    SetWindowText(g_hJoystickLabel, buf);
+}
+
+// Opens a device by instance GUID without enumerating; nullptr if it is not attached.
+static std::unique_ptr<InputBackend> OpenDevice(HWND hwnd, const std::string& instanceId) {
+    std::unique_ptr<JoystickHelper> joy(new JoystickHelper());
+    GUID guid;
+    if (!GuidFromString(instanceId, guid) || !joy->Init(guid, hwnd)) return nullptr;
+    return std::unique_ptr<InputBackend>(joy.release());
+}
+
+static std::vector<DeviceIdentity> DeviceIdentities(const std::vector<DInputDeviceInfo>& devices) {
+    std::vector<DeviceIdentity> ids;
+    for (const DInputDeviceInfo& d : devices)
+        ids.push_back({ GuidToString(d.guid), GuidToString(d.product), d.path, d.name });
+    return ids;
+}
+
+// Opens each referenced device once and loads the bindings into the engine.
+bool BuildEngine(HWND hwnd, const std::vector<ProfileBinding>& bindings) {
+    g_engine.Clear();
+    g_engine.SetSink(&g_coalescer);
+    g_coalescer.Reset();
+    g_audio.Invoke([] {
+        g_sink.Clear();
+        g_ramp.Reset();
+        g_ramp.SetSettings(g_profile.ramp);
+    });
+    g_traceInputs.clear();
+    g_deviceManager.Clear();
+    // Devices that are missing now, or get unplugged later, are opened by Reconcile when they show up.
+    g_deviceManager.SetOpener([hwnd](const DeviceIdentity& found) { return OpenDevice(hwnd, found.instanceId); });
+    g_deviceManager.SetLostHandler([] { RefreshDeviceList(); });
+    g_coalescer.SetNext(&g_audio);
+    if (g_recordTrace) {
+        SYSTEMTIME t;
+        GetLocalTime(&t);
+        char path[64];
+        sprintf_s(path, sizeof(path), "trace-%04u%02u%02u-%02u%02u%02u.javt", t.wYear, t.wMonth, t.wDay, t.wHour, t.wMinute, t.wSecond);
+        if (g_trace.Open(path)) {
+            g_coalescer.SetNext(&g_traceSink);
+            LOG_INFO("Recording input trace to %s", path);
+        } else {
+            LOG_ERROR("Failed to open trace file %s", path);
+        }
+    }
+    std::map<std::string, int> deviceSlot;
+    std::map<int, ManagedDevice*> managed;     // by engine device index
+    auto slotFor = [&](const DeviceIdentity& wanted) {
+        auto found = deviceSlot.find(wanted.instanceId);
+        if (found != deviceSlot.end()) return found->second;
+        ManagedDevice* tracked = g_deviceManager.Track(wanted, OpenDevice(hwnd, wanted.instanceId), wanted);
+        InputBackend* input = tracked;
+        if (g_trace.IsOpen()) {
+            g_traceInputs.emplace_back(new RecordingInputBackend(input, &g_trace, (int)g_traceInputs.size()));
+            input = g_traceInputs.back().get();
+        }
+        int slot = g_engine.AddDevice(input);
+        managed[slot] = tracked;
+        return deviceSlot.emplace(wanted.instanceId, slot).first->second;
+    };
+    for (const ProfileBinding& cfg : bindings) {
+        int device = slotFor(DeviceIdentity{ cfg.deviceId, cfg.deviceProduct, L"", cfg.deviceName });
+        // A calibrated range for this device axis wins over the one stored with the binding,
+        // keeping the binding's direction. Auto-calibrating bindings start from it instead.
+        const AxisCalibration* cal = g_profile.FindCalibration(cfg.deviceId, cfg.axisOfs);
+        LONG axisMin = cfg.axisMin, axisMax = cfg.axisMax;
+        if (cal && !cfg.autoCalibrate) {
+            axisMin = cfg.axisMin <= cfg.axisMax ? cal->min : cal->max;
+            axisMax = cfg.axisMin <= cfg.axisMax ? cal->max : cal->min;
+        }
+        Binding b = { device, cfg.axisOfs, g_sink.AddTarget(cfg.target),
+            axisMin, axisMax, cfg.volMin, cfg.volMax, cfg.curve, cfg.filters };
+        b.autoCalibrate = cfg.autoCalibrate;
+        b.povAngle = cfg.povAngle;
+        b.action = cfg.action;
+        b.step = cfg.step;
+        int index = g_engine.AddBinding(b);
+        if (cal && cfg.autoCalibrate) g_engine.SeedCalibration(index, cal->min, cal->max);
+        if (index == 0) g_statusSource = { device, managed[device], b.target };
+    }
+    for (const ProfileRule& cfg : g_profile.rules) {
+        Rule rule = { {}, g_sink.AddTarget(cfg.target), cfg.expression };
+        for (const std::string& id : cfg.deviceIds)
+            rule.devices.push_back(slotFor(DeviceIdentity{ id, "", L"", L"" }));
+        std::string error;
+        if (g_engine.AddRule(rule, &error) < 0) LOG_ERROR("Rule '%s' skipped: %s", cfg.expression.c_str(), error.c_str());
+    }
+    if (bindings.empty()) g_statusSource = { 0, g_deviceManager.Count() ? g_deviceManager.Device(0) : nullptr, -1 };
+    g_engine.Publish();
+    g_active = bindings;
+    // Missing devices are looked for by product and name in a fresh list.
+    if (g_deviceManager.AnyParked()) RefreshDeviceList();
+    return true;
+}
+
+// Copies the ranges learned while running into the profile and saves it. Call with the
+// input thread stopped.
+static void StoreCalibrations() {
+    bool changed = false;
+    for (size_t i = 0; i < g_active.size(); ++i) {
+        LONG low, high;
+        if (!g_engine.CalibratedRange((int)i, low, high)) continue;
+        g_profile.SetCalibration(AxisCalibration{ g_active[i].deviceId, g_active[i].axisOfs, low, high });
+        changed = true;
+    }
+    if (changed && !SaveProfile(g_profilePath, g_profile))
+        LOG_WARN("Could not save calibration to %s", g_profilePath.c_str());
+}
+
+std::wstring SessionLabel(const ProcSessionInfo& s) {
+    return s.processName + L" (PID: " + (s.pid == 0xFFFFFFFF ? L"System" : std::to_wstring(s.pid)) + L")"
+        + (s.endpointName.empty() ? L"" : L" - " + s.endpointName);
+}
+
+// Position of the session in the new list that was at idx in the old one, or -1.
+static int MapSession(const AsyncList<ProcSessionInfo>::Snapshot& from, int idx, const AsyncList<ProcSessionInfo>::Snapshot& to) {
+    if (idx < 0 || idx >= (int)from->size()) return -1;
+    const ProcSessionInfo& s = (*from)[idx];
+    for (size_t i = 0; i < to->size(); ++i)
+        if ((*to)[i].pid == s.pid && (*to)[i].processName == s.processName && (*to)[i].endpointId == s.endpointId) return (int)i;
+    return -1;
+}
+
+static int FindDevice(const AsyncList<DInputDeviceInfo>::Snapshot& devices, const std::string& id) {
+    for (size_t i = 0; i < devices->size(); ++i)
+        if (GuidToString((*devices)[i].guid) == id) return (int)i;
+    return -1;
+}
+
+// Both return at once; the list is swapped in by Adopt*List() when the enumeration completes.
+void RefreshSessionList() {
+    g_sessionList.Refresh();
 }
 
 void RefreshDeviceList() {
-    g_devices.clear();
-    JoystickHelper::EnumerateDevices(g_devices);
-    DEBUG_LOG("Found %zu DirectInput devices", g_devices.size());
+    g_deviceList.Refresh();
+}
+
+// Swaps in the newest session snapshot and refills the list box, keeping both selections.
+static void AdoptSessionList() {
+    AsyncList<ProcSessionInfo>::Snapshot old = g_sessions;
+    g_sessions = g_sessionList.Current();
+    int sel = MapSession(old, (int)SendMessage(g_hListBox, LB_GETCURSEL, 0, 0), g_sessions);
+    g_selectedSession = MapSession(old, g_selectedSession, g_sessions);
+    SendMessage(g_hListBox, WM_SETREDRAW, FALSE, 0);
+    SendMessage(g_hListBox, LB_RESETCONTENT, 0, 0);
+    for (const ProcSessionInfo& s : *g_sessions)
+        SendMessage(g_hListBox, LB_ADDSTRING, 0, (LPARAM)SessionLabel(s).c_str());
+    SendMessage(g_hListBox, LB_SETCURSEL, sel, 0);
+    SendMessage(g_hListBox, WM_SETREDRAW, TRUE, 0);
+    InvalidateRect(g_hListBox, nullptr, TRUE);
+}
+
+static void AdoptDeviceList() {
+    g_devices = g_deviceList.Current();
+    g_selectedDeviceIdx = FindDevice(g_devices, g_selectedDeviceId);
+    LOG_INFO("Found %zu DirectInput devices", g_devices->size());
+    if (g_deviceManager.Count()) g_deviceManager.Reconcile(DeviceIdentities(*g_devices));
+}
+
+// Any device interface arriving or leaving triggers a fresh device list; bursts of
+// notifications collapse into one enumeration because each refresh cancels the last.
+static void WatchDeviceChanges(HWND hwnd) {
+    DEV_BROADCAST_DEVICEINTERFACE filter = { sizeof(filter), DBT_DEVTYP_DEVICEINTERFACE };
+    if (!RegisterDeviceNotification(hwnd, &filter, DEVICE_NOTIFY_WINDOW_HANDLE | DEVICE_NOTIFY_ALL_INTERFACE_CLASSES))
+        LOG_WARN("RegisterDeviceNotification failed: %lu", GetLastError());
+}
+
+static void OnDeviceChange(WPARAM event, LPARAM data) {
+    const DEV_BROADCAST_HDR* hdr = (const DEV_BROADCAST_HDR*)data;
+    if ((event == DBT_DEVICEARRIVAL || event == DBT_DEVICEREMOVECOMPLETE) && hdr && hdr->dbch_devicetype == DBT_DEVTYP_DEVICEINTERFACE)
+        RefreshDeviceList();
 }
 
 LRESULT CALLBACK WndProc(HWND hwnd, UINT msg, WPARAM wParam, LPARAM lParam) {
@@ -122,6 +466,12 @@ LRESULT CALLBACK WndProc(HWND hwnd, UINT msg, WPARAM wParam, LPARAM lParam) {
         HMENU hMenubar = CreateMenu();
         HMENU hApp = CreateMenu();
         AppendMenu(hApp, MF_STRING, APP_MENU_BIND, L"&Bind...");
+        AppendMenu(hApp, MF_STRING, APP_MENU_ADD_BINDING, L"&Add to Binding Table");
+        AppendMenu(hApp, MF_STRING, APP_MENU_CLEAR_BINDINGS, L"&Clear Binding Table");
+        AppendMenu(hApp, MF_SEPARATOR, 0, nullptr);
+        AppendMenu(hApp, MF_STRING, APP_MENU_RECORD_TRACE, L"&Record Input Trace");
+        AppendMenu(hApp, MF_STRING | (LogEnabled(LogLevel::Debug) ? MF_CHECKED : 0), APP_MENU_VERBOSE_LOG, L"&Verbose Logging");
+        AppendMenu(hApp, MF_STRING, APP_MENU_DUMP_STATS, L"&Dump Latency Stats");
         AppendMenu(hMenubar, MF_POPUP, (UINT_PTR)hApp, L"&Configure");
         SetMenu(hwnd, hMenubar);
 
@@ -139,51 +489,134 @@ LRESULT CALLBACK WndProc(HWND hwnd, UINT msg, WPARAM wParam, LPARAM lParam) {
         g_hJoystickLabel = CreateWindow(TEXT("STATIC"), TEXT("Joystick Axis Value: "),
             WS_CHILD | WS_VISIBLE, 22, 300, 440, 28, hwnd, nullptr, g_hInst, nullptr);
 
+        g_hMainWnd = hwnd;
+        WatchDeviceChanges(hwnd);
         RefreshDeviceList();
-        RefreshSessionList(hwnd);
+        RefreshSessionList();
+        if (!g_profile.bindings.empty()) {
+            // Start resumes the saved bindings; the Bind dialog starts from the first one.
+            g_bindings = g_profile.bindings;
+            const ProfileBinding& first = g_bindings[0];
+            int input = FindInput(first.axisOfs, first.povAngle);
+            if (input >= 0) g_selectedAxisIdx = input;
+            g_action = first.action;
+            g_selectedDeviceId = first.deviceId;
+            g_axisMin = first.axisMin;
+            g_axisMax = first.axisMax;
+            g_autoCalibrate = first.autoCalibrate;
+            g_volMin = first.volMin;
+            g_volMax = first.volMax;
+            if (first.curve.type != CurveType::Piecewise) g_curve = first.curve.type;
+            wchar_t buf[64];
+            swprintf_s(buf, 64, L"Profile: %zu binding(s) ready, press Start", g_bindings.size());
+            SetWindowText(g_hJoystickLabel, buf);
+        }
+        LOG_INFO("Window ready %.1f ms after process start", MsSinceProcessStart());
         break;
     }
     case WM_COMMAND:
         if (LOWORD(wParam) == 1002) {
-            RefreshSessionList(hwnd);
+            RefreshSessionList();
         } else if (LOWORD(wParam) == 1003) { // Start
-            if (g_selectedDeviceIdx < 0 || g_selectedDeviceIdx >= (int)g_devices.size()) {
-                MessageBox(hwnd, TEXT("Bind a valid joystick device first!"), TEXT("Error"), MB_OK);
-                DEBUG_LOG("Invalid joystick selected: idx=%d", g_selectedDeviceIdx);
-                break;
-            }
-            if (g_selectedAxisIdx < 0 || g_selectedAxisIdx >= (int)g_axes.size()) {
-                MessageBox(hwnd, TEXT("Bind a valid axis first!"), TEXT("Error"), MB_OK);
-                DEBUG_LOG("Invalid axis selected: idx=%d", g_selectedAxisIdx);
-                break;
+            std::vector<ProfileBinding> bindings = g_bindings;
+            if (bindings.empty()) {
+                if (g_selectedDeviceIdx < 0 || g_selectedDeviceIdx >= (int)g_devices->size()) {
+                    MessageBox(hwnd, TEXT("Bind a valid joystick device first!"), TEXT("Error"), MB_OK);
+                    LOG_WARN("Invalid joystick selected: idx=%d", g_selectedDeviceIdx);
+                    break;
+                }
+                if (g_selectedAxisIdx < 0 || g_selectedAxisIdx >= (int)g_axes.size()) {
+                    MessageBox(hwnd, TEXT("Bind a valid axis first!"), TEXT("Error"), MB_OK);
+                    LOG_WARN("Invalid axis selected: idx=%d", g_selectedAxisIdx);
+                    break;
+                }
+                int sel = (int)SendMessage(g_hListBox, LB_GETCURSEL, 0, 0);
+                if (sel < 0 || sel >= (int)g_sessions->size()) {
+                    MessageBox(hwnd, TEXT("Select a session first!"), TEXT("Info"), MB_OK);
+                    LOG_WARN("No audio session/app selected for binding");
+                    break;
+                }
+                g_selectedSession = sel;
+                bindings.push_back(SelectedBinding());
             }
-            int sel = (int)SendMessage(g_hListBox, LB_GETCURSEL, 0, 0);
-            if (sel < 0 || sel >= (int)g_sessions.size()) {
-                MessageBox(hwnd, TEXT("Select a session first!"), TEXT("Info"), MB_OK);
-                DEBUG_LOG("No audio session/app selected for binding");
+            if (!BuildEngine(hwnd, bindings))
                 break;
-            }
-            g_selectedSession = sel;
-            if (!joystick.Init(g_devices[g_selectedDeviceIdx].guid, hwnd)) {
-                MessageBox(hwnd, TEXT("Failed to initialize joystick!"), TEXT("Error"), MB_OK);
-                DEBUG_LOG("Joystick initialization failed for idx=%d", g_selectedDeviceIdx);
-                break;
-            }
+            g_profile.bindings = bindings;
+            if (!SaveProfile(g_profilePath, g_profile)) LOG_WARN("Could not save profile %s", g_profilePath.c_str());
             g_running = true;
             EnableWindow(g_hStartBtn, FALSE);
+            ResetLatencyStats();
             hThread = CreateThread(nullptr, 0, PollingThreadProc, hwnd, 0, nullptr);
-            DEBUG_LOG("Started polling thread for device=%d axis=%d session=%d", g_selectedDeviceIdx, g_selectedAxisIdx, g_selectedSession);
+            SetTimer(hwnd, IDT_STATUS, STATUS_REFRESH_MS, nullptr);
+            LOG_INFO("Started polling thread for %zu binding(s) on %zu device(s)", g_engine.BindingCount(), g_engine.DeviceCount());
         } else if (LOWORD(wParam) == 1004) {
             g_running = false;
+            g_engine.Wake();
             PostMessage(hwnd, WM_CLOSE, 0, 0);
-            DEBUG_LOG("Exit requested.");
+            LOG_INFO("Exit requested.");
         } else if (LOWORD(wParam) == APP_MENU_BIND) {
             DialogBox(g_hInst, MAKEINTRESOURCE(IDD_BIND_DIALOG), hwnd, BindDlgProc);
+        } else if (LOWORD(wParam) == APP_MENU_ADD_BINDING) {
+            int sel = (int)SendMessage(g_hListBox, LB_GETCURSEL, 0, 0);
+            if (sel >= 0) g_selectedSession = sel;
+            if (g_selectedDeviceIdx < 0 || g_selectedDeviceIdx >= (int)g_devices->size() ||
+                g_selectedSession < 0 || g_selectedSession >= (int)g_sessions->size()) {
+                MessageBox(hwnd, TEXT("Bind a device and select a session first!"), TEXT("Info"), MB_OK);
+                break;
+            }
+            g_bindings.push_back(SelectedBinding());
+            wchar_t buf[64];
+            swprintf_s(buf, 64, L"Binding table: %zu binding(s)", g_bindings.size());
+            SetWindowText(g_hJoystickLabel, buf);
+            LOG_INFO("Added binding device=%d axis=%d session=%d", g_selectedDeviceIdx, g_selectedAxisIdx, g_selectedSession);
+        } else if (LOWORD(wParam) == APP_MENU_CLEAR_BINDINGS) {
+            g_bindings.clear();
+            SetWindowText(g_hJoystickLabel, L"Binding table cleared");
+        } else if (LOWORD(wParam) == APP_MENU_RECORD_TRACE) {
+            // Takes effect on the next Start.
+            g_recordTrace = !g_recordTrace;
+            CheckMenuItem(GetMenu(hwnd), APP_MENU_RECORD_TRACE, g_recordTrace ? MF_CHECKED : MF_UNCHECKED);
+        } else if (LOWORD(wParam) == APP_MENU_VERBOSE_LOG) {
+            bool verbose = !LogEnabled(LogLevel::Debug);
+            SetLogLevel(verbose ? LogLevel::Debug : LogLevel::Info);
+            CheckMenuItem(GetMenu(hwnd), APP_MENU_VERBOSE_LOG, verbose ? MF_CHECKED : MF_UNCHECKED);
+        } else if (LOWORD(wParam) == APP_MENU_DUMP_STATS) {
+            bool ok = DumpLatencyStats("latency-stats.txt");
+            SetWindowText(g_hJoystickLabel, ok ? L"Latency stats appended to latency-stats.txt" : L"Could not write latency-stats.txt");
+        }
+        break;
+    case WM_APP_LIST_READY:
+        if (wParam == kDeviceList) AdoptDeviceList();
+        else AdoptSessionList();
+        if (g_hBindDlg) SendMessage(g_hBindDlg, WM_APP_LIST_READY, wParam, 0);
+        break;
+    case WM_DEVICECHANGE:
+        OnDeviceChange(wParam, lParam);
+        break;
+    case WM_TIMER:
+        if (wParam == IDT_STATUS) {
+            // Attachment changes arrive from session notifications, not the input thread.
+            static StatusSnapshot snap = {};
+            static TargetHealth lastHealth = {};
+            static DeviceHealth lastDevice = {};
+            TargetHealth health = g_statusSource.target >= 0 ? g_sink.Health(g_statusSource.target) : TargetHealth{};
+            DeviceHealth device = g_statusSource.device ? g_statusSource.device->Health() : DeviceHealth{ true };
+            bool healthChanged = health.attached != lastHealth.attached || health.reattachCount != lastHealth.reattachCount ||
+                health.sessionCount != lastHealth.sessionCount || device.present != lastDevice.present;
+            if (g_status.Read(snap) || healthChanged) RenderStatus(snap, health, device);
+            lastHealth = health;
+            lastDevice = device;
         }
         break;
     case WM_CLOSE:
         g_running = false;
-        if (hThread) WaitForSingleObject(hThread, 1000);
+        g_engine.Wake();
+        g_deviceList.Cancel();
+        g_sessionList.Cancel();
+        KillTimer(hwnd, IDT_STATUS);
+        // The learned ranges are read from the engine, so only once the input thread is gone.
+        if (!hThread || WaitForSingleObject(hThread, 1000) == WAIT_OBJECT_0) StoreCalibrations();
+        else LOG_WARN("Input thread did not stop, calibration not saved");
         DestroyWindow(hwnd);
         break;
     case WM_DESTROY:
@@ -200,20 +633,17 @@ void FillCombo(HWND hCombo, const std::vector<std::wstring>& items) {
         SendMessage(hCombo, CB_ADDSTRING, 0, (LPARAM)s.c_str());
     SendMessage(hCombo, CB_SETCURSEL, 0, 0);
 }
-void FillComboDevs(HWND hCombo) {
+void FillComboDevs(HWND hCombo, const std::vector<DInputDeviceInfo>& devices, int sel) {
     SendMessage(hCombo, CB_RESETCONTENT, 0, 0);
-    for (auto& d : g_devices)
+    for (auto& d : devices)
         SendMessage(hCombo, CB_ADDSTRING, 0, (LPARAM)d.name.c_str());
-    SendMessage(hCombo, CB_SETCURSEL, g_selectedDeviceIdx >= 0 ? g_selectedDeviceIdx : 0, 0);
+    SendMessage(hCombo, CB_SETCURSEL, sel >= 0 ? sel : 0, 0);
 }
-void FillComboSessions(HWND hCombo) {
+void FillComboSessions(HWND hCombo, const std::vector<ProcSessionInfo>& sessions, int sel) {
     SendMessage(hCombo, CB_RESETCONTENT, 0, 0);
-    for (auto& s : g_sessions) {
-        std::wstring item = s.processName + L" (PID: " +
-            (s.pid == 0xFFFFFFFF ? L"System" : std::to_wstring(s.pid)) + L")";
-        SendMessage(hCombo, CB_ADDSTRING, 0, (LPARAM)item.c_str());
-    }
-    SendMessage(hCombo, CB_SETCURSEL, g_selectedSession >= 0 ? g_selectedSession : 0, 0);
+    for (auto& s : sessions)
+        SendMessage(hCombo, CB_ADDSTRING, 0, (LPARAM)SessionLabel(s).c_str());
+    SendMessage(hCombo, CB_SETCURSEL, sel >= 0 ? sel : 0, 0);
 }
 
 // Robust float/int parsing
@@ -244,38 +674,75 @@ static void SetFloat(HWND hEdit, float val) {
 }
 
 INT_PTR CALLBACK BindDlgProc(HWND hDlg, UINT msg, WPARAM wParam, LPARAM lParam) {
-    static HWND hDevCombo, hAxisCombo, hSessCombo, hAxisMin, hAxisMax, hVolMin, hVolMax;
+    static HWND hDevCombo, hAxisCombo, hActionCombo, hSessCombo, hAxisMin, hAxisMax, hVolMin, hVolMax, hCurveCombo, hFilterCombo;
+    // The lists the combos were filled from; refreshed lists arrive while the dialog is open.
+    static AsyncList<DInputDeviceInfo>::Snapshot devices;
+    static AsyncList<ProcSessionInfo>::Snapshot sessions;
     switch (msg) {
     case WM_INITDIALOG: {
         hDevCombo = GetDlgItem(hDlg, IDC_BIND_DEVICE);
         hAxisCombo = GetDlgItem(hDlg, IDC_BIND_AXIS);
+        hActionCombo = GetDlgItem(hDlg, IDC_BIND_ACTION);
         hSessCombo = GetDlgItem(hDlg, IDC_BIND_SESSION);
         hAxisMin = GetDlgItem(hDlg, IDC_AXIS_MIN);
         hAxisMax = GetDlgItem(hDlg, IDC_AXIS_MAX);
         hVolMin = GetDlgItem(hDlg, IDC_VOL_MIN);
         hVolMax = GetDlgItem(hDlg, IDC_VOL_MAX);
-
-        RefreshDeviceList();
-        FillComboDevs(hDevCombo);
+        hCurveCombo = GetDlgItem(hDlg, IDC_BIND_CURVE);
+        hFilterCombo = GetDlgItem(hDlg, IDC_BIND_FILTER);
+
+        // Open with the lists already shown and refresh them in the background.
+        g_hBindDlg = hDlg;
+        devices = g_devices;
+        sessions = g_sessions;
+        FillComboDevs(hDevCombo, *devices, g_selectedDeviceIdx);
         FillCombo(hAxisCombo, g_axes);
-        RefreshSessionList(nullptr);
-        FillComboSessions(hSessCombo);
+        FillCombo(hActionCombo, g_actions);
+        FillComboSessions(hSessCombo, *sessions, g_selectedSession);
+        FillCombo(hCurveCombo, g_curves);
+        FillCombo(hFilterCombo, g_filterPresets);
+        RefreshDeviceList();
+        RefreshSessionList();
 
-        SendMessage(hDevCombo, CB_SETCURSEL, g_selectedDeviceIdx >= 0 ? g_selectedDeviceIdx : 0, 0);
         SendMessage(hAxisCombo, CB_SETCURSEL, g_selectedAxisIdx >= 0 ? g_selectedAxisIdx : 2, 0);
-        SendMessage(hSessCombo, CB_SETCURSEL, g_selectedSession >= 0 ? g_selectedSession : 0, 0);
+        SendMessage(hActionCombo, CB_SETCURSEL, (int)g_action, 0);
+        SendMessage(hCurveCombo, CB_SETCURSEL, (int)g_curve < (int)g_curves.size() ? (int)g_curve : 0, 0);
+        SendMessage(hFilterCombo, CB_SETCURSEL, g_filterPreset, 0);
 
         SetInt(hAxisMin, g_axisMin);
         SetInt(hAxisMax, g_axisMax);
+        CheckDlgButton(hDlg, IDC_BIND_AUTOCAL, g_autoCalibrate ? BST_CHECKED : BST_UNCHECKED);
         SetFloat(hVolMin, g_volMin);
         SetFloat(hVolMax, g_volMax);
         break;
     }
+    case WM_APP_LIST_READY:
+        // Forwarded by the main window after it swapped the list in; keep the combo on the same entry.
+        if (wParam == kDeviceList) {
+            int sel = (int)SendMessage(hDevCombo, CB_GETCURSEL, 0, 0);
+            std::string id = sel >= 0 && sel < (int)devices->size() ? GuidToString((*devices)[sel].guid) : g_selectedDeviceId;
+            devices = g_devices;
+            FillComboDevs(hDevCombo, *devices, FindDevice(devices, id));
+        } else {
+            int sel = (int)SendMessage(hSessCombo, CB_GETCURSEL, 0, 0);
+            AsyncList<ProcSessionInfo>::Snapshot old = sessions;
+            sessions = g_sessions;
+            FillComboSessions(hSessCombo, *sessions, MapSession(old, sel, sessions));
+        }
+        return TRUE;
+    case WM_DESTROY:
+        g_hBindDlg = nullptr;
+        devices.reset();
+        sessions.reset();
+        break;
     case WM_COMMAND:
         if (LOWORD(wParam) == IDOK) {
             int deviceIdx = (int)SendMessage(hDevCombo, CB_GETCURSEL, 0, 0);
             int axisIdx = (int)SendMessage(hAxisCombo, CB_GETCURSEL, 0, 0);
+            int actionIdx = (int)SendMessage(hActionCombo, CB_GETCURSEL, 0, 0);
             int sessionIdx = (int)SendMessage(hSessCombo, CB_GETCURSEL, 0, 0);
+            int curveIdx = (int)SendMessage(hCurveCombo, CB_GETCURSEL, 0, 0);
+            int filterIdx = (int)SendMessage(hFilterCombo, CB_GETCURSEL, 0, 0);
             int axisMin, axisMax; float volMin, volMax;
 
             if (!ParseInt(hAxisMin, axisMin)) {
@@ -309,13 +776,18 @@ INT_PTR CALLBACK BindDlgProc(HWND hDlg, UINT msg, WPARAM wParam, LPARAM lParam)
                 break;
             }
 
-            g_selectedDeviceIdx = deviceIdx;
+            if (deviceIdx >= 0 && deviceIdx < (int)devices->size()) g_selectedDeviceId = GuidToString((*devices)[deviceIdx].guid);
+            g_selectedDeviceIdx = FindDevice(g_devices, g_selectedDeviceId);
             g_selectedAxisIdx = axisIdx;
-            g_selectedSession = sessionIdx;
+            g_action = actionIdx >= 0 ? (BindingAction)actionIdx : BindingAction::Volume;
+            g_selectedSession = MapSession(sessions, sessionIdx, g_sessions);
             g_axisMin = axisMin;
             g_axisMax = axisMax;
+            g_autoCalibrate = IsDlgButtonChecked(hDlg, IDC_BIND_AUTOCAL) == BST_CHECKED;
             g_volMin = volMin;
             g_volMax = volMax;
+            g_curve = curveIdx >= 0 ? (CurveType)curveIdx : CurveType::Linear;
+            g_filterPreset = filterIdx >= 0 ? filterIdx : 0;
             EndDialog(hDlg, IDOK);
         } else if (LOWORD(wParam) == IDCANCEL) {
             EndDialog(hDlg, IDCANCEL);
@@ -325,8 +797,111 @@ INT_PTR CALLBACK BindDlgProc(HWND hDlg, UINT msg, WPARAM wParam, LPARAM lParam)
     return 0;
 }
 
+// Hidden top-level window for headless mode: DirectInput needs one for its cooperative
+// level, and WM_CLOSE (e.g. from taskkill) or WM_ENDSESSION stops the engine.
+LRESULT CALLBACK HeadlessWndProc(HWND hwnd, UINT msg, WPARAM wParam, LPARAM lParam) {
+    switch (msg) {
+    case WM_ENDSESSION:
+        if (!wParam) break;
+        // fall through
+    case WM_CLOSE:
+        g_running = false;
+        g_engine.Wake();
+        DestroyWindow(hwnd);
+        return 0;
+    case WM_DEVICECHANGE:
+        OnDeviceChange(wParam, lParam);
+        break;
+    case WM_APP_LIST_READY:
+        if (wParam == kDeviceList) {
+            g_devices = g_deviceList.Current();
+            g_deviceManager.Reconcile(DeviceIdentities(*g_devices));
+        }
+        return 0;
+    case WM_DESTROY:
+        PostQuitMessage(0);
+        return 0;
+    }
+    return DefWindowProc(hwnd, msg, wParam, lParam);
+}
+
+// Builds the engine straight from the profile and runs it until the process is asked to close.
+// Nothing is enumerated up front: devices are opened by GUID and sessions come from the registry;
+// only a device that is missing, or unplugged later, triggers a device enumeration.
+int RunHeadless(HINSTANCE hInstance) {
+    if (g_profile.bindings.empty() && g_profile.rules.empty()) {
+        LOG_ERROR("Headless mode needs a profile with bindings or rules (%s)", g_profilePath.c_str());
+        return 1;
+    }
+    WNDCLASS wc = {0};
+    wc.lpfnWndProc = HeadlessWndProc;
+    wc.hInstance = hInstance;
+    wc.lpszClassName = TEXT("VolJoyHeadlessClass");
+    RegisterClass(&wc);
+    HWND hwnd = CreateWindow(wc.lpszClassName, TEXT("Joystick App Volume Control"), WS_OVERLAPPED,
+        0, 0, 0, 0, nullptr, nullptr, hInstance, nullptr);
+    if (!hwnd) return 2;
+    g_hMainWnd = hwnd;
+    WatchDeviceChanges(hwnd);
+    if (!BuildEngine(hwnd, g_profile.bindings))
+        return 2;
+    g_running = true;
+    ResetLatencyStats();
+    HANDLE hThread = CreateThread(nullptr, 0, PollingThreadProc, nullptr, 0, nullptr);
+    LOG_INFO("Headless: %zu binding(s) and %zu rule(s) on %zu device(s), engine started %.1f ms after process start",
+        g_engine.BindingCount(), g_engine.RuleCount(), g_engine.DeviceCount(), MsSinceProcessStart());
+
+    MSG msg;
+    while (GetMessage(&msg, nullptr, 0, 0))
+        DispatchMessage(&msg);
+    g_running = false;
+    g_engine.Wake();
+    bool stopped = !hThread || WaitForSingleObject(hThread, 1000) == WAIT_OBJECT_0;
+    g_enumPool.Stop();
+    if (stopped) StoreCalibrations();
+    else LOG_WARN("Input thread did not stop, calibration not saved");
+    return 0;
+}
+
+// Default profile location: next to the executable.
+static std::string DefaultProfilePath() {
+    char path[MAX_PATH];
+    DWORD n = GetModuleFileNameA(nullptr, path, MAX_PATH);
+    std::string dir(path, n);
+    size_t slash = dir.find_last_of("\\/");
+    dir = slash == std::string::npos ? std::string() : dir.substr(0, slash + 1);
+    return dir + "JoystickAppVolumeControl.profile";
+}
+
 int WINAPI WinMain(HINSTANCE hInstance, HINSTANCE, LPSTR, int nCmdShow) {
     g_hInst = hInstance;
+    g_profilePath = DefaultProfilePath();
+    int argc = 0;
+    LPWSTR* argv = CommandLineToArgvW(GetCommandLineW(), &argc);
+    for (int i = 1; argv && i < argc; ++i) {
+        if (wcscmp(argv[i], L"--headless") == 0) {
+            g_headless = true;
+        } else if (wcscmp(argv[i], L"--profile") == 0 && i + 1 < argc) {
+            char path[MAX_PATH];
+            WideCharToMultiByte(CP_ACP, 0, argv[++i], -1, path, MAX_PATH, nullptr, nullptr);
+            g_profilePath = path;
+        }
+    }
+    if (argv) LocalFree(argv);
+
+    std::string error;
+    if (LoadProfile(g_profilePath, g_profile, &error))
+        LOG_INFO("Loaded profile %s: %zu binding(s), %zu rule(s)", g_profilePath.c_str(), g_profile.bindings.size(), g_profile.rules.size());
+    else
+        LOG_INFO("No profile loaded: %s", error.c_str());
+    StartAudio();
+    if (g_headless) {
+        int code = RunHeadless(hInstance);
+        StopAudio();
+        StopLogging();
+        return code;
+    }
+
     INITCOMMONCONTROLSEX icex = { sizeof(icex), ICC_WIN95_CLASSES };
     InitCommonControlsEx(&icex);
 
@@ -349,5 +924,8 @@ int WINAPI WinMain(HINSTANCE hInstance, HINSTANCE, LPSTR, int nCmdShow) {
         TranslateMessage(&msg);
         DispatchMessage(&msg);
     }
+    g_enumPool.Stop();
+    StopAudio();
+    StopLogging();
     return (int)msg.wParam;
 }
\ No newline at end of file
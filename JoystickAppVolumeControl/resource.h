@@ -7,6 +7,11 @@
 #define IDI_APPICON      101
 
 #define APP_MENU_BIND    2001
+#define APP_MENU_ADD_BINDING    2002
+#define APP_MENU_CLEAR_BINDINGS 2003
+#define APP_MENU_RECORD_TRACE   2004
+#define APP_MENU_VERBOSE_LOG    2005
+#define APP_MENU_DUMP_STATS     2006
 
 #define IDD_BIND_DIALOG  3001
 #define IDC_BIND_DEVICE  3002
@@ -17,3 +22,7 @@
 #define IDC_AXIS_MAX     3006
 #define IDC_VOL_MIN      3007
 #define IDC_VOL_MAX      3008
+#define IDC_BIND_CURVE   3009
+#define IDC_BIND_FILTER  3010
+#define IDC_BIND_AUTOCAL 3011
+#define IDC_BIND_ACTION  3012
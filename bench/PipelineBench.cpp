@@ -0,0 +1,958 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <deque>
+#include <math.h>
+#include <memory>
+#include <mutex>
+#include <new>
+#include <string>
+#include <thread>
+#include <vector>
+#include "AudioExecutor.h"
+#include "AxisTrace.h"
+#include "BindingEngine.h"
+#include "FakeInputBackend.h"
+#include "JoyInputs.h"
+#include "LatencyStats.h"
+#include "MappingRule.h"
+#include "SessionRegistry.h"
+#include "SessionTargetSink.h"
+#include "SpscQueue.h"
+#include "TraceReplay.h"
+#include "VolumeCoalescer.h"
+#include "VolumeRamp.h"
+#include "log.h"
+
+// Benchmarks of the input-to-volume pipeline on fake devices and fake audio sessions,
+// with no DirectInput or WASAPI, so they build and run on any platform:
+//   extract.*   reading a bound input: the old switch over axis indices vs the InputReader table
+//   rules.*     a tick with 100 mapping rules over four devices; --trace feeds them a real
+//               .javt capture
+//   bindings.*  a tick with 1, 8 and 64 axis bindings, every axis moving
+//   curve.*     axis to volume: the baked audio-taper table vs the old linear lerp and vs exp()
+//   fanout.*    one volume change written to 1, 16 and 128 sessions of an app
+//   replay.*    a recorded axis stream pushed through the engine, coalescer, executor (stopped),
+//               ramp and session sink on one thread; --trace replays a real .javt capture
+//   filter.*    each smoothing filter over the same stream: ns per sample and the delay it
+//               adds to a full-travel step
+//   log.*       a hot-path log call, the same call filtered out by level, and records per
+//               second formatted by the drain thread
+//   live.*      the threaded pipeline as it runs in the app: end-to-end latency from a device
+//               change to the session write, and wakeups per second while moving and idle
+//   swap.*      binding sets published while the input thread runs: what the swaps cost it
+//   ramp.*      a fast fader sweep through the ramp: steps written and the largest step
+//   spsc.*, executor.*   the command queue and the executor's last-value-wins collapsing
+// Results are printed as a table and optionally written as JSON (--json). With --baseline
+// every metric is compared to a stored run and the exit code is 1 if any regressed.
+
+namespace {
+typedef std::chrono::steady_clock Clock;
+
+// Every operator new in the process is counted, so a steady-state loop can be checked for
+// allocations. Counting is process-wide: measure only while other threads are quiet or
+// known not to allocate.
+std::atomic<uint64_t> g_allocations{0};
+// The same, per thread, for loops sharing the process with threads that do allocate.
+thread_local uint64_t t_allocations = 0;
+
+double NsSince(Clock::time_point start) {
+    return std::chrono::duration<double, std::nano>(Clock::now() - start).count();
+}
+
+void Yield() {
+    std::this_thread::yield();
+}
+
+enum class Better { Lower, Higher, None };
+
+struct Metric {
+    std::string name;
+    double value;
+    const char* unit;
+    Better better;
+    bool exact;     // compared with a small absolute slack (counts) instead of the relative tolerance
+};
+
+std::vector<Metric> g_metrics;
+std::string g_filter;
+int g_scale = 4;    // --quick: 1
+
+void Report(const std::string& name, double value, const char* unit, Better better, bool exact = false) {
+    g_metrics.push_back(Metric{ name, value, unit, better, exact });
+    printf("  %-36s %14.3f %s\n", name.c_str(), value, unit);
+    fflush(stdout);
+}
+
+bool Enabled(const char* group) {
+    // "bindings" runs for --only bindings and --only bindings.tick; "bind" runs it too.
+    return strncmp(g_filter.c_str(), group, std::min(g_filter.size(), strlen(group))) == 0;
+}
+
+// Session volume control that counts writes and, when armed, records the time from the
+// input change that caused the next write.
+class BenchControl : public SessionControl {
+public:
+    bool SetVolume(float v) override {
+        value.store(v, std::memory_order_relaxed);
+        writes.fetch_add(1, std::memory_order_relaxed);
+        if (armed.exchange(false, std::memory_order_acq_rel))
+            latency.Record((uint64_t)std::chrono::duration_cast<std::chrono::nanoseconds>(Clock::now() - changedAt).count());
+        return true;
+    }
+    std::atomic<float> value{-1.0f};
+    std::atomic<uint64_t> writes{0};
+    std::atomic<bool> armed{false};
+    Clock::time_point changedAt;    // written before armed is set
+    LatencyHistogram latency;
+};
+
+// The audio half of the app without WASAPI: sessions live in the registry, one per app
+// name, behind the same ramp, executor and coalescer as main.cpp.
+struct FakeAudio {
+    std::vector<std::wstring> names;
+    SessionRegistry registry{ [this](uint32_t pid) { return pid < names.size() ? names[pid] : std::wstring(); } };
+    SessionTargetSink sink{ registry, nullptr };
+    VolumeRamp ramp{ &sink };
+    AudioExecutor audio{ ramp };
+    VolumeCoalescer coalescer{ &audio };
+    std::vector<std::shared_ptr<BenchControl>> controls;
+
+    explicit FakeAudio(int apps) {
+        for (int i = 0; i < apps; ++i) {
+            names.push_back(L"app" + std::to_wstring(i) + L".exe");
+            controls.push_back(std::make_shared<BenchControl>());
+            registry.OnSessionAdded(L"session" + std::to_wstring(i), (uint32_t)i, L"", controls.back());
+        }
+    }
+    ~FakeAudio() {
+        audio.Stop();
+        sink.Clear();
+    }
+    int Target(int app) {
+        return sink.AddTarget(TargetSpec{ names[app], L"", false, false, L"" });
+    }
+};
+
+// Volume binding of one axis (index into DIJOYSTATE2's first eight LONGs).
+Binding AxisBinding(int device, int axis, int target, bool filtered) {
+    Binding b = { device, (DWORD)(axis * sizeof(LONG)), target, 0, 65535, 0.0f, 1.0f, CurveSpec{ CurveType::AudioTaper }, {} };
+    if (filtered) b.filters = { { FilterType::OneEuro, 0, 0.0f, 1.0f, 0.0005f } };
+    return b;
+}
+
+// A plausible capture of someone riding eight faders: smooth moves with sensor noise,
+// one or two axes at a time, and pauses; 250 Hz samples.
+void WriteSyntheticTrace(const std::string& path, int samples) {
+    FILE* f = fopen(path.c_str(), "wb");
+    if (!f) return;
+    TraceFileHeader header = {};
+    memcpy(header.magic, "JAVT", 4);
+    header.version = 1;
+    header.usedBytes = sizeof(header) + (uint64_t)samples * (sizeof(TraceRecordHeader) + sizeof(DIJOYSTATE2));
+    fwrite(&header, sizeof(header), 1, f);
+    DIJOYSTATE2 js = {};
+    for (DWORD& pov : js.rgdwPOV) pov = 0xFFFFFFFF;
+    uint32_t seed = 12345;
+    auto rnd = [&seed] { seed = seed * 1664525u + 1013904223u; return seed >> 8; };
+    int active = 0;
+    for (int i = 0; i < samples; ++i) {
+        int phase = (i / 500) % 4;  // every two seconds: one axis, two axes, idle, one axis
+        if (i % 500 == 0) active = (int)(rnd() % 8);
+        if (phase != 2) {
+            for (int k = 0; k < (phase == 1 ? 2 : 1); ++k) {
+                int axis = (active + k) % 8;
+                double pos = 0.5 + 0.5 * sin((i % 500) * 0.0126 + axis);
+                (&js.lX)[axis] = (LONG)(pos * 65000) + (LONG)(rnd() % 64);
+            }
+        }
+        TraceRecordHeader rec = { (uint8_t)TraceRecordType::JoyState, 0, 0, (uint32_t)sizeof(js), (int64_t)i * 4000000 };
+        fwrite(&rec, sizeof(rec), 1, f);
+        fwrite(&js, sizeof(js), 1, f);
+    }
+    fclose(f);
+}
+
+// ---- extract: switch vs table (user-017) -------------------------------------------
+
+// The reader the original code used: a switch over the eight DIJOYSTATE axes.
+LONG SwitchAxis(const DIJOYSTATE2& js, int idx) {
+    switch (idx) {
+    case 0: return js.lX;
+    case 1: return js.lY;
+    case 2: return js.lZ;
+    case 3: return js.lRx;
+    case 4: return js.lRy;
+    case 5: return js.lRz;
+    case 6: return js.rglSlider[0];
+    case 7: return js.rglSlider[1];
+    default: return 0;
+    }
+}
+
+void BenchExtract() {
+    std::vector<DIJOYSTATE2> states(1024);
+    for (size_t i = 0; i < states.size(); ++i)
+        for (int k = 0; k < 8; ++k) (&states[i].lX)[k] = (LONG)(i * 31 + k * 7);
+    InputReader readers[8];
+    volatile int indexSource[8] = { 0, 1, 2, 3, 4, 5, 6, 7 };   // keep the switch from being folded
+    int index[8];
+    for (int k = 0; k < 8; ++k) {
+        readers[k] = InputReader::For(k * sizeof(LONG));
+        index[k] = indexSource[k];
+    }
+    const int n = 500000 * g_scale;
+    long long sumSwitch = 0, sumTable = 0;
+    double bestSwitch = 1e30, bestTable = 1e30;
+    for (int rep = 0; rep < 3; ++rep) {
+        Clock::time_point t0 = Clock::now();
+        for (int i = 0; i < n; ++i) {
+            const DIJOYSTATE2& s = states[i & 1023];
+            for (int k = 0; k < 8; ++k) sumSwitch += SwitchAxis(s, index[(k + i) & 7]);
+        }
+        bestSwitch = std::min(bestSwitch, NsSince(t0) / (n * 8.0));
+        t0 = Clock::now();
+        for (int i = 0; i < n; ++i) {
+            const DIJOYSTATE2& s = states[i & 1023];
+            for (int k = 0; k < 8; ++k) sumTable += readers[(k + i) & 7].Read(s);
+        }
+        bestTable = std::min(bestTable, NsSince(t0) / (n * 8.0));
+    }
+    if (sumSwitch != sumTable) fprintf(stderr, "extract: readers disagree\n");
+    Report("extract.switch_ns_per_read", bestSwitch, "ns", Better::None);
+    Report("extract.table_ns_per_read", bestTable, "ns", Better::Lower);
+}
+
+// ---- rules: 100 rules per tick (user-018) ------------------------------------------
+
+class NullSink : public AudioSink {
+public:
+    void SetVolume(int, float) override { ++writes; }
+    uint64_t writes = 0;
+};
+
+void BenchRules(const std::string& tracePath) {
+    const int kDevices = 4, kRules = 100;
+    const char* const kTemplates[] = {
+        "d%d.Z * d%d.Slider0",
+        "d%d.X * (d%d.Button3 ? 0.2 : 1)",
+        "1 - d%d.Y + 0 * d%d.Y",
+        "clamp(lerp(d%d.Rx, d%d.Ry, 0.5) * 1.2, 0.1, 0.9)",
+        "range(d%d.Slider1, 0.1, 0.9) * (d%d.POV0Up ? 1 : 0.5)",
+    };
+    FakeInputBackend devices[kDevices];
+    BindingEngine engine;
+    NullSink sink;
+    engine.SetSink(&sink);
+    std::vector<int> ids;
+    for (FakeInputBackend& d : devices) ids.push_back(engine.AddDevice(&d));
+    MappingProgram programs[kRules];
+    for (int i = 0; i < kRules; ++i) {
+        char expr[160];
+        snprintf(expr, sizeof(expr), kTemplates[i % 5], i % kDevices, (i + 1) % kDevices);
+        engine.AddRule(Rule{ ids, i, expr });
+        programs[i].Compile(expr, kDevices);
+    }
+    // A recorded stream (the synthetic capture unless --trace is given), its states dealt
+    // round the four devices in turn.
+    std::string path = tracePath;
+    if (path.empty()) {
+        path = "javc-bench-rules.javt";
+        WriteSyntheticTrace(path, 2500 * g_scale);
+    }
+    TraceReader reader;
+    bool loaded = reader.Load(path);
+    if (tracePath.empty()) remove(path.c_str());
+    if (!loaded) {
+        fprintf(stderr, "rules: cannot load %s\n", path.c_str());
+        return;
+    }
+    std::vector<const DIJOYSTATE2*> trace;
+    for (const TraceRecord& r : reader.Records())
+        if (r.type == TraceRecordType::JoyState) trace.push_back(&r.state);
+    if (trace.empty()) return;
+    engine.Start();
+    const int warmup = 100, n = 5000 * g_scale;
+    for (int i = 0; i < warmup; ++i) {
+        devices[i % kDevices].SetState(*trace[i % trace.size()]);
+        engine.Tick(i * 0.001);
+    }
+    uint64_t allocs = g_allocations.load();
+    Clock::time_point t0 = Clock::now();
+    for (int i = warmup; i < warmup + n; ++i) {
+        devices[i % kDevices].SetState(*trace[i % trace.size()]);
+        engine.Tick(i * 0.001);
+    }
+    double tickNs = NsSince(t0) / n;
+    double allocsPerTick = double(g_allocations.load() - allocs) / n;
+    engine.Stop();
+
+    const DIJOYSTATE2* states[kDevices];
+    float sum = 0;
+    t0 = Clock::now();
+    for (int i = 0; i < n; ++i) {
+        for (int k = 0; k < kDevices; ++k) states[k] = trace[(i + k) % trace.size()];
+        for (MappingProgram& p : programs) sum += p.Evaluate(states);
+    }
+    double evalNs = NsSince(t0) / (double(n) * kRules);
+    if (sum < 0) fprintf(stderr, "rules: impossible sum\n");
+    Report("rules.tick_us_100_rules", tickNs / 1000.0, "us", Better::Lower);
+    Report("rules.eval_ns_per_rule", evalNs, "ns", Better::Lower);
+    Report("rules.allocs_per_tick", allocsPerTick, "allocs", Better::Lower, true);
+}
+
+// ---- bindings: tick cost by binding count (user-002) -----------------------------------
+
+// Every axis of every device moves each tick, so each binding is evaluated every time.
+// Eight bindings share a device; the engine must still read each device once per tick.
+void BenchBindings() {
+    const int kCounts[] = { 1, 8, 64 };
+    for (int count : kCounts) {
+        const int kDevices = (count + 7) / 8;
+        std::vector<FakeInputBackend> devices(kDevices);
+        BindingEngine engine;
+        NullSink sink;
+        engine.SetSink(&sink);
+        for (int d = 0; d < kDevices; ++d) {
+            int device = engine.AddDevice(&devices[d]);
+            for (int axis = 0; axis < 8 && d * 8 + axis < count; ++axis)
+                engine.AddBinding(AxisBinding(device, axis, d * 8 + axis, false));
+        }
+        std::vector<DIJOYSTATE2> trace(1024);
+        for (size_t i = 0; i < trace.size(); ++i) {
+            for (int k = 0; k < 8; ++k) (&trace[i].lX)[k] = (LONG)((i * 997 + k * 4099) % 65536);
+            for (DWORD& pov : trace[i].rgdwPOV) pov = 0xFFFFFFFF;
+        }
+        engine.Start();
+        const int warmup = 100, n = 20000 * g_scale;
+        for (int i = 0; i < warmup; ++i) {
+            for (int d = 0; d < kDevices; ++d) devices[d].SetState(trace[(i + d) % trace.size()]);
+            engine.Tick(i * 0.001);
+        }
+        uint64_t allocs = g_allocations.load();
+        uint64_t readsBefore = 0, reads = 0;
+        for (const FakeInputBackend& d : devices) readsBefore += d.ReadCount();
+        // SetState is part of every iteration; it is the same per device at every count.
+        Clock::time_point t0 = Clock::now();
+        for (int i = warmup; i < warmup + n; ++i) {
+            for (int d = 0; d < kDevices; ++d) devices[d].SetState(trace[(i + d) % trace.size()]);
+            engine.Tick(i * 0.001);
+        }
+        double tickNs = NsSince(t0) / n;
+        double allocsPerTick = double(g_allocations.load() - allocs) / n;
+        for (const FakeInputBackend& d : devices) reads += d.ReadCount();
+        engine.Stop();
+
+        std::string suffix = std::to_string(count);
+        Report("bindings.tick_us_" + suffix, tickNs / 1000.0, "us", Better::Lower);
+        Report("bindings.device_reads_per_tick_" + suffix, double(reads - readsBefore) / n / kDevices, "reads", Better::Lower, true);
+        Report("bindings.allocs_per_tick_" + suffix, allocsPerTick, "allocs", Better::Lower, true);
+    }
+}
+
+// ---- curve: table vs lerp vs direct math (user-008) ------------------------------------
+
+// The audio taper computed per sample, as the table saves doing.
+float DirectAudioTaper(LONG raw, LONG axisMin, LONG axisMax) {
+    const double k = 6.907755278982137;
+    double t = (double(raw) - axisMin) / (double(axisMax) - axisMin);
+    t = t < 0.0 ? 0.0 : t > 1.0 ? 1.0 : t;
+    return (float)((exp(k * t) - 1.0) / (exp(k) - 1.0));
+}
+
+void BenchCurve() {
+    Binding b = AxisBinding(0, 0, 0, false);
+    CurveTable table;
+    table.Bake(b.axisMin, b.axisMax, b.volMin, b.volMax, b.curve);
+    std::vector<LONG> raws(4096);
+    for (size_t i = 0; i < raws.size(); ++i) raws[i] = (LONG)((i * 40503u) % 65536);
+    const int n = 2000000 * g_scale;
+    float sumLerp = 0, sumTable = 0, sumDirect = 0;
+    double bestLerp = 1e30, bestTable = 1e30, bestDirect = 1e30;
+    for (int rep = 0; rep < 3; ++rep) {
+        Clock::time_point t0 = Clock::now();
+        for (int i = 0; i < n; ++i) sumLerp += MapAxisToVolume(raws[i & 4095], b);
+        bestLerp = std::min(bestLerp, NsSince(t0) / n);
+        t0 = Clock::now();
+        for (int i = 0; i < n; ++i) sumTable += table.Lookup(raws[i & 4095]);
+        bestTable = std::min(bestTable, NsSince(t0) / n);
+        t0 = Clock::now();
+        for (int i = 0; i < n; ++i) sumDirect += DirectAudioTaper(raws[i & 4095], b.axisMin, b.axisMax);
+        bestDirect = std::min(bestDirect, NsSince(t0) / n);
+    }
+    if (sumLerp < 0 || sumTable < 0 || sumDirect < 0) fprintf(stderr, "curve: impossible sum\n");
+    double maxError = 0;
+    for (LONG raw = b.axisMin; raw <= b.axisMax; ++raw)
+        maxError = std::max(maxError, (double)fabsf(table.Lookup(raw) - DirectAudioTaper(raw, b.axisMin, b.axisMax)));
+    Report("curve.lerp_ns", bestLerp, "ns", Better::None);
+    Report("curve.table_ns", bestTable, "ns", Better::Lower);
+    Report("curve.direct_ns", bestDirect, "ns", Better::None);
+    Report("curve.table_max_error", maxError, "volume", Better::Lower, true);
+}
+
+// ---- fanout: one target, many sessions (user-007) --------------------------------------
+
+// A browser with 1, 16 and 128 sessions, one per process, all driven by one allSessions
+// target. Each input change is one SetVolume on the sink, which writes every session.
+void BenchFanout() {
+    const int kCounts[] = { 1, 16, 128 };
+    for (int count : kCounts) {
+        SessionRegistry registry([](uint32_t) { return std::wstring(L"browser.exe"); });
+        std::vector<std::shared_ptr<BenchControl>> controls;
+        for (int i = 0; i < count; ++i) {
+            controls.push_back(std::make_shared<BenchControl>());
+            registry.OnSessionAdded(L"session" + std::to_wstring(i), (uint32_t)(1000 + i), L"", controls.back());
+        }
+        SessionTargetSink sink(registry, nullptr);
+        int target = sink.AddTarget(TargetSpec{ L"browser.exe", L"", false, true, L"" });
+        sink.SetVolume(target, 0.0f);
+
+        const int n = 2000000 * g_scale / count;
+        uint64_t writes = sink.SessionWrites();
+        uint64_t allocs = g_allocations.load();
+        Clock::time_point t0 = Clock::now();
+        for (int i = 0; i < n; ++i) sink.SetVolume(target, (i & 1023) / 1023.0f);
+        double changeNs = NsSince(t0) / n;
+        double allocsPerChange = double(g_allocations.load() - allocs) / n;
+        writes = sink.SessionWrites() - writes;
+        for (const std::shared_ptr<BenchControl>& c : controls)
+            if (c->writes.load() != (uint64_t)n + 1) fprintf(stderr, "fanout: a session missed writes\n");
+        sink.Clear();
+
+        std::string suffix = std::to_string(count);
+        Report("fanout.ns_per_change_" + suffix, changeNs, "ns", Better::Lower);
+        Report("fanout.ns_per_session_" + suffix, changeNs / count, "ns", Better::Lower);
+        Report("fanout.writes_per_change_" + suffix, double(writes) / n, "writes", Better::Higher, true);
+        Report("fanout.allocs_per_change_" + suffix, allocsPerChange, "allocs", Better::Lower, true);
+    }
+}
+
+// ---- replay: recorded stream through the whole chain on one thread --------------------
+
+void BenchReplay(const std::string& tracePath) {
+    std::string path = tracePath;
+    if (path.empty()) {
+        path = "javc-bench-synthetic.javt";
+        WriteSyntheticTrace(path, 2500 * g_scale);
+    }
+    TraceReader trace;
+    if (!trace.Load(path)) {
+        fprintf(stderr, "replay: cannot load %s\n", path.c_str());
+        return;
+    }
+    int deviceCount = std::max(trace.DeviceCount(), 1);
+    FakeAudio fake(8 * deviceCount);
+    fake.coalescer.SetClock(&TraceClockNow);
+    std::vector<std::unique_ptr<FakeInputBackend>> devices;
+    std::vector<FakeInputBackend*> inputs;
+    BindingEngine engine;
+    engine.SetSink(&fake.coalescer);
+    for (int d = 0; d < deviceCount; ++d) {
+        devices.emplace_back(new FakeInputBackend());
+        inputs.push_back(devices.back().get());
+        int device = engine.AddDevice(inputs.back());
+        for (int axis = 0; axis < 8; ++axis)
+            engine.AddBinding(AxisBinding(device, axis, fake.Target(d * 8 + axis), axis % 2 == 0));
+    }
+    // One pass to warm caches and grow every lazily sized buffer, then the measured one.
+    ReplayTrace(trace, engine, inputs);
+    fake.coalescer.Reset();     // trace time starts over
+    uint64_t writes = 0;
+    for (const auto& c : fake.controls) writes -= c->writes.load();
+    uint64_t allocs = g_allocations.load();
+    uint64_t ticks = GetLatencyStats().counters[(int)StatCounter::Ticks];
+    ReplayStats stats = ReplayTrace(trace, engine, inputs);
+    ticks = GetLatencyStats().counters[(int)StatCounter::Ticks] - ticks;
+    double allocsPerTick = double(g_allocations.load() - allocs) / std::max<uint64_t>(ticks ? ticks : stats.samples, 1);
+    for (const auto& c : fake.controls) writes += c->writes.load();
+    Report("replay.ns_per_sample", stats.wallSeconds * 1e9 / std::max<uint64_t>(stats.samples, 1), "ns", Better::Lower);
+    Report("replay.allocs_per_tick", allocsPerTick, "allocs", Better::Lower, true);
+    Report("replay.session_writes_per_trace_sec", writes / std::max(stats.traceSeconds, 1e-9), "writes/s", Better::None);
+    if (tracePath.empty()) remove(path.c_str());
+}
+
+// ---- filter: per-filter throughput and added latency (user-009) -------------------------
+
+// Each filter runs on every axis of a recorded stream (the synthetic capture unless --trace
+// is given), one AxisFilter per axis as the engine keeps them. The added latency is how
+// long the output takes to get halfway through a full-travel step at 250 Hz; unfiltered,
+// it gets there on the step's own sample. One-Euro opens up on fast moves, so a step
+// passes it straight through; its smoothing only applies to slow drift.
+void BenchFilter(const std::string& tracePath) {
+    std::string path = tracePath;
+    if (path.empty()) {
+        path = "javc-bench-filter.javt";
+        WriteSyntheticTrace(path, 2500 * g_scale);
+    }
+    TraceReader trace;
+    bool loaded = trace.Load(path);
+    if (tracePath.empty()) remove(path.c_str());
+    if (!loaded) {
+        fprintf(stderr, "filter: cannot load %s\n", path.c_str());
+        return;
+    }
+    std::vector<const TraceRecord*> samples;
+    for (const TraceRecord& r : trace.Records())
+        if (r.type == TraceRecordType::JoyState) samples.push_back(&r);
+    if (samples.empty()) return;
+
+    // The presets main.cpp offers.
+    struct Preset { const char* name; FilterSpec spec; };
+    const Preset kPresets[] = {
+        { "moving_average", { FilterType::MovingAverage, 4, 0.0f, 0.0f, 0.0f } },
+        { "exponential", { FilterType::Exponential, 0, 0.3f, 0.0f, 0.0f } },
+        { "one_euro", { FilterType::OneEuro, 0, 0.0f, 1.0f, 0.0005f } },
+        { "median", { FilterType::Median, 5, 0.0f, 0.0f, 0.0f } },
+    };
+    for (const Preset& p : kPresets) {
+        AxisFilter filters[8];
+        for (AxisFilter& f : filters) f = AxisFilter(p.spec);
+        long long sum = 0;
+        double best = 1e30;
+        uint64_t allocs = g_allocations.load();
+        for (int rep = 0; rep < 3; ++rep) {
+            for (AxisFilter& f : filters) f.Reset();
+            Clock::time_point t0 = Clock::now();
+            for (const TraceRecord* r : samples) {
+                double t = r->timestampNs * 1e-9;
+                for (int k = 0; k < 8; ++k) sum += filters[k].Process((&r->state.lX)[k], t);
+            }
+            best = std::min(best, NsSince(t0) / (samples.size() * 8.0));
+        }
+        double allocsPerSample = double(g_allocations.load() - allocs) / (samples.size() * 8.0 * 3);
+        if (sum < 0) fprintf(stderr, "filter: impossible sum\n");
+
+        AxisFilter step(p.spec);
+        const int kRestSamples = 50, kMaxSamples = 1000;
+        const double kPeriod = 0.004;
+        for (int i = 0; i < kRestSamples; ++i) step.Process(0, i * kPeriod);
+        int late = 0;
+        while (late < kMaxSamples && step.Process(60000, (kRestSamples + late) * kPeriod) < 30000) ++late;
+
+        std::string prefix = std::string("filter.") + p.name;
+        Report(prefix + "_ns_per_sample", best, "ns", Better::Lower);
+        Report(prefix + "_latency_ms", late * kPeriod * 1000.0, "ms", Better::Lower, true);
+        Report(prefix + "_allocs", allocsPerSample, "allocs", Better::Lower, true);
+    }
+}
+
+// ---- log: call cost and drain throughput (user-011) ------------------------------------
+
+std::atomic<uint64_t> g_logBytes{0};
+
+void CountLogOutput(const char*, size_t len) {
+    g_logBytes.fetch_add(len, std::memory_order_relaxed);
+}
+
+// The hot-path call the polling loop makes, in batches that fit one thread's ring; each
+// batch is then flushed, which times the drain thread formatting and writing it.
+void BenchLog() {
+    const int kBatch = (int)LogRing::kSlots / 2;
+    const int batches = 50 * g_scale;
+    SetLogOutput(&CountLogOutput);
+    SetLogLevel(LogLevel::Info);
+    FlushLog();
+    LogStats before = GetLogStats();
+    double callNs = 0, flushNs = 0, disabledNs = 1e30;
+    for (int b = 0; b < batches; ++b) {
+        Clock::time_point t0 = Clock::now();
+        for (int i = 0; i < kBatch; ++i) LOG_INFO("AxisValue=%ld mapped=%.3f", (long)(b * kBatch + i), i / 512.0);
+        callNs += NsSince(t0);
+        t0 = Clock::now();
+        FlushLog();
+        flushNs += NsSince(t0);
+        t0 = Clock::now();
+        for (int i = 0; i < kBatch; ++i) LOG_DEBUG("AxisValue=%ld mapped=%.3f", (long)i, i / 512.0);
+        disabledNs = std::min(disabledNs, NsSince(t0) / kBatch);
+    }
+    LogStats after = GetLogStats();
+    SetLogLevel(LogLevel::Warn);
+    SetLogOutput(nullptr);
+    uint64_t records = (uint64_t)batches * kBatch;
+    if (after.written - before.written != records) fprintf(stderr, "log: %llu of %llu records written\n",
+        (unsigned long long)(after.written - before.written), (unsigned long long)records);
+    Report("log.call_ns", callNs / records, "ns", Better::Lower);
+    Report("log.disabled_call_ns", disabledNs, "ns", Better::Lower);
+    Report("log.drain_krecords_per_sec", records / (flushNs * 1e-9) / 1000.0, "krecords/s", Better::Higher);
+    Report("log.dropped", double(after.dropped - before.dropped), "records", Better::Lower, true);
+}
+
+// ---- live: threaded pipeline, latency and wakeups -------------------------------------
+
+void BenchLive() {
+    FakeAudio fake(1);
+    FakeInputBackend device(true);
+    BindingEngine engine;
+    engine.SetSink(&fake.coalescer);
+    int d = engine.AddDevice(&device);
+    engine.AddBinding(AxisBinding(d, 2, fake.Target(0), false));
+    fake.audio.Start();
+    std::atomic<bool> running{true};
+    std::thread input([&] { engine.Run(running); });
+    std::this_thread::sleep_for(std::chrono::milliseconds(50));
+
+    BenchControl& control = *fake.controls[0];
+    auto counters = [&](uint64_t& ticks, uint64_t& wakeups) {
+        ticks = GetLatencyStats().counters[(int)StatCounter::Ticks];
+        wakeups = fake.audio.Wakeups();
+    };
+    // Moving: a jump every 8 ms, each answered by the first ramp step.
+    const int changes = 60 * g_scale;
+    uint64_t ticks0, wakeups0, ticks1, wakeups1;
+    counters(ticks0, wakeups0);
+    uint64_t allocs = g_allocations.load();
+    Clock::time_point start = Clock::now();
+    for (int i = 0; i < changes; ++i) {
+        control.changedAt = Clock::now();
+        control.armed.store(true, std::memory_order_release);
+        device.SetAxis(DIJOFS_Z, i % 2 ? 60000 + i : 5000 + i);
+        std::this_thread::sleep_for(std::chrono::milliseconds(8));
+    }
+    double movingSec = std::chrono::duration<double>(Clock::now() - start).count();
+    counters(ticks1, wakeups1);
+    allocs = g_allocations.load() - allocs;
+    control.armed = false;
+    std::this_thread::sleep_for(std::chrono::milliseconds(300));   // ramp lands, filters settle
+
+    // Idle: nothing moves; an event-driven pipeline should not wake at all.
+    uint64_t ticks2, wakeups2, ticks3, wakeups3;
+    counters(ticks2, wakeups2);
+    start = Clock::now();
+    std::this_thread::sleep_for(std::chrono::milliseconds(250 * g_scale));
+    double idleSec = std::chrono::duration<double>(Clock::now() - start).count();
+    counters(ticks3, wakeups3);
+
+    running = false;
+    engine.Wake();
+    input.join();
+    fake.audio.Stop();
+
+    const LatencyHistogram& h = control.latency;
+    Report("live.latency_p50_us", h.Percentile(0.50) / 1000.0, "us", Better::Lower);
+    Report("live.latency_p90_us", h.Percentile(0.90) / 1000.0, "us", Better::Lower);
+    Report("live.latency_p99_us", h.Percentile(0.99) / 1000.0, "us", Better::Lower);
+    Report("live.latency_max_us", h.Max() / 1000.0, "us", Better::None);
+    Report("live.moving_input_wakeups_per_sec", (ticks1 - ticks0) / movingSec, "wakeups/s", Better::Lower);
+    // How many commands share a wakeup depends on scheduling, so this one is not compared.
+    Report("live.moving_audio_wakeups_per_sec", (wakeups1 - wakeups0) / movingSec, "wakeups/s", Better::None);
+    Report("live.idle_input_wakeups_per_sec", (ticks3 - ticks2) / idleSec, "wakeups/s", Better::Lower, true);
+    Report("live.idle_audio_wakeups_per_sec", (wakeups3 - wakeups2) / idleSec, "wakeups/s", Better::Lower, true);
+    // Input and audio threads together, per input tick.
+    Report("live.allocs_per_tick", double(allocs) / std::max<uint64_t>(ticks1 - ticks0, 1), "allocs", Better::Lower, true);
+}
+
+// ---- swap: configuration changes while running -----------------------------------------
+
+// Four devices with eight bindings each move every millisecond while the bindings are
+// rebuilt and published every 10 ms, rotating which app each axis drives. The input
+// thread swaps each set in between ticks; building and freeing sets is the publisher's job.
+void BenchSwap() {
+    const int kDevices = 4, kApps = 8;
+    FakeAudio fake(kApps);
+    std::vector<int> targets;
+    for (int i = 0; i < kApps; ++i) targets.push_back(fake.Target(i));
+    std::vector<FakeInputBackend> devices(kDevices);
+    BindingEngine engine;
+    engine.SetSink(&fake.coalescer);
+    double publishNs = 0;
+    int published = 0;
+    auto publish = [&](int variant) {
+        Clock::time_point start = Clock::now();
+        for (int d = 0; d < kDevices; ++d) {
+            int device = engine.AddDevice(&devices[d]);
+            for (int axis = 0; axis < 8; ++axis)
+                engine.AddBinding(AxisBinding(device, axis, targets[(d * 8 + axis + variant) % kApps], axis % 2 == 0));
+        }
+        engine.Publish();
+        publishNs += NsSince(start);
+        ++published;
+    };
+    publish(0);
+    fake.audio.Start();
+
+    std::atomic<bool> running{true};
+    std::atomic<uint64_t> inputAllocs{0}, inputTicks{0};
+    std::thread input([&] {
+        engine.Start();
+        // The first tick writes every target once, which sizes the coalescer's table.
+        engine.Wait(engine.Tick() > 0);
+        uint64_t allocs = t_allocations, ticks = 0;
+        while (running) {
+            engine.Wait(engine.Tick() > 0);
+            ++ticks;
+        }
+        inputAllocs = t_allocations - allocs;
+        inputTicks = ticks;
+        engine.Stop();
+    });
+    const int steps = 250 * g_scale;
+    for (int i = 1; i <= steps; ++i) {
+        for (int d = 0; d < kDevices; ++d)
+            devices[d].SetAxis((DWORD)((i % 8) * sizeof(LONG)), i % 2 ? 60000 - i : 5000 + i);
+        if (i % 10 == 0) publish(i / 10);
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+    running = false;
+    engine.Wake();
+    input.join();
+    fake.audio.Stop();
+
+    Report("swap.input_allocs_per_tick", double(inputAllocs.load()) / std::max<uint64_t>(inputTicks.load(), 1), "allocs", Better::Lower, true);
+    Report("swap.publish_us", publishNs / 1000.0 / published, "us", Better::Lower);
+    Report("swap.adopted_pct", 100.0 * engine.Swaps() / (published - 1), "%", Better::None);
+}
+
+// ---- ramp: fader sweep (user-019) ----------------------------------------------------
+
+void BenchRamp() {
+    FakeAudio fake(1);
+    int target = fake.Target(0);
+    fake.audio.Start();
+    fake.audio.SetVolume(target, 0.0f);
+    std::this_thread::sleep_for(std::chrono::milliseconds(20));
+    fake.audio.Invoke([&] { fake.ramp.ResetStepStats(); });
+    BenchControl& control = *fake.controls[0];
+    uint64_t writes = control.writes.load();
+    // 0 to 1 in five 40 ms input steps: five big jumps without the ramp.
+    for (int i = 1; i <= 5; ++i) {
+        fake.audio.SetVolume(target, i * 0.2f);
+        std::this_thread::sleep_for(std::chrono::milliseconds(40));
+    }
+    for (int i = 0; i < 100 && control.value.load() != 1.0f; ++i)
+        std::this_thread::sleep_for(std::chrono::milliseconds(5));
+    fake.audio.Stop();
+    Report("ramp.sweep_writes", double(control.writes.load() - writes), "writes", Better::None);
+    Report("ramp.sweep_max_step", fake.ramp.MaxStep(), "volume", Better::Lower);
+}
+
+// ---- spsc and executor (user-021) ------------------------------------------------------
+
+template<typename Push, typename Pop>
+double Throughput(uint32_t n, Push push, Pop pop) {
+    bool ordered = true;
+    Clock::time_point t0 = Clock::now();
+    std::thread consumer([&] {
+        for (uint32_t expect = 0; expect < n;) {
+            uint32_t v;
+            if (!pop(v)) {
+                Yield();
+                continue;
+            }
+            if (v != expect) ordered = false;
+            ++expect;
+        }
+    });
+    for (uint32_t i = 0; i < n;)
+        if (push(i)) ++i;
+        else Yield();
+    consumer.join();
+    double sec = NsSince(t0) * 1e-9;
+    if (!ordered) fprintf(stderr, "spsc: out of order\n");
+    return n / sec / 1e6;
+}
+
+void BenchQueue() {
+    const uint32_t n = 1000000 * g_scale;
+    std::unique_ptr<SpscQueue<uint32_t, 1024>> queue(new SpscQueue<uint32_t, 1024>());
+    double spsc = Throughput(n, [&](uint32_t v) { return queue->Push(v); }, [&](uint32_t& v) { return queue->Pop(v); });
+    std::mutex mutex;
+    std::deque<uint32_t> deque;
+    double locked = Throughput(n,
+        [&](uint32_t v) { std::lock_guard<std::mutex> lock(mutex); if (deque.size() >= 1024) return false; deque.push_back(v); return true; },
+        [&](uint32_t& v) { std::lock_guard<std::mutex> lock(mutex); if (deque.empty()) return false; v = deque.front(); deque.pop_front(); return true; });
+    Report("spsc.mops", spsc, "Mops/s", Better::Higher);
+    Report("spsc.mutex_deque_mops", locked, "Mops/s", Better::None);
+
+    // The input thread's side of the executor: 64 targets written round-robin.
+    const int kTargets = 64;
+    FakeAudio fake(kTargets);
+    std::vector<int> targets;
+    for (int i = 0; i < kTargets; ++i) targets.push_back(fake.Target(i));
+    fake.ramp.SetSettings(RampSettings{ 1000, 1000.0f, 1000000 });    // steps as fast as the timer allows
+    fake.audio.Start();
+    const int commands = 250000 * g_scale;
+    Clock::time_point t0 = Clock::now();
+    for (int i = 0; i < commands; ++i)
+        fake.audio.SetVolume(targets[i % kTargets], (i % 1000) / 1000.0f);
+    double ns = NsSince(t0) / commands;
+    fake.audio.Stop();
+    bool landed = true;
+    for (int i = commands - kTargets; i < commands; ++i)    // the last command of each target
+        if (fake.controls[i % kTargets]->value.load() != (i % 1000) / 1000.0f) landed = false;
+    if (!landed) fprintf(stderr, "executor: a target missed its last value\n");
+    Report("executor.ns_per_command", ns, "ns", Better::Lower);
+    Report("executor.collapsed_pct", 100.0 * fake.audio.Collapsed() / std::max<uint64_t>(fake.audio.Commands(), 1), "%", Better::None);
+}
+
+// ---- JSON and baseline -------------------------------------------------------------------
+
+const char* BetterName(Better b) {
+    return b == Better::Lower ? "lower" : b == Better::Higher ? "higher" : "none";
+}
+
+bool WriteJson(const std::string& path) {
+    FILE* f = path == "-" ? stdout : fopen(path.c_str(), "w");
+    if (!f) return false;
+    fprintf(f, "{\n  \"schema\": 1,\n  \"metrics\": {\n");
+    for (size_t i = 0; i < g_metrics.size(); ++i) {
+        const Metric& m = g_metrics[i];
+        fprintf(f, "    \"%s\": { \"value\": %.6g, \"unit\": \"%s\", \"better\": \"%s\"%s }%s\n",
+            m.name.c_str(), m.value, m.unit, BetterName(m.better), m.exact ? ", \"exact\": true" : "",
+            i + 1 < g_metrics.size() ? "," : "");
+    }
+    fprintf(f, "  }\n}\n");
+    return f == stdout || fclose(f) == 0;
+}
+
+// Reads "name": { "value": X from a file written by WriteJson.
+bool BaselineValue(const std::string& json, const std::string& name, double& out) {
+    size_t at = json.find("\"" + name + "\"");
+    if (at == std::string::npos) return false;
+    at = json.find("\"value\":", at);
+    if (at == std::string::npos) return false;
+    out = strtod(json.c_str() + at + 8, nullptr);
+    return true;
+}
+
+// Returns the number of regressions.
+// Metric names in a baseline, in file order; WriteJson puts each metric on its own line.
+std::vector<std::string> BaselineNames(const std::string& json) {
+    std::vector<std::string> names;
+    for (size_t line = 0; line < json.size();) {
+        size_t end = json.find('\n', line);
+        if (end == std::string::npos) end = json.size();
+        size_t value = json.find("\"value\":", line);
+        size_t open = json.find('"', line);
+        if (value < end && open < value) {
+            size_t close = json.find('"', open + 1);
+            names.push_back(json.substr(open + 1, close - open - 1));
+        }
+        line = end + 1;
+    }
+    return names;
+}
+
+int CompareBaseline(const std::string& path, double tolerance) {
+    FILE* f = fopen(path.c_str(), "rb");
+    if (!f) {
+        fprintf(stderr, "cannot read baseline %s\n", path.c_str());
+        return -1;
+    }
+    std::string json;
+    char buf[4096];
+    for (size_t n; (n = fread(buf, 1, sizeof(buf), f)) > 0;) json.append(buf, n);
+    fclose(f);
+    int regressions = 0;
+    printf("\nAgainst %s (tolerance %.0f%%):\n", path.c_str(), tolerance * 100);
+    for (const Metric& m : g_metrics) {
+        double base;
+        if (!BaselineValue(json, m.name, base)) {
+            printf("  %-36s %14s  new\n", m.name.c_str(), "");
+            continue;
+        }
+        bool worse = false;
+        if (m.exact)
+            worse = m.better == Better::Lower ? m.value > base + 0.01 : m.better == Better::Higher && m.value < base - 0.01;
+        else if (m.better == Better::Lower)
+            worse = m.value > base * (1 + tolerance);
+        else if (m.better == Better::Higher)
+            worse = m.value < base / (1 + tolerance);
+        double change = base != 0 ? (m.value - base) / fabs(base) * 100 : 0;
+        printf("  %-36s %14.3f -> %-14.3f %+7.1f%%  %s\n", m.name.c_str(), base, m.value, change,
+            worse ? "REGRESSED" : m.better == Better::None ? "info" : "ok");
+        if (worse) ++regressions;
+    }
+    // A benchmark that was dropped or renamed must not pass the gate by omission.
+    for (const std::string& name : BaselineNames(json)) {
+        if (!Enabled(name.c_str())) continue;
+        bool ran = false;
+        for (const Metric& m : g_metrics) ran = ran || m.name == name;
+        if (ran) continue;
+        printf("  %-36s %14s  MISSING\n", name.c_str(), "");
+        ++regressions;
+    }
+    return regressions;
+}
+
+void* CountedAlloc(size_t size) {
+    g_allocations.fetch_add(1, std::memory_order_relaxed);
+    ++t_allocations;
+    if (void* p = malloc(size ? size : 1)) return p;
+    throw std::bad_alloc();
+}
+
+void Usage() {
+    fprintf(stderr,
+        "usage: javc-bench [options]\n"
+        "  --json FILE        write the results as JSON (- for stdout)\n"
+        "  --baseline FILE    compare with a stored run; exit 1 if anything regressed\n"
+        "  --tolerance F      allowed relative slowdown for timings (default 0.5)\n"
+        "  --trace FILE       replay a recorded .javt trace instead of the synthetic one\n"
+        "  --only PREFIX      run only benchmarks whose name starts with PREFIX\n"
+        "  --quick            fewer iterations\n");
+}
+}
+
+void* operator new(size_t size) {
+    return CountedAlloc(size);
+}
+void* operator new[](size_t size) {
+    return CountedAlloc(size);
+}
+void operator delete(void* p) noexcept {
+    free(p);
+}
+void operator delete[](void* p) noexcept {
+    free(p);
+}
+void operator delete(void* p, size_t) noexcept {
+    free(p);
+}
+void operator delete[](void* p, size_t) noexcept {
+    free(p);
+}
+
+int main(int argc, char** argv) {
+    std::string jsonPath, baselinePath, tracePath;
+    double tolerance = 0.5;
+    for (int i = 1; i < argc; ++i) {
+        bool hasValue = i + 1 < argc;
+        if (strcmp(argv[i], "--json") == 0 && hasValue) jsonPath = argv[++i];
+        else if (strcmp(argv[i], "--baseline") == 0 && hasValue) baselinePath = argv[++i];
+        else if (strcmp(argv[i], "--tolerance") == 0 && hasValue) tolerance = atof(argv[++i]);
+        else if (strcmp(argv[i], "--trace") == 0 && hasValue) tracePath = argv[++i];
+        else if (strcmp(argv[i], "--only") == 0 && hasValue) g_filter = argv[++i];
+        else if (strcmp(argv[i], "--quick") == 0) g_scale = 1;
+        else {
+            Usage();
+            return 2;
+        }
+    }
+    SetLogLevel(LogLevel::Warn);
+    printf("javc-bench (%s)\n", JAVC_LATENCY_STATS ? "latency stats on" : "latency stats off: wakeup counts read 0");
+    if (Enabled("extract")) BenchExtract();
+    if (Enabled("rules")) BenchRules(tracePath);
+    if (Enabled("bindings")) BenchBindings();
+    if (Enabled("curve")) BenchCurve();
+    if (Enabled("fanout")) BenchFanout();
+    if (Enabled("replay")) BenchReplay(tracePath);
+    if (Enabled("filter")) BenchFilter(tracePath);
+    if (Enabled("log")) BenchLog();
+    if (Enabled("live")) BenchLive();
+    if (Enabled("swap")) BenchSwap();
+    if (Enabled("ramp")) BenchRamp();
+    if (Enabled("spsc") || Enabled("executor")) BenchQueue();
+
+    if (!jsonPath.empty() && !WriteJson(jsonPath)) {
+        fprintf(stderr, "cannot write %s\n", jsonPath.c_str());
+        return 2;
+    }
+    int regressions = baselinePath.empty() ? 0 : CompareBaseline(baselinePath, tolerance);
+    StopLogging();
+    if (regressions < 0) return 2;
+    if (regressions) printf("%d metric(s) regressed\n", regressions);
+    return regressions ? 1 : 0;
+}
@@ -0,0 +1,208 @@
+#include "Test.h"
+#include <stdlib.h>
+#include <atomic>
+#include <new>
+#include <string>
+#include <vector>
+#include "BindingEngine.h"
+#include "FakeInputBackend.h"
+#include "SessionRegistry.h"
+#include "SessionTargetSink.h"
+#include "VolumeCoalescer.h"
+#include "VolumeRamp.h"
+
+// The input thread allocates nothing once running: not per tick through the whole write
+// path, and not when it swaps in a binding set published while it runs (user-024).
+
+namespace {
+// Every operator new is counted per thread, so the input thread can be checked while the
+// configuring thread allocates new sets next to it.
+thread_local uint64_t t_allocations = 0;
+
+void* CountedAlloc(size_t size) {
+    ++t_allocations;
+    if (void* p = malloc(size ? size : 1)) return p;
+    throw std::bad_alloc();
+}
+
+class NullControl : public SessionControl {
+public:
+    bool SetVolume(float) override { return true; }
+};
+
+const int kDevices = 4, kApps = 16;
+
+// The write path of the app without WASAPI or the executor thread: coalescer, ramp and
+// session targets, all running on the thread that ticks.
+struct AudioPath {
+    SessionRegistry registry{ [](uint32_t pid) { return L"app" + std::to_wstring(pid) + L".exe"; } };
+    SessionTargetSink sink{ registry, nullptr };
+    VolumeRamp ramp{ &sink };
+    VolumeCoalescer coalescer{ &ramp, CoalescerSettings{ 0.001f, 2, 0 } };
+    int targets[kApps + 1];
+
+    AudioPath() {
+        for (int i = 0; i <= kApps; ++i) {
+            registry.OnSessionAdded(L"session" + std::to_wstring(i), (uint32_t)i, L"", std::make_shared<NullControl>());
+            targets[i] = sink.AddTarget(TargetSpec{ L"app" + std::to_wstring(i) + L".exe", L"", false, false, L"" });
+        }
+    }
+    ~AudioPath() { sink.Clear(); }
+};
+
+// Every kind of binding the engine runs: filtered and calibrated axes on both curves,
+// mute and step buttons, a hat direction and a rule across two devices. variant moves
+// the axes to other targets, as an edited profile would.
+void Configure(BindingEngine& engine, FakeInputBackend* devices, const AudioPath& audio, int variant) {
+    const FilterSpec kFilters[] = {
+        { FilterType::OneEuro, 0, 0.0f, 1.0f, 0.0005f },
+        { FilterType::MovingAverage, 8 },
+        { FilterType::Median, 5 },
+        { FilterType::Exponential, 0, 0.3f },
+    };
+    std::vector<int> ids;
+    for (int d = 0; d < kDevices; ++d) {
+        int device = engine.AddDevice(&devices[d]);
+        ids.push_back(device);
+        for (int axis = 0; axis < 8; ++axis) {
+            Binding b = { device, (DWORD)(axis * sizeof(LONG)), audio.targets[(d * 8 + axis + variant) % kApps], 0, 65535,
+                0.0f, 1.0f, CurveSpec{ axis % 2 ? CurveType::Linear : CurveType::AudioTaper }, {} };
+            b.filters = { kFilters[axis % 4] };
+            b.autoCalibrate = axis == 7;
+            engine.AddBinding(b);
+        }
+        Binding mute = { device, DIJOFS_BUTTON(0), audio.targets[d], 0, 1, 0.0f, 1.0f, CurveSpec{ CurveType::Linear }, {} };
+        mute.action = BindingAction::MuteToggle;
+        engine.AddBinding(mute);
+        Binding step = mute;
+        step.axisOfs = DIJOFS_BUTTON(1);
+        step.action = BindingAction::StepUp;
+        engine.AddBinding(step);
+        Binding hat = { device, DIJOFS_POV(0), audio.targets[kApps - 1 - d], 0, 1, 0.0f, 0.8f, CurveSpec{ CurveType::Linear }, {} };
+        hat.povAngle = 9000;
+        engine.AddBinding(hat);
+    }
+    engine.AddRule(Rule{ ids, audio.targets[kApps], "d0.Z * d1.Slider0" });
+}
+
+// Tick i of a stream that moves every axis, presses the buttons every 64 ticks and turns
+// the hat every 100.
+void Drive(FakeInputBackend* devices, int i) {
+    for (int d = 0; d < kDevices; ++d) {
+        DIJOYSTATE2 js = {};
+        for (int k = 0; k < 8; ++k) (&js.lX)[k] = (LONG)((i * 997 + k * 4099 + d * 131) % 65536);
+        js.rgbButtons[0] = (i / 64 + d) % 2 ? 0x80 : 0;
+        js.rgbButtons[1] = (i / 32) % 2 ? 0x80 : 0;
+        js.rgdwPOV[0] = (i / 100) % 2 ? 9000 : 0xFFFFFFFF;
+        for (int p = 1; p < 4; ++p) js.rgdwPOV[p] = 0xFFFFFFFF;
+        devices[d].SetState(js);
+    }
+}
+}
+
+void* operator new(size_t size) {
+    return CountedAlloc(size);
+}
+void* operator new[](size_t size) {
+    return CountedAlloc(size);
+}
+void operator delete(void* p) noexcept {
+    free(p);
+}
+void operator delete[](void* p) noexcept {
+    free(p);
+}
+void operator delete(void* p, size_t) noexcept {
+    free(p);
+}
+void operator delete[](void* p, size_t) noexcept {
+    free(p);
+}
+
+// A zero below only means something if the counter sees allocations at all.
+TEST(CounterSeesAllocations) {
+    uint64_t before = t_allocations;
+    std::vector<int>* v = new std::vector<int>(16);
+    delete v;
+    CHECK(t_allocations - before == 2);
+}
+
+TEST(SteadyStateTicksAllocateNothing) {
+    AudioPath audio;
+    FakeInputBackend devices[kDevices];
+    BindingEngine engine;
+    engine.SetSink(&audio.coalescer);
+    Configure(engine, devices, audio, 0);
+    engine.Start();
+    // Warm-up: the first writes size the coalescer's table and the ramp's targets.
+    for (int i = 0; i < 300; ++i) {
+        Drive(devices, i);
+        engine.Tick(i * 0.004);
+        audio.coalescer.Flush();
+    }
+    const int kTicks = 20000;
+    uint64_t allocs = 0, writes = audio.sink.SessionWrites();
+    for (int i = 300; i < 300 + kTicks; ++i) {
+        Drive(devices, i);
+        uint64_t before = t_allocations;
+        engine.Tick(i * 0.004);
+        audio.coalescer.Flush();
+        allocs += t_allocations - before;
+    }
+    engine.Stop();
+    printf("  %d ticks, %llu session writes, %llu allocations\n", kTicks,
+        (unsigned long long)(audio.sink.SessionWrites() - writes), (unsigned long long)allocs);
+    CHECK(allocs == 0);
+    CHECK(audio.sink.SessionWrites() > writes);
+}
+
+// The configuring thread publishes a new set every 10 ms while the input thread runs; the
+// input thread swaps each one in without allocating.
+TEST(SwappingPublishedSetsAllocatesNothingOnTheInputThread) {
+    AudioPath audio;
+    FakeInputBackend devices[kDevices];
+    BindingEngine engine;
+    engine.SetSink(&audio.coalescer);
+    Configure(engine, devices, audio, 0);
+    engine.Publish();
+
+    std::atomic<bool> running{true}, warm{false};
+    std::atomic<uint64_t> inputAllocs{0}, inputTicks{0};
+    std::thread input([&] {
+        engine.Start();
+        engine.Wait(engine.Tick() > 0);
+        warm = true;
+        uint64_t allocs = t_allocations, ticks = 0;
+        while (running) {
+            engine.Wait(engine.Tick() > 0);
+            ++ticks;
+        }
+        inputAllocs = t_allocations - allocs;
+        inputTicks = ticks;
+        engine.Stop();
+    });
+    REQUIRE(test::WaitFor([&] { return warm.load(); }));
+    const int kSteps = 300;
+    int published = 0;
+    for (int i = 1; i <= kSteps; ++i) {
+        Drive(devices, i);
+        if (i % 10 == 0) {
+            Configure(engine, devices, audio, i / 10);
+            engine.Publish();
+            ++published;
+        }
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+    REQUIRE(test::WaitFor([&] { return engine.Swaps() > 0; }));
+    running = false;
+    engine.Wake();
+    input.join();
+
+    printf("  %llu ticks, %d sets published, %llu swapped in, %llu allocations\n", (unsigned long long)inputTicks.load(),
+        published, (unsigned long long)engine.Swaps(), (unsigned long long)inputAllocs.load());
+    CHECK(inputAllocs.load() == 0);
+    CHECK(inputTicks.load() > 0);
+    CHECK(engine.Swaps() >= 1 && engine.Swaps() <= (uint64_t)published);
+    CHECK(engine.Active().BindingCount() == (size_t)kDevices * 11);
+    CHECK(engine.Active().RuleCount() == 1);
+}
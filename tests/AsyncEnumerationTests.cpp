@@ -0,0 +1,136 @@
+#include "Test.h"
+#include <algorithm>
+#include <atomic>
+#include <string>
+#include "AsyncList.h"
+#include "WorkerPool.h"
+
+// Device and session lists enumerated on a worker pool by slow fake enumerators: the
+// UI-side calls never wait, and superseded requests stop early and are never shown
+// (user-015).
+
+namespace {
+typedef std::chrono::steady_clock Clock;
+
+double MsSince(Clock::time_point start) {
+    return std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+}
+
+// Stands in for a machine with many HID devices or audio sessions: takes totalMs to
+// list its items, checking for cancellation every millisecond as the real ones do
+// between devices.
+struct SlowEnumerator {
+    int totalMs;
+    std::string tag;
+    std::atomic<int> started{0}, cancelled{0};
+
+    bool operator()(std::vector<std::string>& out, const EnumCancel& cancel) {
+        ++started;
+        for (int ms = 0; ms < totalMs; ++ms) {
+            if (cancel.Cancelled()) {
+                ++cancelled;
+                return false;
+            }
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        }
+        out = { tag + "0", tag + "1", tag + "2" };
+        return true;
+    }
+};
+}
+
+TEST(UiCallsNeverWaitForASlowEnumeration) {
+    WorkerPool pool(2);
+    SlowEnumerator slow{ 300, "device" };
+    std::atomic<int> published{0};
+    AsyncList<std::string> list(pool, std::ref(slow), [&] { ++published; });
+
+    double worstMs = 0;
+    Clock::time_point start = Clock::now();
+    list.Refresh();
+    worstMs = std::max(worstMs, MsSince(start));
+    // What WM_CREATE and the Bind dialog do while the enumeration is running.
+    while (!published) {
+        Clock::time_point t = Clock::now();
+        AsyncList<std::string>::Snapshot shown = list.Current();
+        worstMs = std::max(worstMs, MsSince(t));
+        CHECK(shown && (shown->empty() || published));
+        std::this_thread::sleep_for(std::chrono::milliseconds(5));
+        REQUIRE(MsSince(start) < 5000);
+    }
+    printf("  slowest UI call %.3f ms against a %d ms enumeration\n", worstMs, slow.totalMs);
+    CHECK(worstMs < 20.0);
+    CHECK(list.Current()->size() == 3);
+    CHECK(list.PublishedRequest() == 1);
+    pool.Stop();
+}
+
+TEST(SupersededRequestsStopAndAreNeverPublished) {
+    WorkerPool pool(2);
+    SlowEnumerator slow{ 100, "session" };
+    std::atomic<int> published{0};
+    AsyncList<std::string> list(pool, std::ref(slow), [&] { ++published; });
+    uint64_t last = 0;
+    for (int i = 0; i < 5; ++i) {
+        last = list.Refresh();
+        std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    }
+    REQUIRE(test::WaitFor([&] { return list.PublishedRequest() == last; }));
+    CHECK(published.load() == 1);
+    CHECK(list.DiscardedRuns() == 4);
+    // Runs still queued when superseded are skipped without enumerating at all.
+    CHECK(slow.started.load() + (int)list.DiscardedRuns() - slow.cancelled.load() == 5);
+    CHECK(slow.cancelled.load() >= 1);
+    pool.Stop();
+}
+
+TEST(ShownSnapshotIsNotChangedByALaterRefresh) {
+    WorkerPool pool(1);
+    SlowEnumerator slow{ 1, "a" };
+    AsyncList<std::string> list(pool, std::ref(slow));
+    list.Refresh();
+    REQUIRE(test::WaitFor([&] { return list.PublishedRequest() == 1; }));
+    AsyncList<std::string>::Snapshot shown = list.Current();
+    slow.tag = "b";
+    list.Refresh();
+    REQUIRE(test::WaitFor([&] { return list.PublishedRequest() == 2; }));
+    CHECK((*shown)[0] == "a0");
+    CHECK((*list.Current())[0] == "b0");
+    pool.Stop();
+}
+
+// Closing the dialog that owns a list while its enumeration still runs: the run is
+// abandoned and nothing is published to the dead dialog.
+TEST(ListDestroyedDuringEnumerationPublishesNothing) {
+    WorkerPool pool(1);
+    SlowEnumerator slow{ 200, "x" };
+    std::atomic<int> published{0};
+    {
+        AsyncList<std::string> list(pool, std::ref(slow), [&] { ++published; });
+        list.Refresh();
+        REQUIRE(test::WaitFor([&] { return slow.started.load() == 1; }));
+    }
+    pool.Stop();    // waits for the running enumeration
+    CHECK(slow.cancelled.load() == 1);
+    CHECK(published.load() == 0);
+}
+
+TEST(StoppedPoolDropsQueuedWork) {
+    WorkerPool pool(1);
+    std::atomic<int> ran{0};
+    std::atomic<bool> started{false}, release{false};
+    pool.Submit([&] {
+        started = true;
+        while (!release) std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        ++ran;
+    });
+    REQUIRE(test::WaitFor([&] { return started.load(); }));
+    for (int i = 0; i < 10; ++i) pool.Submit([&] { ++ran; });
+    std::thread stopper([&] { pool.Stop(); });
+    std::this_thread::sleep_for(std::chrono::milliseconds(20));
+    release = true;
+    stopper.join();
+    CHECK(ran.load() == 1);
+    pool.Submit([&] { ++ran; });
+    CHECK(ran.load() == 1);
+}
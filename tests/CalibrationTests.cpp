@@ -0,0 +1,157 @@
+#include "Test.h"
+#include <stdio.h>
+#include <map>
+#include <string>
+#include <vector>
+#include "AxisCalibrator.h"
+#include "AxisTrace.h"
+#include "BindingEngine.h"
+#include "Profile.h"
+#include "TraceReplay.h"
+
+// Auto-calibration against recorded traces of the axes it is meant for: a sticky pot
+// that never reaches its ends, a noisy one with spikes, one barely moved (user-014).
+
+namespace {
+class RecordingSink : public AudioSink {
+public:
+    void SetVolume(int target, float v) override { last[target] = v; }
+    std::map<int, float> last;
+};
+
+// Records the Z axis positions as a trace file, one sample each, and loads it back.
+bool MakeTrace(const std::vector<LONG>& positions, TraceReader& out) {
+    const char* path = "calibration-test.javt";
+    {
+        TraceRecorder recorder;
+        if (!recorder.Open(path)) return false;
+        DIJOYSTATE2 js = {};
+        for (DWORD& pov : js.rgdwPOV) pov = 0xFFFFFFFF;
+        for (LONG z : positions) {
+            js.lZ = z;
+            recorder.RecordJoyState(0, js);
+        }
+    }
+    bool ok = out.Load(path);
+    remove(path);
+    return ok;
+}
+
+// Slow sweeps between low and high with a little sensor noise, ending at high.
+std::vector<LONG> Sweeps(LONG low, LONG high, int sweeps, LONG noise) {
+    std::vector<LONG> v;
+    uint32_t seed = 3;
+    for (int s = 0; s < sweeps; ++s)
+        for (int i = 0; i <= 400; ++i) {
+            seed = seed * 1664525u + 1013904223u;
+            LONG jitter = noise ? (LONG)((seed >> 8) % (2 * noise + 1)) - noise : 0;
+            double t = (s % 2 ? 400 - i : i) / 400.0;
+            LONG x = (LONG)(low + t * (high - low)) + jitter;
+            v.push_back(x < low ? low : x > high ? high : x);
+        }
+    if (sweeps % 2 == 0) v.push_back(high);
+    for (int i = 0; i < 50; ++i) v.push_back(high);     // rests at the top
+    return v;
+}
+
+struct CalibratedEngine {
+    FakeInputBackend device;
+    BindingEngine engine;
+    RecordingSink sink;
+    explicit CalibratedEngine(bool autoCalibrate) {
+        engine.SetSink(&sink);
+        int d = engine.AddDevice(&device);
+        Binding b = { d, DIJOFS_Z, 0, 0, 65535, 0.0f, 1.0f, CurveSpec{ CurveType::Linear }, {} };
+        b.autoCalibrate = autoCalibrate;
+        engine.AddBinding(b);
+    }
+    void Replay(const TraceReader& trace) { ReplayTrace(trace, engine, { &device }); }
+};
+}
+
+// The pot stops 1500 counts short of both ends; calibrated, its top is full volume.
+TEST(StickyAxisReachesTheEndsOfTheCurve) {
+    TraceReader trace;
+    REQUIRE(MakeTrace(Sweeps(1500, 63500, 6, 20), trace));
+    CalibratedEngine plain(false), calibrated(true);
+    plain.Replay(trace);
+    calibrated.Replay(trace);
+    LONG low = 0, high = 0;
+    REQUIRE(calibrated.engine.CalibratedRange(0, low, high));
+    printf("  learned %ld..%ld; top of travel: %.3f uncalibrated, %.3f calibrated\n", (long)low, (long)high,
+        plain.sink.last[0], calibrated.sink.last[0]);
+    CHECK(low >= 1500 && low <= 2500);
+    CHECK(high >= 62500 && high <= 63500);
+    CHECK(plain.sink.last[0] < 0.98f);
+    CHECK(calibrated.sink.last[0] == 1.0f);
+}
+
+// Real travel 8000..56000 with jitter, plus four one-off spikes towards the ends.
+TEST(NoisyAxisIgnoresSpikes) {
+    std::vector<LONG> samples = Sweeps(8000, 56000, 8, 60);
+    const LONG kSpikes[] = { 150, 700, 64800, 65400 };
+    for (int i = 0; i < 4; ++i) samples[300 + i * 500] = kSpikes[i];
+    TraceReader trace;
+    REQUIRE(MakeTrace(samples, trace));
+    AxisCalibrator cal;
+    for (const TraceRecord& r : trace.Records()) cal.Add(r.state.lZ);
+    REQUIRE(cal.Usable());
+    printf("  learned %ld..%ld\n", (long)cal.Min(), (long)cal.Max());
+    CHECK(cal.Min() >= 7800 && cal.Min() <= 9000);
+    CHECK(cal.Max() >= 55000 && cal.Max() <= 56200);
+    CHECK(cal.Converged());
+}
+
+// Too little travel to trust: the binding keeps its configured range.
+TEST(BarelyMovedAxisKeepsTheConfiguredRange) {
+    TraceReader trace;
+    REQUIRE(MakeTrace(Sweeps(30000, 31000, 4, 10), trace));
+    CalibratedEngine calibrated(true);
+    calibrated.Replay(trace);
+    LONG low, high;
+    CHECK(!calibrated.engine.CalibratedRange(0, low, high));
+    CHECK(calibrated.sink.last[0] > 0.46f && calibrated.sink.last[0] < 0.48f);
+}
+
+// A range saved under the device's id seeds the next run, and travel that only covers
+// part of it does not shrink it.
+TEST(PersistedRangeSeedsTheNextRun) {
+    Profile saved;
+    saved.calibrations.push_back(AxisCalibration{ "{device-guid}", DIJOFS_Z, 1500, 63500 });
+    const char* path = "calibration-test.profile";
+    REQUIRE(SaveProfile(path, saved));
+    Profile loaded;
+    bool ok = LoadProfile(path, loaded);
+    remove(path);
+    REQUIRE(ok);
+    const AxisCalibration* cal = loaded.FindCalibration("{device-guid}", DIJOFS_Z);
+    REQUIRE(cal && cal->min == 1500 && cal->max == 63500);
+    CHECK(!loaded.FindCalibration("{other-guid}", DIJOFS_Z));
+
+    CalibratedEngine next(true);
+    next.engine.SeedCalibration(0, cal->min, cal->max);
+    TraceReader trace;
+    REQUIRE(MakeTrace(Sweeps(20000, 63500, 2, 0), trace));
+    next.Replay(trace);
+    LONG low, high;
+    REQUIRE(next.engine.CalibratedRange(0, low, high));
+    CHECK(low <= 2500);    // the seed, less the margin for sticky ends
+    CHECK(high >= 62500);
+    CHECK(next.sink.last[0] == 1.0f);
+}
+
+// Hours of input in constant memory: the calibrator is a fixed-size object however wide
+// and long the stream.
+TEST(LongWideStreamStaysBoundedAndStable) {
+    AxisCalibrator cal;
+    uint32_t seed = 11;
+    int changes = 0;
+    for (int i = 0; i < 1000000; ++i) {
+        seed = seed * 1664525u + 1013904223u;
+        if (cal.Add((LONG)(seed >> 16)) && i > 100000) ++changes;
+    }
+    CHECK(cal.Usable() && cal.Converged());
+    CHECK(cal.Min() < 1024 && cal.Max() > 64511);
+    CHECK(changes == 0);
+    CHECK(cal.Samples() == 1000000);
+}
@@ -0,0 +1,133 @@
+#include "Test.h"
+#include <math.h>
+#include <vector>
+#include "VolumeCoalescer.h"
+
+// What the coalescer lets through to the audio sink, and what it saves (user-003).
+
+namespace {
+typedef VolumeCoalescer::Clock Clock;
+
+Clock::time_point g_now;
+Clock::time_point FakeNow() { return g_now; }
+void Advance(int ms) { g_now += std::chrono::milliseconds(ms); }
+
+class RecordingSink : public AudioSink {
+public:
+    struct Write {
+        int target;
+        float volume;
+    };
+    void SetVolume(int target, float v) override { writes.push_back(Write{ target, v }); }
+    std::vector<Write> writes;
+};
+
+struct Fixture {
+    RecordingSink sink;
+    VolumeCoalescer coalescer{ &sink };
+    Fixture() {
+        g_now = Clock::time_point() + std::chrono::seconds(1);
+        coalescer.SetClock(&FakeNow);
+    }
+};
+
+bool Near(float a, float b) { return fabsf(a - b) < 1e-4f; }
+}
+
+TEST(RepeatedValueIsWrittenOnce) {
+    Fixture f;
+    for (int i = 0; i < 100; ++i) {
+        f.coalescer.SetVolume(0, 0.5f);
+        Advance(20);
+    }
+    REQUIRE(f.sink.writes.size() == 1);
+    CHECK(Near(f.sink.writes[0].volume, 0.5f));
+    CHECK(f.coalescer.Requested() == 100);
+    CHECK(f.coalescer.Suppressed() == 99);
+}
+
+TEST(JitterInsideDeadbandIsDropped) {
+    Fixture f;
+    f.coalescer.SetVolume(0, 0.500f);
+    Advance(20);
+    f.coalescer.SetVolume(0, 0.501f);   // one step either way: sensor noise
+    Advance(20);
+    f.coalescer.SetVolume(0, 0.499f);
+    Advance(20);
+    CHECK(f.sink.writes.size() == 1);
+    f.coalescer.SetVolume(0, 0.502f);
+    REQUIRE(f.sink.writes.size() == 2);
+    CHECK(Near(f.sink.writes[1].volume, 0.502f));
+}
+
+TEST(EndsOfRangeAlwaysLand) {
+    Fixture f;
+    f.coalescer.SetVolume(0, 0.001f);
+    Advance(20);
+    f.coalescer.SetVolume(0, 0.0f);     // inside the deadband, but fully down must mean silent
+    Advance(20);
+    f.coalescer.SetVolume(0, 0.999f);
+    Advance(20);
+    f.coalescer.SetVolume(0, 1.0f);
+    REQUIRE(f.sink.writes.size() == 4);
+    CHECK(f.sink.writes[1].volume == 0.0f);
+    CHECK(Near(f.sink.writes[3].volume, 1.0f));
+}
+
+TEST(RateLimitHoldsTheLatestValueUntilFlush) {
+    Fixture f;
+    f.coalescer.SetVolume(0, 0.2f);
+    Advance(1);
+    f.coalescer.SetVolume(0, 0.3f);
+    Advance(1);
+    f.coalescer.SetVolume(0, 0.4f);
+    CHECK(f.sink.writes.size() == 1);
+    Advance(3);
+    uint32_t dueMs = f.coalescer.Flush();
+    CHECK(dueMs > 0 && dueMs <= 6);
+    CHECK(f.sink.writes.size() == 1);
+    Advance(5);
+    f.coalescer.Flush();
+    REQUIRE(f.sink.writes.size() == 2);
+    CHECK(Near(f.sink.writes[1].volume, 0.4f));
+    CHECK(f.coalescer.Flush() == AudioSink::kNoPendingWrites);
+}
+
+TEST(TargetsAreLimitedIndependently) {
+    Fixture f;
+    f.coalescer.SetVolume(0, 0.2f);
+    f.coalescer.SetVolume(3, 0.7f);
+    Advance(1);
+    f.coalescer.SetVolume(3, 0.8f);     // held: target 3 wrote 1 ms ago
+    REQUIRE(f.sink.writes.size() == 2);
+    CHECK(f.sink.writes[0].target == 0);
+    CHECK(f.sink.writes[1].target == 3);
+    f.coalescer.Flush(true);
+    REQUIRE(f.sink.writes.size() == 3);
+    CHECK(f.sink.writes[2].target == 3);
+    CHECK(Near(f.sink.writes[2].volume, 0.8f));
+}
+
+// A noisy 250 Hz fader sweep from bottom to top and back, then a second at rest.
+TEST(NoisySweepSavesMostWrites) {
+    Fixture f;
+    uint32_t seed = 1;
+    auto noise = [&seed] { seed = seed * 1664525u + 1013904223u; return ((int)((seed >> 16) % 5) - 2) * 0.0004f; };
+    float last = 0.0f;
+    for (int i = 0; i < 1000; ++i) {
+        float pos = i < 500 ? i / 499.0f : (999 - i) / 499.0f;
+        if (i >= 750) pos = 0.25f;
+        last = fminf(fmaxf(pos + noise(), 0.0f), 1.0f);
+        f.coalescer.SetVolume(0, last);
+        f.coalescer.Flush();
+        Advance(4);
+    }
+    f.coalescer.Flush(true);
+    uint64_t requested = f.coalescer.Requested(), written = f.coalescer.Written();
+    printf("  %llu of %llu writes reached the sink\n", (unsigned long long)written, (unsigned long long)requested);
+    CHECK(written == f.sink.writes.size());
+    CHECK(written * 2 < requested);
+    CHECK(written + f.coalescer.Suppressed() == requested);
+    REQUIRE(!f.sink.writes.empty());
+    CHECK(fabsf(f.sink.writes.back().volume - last) <= 0.0015f);
+}
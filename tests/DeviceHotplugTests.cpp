@@ -0,0 +1,186 @@
+#include "Test.h"
+#include <math.h>
+#include <algorithm>
+#include <atomic>
+#include <memory>
+#include <vector>
+#include "BindingEngine.h"
+#include "DeviceManager.h"
+#include "FakeInputBackend.h"
+
+// A fake device unplugged and plugged back in under the device manager: its bindings are
+// parked without reading it while it is gone, and reattach and write again when it
+// returns (user-016).
+
+namespace {
+typedef std::chrono::steady_clock Clock;
+
+double MsSince(Clock::time_point start) {
+    return std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+}
+
+bool IsVolumeOf(float v, LONG z) {
+    return fabsf(v - z / 65535.0f) < 1e-4f;
+}
+
+class CountingSink : public AudioSink {
+public:
+    void SetVolume(int, float v) override {
+        last.store(v);
+        writes.fetch_add(1);
+    }
+    std::atomic<float> last{-1.0f};
+    std::atomic<uint64_t> writes{0};
+};
+
+// What the opener hands the device manager: a fresh handle on the same fake device, as
+// reopening a DirectInput device yields a new object for the same hardware.
+class FakeHandle : public InputBackend {
+public:
+    explicit FakeHandle(FakeInputBackend& dev) : m_dev(dev) {}
+    bool GetJoyState(DIJOYSTATE2& js) override { return m_dev.GetJoyState(js); }
+    void SetNotify(WakeEvent* ev) override { m_dev.SetNotify(ev); }
+    bool IsEventDriven() const override { return m_dev.IsEventDriven(); }
+    uint64_t TakeChanges() override { return m_dev.TakeChanges(); }
+    bool IsPresent() const override { return m_dev.IsPresent(); }
+private:
+    FakeInputBackend& m_dev;
+};
+
+// One fake device behind a DeviceManager, bound to a volume, with the engine on its own
+// thread and the test thread standing in for the window procedure that reconciles the
+// device list when the input thread reports a loss.
+struct HotplugRig {
+    FakeInputBackend device;
+    DeviceManager manager;
+    BindingEngine engine;
+    CountingSink sink;
+    DeviceIdentity identity = { "{fake-instance}", "{fake-product}", L"\\\\?\\hid#fake", L"Fake stick" };
+    std::atomic<bool> rescan{false}, running{true};
+    std::thread input;
+
+    explicit HotplugRig(bool eventDriven) : device(eventDriven) {
+        manager.SetOpener([this](const DeviceIdentity&) { return std::unique_ptr<InputBackend>(new FakeHandle(device)); });
+        manager.SetLostHandler([this] { rescan = true; });
+        ManagedDevice* managed = manager.Track(identity, std::unique_ptr<InputBackend>(new FakeHandle(device)), identity);
+        engine.SetSink(&sink);
+        int d = engine.AddDevice(managed);
+        engine.AddBinding(Binding{ d, DIJOFS_Z, 0, 0, 65535, 0.0f, 1.0f, CurveSpec{ CurveType::Linear }, {} });
+        input = std::thread([this] { engine.Run(running); });
+    }
+    ~HotplugRig() {
+        running = false;
+        engine.Wake();
+        input.join();
+    }
+    // The device enumeration: the fake is listed while it is plugged in.
+    int Reconcile() {
+        std::vector<DeviceIdentity> attached;
+        if (device.IsPresent()) attached.push_back(identity);
+        return manager.Reconcile(attached);
+    }
+    bool MoveAndWaitForWrite(LONG z) {
+        uint64_t writes = sink.writes.load();
+        device.SetAxis(DIJOFS_Z, z);
+        return test::WaitFor([&] { return sink.writes.load() > writes && IsVolumeOf(sink.last.load(), z); });
+    }
+};
+}
+
+TEST(UnpluggedDeviceIsParkedAndNotRead) {
+    HotplugRig rig(true);
+    REQUIRE(rig.MoveAndWaitForWrite(30000));
+
+    rig.device.Unplug();
+    // The input thread finds the device gone on its next read and asks for a rescan.
+    REQUIRE(test::WaitFor([&] { return rig.rescan.load(); }));
+    rig.rescan = false;
+    CHECK(rig.Reconcile() == 0);
+    ManagedDevice* managed = rig.manager.Device(0);
+    CHECK(!managed->IsPresent());
+    CHECK(rig.manager.AnyParked());
+
+    uint64_t reads = rig.device.ReadCount(), writes = rig.sink.writes.load();
+    std::this_thread::sleep_for(std::chrono::milliseconds(50));
+    // Input arriving while parked wakes the engine, which still leaves the device alone.
+    rig.device.SetAxis(DIJOFS_Z, 50000);
+    std::this_thread::sleep_for(std::chrono::milliseconds(50));
+    CHECK(rig.device.ReadCount() == reads);
+    CHECK(rig.sink.writes.load() == writes);
+    CHECK(IsVolumeOf(rig.sink.last.load(), 30000));
+    // Nothing to match yet: the rescans the app repeats while a device is parked find nothing.
+    CHECK(rig.Reconcile() == 0);
+    CHECK(!rig.rescan.load());
+}
+
+TEST(ReplugReattachesAndWritesResume) {
+    HotplugRig rig(true);
+    REQUIRE(rig.MoveAndWaitForWrite(20000));
+    rig.device.Unplug();
+    REQUIRE(test::WaitFor([&] { return rig.rescan.load(); }));
+    rig.Reconcile();
+    rig.device.SetAxis(DIJOFS_Z, 45000);      // moved while unplugged
+
+    rig.device.Replug();
+    uint64_t writes = rig.sink.writes.load();
+    Clock::time_point reopened = Clock::now();
+    CHECK(rig.Reconcile() == 1);
+    // The first read after reattaching picks up where the axis is now.
+    REQUIRE(test::WaitFor([&] { return rig.sink.writes.load() > writes && IsVolumeOf(rig.sink.last.load(), 45000); }));
+    double reattachMs = MsSince(reopened);
+    DeviceHealth health = rig.manager.Device(0)->Health();
+    printf("  outage %.1f ms, first read %.3f ms after reopen, first write %.3f ms after reopen\n",
+        health.lastOutageMs, health.lastReattachMs, reattachMs);
+    CHECK(health.present);
+    CHECK(health.lossCount == 1 && health.reattachCount == 1);
+    CHECK(health.lastReattachMs <= reattachMs);
+    CHECK(reattachMs < 250.0);
+    CHECK(!rig.manager.AnyParked());
+    CHECK(rig.MoveAndWaitForWrite(10000));
+}
+
+// A polled device is not polled while it is gone either: the engine sleeps until the
+// device manager wakes it with the reattached device.
+TEST(PolledDeviceIsNotPolledWhileParked) {
+    HotplugRig rig(false);
+    REQUIRE(rig.MoveAndWaitForWrite(30000));
+    rig.device.Unplug();
+    REQUIRE(test::WaitFor([&] { return rig.rescan.load(); }));
+    rig.Reconcile();
+    std::this_thread::sleep_for(std::chrono::milliseconds(20));
+    uint64_t reads = rig.device.ReadCount();
+    std::this_thread::sleep_for(std::chrono::milliseconds(300));
+    CHECK(rig.device.ReadCount() == reads);
+
+    rig.device.Replug();
+    CHECK(rig.Reconcile() == 1);
+    CHECK(rig.MoveAndWaitForWrite(40000));
+    CHECK(rig.device.ReadCount() > reads);
+}
+
+// A loose cable: the device drops out and comes back over and over, and every return
+// resumes writes with the worst reattach kept in the device's health.
+TEST(FlappingDeviceReattachesEveryTime) {
+    HotplugRig rig(true);
+    REQUIRE(rig.MoveAndWaitForWrite(1000));
+    const int kCycles = 20;
+    double worstMs = 0;
+    int resumed = 0;
+    for (int i = 0; i < kCycles; ++i) {
+        rig.device.Unplug();
+        REQUIRE(test::WaitFor([&] { return rig.rescan.load(); }));
+        rig.rescan = false;
+        rig.Reconcile();
+        rig.device.Replug();
+        Clock::time_point reopened = Clock::now();
+        rig.Reconcile();
+        if (rig.MoveAndWaitForWrite(2000 + i * 3000)) ++resumed;
+        worstMs = std::max(worstMs, MsSince(reopened));
+    }
+    DeviceHealth health = rig.manager.Device(0)->Health();
+    printf("  %d cycles, worst reopen to write %.3f ms, worst reopen to read %.3f ms\n",
+        kCycles, worstMs, health.maxReattachMs);
+    CHECK(resumed == kCycles);
+    CHECK(health.lossCount == (uint32_t)kCycles && health.reattachCount == (uint32_t)kCycles);
+    CHECK(health.maxReattachMs >= health.lastReattachMs);
+}
@@ -0,0 +1,229 @@
+#include "Test.h"
+#include <string>
+#include <vector>
+#include "EndpointManager.h"
+#include "FakeEndpointProvider.h"
+#include "SessionTargetSink.h"
+
+// Targets addressed by audio endpoint on fake endpoints: every endpoint stays open, and a
+// default-device switch re-activates nothing and costs each following target one pointer
+// swap and one write, however many endpoints and sessions there are (user-020).
+
+namespace {
+std::wstring NameOf(uint32_t pid) {
+    return L"app" + std::to_wstring(pid % 10) + L".exe";
+}
+
+std::wstring OutputId(int i) {
+    return L"{0.0.0.00000000}.{output-" + std::to_wstring(i) + L"}";
+}
+
+// kOutputs render endpoints and one capture endpoint, each with ten sessions, one per app;
+// output 0 is the default. Endpoints are announced to the manager once it is started.
+struct EndpointRig {
+    static const int kOutputs = 32, kSessionsEach = 10;
+    SessionRegistry registry;
+    FakeEndpointProvider provider;
+    EndpointManager manager;
+    SessionTargetSink sink;
+    std::wstring mic = L"{0.0.1.00000000}.{mic}";
+
+    EndpointRig() : registry(&NameOf), provider(registry), manager(provider, registry), sink(registry, &manager) {
+        for (int i = 0; i < kOutputs; ++i) {
+            provider.Plug(EndpointInfo{ OutputId(i), L"Output " + std::to_wstring(i), EndpointFlow::Render });
+            for (int s = 0; s < kSessionsEach; ++s)
+                provider.AddSession(OutputId(i), L"{session-" + std::to_wstring(i) + L"-" + std::to_wstring(s) + L"}",
+                    (uint32_t)(1000 + i * kSessionsEach + s));
+        }
+        provider.Plug(EndpointInfo{ mic, L"Microphone", EndpointFlow::Capture });
+        provider.AddSession(mic, L"{session-mic}", 1003);
+        provider.SetDefault(EndpointFlow::Render, OutputId(0));
+        provider.SetDefault(EndpointFlow::Capture, mic);
+        provider.SetNotify(&manager);
+        manager.Start();
+    }
+    ~EndpointRig() {
+        sink.Clear();
+        provider.SetNotify(nullptr);
+        manager.Stop();
+    }
+    uint64_t SessionWritesOnAllEndpoints() {
+        uint64_t writes = 0;
+        for (int i = 0; i < kOutputs; ++i)
+            for (int s = 0; s < kSessionsEach; ++s)
+                writes += provider.Session(L"{session-" + std::to_wstring(i) + L"-" + std::to_wstring(s) + L"}")->Writes();
+        return writes + provider.Session(L"{session-mic}")->Writes();
+    }
+};
+}
+
+TEST(EveryEndpointIsOpenedOnceAtStart) {
+    EndpointRig rig;
+    CHECK(rig.manager.Size() == EndpointRig::kOutputs + 1);
+    CHECK(rig.manager.Activations() == EndpointRig::kOutputs + 1);
+    CHECK(rig.provider.Opens() == EndpointRig::kOutputs + 1);
+    CHECK(rig.registry.Size() == EndpointRig::kOutputs * EndpointRig::kSessionsEach + 1);
+    CHECK(rig.manager.DefaultEndpoint(EndpointFlow::Render) == OutputId(0));
+    CHECK(rig.manager.DefaultEndpoint(EndpointFlow::Capture) == rig.mic);
+    SessionInfo info;
+    REQUIRE(rig.registry.FindBySessionId(L"{session-mic}", info));
+    CHECK(info.capture && info.endpointId == rig.mic);
+}
+
+// Switching the default output round all the outputs: nothing is opened again, the session
+// table is not touched, and the only writes are the follower's volume, once per switch, on
+// the new default.
+TEST(DefaultSwitchCostsOneWritePerFollowingTarget) {
+    EndpointRig rig;
+    int system = rig.sink.AddTarget(TargetSpec{ L"", L"", true, false, L"" });
+    int pinned = rig.sink.AddTarget(TargetSpec{ L"", L"", true, false, OutputId(5) });
+    int app = rig.sink.AddTarget(TargetSpec{ L"app3.exe", L"", false, true, L"" });
+    REQUIRE(system >= 0 && pinned >= 0 && app >= 0);
+    rig.sink.SetVolume(system, 0.25f);
+    rig.sink.SetVolume(pinned, 0.75f);
+    rig.sink.SetVolume(app, 0.5f);
+
+    uint64_t activations = rig.manager.Activations(), opens = rig.provider.Opens();
+    uint64_t revision = rig.registry.Revision(), sessionWrites = rig.SessionWritesOnAllEndpoints();
+    uint64_t masterWrites[EndpointRig::kOutputs];
+    for (int i = 0; i < EndpointRig::kOutputs; ++i) masterWrites[i] = rig.provider.Master(OutputId(i))->Writes();
+
+    const int kRounds = 10;
+    for (int r = 0; r < kRounds; ++r)
+        for (int i = 1; i <= EndpointRig::kOutputs; ++i)
+            rig.provider.SetDefault(EndpointFlow::Render, OutputId(i % EndpointRig::kOutputs));
+
+    CHECK(rig.manager.Activations() == activations);
+    CHECK(rig.provider.Opens() == opens);
+    CHECK(rig.registry.Revision() == revision);
+    CHECK(rig.SessionWritesOnAllEndpoints() == sessionWrites);
+    int wrong = 0;
+    for (int i = 0; i < EndpointRig::kOutputs; ++i) {
+        // Each output became the default kRounds times, the pinned one included.
+        std::shared_ptr<FakeVolumeControl> master = rig.provider.Master(OutputId(i));
+        if (master->Writes() != masterWrites[i] + kRounds || master->Volume() != 0.25f) ++wrong;
+    }
+    CHECK(wrong == 0);
+    CHECK(rig.sink.Health(system).attached && rig.sink.Health(system).sessionCount == 1);
+    CHECK(rig.sink.Health(app).sessionCount == (uint32_t)EndpointRig::kOutputs);
+
+    // Writes after the switches go to the current default only.
+    uint64_t before = rig.provider.Master(OutputId(0))->Writes();
+    rig.sink.SetVolume(system, 0.4f);
+    CHECK(rig.provider.Master(OutputId(0))->Volume() == 0.4f);
+    CHECK(rig.provider.Master(OutputId(0))->Writes() == before + 1);
+    CHECK(rig.provider.Master(OutputId(1))->Volume() == 0.25f);
+}
+
+TEST(TargetsScopedToAnEndpointOnlyDriveIt) {
+    EndpointRig rig;
+    int pinned = rig.sink.AddTarget(TargetSpec{ L"", L"", true, false, OutputId(7) });
+    int anyOutput = rig.sink.AddTarget(TargetSpec{ L"app3.exe", L"", false, true, L"" });
+    int onMic = rig.sink.AddTarget(TargetSpec{ L"app3.exe", L"", false, true, rig.mic });
+    int onOutput2 = rig.sink.AddTarget(TargetSpec{ L"app3.exe", L"", false, true, OutputId(2) });
+    rig.sink.SetVolume(pinned, 0.6f);
+    rig.sink.SetVolume(onMic, 0.1f);
+    rig.sink.SetVolume(onOutput2, 0.2f);
+    CHECK(rig.provider.Master(OutputId(7))->Volume() == 0.6f);
+    CHECK(rig.provider.Master(OutputId(0))->Writes() == 0);
+    CHECK(rig.provider.Session(L"{session-mic}")->Volume() == 0.1f);
+    CHECK(rig.provider.Session(L"{session-2-3}")->Volume() == 0.2f);
+    CHECK(rig.provider.Session(L"{session-1-3}")->Writes() == 0);
+    // No endpoint means any output; the app's recording session is only reached through the mic.
+    CHECK(rig.sink.Health(anyOutput).sessionCount == (uint32_t)EndpointRig::kOutputs);
+    CHECK(rig.sink.Health(onMic).sessionCount == 1);
+    CHECK(rig.sink.Health(onOutput2).sessionCount == 1);
+}
+
+// Unplugging an output closes it and drops its sessions; plugging it back opens it once
+// and a target pinned to it gets its last volume again.
+TEST(RemovedEndpointDetachesAndReturns) {
+    EndpointRig rig;
+    int pinned = rig.sink.AddTarget(TargetSpec{ L"", L"", true, false, OutputId(3) });
+    int onOutput3 = rig.sink.AddTarget(TargetSpec{ L"app1.exe", L"", false, true, OutputId(3) });
+    rig.sink.SetVolume(pinned, 0.3f);
+    rig.sink.SetVolume(onOutput3, 0.9f);
+    size_t sessions = rig.registry.Size();
+    uint64_t activations = rig.manager.Activations();
+
+    rig.provider.Unplug(OutputId(3));
+    EndpointInfo info;
+    CHECK(!rig.manager.Find(OutputId(3), info));
+    CHECK(rig.registry.Size() == sessions - EndpointRig::kSessionsEach);
+    CHECK(!rig.sink.Health(pinned).attached);
+    CHECK(rig.sink.Health(onOutput3).sessionCount == 0);
+    rig.sink.SetVolume(pinned, 0.35f);      // remembered for when it is back
+
+    rig.provider.Plug(EndpointInfo{ OutputId(3), L"Output 3", EndpointFlow::Render });
+    CHECK(rig.manager.Activations() == activations + 1);
+    CHECK(rig.registry.Size() == sessions);
+    CHECK(rig.sink.Health(pinned).attached);
+    CHECK(rig.sink.Health(pinned).reattachCount == 1);
+    CHECK(rig.provider.Master(OutputId(3))->Volume() == 0.35f);
+    CHECK(rig.sink.Health(onOutput3).sessionCount == 1);
+    CHECK(rig.provider.Session(L"{session-3-1}")->Volume() == 0.9f);
+}
+
+// Opening an output reports its sessions to the registry while the manager is still opening
+// it; a registry listener that calls back into the manager must not deadlock, and neither
+// must an endpoint listener that removes itself.
+TEST(ListenersMayCallBackIntoTheManager) {
+    EndpointRig rig;
+    std::wstring extra = OutputId(EndpointRig::kOutputs);
+    rig.provider.SetNotify(nullptr);
+    rig.provider.Plug(EndpointInfo{ extra, L"Extra output", EndpointFlow::Render });
+    for (int s = 0; s < 3; ++s) rig.provider.AddSession(extra, L"{session-extra-" + std::to_wstring(s) + L"}", (uint32_t)(5000 + s));
+    rig.provider.SetNotify(&rig.manager);
+
+    int sessionsSeen = 0;
+    size_t sizeSeen = 0;
+    int sessionListener = rig.registry.AddListener([&](const SessionInfo& info, bool added) {
+        if (!added || info.endpointId != extra) return;
+        sizeSeen = rig.manager.Size();
+        ++sessionsSeen;
+    });
+    int endpointEvents = 0, endpointListener = 0;
+    endpointListener = rig.manager.AddListener([&](const EndpointEvent&) {
+        ++endpointEvents;
+        rig.manager.RemoveListener(endpointListener);
+    });
+
+    rig.manager.OnEndpointAdded(extra);
+    CHECK(sessionsSeen == 3);
+    CHECK(sizeSeen == (size_t)EndpointRig::kOutputs + 1);    // not listed until it is open
+    CHECK(rig.manager.Size() == (size_t)EndpointRig::kOutputs + 2);
+    CHECK(endpointEvents == 1);
+    rig.provider.Unplug(extra);
+    CHECK(endpointEvents == 1);
+    rig.registry.RemoveListener(sessionListener);
+}
+
+// An output unplugged while the manager is opening it is closed again once the open
+// returns, and its sessions do not stay behind.
+TEST(EndpointRemovedWhileOpeningIsClosedAgain) {
+    EndpointRig rig;
+    std::wstring extra = OutputId(EndpointRig::kOutputs);
+    rig.provider.SetNotify(nullptr);
+    rig.provider.Plug(EndpointInfo{ extra, L"Extra output", EndpointFlow::Render });
+    rig.provider.AddSession(extra, L"{session-extra}", 5000);
+    rig.provider.SetNotify(&rig.manager);
+    int listener = rig.registry.AddListener([&](const SessionInfo& info, bool added) {
+        if (added && info.endpointId == extra) rig.provider.Unplug(extra);
+    });
+    size_t sessions = rig.registry.Size();
+    uint64_t activations = rig.manager.Activations();
+
+    rig.manager.OnEndpointAdded(extra);
+    rig.registry.RemoveListener(listener);
+    EndpointInfo info;
+    CHECK(!rig.manager.Find(extra, info));
+    CHECK(rig.manager.Activations() == activations + 1);
+    CHECK(rig.registry.Size() == sessions);
+    SessionInfo session;
+    CHECK(!rig.registry.FindBySessionId(L"{session-extra}", session));
+
+    // Plugged back in, it opens normally.
+    rig.provider.Plug(EndpointInfo{ extra, L"Extra output", EndpointFlow::Render });
+    CHECK(rig.manager.Find(extra, info));
+    CHECK(rig.registry.Size() == sessions + 1);
+}
@@ -0,0 +1,151 @@
+#include "Test.h"
+#include <math.h>
+#include <atomic>
+#include <vector>
+#include "AudioExecutor.h"
+#include "SpscQueue.h"
+#include "VolumeRamp.h"
+
+// The SPSC queue and the audio executor under a producer thread writing as fast as it
+// can: nothing is lost, reordered or torn, and each target ends on the last value
+// written to it (user-021).
+
+namespace {
+// Carries its own check so a torn slot shows up.
+struct Command {
+    uint32_t seq;
+    uint32_t check;
+};
+
+// Records every write the ramp makes, on the executor thread.
+class RecordingSink : public AudioSink {
+public:
+    explicit RecordingSink(int targets) : writes(targets) {}
+    void SetVolume(int target, float v) override {
+        if (std::this_thread::get_id() != executor) ++offThread;
+        writes[target].push_back(v);
+        last.store(v);
+        ++count;
+    }
+    std::vector<std::vector<float>> writes;
+    std::thread::id executor;
+    int offThread = 0;
+    std::atomic<float> last{-1.0f};
+    std::atomic<uint64_t> count{0};
+};
+}
+
+TEST(QueueKeepsOrderUnderContention) {
+    // A small ring wraps constantly and keeps both sides running into full and empty.
+    static SpscQueue<Command, 8> queue;
+    const uint32_t kCount = 2000000;
+    std::thread producer([&] {
+        for (uint32_t i = 0; i < kCount; ++i)
+            while (!queue.Push(Command{ i, ~i })) std::this_thread::yield();
+    });
+    uint32_t expected = 0, outOfOrder = 0, torn = 0;
+    uint64_t emptyPolls = 0;
+    Command c;
+    while (expected < kCount) {
+        if (!queue.Pop(c)) {
+            ++emptyPolls;
+            std::this_thread::yield();
+            continue;
+        }
+        if (c.check != ~c.seq) ++torn;
+        if (c.seq != expected) ++outOfOrder;
+        expected = c.seq + 1;
+    }
+    producer.join();
+    printf("  %u commands through an 8-slot ring, %llu empty polls\n", kCount, (unsigned long long)emptyPolls);
+    CHECK(torn == 0);
+    CHECK(outOfOrder == 0);
+    CHECK(queue.Empty());
+    CHECK(!queue.Pop(c));
+}
+
+TEST(QueueRefusesWhenFullAndEmpty) {
+    SpscQueue<uint16_t, 4> queue;
+    uint16_t v;
+    CHECK(!queue.Pop(v));
+    for (uint16_t i = 0; i < 4; ++i) CHECK(queue.Push(i));
+    CHECK(!queue.Push(99));
+    REQUIRE(queue.Pop(v));
+    CHECK(v == 0);
+    CHECK(queue.Push(4));
+    for (uint16_t i = 1; i <= 4; ++i) {
+        REQUIRE(queue.Pop(v));
+        CHECK(v == i);
+    }
+    CHECK(queue.Empty());
+}
+
+// One producer sweeps 64 targets upwards in an interleaved order, far faster than the
+// ramp writes. Every target must end exactly on its last value, no write may go back to
+// an older value, and only the executor thread may touch the sink.
+TEST(LastValueWinsPerTargetUnderStress) {
+    const int kTargets = 64, kValuesEach = 20000;
+    RecordingSink sink(kTargets);
+    VolumeRamp ramp(&sink);
+    AudioExecutor executor(ramp);
+    executor.Start();
+    executor.Invoke([&] { sink.executor = std::this_thread::get_id(); });
+
+    std::thread producer([&] {
+        for (int k = 1; k <= kValuesEach; ++k) {
+            for (int t = 0; t < kTargets; ++t) {
+                int target = (t * 37 + k) % kTargets;
+                executor.SetVolume(target, (float)k / kValuesEach * (0.5f + target / 128.0f));
+            }
+            // Let ramp steps land in between, even on a single core.
+            if (k % 200 == 0) std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        }
+    });
+    producer.join();
+    executor.Stop();    // lands the ramp on the last values
+
+    uint64_t commands = (uint64_t)kTargets * kValuesEach;
+    printf("  %llu commands, %llu collapsed, %llu wakeups, %llu sink writes\n", (unsigned long long)executor.Commands(),
+        (unsigned long long)executor.Collapsed(), (unsigned long long)executor.Wakeups(), (unsigned long long)sink.count.load());
+    CHECK(executor.Commands() == commands);
+    CHECK(executor.Collapsed() > 0);
+    CHECK(sink.count.load() < commands);
+    CHECK(sink.offThread == 0);
+    int wrongFinal = 0, backwards = 0;
+    for (int t = 0; t < kTargets; ++t) {
+        const std::vector<float>& w = sink.writes[t];
+        if (w.empty() || w.back() != 0.5f + t / 128.0f) ++wrongFinal;
+        for (size_t i = 1; i < w.size(); ++i)
+            if (w[i] < w[i - 1]) ++backwards;
+    }
+    CHECK(wrongFinal == 0);
+    CHECK(backwards == 0);
+}
+
+// The producer only signals the executor when it is asleep: writes spaced out enough for
+// the ramp to come to rest each cost one wakeup, a burst costs at most one.
+TEST(ProducerWakesOnlyASleepingExecutor) {
+    RecordingSink sink(1);
+    VolumeRamp ramp(&sink);
+    AudioExecutor executor(ramp);
+    executor.Start();
+    executor.Invoke([&] { sink.executor = std::this_thread::get_id(); });
+    std::this_thread::sleep_for(std::chrono::milliseconds(20));
+
+    const int kSpaced = 10;
+    uint64_t wakeups = executor.Wakeups();
+    for (int i = 1; i <= kSpaced; ++i) {
+        float v = i * 0.01f;
+        executor.SetVolume(0, v);
+        CHECK(test::WaitFor([&] { return fabsf(sink.last.load() - v) < 1e-6f; }));
+        std::this_thread::sleep_for(std::chrono::milliseconds(20));
+    }
+    CHECK(executor.Wakeups() == wakeups + kSpaced);
+
+    wakeups = executor.Wakeups();
+    for (int i = 0; i < 1000; ++i) executor.SetVolume(0, i / 1000.0f);
+    executor.Stop();
+    CHECK(executor.Wakeups() <= wakeups + 1);
+    CHECK(sink.writes[0].back() == 0.999f);
+    CHECK(sink.offThread == 0);
+}
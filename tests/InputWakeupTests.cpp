@@ -0,0 +1,92 @@
+#include "Test.h"
+#include <math.h>
+#include <algorithm>
+#include <atomic>
+#include <vector>
+#include "BindingEngine.h"
+#include "FakeInputBackend.h"
+
+// The input thread on a scripted fake device: asleep while nothing moves, awake as soon
+// as something does (user-001).
+
+namespace {
+typedef std::chrono::steady_clock Clock;
+
+class CountingSink : public AudioSink {
+public:
+    void SetVolume(int, float v) override {
+        last.store(v);
+        writes.fetch_add(1);
+    }
+    std::atomic<float> last{-1.0f};
+    std::atomic<uint64_t> writes{0};
+};
+
+struct RunningEngine {
+    BindingEngine engine;
+    CountingSink sink;
+    std::atomic<bool> running{true};
+    std::thread thread;
+
+    explicit RunningEngine(FakeInputBackend& device) {
+        engine.SetSink(&sink);
+        int d = engine.AddDevice(&device);
+        engine.AddBinding(Binding{ d, DIJOFS_Z, 0, 0, 65535, 0.0f, 1.0f, CurveSpec{ CurveType::Linear }, {} });
+        thread = std::thread([this] { engine.Run(running); });
+    }
+    ~RunningEngine() {
+        running = false;
+        engine.Wake();
+        thread.join();
+    }
+};
+}
+
+TEST(IdleEventDrivenDeviceIsNeverRead) {
+    FakeInputBackend device(true);
+    RunningEngine run(device);
+    REQUIRE(test::WaitFor([&] { return run.sink.writes.load() > 0; }));
+    std::this_thread::sleep_for(std::chrono::milliseconds(50));
+    uint64_t reads = device.ReadCount(), writes = run.sink.writes.load();
+    std::this_thread::sleep_for(std::chrono::milliseconds(300));
+    CHECK(device.ReadCount() == reads);
+    CHECK(run.sink.writes.load() == writes);
+}
+
+TEST(AxisChangeReachesSinkWithoutPollDelay) {
+    FakeInputBackend device(true);
+    RunningEngine run(device);
+    REQUIRE(test::WaitFor([&] { return run.sink.writes.load() > 0; }));
+    std::vector<double> latencyMs;
+    for (int i = 0; i < 20; ++i) {
+        uint64_t writes = run.sink.writes.load();
+        Clock::time_point changed = Clock::now();
+        device.SetAxis(DIJOFS_Z, i % 2 ? 60000 : 5000);
+        REQUIRE(test::WaitFor([&] { return run.sink.writes.load() > writes; }));
+        latencyMs.push_back(std::chrono::duration<double, std::milli>(Clock::now() - changed).count());
+        std::this_thread::sleep_for(std::chrono::milliseconds(5));
+    }
+    std::sort(latencyMs.begin(), latencyMs.end());
+    // The old loop polled every 40 ms, 20 ms late on average.
+    printf("  latency p50 %.2f ms, max %.2f ms\n", latencyMs[10], latencyMs.back());
+    CHECK(latencyMs[10] < 10.0);
+    CHECK(fabsf(run.sink.last.load() - 60000 / 65535.0f) < 0.001f);
+}
+
+TEST(PolledDeviceBacksOffWhileIdle) {
+    FakeInputBackend device(false);
+    RunningEngine run(device);
+    REQUIRE(test::WaitFor([&] { return run.sink.writes.load() > 0; }));
+    std::this_thread::sleep_for(std::chrono::milliseconds(500));
+    uint64_t reads = device.ReadCount();
+    std::this_thread::sleep_for(std::chrono::milliseconds(500));
+    reads = device.ReadCount() - reads;
+    // Backed off to the 100 ms ceiling: about five reads, not the hundred a 5 ms poll makes.
+    printf("  %llu reads in 500 ms idle\n", (unsigned long long)reads);
+    CHECK(reads >= 2 && reads <= 12);
+
+    uint64_t writes = run.sink.writes.load();
+    device.SetAxis(DIJOFS_Z, 65535);
+    CHECK(test::WaitFor([&] { return run.sink.writes.load() > writes; }, 500));
+    CHECK(run.sink.last.load() == 1.0f);
+}
@@ -0,0 +1,146 @@
+#include "Test.h"
+#include <string>
+#include <vector>
+#include "BindingEngine.h"
+#include "FakeInputBackend.h"
+#include "LatencyStats.h"
+#include "SessionRegistry.h"
+#include "SessionTargetSink.h"
+#include "VolumeCoalescer.h"
+
+// The latency histograms, and the stage timers and counters the pipeline feeds them,
+// driven through fake devices and sessions (user-012).
+
+namespace {
+class NullControl : public SessionControl {
+public:
+    bool SetVolume(float) override { return true; }
+};
+
+bool WithinBucketError(uint64_t value, uint64_t expected) {
+    return value >= expected && value <= expected + expected / 16 + 1;
+}
+}
+
+TEST(PercentilesAreWithinOneBucket) {
+    LatencyHistogram h;
+    for (uint64_t us = 1; us <= 10000; ++us) h.Record(us * 1000);
+    CHECK(h.Count() == 10000);
+    CHECK(h.Max() == 10000000);
+    CHECK(WithinBucketError(h.Percentile(0.50), 5000000));
+    CHECK(WithinBucketError(h.Percentile(0.99), 9900000));
+    CHECK(h.Percentile(1.0) == h.Max());
+    CHECK(h.Mean() > 5000000 * 0.99 && h.Mean() < 5001000 * 1.01);
+    h.Reset();
+    CHECK(h.Count() == 0 && h.Max() == 0 && h.Percentile(0.5) == 0);
+}
+
+// 2^40 ns is about 18 minutes: a stage stalled that long must not write past the buckets.
+TEST(OutOfRangeValuesLandInTheLastBucket) {
+    LatencyHistogram h;
+    h.Record(1ull << 40);
+    h.Record((1ull << 41) + 12345);
+    CHECK(h.Count() == 2);
+    CHECK(h.Max() == (1ull << 41) + 12345);
+    CHECK(h.Percentile(1.0) == h.Max());
+}
+
+TEST(BucketsCoverTheRangeInOrder) {
+    uint64_t previous = 0;
+    int misplaced = 0;
+    for (int b = 0; b < LatencyHistogram::kBuckets; ++b) {
+        uint64_t upper = LatencyHistogram::BucketUpperBound(b);
+        if (upper <= previous && b > 0) ++misplaced;
+        if (LatencyHistogram::BucketOf(upper) != b) ++misplaced;
+        previous = upper;
+    }
+    CHECK(misplaced == 0);
+    CHECK(LatencyHistogram::BucketOf(0) == 0);
+    // The top of the range and everything above it land in the last bucket.
+    CHECK(LatencyHistogram::BucketOf((1ull << 40) - 1) == LatencyHistogram::kBuckets - 1);
+    CHECK(LatencyHistogram::BucketOf(1ull << 40) < LatencyHistogram::kBuckets);
+    CHECK(LatencyHistogram::BucketOf(1ull << 40) == LatencyHistogram::kBuckets - 1);
+    CHECK(LatencyHistogram::BucketOf(~0ull) == LatencyHistogram::kBuckets - 1);
+}
+
+TEST(ConcurrentRecordsAreAllCounted) {
+    LatencyHistogram h;
+    const int kThreads = 4, kRecords = 100000;
+    std::vector<std::thread> threads;
+    for (int t = 0; t < kThreads; ++t)
+        threads.emplace_back([&h, t] {
+            for (int i = 0; i < kRecords; ++i) h.Record((uint64_t)(t * kRecords + i));
+        });
+    for (std::thread& t : threads) t.join();
+    CHECK(h.Count() == (uint64_t)kThreads * kRecords);
+    CHECK(h.Max() == (uint64_t)kThreads * kRecords - 1);
+}
+
+// Two devices, two bindings: one target with a live session, one whose app is not
+// running. Every stage the engine times and every counter on the path must move.
+TEST(PipelineFillsStagesAndCounters) {
+    SessionRegistry registry([](uint32_t pid) { return std::wstring(pid == 1 ? L"game.exe" : L"other.exe"); });
+    registry.OnSessionAdded(L"s1", 1, L"", std::make_shared<NullControl>());
+    SessionTargetSink sink(registry, nullptr);
+    int live = sink.AddTarget(TargetSpec{ L"game.exe", L"", false, false, L"" });
+    int absent = sink.AddTarget(TargetSpec{ L"music.exe", L"", false, false, L"" });
+    VolumeCoalescer coalescer(&sink, CoalescerSettings{ 0.001f, 1, 0 });
+    FakeInputBackend devices[2];
+    BindingEngine engine;
+    engine.SetSink(&coalescer);
+    int d0 = engine.AddDevice(&devices[0]), d1 = engine.AddDevice(&devices[1]);
+    Binding filtered = { d0, DIJOFS_Z, live, 0, 65535, 0.0f, 1.0f, CurveSpec{ CurveType::AudioTaper }, {} };
+    filtered.filters = { { FilterType::MovingAverage, 4 } };
+    engine.AddBinding(filtered);
+    engine.AddBinding(Binding{ d1, DIJOFS_X, absent, 0, 65535, 0.0f, 1.0f, CurveSpec{ CurveType::Linear }, {} });
+
+    ResetLatencyStats();
+    engine.Start();
+    const int kTicks = 200;
+    for (int i = 0; i < kTicks; ++i) {
+        devices[0].SetAxis(DIJOFS_Z, (i / 2) * 300);    // every other tick repeats a value
+        if (i % 10 == 0) devices[1].SetAxis(DIJOFS_X, i * 300);
+        engine.Tick(i * 0.004);
+    }
+    engine.Stop();
+    LatencySnapshot snap = GetLatencyStats();
+    sink.Clear();
+
+#if JAVC_LATENCY_STATS
+    const uint64_t* c = snap.counters;
+    CHECK(c[(int)StatCounter::Ticks] == kTicks);
+    CHECK(c[(int)StatCounter::DeviceReads] == engine.DeviceReads());
+    CHECK(c[(int)StatCounter::DeviceReads] < kTicks);     // repeats wake nothing
+    CHECK(c[(int)StatCounter::WritesRequested] > 0);
+    CHECK(c[(int)StatCounter::WritesSuppressed] > 0);
+    CHECK(c[(int)StatCounter::WritesRequested] == c[(int)StatCounter::WritesSuppressed] + coalescer.Written());
+    CHECK(c[(int)StatCounter::SessionWrites] > 0);
+    CHECK(c[(int)StatCounter::WritesDropped] > 0);
+    const Stage kEngineStages[] = { Stage::DeviceRead, Stage::Filter, Stage::Map, Stage::SinkWrite, Stage::Tick };
+    for (Stage s : kEngineStages) {
+        const StageSummary& st = snap.stages[(int)s];
+        CHECK(st.count > 0);
+        CHECK(st.p50Ns <= st.p99Ns && st.p99Ns <= st.maxNs);
+    }
+    CHECK(snap.stages[(int)Stage::Tick].count == kTicks);
+    CHECK(snap.tickRate > 0);
+#else
+    // Compiled out: the hooks cost nothing and the query reports zeros.
+    for (uint64_t c : snap.counters) CHECK(c == 0);
+    for (const StageSummary& st : snap.stages) CHECK(st.count == 0);
+#endif
+}
+
+TEST(DumpListsEveryStageAndCounter) {
+    FILE* f = tmpfile();
+    REQUIRE(f);
+    DumpLatencyStats(f);
+    std::string text;
+    rewind(f);
+    char buf[512];
+    while (size_t n = fread(buf, 1, sizeof(buf), f)) text.append(buf, n);
+    fclose(f);
+    for (int i = 0; i < (int)Stage::Count; ++i) CHECK(text.find(StageName((Stage)i)) != std::string::npos);
+    for (int i = 0; i < (int)StatCounter::Count; ++i) CHECK(text.find(StatCounterName((StatCounter)i)) != std::string::npos);
+    CHECK(text.find("ticks/s") != std::string::npos);
+}
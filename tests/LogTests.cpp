@@ -0,0 +1,48 @@
+#include "Test.h"
+#include <mutex>
+#include <string>
+#include "log.h"
+
+// String arguments of the binary logger come out of the drain thread whole, as long as
+// they fit in the record (user-011).
+
+namespace {
+std::mutex g_mutex;
+std::string g_output;
+
+void Capture(const char* text, size_t len) {
+    std::lock_guard<std::mutex> lock(g_mutex);
+    g_output.append(text, len);
+}
+
+// Logs through the real ring and drain thread and returns what was written.
+template<typename... Args> std::string Logged(const char* fmt, const Args&... args) {
+    {
+        std::lock_guard<std::mutex> lock(g_mutex);
+        g_output.clear();
+    }
+    SetLogOutput(&Capture);
+    LogWrite(LogLevel::Warn, fmt, args...);
+    FlushLog();
+    SetLogOutput(nullptr);
+    std::lock_guard<std::mutex> lock(g_mutex);
+    return g_output;
+}
+}
+
+TEST(GuidArgumentsRoundTrip) {
+    const char* guid = "{01234567-89ab-cdef-0123-456789abcdef}";
+    std::string out = Logged("Session %s on %s", guid, guid);
+    CHECK(out.find("Session {01234567-89ab-cdef-0123-456789abcdef} on {01234567-89ab-cdef-0123-456789abcdef}") != std::string::npos);
+}
+
+TEST(LongStringsAreTruncatedToTheRecord) {
+    std::string path(400, 'x');
+    std::string out = Logged("Cannot open %s: errno %d", path.c_str(), 2);
+    CHECK(out.find(std::string(kLogStringBytes - 1, 'x') + ": errno 2") != std::string::npos);
+    CHECK(out.find(std::string(kLogStringBytes, 'x')) == std::string::npos);
+
+    // A string after a full buffer formats as empty; the other arguments are intact.
+    out = Logged("%s|%s|%d", path.c_str(), "next", 7);
+    CHECK(out.find("x||7") != std::string::npos);
+}
@@ -0,0 +1,209 @@
+#include "Test.h"
+#include <atomic>
+#include <map>
+#include <set>
+#include <string>
+#include <vector>
+#include "SessionRegistry.h"
+#include "SessionTargetSink.h"
+
+// The session registry under a fake notification source churning hundreds of sessions:
+// indexes, the change log and listeners all agree with a model of what is live (user-005).
+
+namespace {
+class NullControl : public SessionControl {
+public:
+    bool SetVolume(float) override { return true; }
+};
+
+// Process names by PID: ten apps, each with a range of PIDs.
+std::wstring NameOf(uint32_t pid) {
+    return L"app" + std::to_wstring(pid % 10) + L".exe";
+}
+
+// Deterministic stream of session created/expired notifications over a fixed pool of ids.
+struct FakeSessionSource {
+    static const int kSessions = 300, kPids = 60;
+    uint32_t seed = 7;
+    std::map<std::wstring, uint32_t> live;     // session id -> pid
+    uint64_t pidArrivals = 0;                   // times a PID went from no sessions to some
+
+    uint32_t Next() { seed = seed * 1664525u + 1013904223u; return seed >> 8; }
+    size_t SessionsOf(uint32_t pid) const {
+        size_t n = 0;
+        for (const auto& s : live) n += s.second == pid;
+        return n;
+    }
+    // One notification, delivered to the registry.
+    void Step(SessionRegistry& registry) {
+        int n = (int)(Next() % kSessions);
+        std::wstring id = L"{session-" + std::to_wstring(n) + L"}";
+        if (live.count(id)) {
+            live.erase(id);
+            registry.OnSessionRemoved(id);
+        } else {
+            uint32_t pid = 1000 + (uint32_t)(n % kPids);
+            if (!SessionsOf(pid)) ++pidArrivals;
+            live[id] = pid;
+            registry.OnSessionAdded(id, pid, L"", std::make_shared<NullControl>());
+        }
+    }
+};
+
+void CheckMatchesModel(const SessionRegistry& registry, const FakeSessionSource& source) {
+    CHECK(registry.Size() == source.live.size());
+    size_t mismatched = 0;
+    for (const auto& s : source.live) {
+        SessionInfo info;
+        if (!registry.FindBySessionId(s.first, info) || info.pid != s.second || info.processName != NameOf(s.second))
+            ++mismatched;
+    }
+    CHECK(mismatched == 0);
+    for (uint32_t app = 0; app < 10; ++app) {
+        std::vector<SessionInfo> found;
+        registry.FindByName(L"APP" + std::to_wstring(app) + L".EXE", L"", found);
+        size_t expected = 0;
+        for (const auto& s : source.live) expected += s.second % 10 == app;
+        CHECK(found.size() == expected);
+    }
+    for (uint32_t pid = 1000; pid < 1000 + FakeSessionSource::kPids; ++pid) {
+        SessionInfo info;
+        CHECK(registry.FindByPid(pid, info) == (source.SessionsOf(pid) > 0));
+    }
+}
+}
+
+TEST(ChurnKeepsEveryIndexConsistent) {
+    std::atomic<uint64_t> resolves{0};
+    SessionRegistry registry([&](uint32_t pid) { ++resolves; return NameOf(pid); });
+    FakeSessionSource source;
+    for (int round = 0; round < 20; ++round) {
+        for (int i = 0; i < 1000; ++i) source.Step(registry);
+        CheckMatchesModel(registry, source);
+    }
+    // One name lookup per process for as long as it has sessions.
+    CHECK(registry.NameLookups() == resolves.load());
+    CHECK(resolves.load() == source.pidArrivals);
+    printf("  %zu live sessions, %llu name lookups for 20000 notifications\n", source.live.size(),
+        (unsigned long long)resolves.load());
+}
+
+// A reader that keeps its own list current from ChangesSince, as the session list in the
+// UI does, ends up with the same sessions as a full snapshot.
+TEST(ChangesSinceKeepsACopyInSync) {
+    SessionRegistry registry(&NameOf);
+    FakeSessionSource source;
+    std::set<std::wstring> copy;
+    uint64_t rev = registry.Revision();
+    int resyncs = 0;
+    for (int round = 0; round < 50; ++round) {
+        for (int i = 0; i < 37; ++i) source.Step(registry);
+        std::vector<SessionInfo> added;
+        std::vector<std::wstring> removed;
+        if (registry.ChangesSince(rev, added, removed, rev)) {
+            for (const std::wstring& id : removed) copy.erase(id);
+            for (const SessionInfo& s : added) copy.insert(s.sessionId);
+        } else {
+            ++resyncs;
+        }
+        std::vector<SessionInfo> all;
+        registry.Snapshot(all, false);
+        std::set<std::wstring> expected;
+        for (const SessionInfo& s : all) {
+            expected.insert(s.sessionId);
+            CHECK(!s.control);
+        }
+        CHECK(copy == expected);
+    }
+    CHECK(resyncs == 0);
+}
+
+TEST(ListenersSeeEveryChangeFromConcurrentSources) {
+    SessionRegistry registry(&NameOf);
+    std::atomic<int64_t> live{0};
+    std::atomic<uint64_t> notifications{0};
+    registry.AddListener([&](const SessionInfo&, bool added) {
+        live += added ? 1 : -1;
+        ++notifications;
+    });
+    // Four notification threads, as WASAPI delivers them, each churning its own sessions.
+    const int kThreads = 4, kOps = 5000;
+    std::vector<std::thread> threads;
+    for (int t = 0; t < kThreads; ++t) {
+        threads.emplace_back([&registry, t] {
+            std::set<int> mine;
+            uint32_t seed = 100 + t;
+            for (int i = 0; i < kOps; ++i) {
+                seed = seed * 1664525u + 1013904223u;
+                int n = (int)((seed >> 8) % 100);
+                std::wstring id = std::to_wstring(t) + L"/" + std::to_wstring(n);
+                if (mine.erase(n)) {
+                    registry.OnSessionRemoved(id);
+                } else {
+                    mine.insert(n);
+                    registry.OnSessionAdded(id, 1000 + (uint32_t)n, L"", std::make_shared<NullControl>());
+                }
+            }
+        });
+    }
+    for (std::thread& t : threads) t.join();
+    CHECK(notifications.load() == (uint64_t)kThreads * kOps);
+    CHECK(live.load() == (int64_t)registry.Size());
+
+    registry.Clear();
+    CHECK(registry.Size() == 0);
+    CHECK(live.load() == 0);
+}
+
+TEST(RemoveListenerWaitsForCallsUnderWay) {
+    SessionRegistry registry(&NameOf);
+    std::atomic<bool> entered{false}, release{false}, removed{false};
+    int id = registry.AddListener([&](const SessionInfo&, bool) {
+        entered = true;
+        while (!release) std::this_thread::yield();
+    });
+    std::thread source([&] { registry.OnSessionAdded(L"{a}", 1, L"", std::make_shared<NullControl>()); });
+    REQUIRE(test::WaitFor([&] { return entered.load(); }));
+    std::thread remover([&] { registry.RemoveListener(id); removed = true; });
+    CHECK(!test::WaitFor([&] { return removed.load(); }, 100));
+    release = true;
+    source.join();
+    remover.join();
+    CHECK(removed.load());
+
+    // Gone for good: later notifications do not reach it.
+    entered = false;
+    registry.OnSessionRemoved(L"{a}");
+    CHECK(!entered.load());
+}
+
+TEST(ListenerMayRemoveItself) {
+    SessionRegistry registry(&NameOf);
+    int calls = 0, id = 0;
+    id = registry.AddListener([&](const SessionInfo&, bool) {
+        ++calls;
+        registry.RemoveListener(id);
+    });
+    registry.OnSessionAdded(L"{a}", 1, L"", std::make_shared<NullControl>());
+    registry.OnSessionRemoved(L"{a}");
+    CHECK(calls == 1);
+}
+
+// Sinks come and go (binding-set swaps) while notification threads churn sessions: a sink's
+// destructor must not return while one of its listeners is still running.
+TEST(SinksDestroyedDuringChurnAreNeverCalledAfterwards) {
+    SessionRegistry registry(&NameOf);
+    std::atomic<bool> stop{false};
+    std::thread source([&] {
+        FakeSessionSource fake;
+        while (!stop) fake.Step(registry);
+    });
+    TargetSpec spec = { L"app3.exe", L"", false, true, L"" };
+    for (int i = 0; i < 500; ++i) {
+        std::unique_ptr<SessionTargetSink> sink(new SessionTargetSink(registry, nullptr));
+        int target = sink->AddTarget(spec);
+        sink->SetVolume(target, 0.5f);
+    }
+    stop = true;
+    source.join();
+}
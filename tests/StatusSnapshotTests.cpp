@@ -0,0 +1,135 @@
+#include "Test.h"
+#include <atomic>
+#include <mutex>
+#include "BindingEngine.h"
+#include "FakeInputBackend.h"
+#include "SnapshotSlot.h"
+
+// The input thread hands its status to the UI through a SnapshotSlot and never waits on
+// the UI; a stalled UI sees the latest status once it comes back (user-004).
+
+namespace {
+struct Status {
+    uint64_t seq;
+    LONG axisRaw;
+    float volume;
+};
+
+class CountingSink : public AudioSink {
+public:
+    void SetVolume(int, float v) override {
+        last.store(v);
+        writes.fetch_add(1);
+    }
+    std::atomic<float> last{-1.0f};
+    std::atomic<uint64_t> writes{0};
+};
+}
+
+TEST(InputLoopKeepsRunningWhileConsumerStalls) {
+    FakeInputBackend device(true);
+    BindingEngine engine;
+    CountingSink sink;
+    engine.SetSink(&sink);
+    int d = engine.AddDevice(&device);
+    engine.AddBinding(Binding{ d, DIJOFS_Z, 0, 0, 65535, 0.0f, 1.0f, CurveSpec{ CurveType::Linear }, {} });
+    SnapshotSlot<Status> slot;
+    std::atomic<bool> running{true};
+    std::atomic<uint64_t> published{0};
+
+    // The polling thread as main.cpp runs it: tick, publish what changed, wait.
+    std::thread input([&] {
+        engine.Start();
+        uint64_t seq = 0;
+        while (running) {
+            int changed = engine.Tick();
+            if (changed) {
+                const BindingStatus& st = engine.Status(0);
+                slot.Publish(Status{ ++seq, st.axisRaw, st.volume });
+                published = seq;
+            }
+            engine.Wait(changed > 0);
+        }
+        engine.Stop();
+    });
+    // The UI thread: renders at display rate, except while it is stuck (here: a modal
+    // dialog, modelled by a lock the test holds).
+    std::mutex modal;
+    std::atomic<uint64_t> rendered{0};
+    std::atomic<LONG> renderedAxis{-1};
+    std::thread ui([&] {
+        Status s;
+        while (running) {
+            { std::lock_guard<std::mutex> lock(modal); }
+            if (slot.Read(s)) {
+                rendered = s.seq;
+                renderedAxis = s.axisRaw;
+            }
+            std::this_thread::sleep_for(std::chrono::milliseconds(16));
+        }
+    });
+
+    REQUIRE(test::WaitFor([&] { return rendered.load() > 0; }));
+    {
+        std::lock_guard<std::mutex> lock(modal);
+        std::this_thread::sleep_for(std::chrono::milliseconds(30));
+        uint64_t renderedBefore = rendered.load(), writes = sink.writes.load();
+        for (int i = 1; i <= 20; ++i) {
+            device.SetAxis(DIJOFS_Z, i * 3000);
+            CHECK(test::WaitFor([&] { return sink.writes.load() >= writes + i; }, 500));
+        }
+        CHECK(rendered.load() == renderedBefore);
+        CHECK(published.load() >= renderedBefore + 20);
+    }
+    // Back from the stall: the UI skips the intermediate states and shows the newest.
+    CHECK(test::WaitFor([&] { return rendered.load() == published.load(); }));
+    CHECK(renderedAxis.load() == 60000);
+
+    running = false;
+    engine.Wake();
+    input.join();
+    ui.join();
+}
+
+TEST(ReadReturnsFalseUntilSomethingNewIsPublished) {
+    SnapshotSlot<Status> slot;
+    Status s = { 99, 0, 0.0f };
+    CHECK(!slot.Read(s));
+    CHECK(s.seq == 99);
+    slot.Publish(Status{ 1, 100, 0.5f });
+    slot.Publish(Status{ 2, 200, 0.6f });
+    REQUIRE(slot.Read(s));
+    CHECK(s.seq == 2 && s.axisRaw == 200);
+    CHECK(!slot.Read(s));
+}
+
+// The reader never sees a torn value or an older one than it already saw.
+TEST(ConcurrentReadsSeeWholeIncreasingValues) {
+    SnapshotSlot<Status> slot;
+    const uint64_t kCount = 200000;
+    std::atomic<bool> done{false};
+    std::thread producer([&] {
+        for (uint64_t i = 1; i <= kCount; ++i) {
+            slot.Publish(Status{ i, (LONG)(i * 3), (float)(i % 1000) });
+            if (i % 64 == 0) std::this_thread::yield();
+        }
+        done = true;
+    });
+    uint64_t last = 0, reads = 0, torn = 0, backwards = 0;
+    Status s;
+    while (!done || last < kCount) {
+        if (!slot.Read(s)) {
+            std::this_thread::yield();
+            continue;
+        }
+        ++reads;
+        if (s.axisRaw != (LONG)(s.seq * 3) || s.volume != (float)(s.seq % 1000)) ++torn;
+        if (s.seq <= last) ++backwards;
+        last = s.seq;
+    }
+    producer.join();
+    CHECK(torn == 0);
+    CHECK(backwards == 0);
+    CHECK(last == kCount);
+    CHECK(reads > 0);
+}
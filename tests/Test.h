@@ -0,0 +1,32 @@
+#pragma once
+#include <stdio.h>
+#include <chrono>
+#include <thread>
+
+// A small test harness with no dependencies. TEST(Name) { ... } registers a case;
+// CHECK records a failure and carries on, REQUIRE also ends the case. Each tests/*.cpp
+// is its own executable linked with TestMain.cpp; give it case names to run only those.
+namespace test {
+typedef void (*CaseFn)();
+struct Register {
+    Register(const char* name, CaseFn fn);
+};
+void Fail(const char* file, int line, const char* what);
+
+// Polls cond until it holds or timeoutMs passes; for results another thread produces.
+template<typename Cond> bool WaitFor(Cond cond, int timeoutMs = 2000) {
+    auto deadline = std::chrono::steady_clock::now() + std::chrono::milliseconds(timeoutMs);
+    while (!cond()) {
+        if (std::chrono::steady_clock::now() > deadline) return false;
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+    return true;
+}
+}
+
+#define TEST(name) \
+    static void name(); \
+    static test::Register name##_register(#name, &name); \
+    static void name()
+#define CHECK(cond) do { if (!(cond)) test::Fail(__FILE__, __LINE__, #cond); } while (0)
+#define REQUIRE(cond) do { if (!(cond)) { test::Fail(__FILE__, __LINE__, #cond); return; } } while (0)
@@ -0,0 +1,50 @@
+#include "Test.h"
+#include <string.h>
+#include <vector>
+#include "log.h"
+
+namespace {
+struct Case {
+    const char* name;
+    test::CaseFn fn;
+};
+
+std::vector<Case>& Cases() {
+    static std::vector<Case> cases;
+    return cases;
+}
+
+int g_failures = 0;
+}
+
+test::Register::Register(const char* name, CaseFn fn) {
+    Cases().push_back(Case{ name, fn });
+}
+
+void test::Fail(const char* file, int line, const char* what) {
+    printf("  %s:%d: CHECK failed: %s\n", file, line, what);
+    fflush(stdout);
+    ++g_failures;
+}
+
+int main(int argc, char** argv) {
+    SetLogLevel(LogLevel::Warn);
+    int failed = 0, run = 0;
+    for (const Case& c : Cases()) {
+        bool selected = argc < 2;
+        for (int i = 1; i < argc; ++i) selected = selected || strcmp(argv[i], c.name) == 0;
+        if (!selected) continue;
+        printf("%s\n", c.name);
+        fflush(stdout);
+        int before = g_failures;
+        c.fn();
+        ++run;
+        if (g_failures != before) {
+            printf("  FAILED\n");
+            ++failed;
+        }
+    }
+    StopLogging();
+    printf("%d of %d case(s) passed\n", run - failed, run);
+    return failed || !run ? 1 : 0;
+}